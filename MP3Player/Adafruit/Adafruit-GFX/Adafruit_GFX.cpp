@@ -34,7 +34,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "Adafruit_GFX.h"
 #include "glcdfont.c"
 
-void PrintToLcdWithBuf(char *buf, int size, char *format, ...);
+void PrintToLcdWithBuf(char *buf, int size, const char *format, ...);
 #define BUTTONBUFSIZE 16
 char buttonBuf[BUTTONBUFSIZE];
 
@@ -561,7 +561,7 @@ void Adafruit_GFX_Button::initButton(Adafruit_GFX *gfx,
 					  uint8_t w, uint8_t h, 
 					  uint16_t outline, uint16_t fill, 
 					  uint16_t textcolor,
-					  char *label, uint8_t textsize)
+					  const char *label, uint8_t textsize)
 {
   _x = x;
   _y = y;
@@ -99,7 +99,7 @@ class Adafruit_GFX_Button {
   void initButton(Adafruit_GFX *gfx, int16_t x, int16_t y, 
 		      uint8_t w, uint8_t h, 
 		      uint16_t outline, uint16_t fill, uint16_t textcolor,
-		      char *label, uint8_t textsize);
+		      const char *label, uint8_t textsize);
   void drawButton(boolean inverted = false);
   boolean contains(int16_t x, int16_t y);
 
@@ -16,9 +16,11 @@
 #include "Adafruit_ILI9341.h"
 #include <limits.h>
 #include "pjdf.h"
+#include "pjdfBind.h"
 
 void delay(uint32_t time);
 
+ili9341_fill_stats_t Adafruit_ILI9341::fillStats_;
 
 #define spi_begin()
 #define spi_end()
@@ -27,6 +29,7 @@ void delay(uint32_t time);
 Adafruit_ILI9341::Adafruit_ILI9341() : Adafruit_GFX(ILI9341_TFTWIDTH, ILI9341_TFTHEIGHT) {
     hLcd = 0;
     iSpiBuffer = 0;
+    windowPending = false;
 };
 
 
@@ -45,9 +48,25 @@ void Adafruit_ILI9341::setPjdfHandle(HANDLE hLcd) {
 }
 
 
+// Send the buffer; after setAddrWindow() together with the address window
+// commands, as one transaction with a single chip-select assertion.
 void Adafruit_ILI9341::spiFlush() {
-    if (iSpiBuffer > 0) {
-        Write(hLcd, spiBuffer, (uint32_t*) &iSpiBuffer);
+    if (windowPending) {
+        PjdfSegment segments[] = {
+            { &window[0], 1, PJDF_SEG_COMMAND },    // CASET
+            { &window[1], 4, PJDF_SEG_DATA },
+            { &window[5], 1, PJDF_SEG_COMMAND },    // PASET
+            { &window[6], 4, PJDF_SEG_DATA },
+            { &window[10], 1, PJDF_SEG_COMMAND },   // RAMWR
+            { spiBuffer, iSpiBuffer, PJDF_SEG_DATA },
+        };
+        WriteV(hLcd, segments, iSpiBuffer > 0 ? 6 : 5);
+        windowPending = false;
+        iSpiBuffer = 0;
+    }
+    else if (iSpiBuffer > 0) {
+        uint32_t length = iSpiBuffer;   // iSpiBuffer is a byte
+        Write(hLcd, spiBuffer, &length);
         iSpiBuffer = 0;
     }
 }
@@ -64,7 +83,7 @@ void Adafruit_ILI9341::spiWriteByte(uint8_t c) {
 
 void Adafruit_ILI9341::writecommand(uint8_t c) {
     spiFlush();
-    Ioctl(hLcd, PJDF_CTRL_LCD_SELECT_COMMAND, 0, 0);
+    BindLcdSelectCommand(hLcd);
     spiWriteByte(c);
     spiFlush();
 }
@@ -73,7 +92,7 @@ void Adafruit_ILI9341::writecommand(uint8_t c) {
 // write the given byte
 // Set CS high to deselect TFT chip
 void Adafruit_ILI9341::writedata(uint8_t c) {
-    Ioctl(hLcd, PJDF_CTRL_LCD_SELECT_DATA, 0, 0);
+    BindLcdSelectData(hLcd);
     spiWriteByte(c);
 } 
 
@@ -251,22 +270,26 @@ void Adafruit_ILI9341::begin(void) {
 }
 
 
+// The commands go out with the first pixel data, see spiFlush()
 void Adafruit_ILI9341::setAddrWindow(uint16_t x0, uint16_t y0, uint16_t x1,
  uint16_t y1) {
 
-  writecommand(ILI9341_CASET); // Column addr set
-  writedata(x0 >> 8);
-  writedata(x0 & 0xFF);     // XSTART 
-  writedata(x1 >> 8);
-  writedata(x1 & 0xFF);     // XEND
+  spiFlush();
 
-  writecommand(ILI9341_PASET); // Row addr set
-  writedata(y0>>8);
-  writedata(y0);     // YSTART
-  writedata(y1>>8);
-  writedata(y1);     // YEND
+  window[0] = ILI9341_CASET; // Column addr set
+  window[1] = x0 >> 8;
+  window[2] = x0 & 0xFF;     // XSTART 
+  window[3] = x1 >> 8;
+  window[4] = x1 & 0xFF;     // XEND
 
-  writecommand(ILI9341_RAMWR); // write to RAM
+  window[5] = ILI9341_PASET; // Row addr set
+  window[6] = y0>>8;
+  window[7] = y0;     // YSTART
+  window[8] = y1>>8;
+  window[9] = y1;     // YEND
+
+  window[10] = ILI9341_RAMWR; // write to RAM
+  windowPending = true;
 }
 
 
@@ -353,6 +376,10 @@ void Adafruit_ILI9341::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
   if((x + w - 1) >= _width)  w = _width  - x;
   if((y + h - 1) >= _height) h = _height - y;
 
+  uint32_t start = CYCLE_COUNT();
+  fillStats_.fills++;
+  fillStats_.pixels += (uint32_t)w * h;
+
   if (hwSPI) spi_begin();
   setAddrWindow(x, y, x+w-1, y+h-1);
 
@@ -367,6 +394,7 @@ void Adafruit_ILI9341::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
   }
   spiFlush();
   if (hwSPI) spi_end();
+  fillStats_.cycles += CYCLE_COUNT() - start;
 }
 
 
@@ -103,6 +103,13 @@
 
 #define ILI9341_SPIBUFLEN   128
 
+// fillRect() counters, fillScreen() included
+struct ili9341_fill_stats_t {
+  uint32_t fills;       // fillRect() calls that drew
+  uint32_t pixels;      // pixels they filled
+  uint64_t cycles;      // CYCLE_COUNT() cycles they took
+};
+
 class Adafruit_ILI9341 : public Adafruit_GFX {
 
  public:
@@ -141,11 +148,15 @@ class Adafruit_ILI9341 : public Adafruit_GFX {
   void writedata(uint8_t d);
   void commandList(uint8_t *addr);
   uint8_t  spiread(void);
+  static const ili9341_fill_stats_t& fillStats(void) {return fillStats_;}
 
  private:
+  static ili9341_fill_stats_t fillStats_;
   HANDLE hLcd;
   uint8_t spiBuffer[ILI9341_SPIBUFLEN];
   uint8_t iSpiBuffer; /* current SPI buffer empty ascending point */
+  uint8_t window[11]; /* CASET, x0, x1, PASET, y0, y1, RAMWR, sent by spiFlush() */
+  boolean windowPending;
   uint8_t  tabcolor;
 
  
@@ -0,0 +1,78 @@
+/*
+    clockGov.c
+
+    Clock governor, see clockGov.h.
+
+    The streaming loop and the touch task report activity with
+    ClockGovActivity(), which ramps the clock up right away so a song never
+    starts at 16 MHz. The touch task calls ClockGovPoll() while nothing is
+    touched; it ramps down after the idle timeout. Both switch while holding
+    the SPI1 lock so no MP3, SD or LCD transfer sees the clock change.
+*/
+
+#include "bsp.h"
+#include "print.h"
+#include "clockGov.h"
+
+static HANDLE hClockSpi;            // SPI1 handle, only used for its lock
+static INT32U lastActivity;         // OSTime of the last ClockGovActivity()
+
+
+static BOOLEAN ClockGovIdle(void)
+{
+    return OSTimeGet() - lastActivity >= APP_CFG_CLOCK_GOV_IDLE_TICKS;
+}
+
+// Switch speed with SPI1 idle
+static void ClockGovSwitch(ClockSpeed_t speed)
+{
+    PjdfErrCode retval;
+
+    retval = Ioctl(hClockSpi, PJDF_CTRL_SPI_WAIT_FOR_LOCK, 0, 0);
+    if (retval != PJDF_ERR_NONE) while(1);
+
+    // Activity may have been reported while waiting for the lock
+    if (speed == CLOCK_SPEED_80MHZ || ClockGovIdle())
+    {
+        ClockSetSpeed(speed);
+    }
+
+    retval = Ioctl(hClockSpi, PJDF_CTRL_SPI_RELEASE_LOCK, 0, 0);
+    if (retval != PJDF_ERR_NONE) while(1);
+}
+
+/*
+ NAME:
+   ClockGovInit
+ PURPOSE:
+   Open the SPI1 handle used to serialize clock switches with SPI
+   transfers. Called from StartupTask() after the tick is running.
+ */
+void ClockGovInit(void)
+{
+    hClockSpi = Open(PJDF_DEVICE_ID_SPI1, 0);
+    if (!PJDF_IS_VALID_HANDLE(hClockSpi)) while(1);
+
+    lastActivity = OSTimeGet();
+    ClockStatsReset();
+}
+
+// Playback or UI activity: make sure the CPU runs at full speed
+void ClockGovActivity(void)
+{
+    lastActivity = OSTimeGet();
+    if (APP_CFG_CLOCK_GOV_IDLE_TICKS > 0 && ClockGetSpeed() != CLOCK_SPEED_80MHZ)
+    {
+        ClockGovSwitch(CLOCK_SPEED_80MHZ);
+    }
+}
+
+// Drop to 16 MHz once nothing happened for APP_CFG_CLOCK_GOV_IDLE_TICKS
+void ClockGovPoll(void)
+{
+    if (APP_CFG_CLOCK_GOV_IDLE_TICKS > 0 &&
+        ClockGetSpeed() != CLOCK_SPEED_16MHZ && ClockGovIdle())
+    {
+        ClockGovSwitch(CLOCK_SPEED_16MHZ);
+    }
+}
@@ -0,0 +1,25 @@
+/*
+    clockGov.h
+
+    Clock governor: runs the CPU at 80 MHz while music is streaming or the
+    touch screen is in use and drops to 16 MHz once both have been idle for
+    APP_CFG_CLOCK_GOV_IDLE_TICKS (playback paused or halted, nobody
+    touching the screen).
+*/
+
+#ifndef __CLOCKGOV_H
+#define __CLOCKGOV_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void ClockGovInit(void);
+void ClockGovActivity(void);
+void ClockGovPoll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CLOCKGOV_H */
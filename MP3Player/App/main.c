@@ -20,11 +20,6 @@ Revision History:
 #include "print.h"
 //#include "button_ui.h"
  
-// Prototype for startup task
-void StartupTask(void* pdata);
-
-
-
 
 // Allocate a stack for the startup task
 static OS_STK StartupStk[APP_CFG_TASK_START_STK_SIZE];
@@ -8,10 +8,29 @@ Some utility functions for controlling the MP3 decoder.
 #include "bsp.h"
 #include "print.h"
 #include "SD.h"
+#include "clockGov.h"
 
 void delay(uint32_t time);
 
-static File dataFile;
+// Mp3StreamSDFile() fills one buffer from the SD card while the other is
+// written to the decoder by WriteAsync(). A buffer's flag is set while it
+// is free.
+#define MP3_STREAM_BUFS 2
+static INT8U mp3StreamBuf[MP3_STREAM_BUFS][MP3_DECODER_BUF_SIZE];
+static PjdfRequest mp3StreamReq[MP3_STREAM_BUFS];
+static OS_FLAG_GRP *mp3StreamFree;
+
+// A file stored in one run of blocks is read straight from the card, a
+// block at a time into mp3Block, rather than through the SD library's
+// cache, see Mp3StreamRead(). Like the buffers above, this belongs to the
+// one file streaming to the decoder; the file itself is Mp3StreamFile()'s
+// caller's.
+static BOOLEAN mp3Raw;
+static SdRawStream mp3RawStream;
+static INT8U mp3Block[512];
+static INT16U mp3BlockPos;      // bytes of mp3Block streamed
+static INT16U mp3BlockLen;      // bytes of the file in mp3Block
+static INT32U mp3RawLeft;       // bytes of the file not read into mp3Block yet
 
 // ------------------- MP3 Player Status Pointers -------------------
 extern BOOLEAN nextSong;
@@ -29,19 +48,6 @@ BOOLEAN resetVolume = OS_TRUE;
 
 static void Mp3StreamInit(HANDLE hMp3)
 {
-  INT32U length;
-  
-  // Place MP3 driver in command mode (subsequent writes will be sent to the decoder's command interface)
-  Ioctl(hMp3, PJDF_CTRL_MP3_SELECT_COMMAND, 0, 0);
-  
-  // Reset the device
-  length = BspMp3SoftResetLen;
-  Write(hMp3, (void*)BspMp3SoftReset, &length);
- 
-  // To allow streaming data, set the decoder mode to Play Mode
-  length = BspMp3PlayModeLen;
-  Write(hMp3, (void*)BspMp3PlayMode, &length);
-  
   /*
     Capture the Default Volume (BspMp3SetVol1010) and Place into our Custom One
     BspMp3SetVolCustom - Changes Based on User Input
@@ -59,11 +65,14 @@ static void Mp3StreamInit(HANDLE hMp3)
     resetVolume = OS_FALSE;
   }
   
-  // Length of Default Volume[]
-  length = BspMp3SetVol1010Len;
-  
-  // Set Volume: Write Our Custom Volume
-  Write(hMp3, (void*)BspMp3SetVolCustom, &length);
+  // Reset the device, set the decoder mode to Play Mode to allow streaming
+  // data, and set our custom volume: three commands in one transaction
+  PjdfSegment init[] = {
+    { (void*)BspMp3SoftReset, BspMp3SoftResetLen, PJDF_SEG_COMMAND },
+    { (void*)BspMp3PlayMode, BspMp3PlayModeLen, PJDF_SEG_COMMAND },
+    { (void*)BspMp3SetVolCustom, BspMp3SetVol1010Len, PJDF_SEG_COMMAND },
+  };
+  WriteV(hMp3, init, sizeof(init)/sizeof(init[0]));
   
    // Set MP3 driver to data mode (subsequent writes will be sent to decoder's data interface)
   Ioctl(hMp3, PJDF_CTRL_MP3_SELECT_DATA, 0, 0);
@@ -71,31 +80,97 @@ static void Mp3StreamInit(HANDLE hMp3)
   
 }
 
-// Mp3StreamSDFile
-// Streams the given file from the SD card to the given MP3 decoder.
-// hMP3: an open handle to the MP3 decoder
-// pFilename: The file on the SD card to stream. 
-void Mp3StreamSDFile(HANDLE hMp3, char *pFilename)
+// Mp3StreamOpen
+// Streams pFile raw if it is stored in one run of blocks
+static void Mp3StreamOpen(File *pFile)
 {
-  INT32U length;
+  uint32_t bgnBlock, endBlock;
   
-  Mp3StreamInit(hMp3);
-  
-  char printBuf[PRINTBUFMAX];
+  mp3BlockPos = mp3BlockLen = 0;
+  mp3RawLeft = pFile->size();
+  mp3Raw = mp3RawLeft > 0 && pFile->contiguousRange(&bgnBlock, &endBlock)
+    && mp3RawStream.begin(SdVolume::sdCard(), bgnBlock, bgnBlock + (mp3RawLeft - 1) / 512);
+}
+
+// Mp3StreamAvailable
+// Returns whether pFile has bytes left to stream
+static BOOLEAN Mp3StreamAvailable(File *pFile)
+{
+  if (!mp3Raw) return pFile->available() > 0;
+  return mp3RawLeft > 0 || mp3BlockPos < mp3BlockLen;
+}
+
+// Mp3StreamRead
+// Copies the next bytes of pFile, up to count, to pBuf. Returns the
+// count copied, zero at the end of the file or on a read error.
+static INT32U Mp3StreamRead(File *pFile, INT8U *pBuf, INT32U count)
+{
+  INT32U n = 0;
   
-  // Open File
-  dataFile = SD.open(pFilename, O_READ);
+  if (!mp3Raw)
+  {
+    // one call, one hold of the SD volume lock
+    int got = pFile->read(pBuf, count);
+    return got > 0 ? got : 0;
+  }
   
-  if (!dataFile) 
+  while (n < count)
   {
-    PrintWithBuf(printBuf, PRINTBUFMAX, "Error: could not open SD card file '%s'\n", pFilename);
-    return;
+    if (mp3BlockPos == mp3BlockLen)
+    {
+      if (mp3RawLeft == 0) break;
+      SdVolume::lock();
+      BOOLEAN ok = mp3RawStream.read(mp3Block);
+      SdVolume::unlock();
+      if (!ok)
+      {
+        // the rest of the song is lost
+        mp3RawLeft = 0;
+        break;
+      }
+      mp3BlockLen = mp3RawLeft < sizeof(mp3Block) ? mp3RawLeft : sizeof(mp3Block);
+      mp3RawLeft -= mp3BlockLen;
+      mp3BlockPos = 0;
+    }
+    INT32U chunk = count - n;
+    if (chunk > (INT32U)(mp3BlockLen - mp3BlockPos)) chunk = mp3BlockLen - mp3BlockPos;
+    memcpy(pBuf + n, mp3Block + mp3BlockPos, chunk);
+    mp3BlockPos += chunk;
+    n += chunk;
   }
+  return n;
+}
+
+// Mp3StreamFile
+// Streams a file already open on the SD card, e.g. by openNextFile(), to
+// the given MP3 decoder, with no second search for it by name.
+// hMP3: an open handle to the MP3 decoder
+// pFile: the file, open and at its start. The caller closes it.
+void Mp3StreamFile(HANDLE hMp3, File *pFile)
+{
+  // Ramp the clock up before streaming
+  ClockGovActivity();
   
-  INT8U mp3Buf[MP3_DECODER_BUF_SIZE];
+  Mp3StreamInit(hMp3);
+  
+  INT8U osErr;
+  INT8U iBuf = 0;
   INT32U iBufPos = 0;
+  
+  if (mp3StreamFree == NULL)
+  {
+    mp3StreamFree = OSFlagCreate((1u << MP3_STREAM_BUFS) - 1u, &osErr);
+    if (osErr != OS_ERR_NONE) while (1);
+    for (INT8U i = 0; i < MP3_STREAM_BUFS; i++)
+    {
+      mp3StreamReq[i].pBuffer = mp3StreamBuf[i];
+      mp3StreamReq[i].pDoneFlags = mp3StreamFree;
+      mp3StreamReq[i].doneFlags = 1u << i;
+    }
+  }
  
-  while (dataFile.available())
+  Mp3StreamOpen(pFile);
+  while (Mp3StreamAvailable(pFile))
   {
     
     if(stopSong)
@@ -105,15 +180,23 @@ void Mp3StreamSDFile(HANDLE hMp3, char *pFilename)
     }
     else
     {
-      iBufPos = 0;
-      while (dataFile.available() && iBufPos < MP3_DECODER_BUF_SIZE)
+      // Keep the clock up while playing, also after a pause
+      ClockGovActivity();
+      
+      // Wait for the decoder to be done with this buffer
+      OSFlagPend(mp3StreamFree, 1u << iBuf, OS_FLAG_WAIT_SET_ALL + OS_FLAG_CONSUME, 0, &osErr);
+      
+      iBufPos = Mp3StreamRead(pFile, mp3StreamBuf[iBuf], MP3_DECODER_BUF_SIZE);
+      if (iBufPos == 0)
       {
-        mp3Buf[iBufPos] = dataFile.read();
-        
-        iBufPos++;
+        // read error: give the buffer back and end the song
+        OSFlagPost(mp3StreamFree, 1u << iBuf, OS_FLAG_SET, &osErr);
+        break;
       }
       
-      Write(hMp3, mp3Buf, &iBufPos);
+      mp3StreamReq[iBuf].length = iBufPos;
+      WriteAsync(hMp3, &mp3StreamReq[iBuf]);
+      iBuf = (iBuf + 1) % MP3_STREAM_BUFS;
      
       // Skip Song if NextSong or PrevSong are True
       if (nextSong)
@@ -132,11 +215,37 @@ void Mp3StreamSDFile(HANDLE hMp3, char *pFilename)
     
   }
   
-  dataFile.close();
+  if (mp3Raw)
+  {
+    SdVolume::lock();
+    mp3RawStream.end();
+    SdVolume::unlock();
+  }
   
-  Ioctl(hMp3, PJDF_CTRL_MP3_SELECT_COMMAND, 0, 0);
-  length = BspMp3SoftResetLen;
-  Write(hMp3, (void*)BspMp3SoftReset, &length);
+  // Reset the device, once the buffers still queued are written
+  PjdfSegment reset = { (void*)BspMp3SoftReset, BspMp3SoftResetLen, PJDF_SEG_COMMAND };
+  WriteV(hMp3, &reset, 1);
+}
+
+// Mp3StreamSDFile
+// Streams the given file from the SD card to the given MP3 decoder.
+// hMP3: an open handle to the MP3 decoder
+// pFilename: The file on the SD card to stream. 
+void Mp3StreamSDFile(HANDLE hMp3, char *pFilename)
+{
+  char printBuf[PRINTBUFMAX];
+  
+  // Open File
+  File dataFile = SD.open(pFilename, O_READ);
+  
+  if (!dataFile) 
+  {
+    PrintWithBuf(printBuf, PRINTBUFMAX, "Error: could not open SD card file '%s'\n", pFilename);
+    return;
+  }
+  
+  Mp3StreamFile(hMp3, &dataFile);
+  dataFile.close();
 }
 
 // Mp3Stream
@@ -156,6 +265,8 @@ void Mp3Stream(HANDLE hMp3, INT8U *pBuf, INT32U bufLen)
   
   chunkLen = MP3_DECODER_BUF_SIZE;
   
+  ClockGovActivity();
+  
   while (!done)
   {
     
@@ -166,6 +277,8 @@ void Mp3Stream(HANDLE hMp3, INT8U *pBuf, INT32U bufLen)
     }
     else
     {      
+      ClockGovActivity();
+      
       // detect last chunk of pBuf
       if (bufLen - iBufPos < MP3_DECODER_BUF_SIZE)
       {
@@ -245,23 +358,14 @@ PjdfErrCode Mp3GetRegister(HANDLE hMp3, INT8U *cmdInDataOut, INT32U bufLen)
 
 void Mp3VolumeUpDown(HANDLE hMp3)
 {
-    INT32U length;
-    
-    // Write To Chip
-    Ioctl(hMp3, PJDF_CTRL_MP3_SELECT_COMMAND, 0, 0);
-    
     // Modify The Volume
     BspMp3SetVolCustom[2] = DefVolume;
     BspMp3SetVolCustom[3] = DefVolume;
 
-    // Get the Length
-    length = BspMp3SetVol1010Len;
-    
-    // Write To vs1053 Chip    
-    Write(hMp3, (void*)BspMp3SetVolCustom, &length);
-    
-    // Switch Back to Select Data.
-    Ioctl(hMp3, PJDF_CTRL_MP3_SELECT_DATA, 0, 0);   
+    // Write To vs1053 Chip as a command segment: the data mode of a song
+    // streaming in another task stays selected throughout
+    PjdfSegment volume = { (void*)BspMp3SetVolCustom, BspMp3SetVol1010Len, PJDF_SEG_COMMAND };
+    WriteV(hMp3, &volume, 1);
 }
 
 
@@ -10,12 +10,14 @@
 #ifndef __MP3UTIL_H
 #define __MP3UTIL_H
 
+class File;
 
 PjdfErrCode Mp3GetRegister(HANDLE hMp3, INT8U *cmdInDataOut, INT32U bufLen);
 void Mp3Init(HANDLE hMp3);
 void Mp3Test(HANDLE hMp3);
 void Mp3Stream(HANDLE hMp3, INT8U *pBuf, INT32U bufLen);
 void Mp3StreamSDFile(HANDLE hMp3, char *pFilename);
+void Mp3StreamFile(HANDLE hMp3, File *pFile);
 
 void Mp3VolumeUpDown(HANDLE hMp3);
 
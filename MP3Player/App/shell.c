@@ -11,12 +11,21 @@
 
 #include "bsp.h"
 #include "print.h"
+#include "SdFat.h"
 
 #define BUFSIZE 256
-#define ARRAYCOUNT(array) (sizeof(array)/sizeof(*array))
+#define SHELL_CRC_RUNS 16       // timings sdcrc takes the fastest of
+#define ARRAYCOUNT(array) ((int)(sizeof(array)/sizeof(*array)))
 
 static void PJShellcd(char *dir);
 static void PJShellls(void);
+static void PJShelltrace(char *arg);
+static void PJShellcrit(char *arg);
+static void PJShellpower(char *arg);
+static void PJShellclock(char *arg);
+static void PJShellpjdf(char *arg);
+static void PJShellsdcache(void);
+static void PJShellsdcrc(void);
 
 
 // Define command strings here
@@ -24,6 +33,13 @@ static const char *CmdList[] =
 {
 	"cd",
 	"ls",
+	"trace",
+	"crit",
+	"power",
+	"clock",
+	"pjdf",
+	"sdcache",
+	"sdcrc",
 };
 
 static int cmdLen[ARRAYCOUNT(CmdList)];
@@ -32,6 +48,13 @@ typedef enum
 {
 	CommandEnumcd,
 	CommandEnumls,
+	CommandEnumtrace,
+	CommandEnumcrit,
+	CommandEnumpower,
+	CommandEnumclock,
+	CommandEnumpjdf,
+	CommandEnumsdcache,
+	CommandEnumsdcrc,
 	CommandEnumInvalid
 }CommandEnum_t;
 
@@ -120,6 +143,27 @@ void PJShellEntry(void *pArg)
 		case CommandEnumls:
 			PJShellls();
 			break;
+		case CommandEnumtrace:
+			PJShelltrace(&cmdLine[cmdLen[CommandEnumtrace]] + 1);
+			break;
+		case CommandEnumcrit:
+			PJShellcrit(&cmdLine[cmdLen[CommandEnumcrit]] + 1);
+			break;
+		case CommandEnumpower:
+			PJShellpower(&cmdLine[cmdLen[CommandEnumpower]] + 1);
+			break;
+		case CommandEnumclock:
+			PJShellclock(&cmdLine[cmdLen[CommandEnumclock]] + 1);
+			break;
+		case CommandEnumpjdf:
+			PJShellpjdf(&cmdLine[cmdLen[CommandEnumpjdf]] + 1);
+			break;
+		case CommandEnumsdcache:
+			PJShellsdcache();
+			break;
+		case CommandEnumsdcrc:
+			PJShellsdcrc();
+			break;
 		default:
 			PrintString("  invalid command\r\n");
 			break;
@@ -141,3 +185,245 @@ static void PJShellls()
 }
 
 
+/*
+ NAME:
+   PJShelltrace
+ PURPOSE:
+   Control the kernel trace recorder: "trace start", "trace stop" or
+   "trace dump". The dump is binary, capture it with a terminal log and
+   convert it with Tools/trace2json.py.
+ PARAMETERS:
+   arg: text following the command name
+ RETURN:
+   none
+ */
+static void PJShelltrace(char *arg)
+{
+#if OS_TRACE_EN > 0u
+	if (!strncmp(arg, "start", 5))
+	{
+		TraceStart();
+	}
+	else if (!strncmp(arg, "stop", 4))
+	{
+		TraceStop();
+	}
+	else if (!strncmp(arg, "dump", 4))
+	{
+		TraceDump();
+		PrintString("\n");
+	}
+	else
+	{
+		PrintString("  usage: trace start|stop|dump\n");
+	}
+#else
+	PrintString("  trace recorder disabled (OS_TRACE_EN)\n");
+#endif
+}
+
+
+/*
+ NAME:
+   PJShellcrit
+ PURPOSE:
+   Print the OS_ENTER_CRITICAL() duration histogram and worst call sites,
+   or clear them with "crit reset".
+ PARAMETERS:
+   arg: text following the command name
+ RETURN:
+   none
+ */
+static void PJShellcrit(char *arg)
+{
+#if OS_CRITICAL_MEAS_EN > 0u
+	if (!strncmp(arg, "reset", 5))
+	{
+		CritMeasReset();
+	}
+	else
+	{
+		CritMeasPrint(10);
+	}
+#else
+	PrintString("  critical section measurement disabled (OS_CRITICAL_MEAS_EN)\n");
+#endif
+}
+
+
+/*
+ NAME:
+   PJShellpower
+ PURPOSE:
+   Print the tickless idle wakeup rate and SLEEP/STOP residency, or clear
+   the statistics with "power reset".
+ PARAMETERS:
+   arg: text following the command name
+ RETURN:
+   none
+ */
+static void PJShellpower(char *arg)
+{
+#if OS_TICKLESS_EN > 0u
+	if (!strncmp(arg, "reset", 5))
+	{
+		PowerStatsReset();
+	}
+	else
+	{
+		PowerStatsPrint();
+	}
+#else
+	PrintString("  tickless idle disabled (OS_TICKLESS_EN)\n");
+#endif
+}
+
+
+/*
+ NAME:
+   PJShellclock
+ PURPOSE:
+   Print the time spent at 16 MHz and 80 MHz, or clear it with
+   "clock reset".
+ PARAMETERS:
+   arg: text following the command name
+ RETURN:
+   none
+ */
+static void PJShellclock(char *arg)
+{
+	if (!strncmp(arg, "reset", 5))
+	{
+		ClockStatsReset();
+	}
+	else
+	{
+		ClockStatsPrint();
+	}
+}
+
+
+/*
+ NAME:
+   PJShellpjdf
+ PURPOSE:
+   Print the PJDF counters of every device: calls, bytes, time in the
+   driver and waiting for the device, errors. "pjdf reset" clears them.
+ PARAMETERS:
+   arg: text following the command name
+ RETURN:
+   none
+ */
+static void PJShellpjdf(char *arg)
+{
+	char buf[PRINTBUFMAX];
+	PjdfDeviceStats stats;
+	const char *pName;
+	INT8U i;
+
+	if (!strncmp(arg, "reset", 5))
+	{
+		PjdfClearStats();
+		return;
+	}
+
+	PrintWithBuf(buf, sizeof(buf), "  %-18s %7s %7s %7s %8s %8s %8s %7s %7s %4s\n", "device", "reads", "writes",
+	             "ioctls", "KB rd", "KB wr", "busy ms", "max us", "wait ms", "err");
+	for (i = 0; (pName = PjdfGetStatsAt(i, &stats)) != NULL; i++)
+	{
+		PrintWithBuf(buf, sizeof(buf), "  %-18s %7u %7u %7u %8u %8u %8u %7u %7u %4u\n", pName,
+		             stats.reads, stats.writes, stats.ioctls,
+		             (INT32U)(stats.bytesRead >> 10), (INT32U)(stats.bytesWritten >> 10),
+		             (INT32U)(stats.busyUs / 1000u), stats.maxBusyUs, (INT32U)(stats.waitUs / 1000u), stats.errors);
+	}
+}
+
+
+/*
+ NAME:
+   PJShellsdcache
+ PURPOSE:
+   Print the SD library block cache counters: FAT and data lookups found
+   in the cache and read from the card, dirty blocks written to make room,
+   what the read-ahead of files being read fetched, the directory entries
+   opens by name read, and how long tasks waited for the volume lock.
+ PARAMETERS:
+   none
+ RETURN:
+   none
+ */
+static void PJShellsdcache(void)
+{
+	char buf[PRINTBUFMAX];
+	cache_stats_t stats;
+
+	SdVolume::lock();
+	stats = SdVolume::cacheStats();
+	SdVolume::unlock();
+
+	PrintWithBuf(buf, sizeof(buf), "  %d slots, %d for the FAT\n", SD_CACHE_SLOTS, SD_CACHE_FAT_SLOTS);
+	PrintWithBuf(buf, sizeof(buf), "  FAT  %10u hits %8u misses\n", stats.fatHits, stats.fatMisses);
+	PrintWithBuf(buf, sizeof(buf), "  data %10u hits %8u misses\n", stats.dataHits, stats.dataMisses);
+	PrintWithBuf(buf, sizeof(buf), "  %u write-backs\n", stats.writeBacks);
+	PrintWithBuf(buf, sizeof(buf), "  %u chain walks\n", stats.chainWalks);
+	PrintWithBuf(buf, sizeof(buf), "  read-ahead %u fills %u blocks %u unread\n",
+		stats.aheadFills, stats.aheadBlocks, stats.aheadUnused);
+	PrintWithBuf(buf, sizeof(buf), "  names %u opens %u entries read, %d indexes of %d slots\n",
+		stats.nameLookups, stats.nameEntries, SD_NAME_INDEXES, SD_NAME_INDEX_SLOTS);
+	PrintWithBuf(buf, sizeof(buf), "  lock %u waits of %u, %u us at most, held %u us at most\n",
+		stats.lockWaits, stats.locks, stats.maxLockWaitUs, stats.maxLockHoldUs);
+}
+
+
+/*
+ NAME:
+   PJShellsdcrc
+ PURPOSE:
+   Print whether the SD library checks CRCs (SD_CRC in Sd2Card.h), the
+   blocks read that failed the check and the reads given up, the SCK the
+   CRC checked reads of SD.calibrate() settled on, and time the
+   CRC16 of a 512 byte block and the CRC7 of a command on this CPU: the
+   fastest of SHELL_CRC_RUNS, so that interrupts and other tasks do not
+   count.
+ PARAMETERS:
+   none
+ RETURN:
+   none
+ */
+static void PJShellsdcrc(void)
+{
+	static INT8U block[512];
+	char buf[PRINTBUFMAX];
+	card_stats_t stats;
+	card_cal_t cal;
+	INT32U start, cycles, cycles16 = 0xFFFFFFFF, cycles7 = 0xFFFFFFFF;
+	INT32U i;
+
+	for (i = 0; i < sizeof(block); i++) block[i] = (INT8U)(i * 7);
+	for (i = 0; i < SHELL_CRC_RUNS; i++)
+	{
+		start = CYCLE_COUNT();
+		sdCrc16(0, block, sizeof(block));
+		cycles = CYCLE_COUNT() - start;
+		if (cycles < cycles16) cycles16 = cycles;
+
+		start = CYCLE_COUNT();
+		sdCrc7(&block[i], 5);
+		cycles = CYCLE_COUNT() - start;
+		if (cycles < cycles7) cycles7 = cycles;
+	}
+
+	SdVolume::lock();
+	stats = Sd2Card::cardStats();
+	cal = Sd2Card::calibration();
+	SdVolume::unlock();
+
+	PrintWithBuf(buf, sizeof(buf), "  CRCs %s, %u blocks failed the check, %u bad start tokens, %u reads given up\n",
+		SD_CRC ? "on" : "off", stats.crcErrors, stats.tokenErrors, stats.crcFailures);
+	PrintWithBuf(buf, sizeof(buf), "  SCK %u kHz in %u steps, card rated %u kHz%s, %u kHz failed; %u KB/s read\n",
+		cal.sckHz / 1000, cal.steps, cal.cardHz / 1000, cal.highSpeed ? " at high speed" : "",
+		cal.failedHz / 1000, cal.bytesPerSec / 1000);
+	PrintWithBuf(buf, sizeof(buf), "  CRC16 of a block %u cycles, %u.%u us; CRC7 of a command %u cycles\n",
+		cycles16, cycles16 / (SystemCoreClock / 1000000u), cycles16 * 10 / (SystemCoreClock / 1000000u) % 10,
+		cycles7);
+}
@@ -23,14 +23,19 @@
 
 // ----------------------- Libraries -----------------------
 #include <stdarg.h>
+#include <stdint.h>
 #include "bsp.h"
 #include "print.h"
 #include "mp3Util.h"
+#include "clockGov.h"
 #include "SD.h"
 #include <Adafruit_GFX.h>    // Core graphics library
 #include <Adafruit_ILI9341.h>
 #include <Adafruit_FT6206.h>
 #include "train_crossing.h" // Non-SD Card
+#ifdef PJDF_SIM
+#include "sim.h"
+#endif
 
 // ----------------------- Directives -----------------------
 #define PENRADIUS 3
@@ -96,7 +101,7 @@ long MapTouchToScreen(long x, long in_min, long in_max, long out_min, long out_m
 // Function : PrintToLcdWithBuf()
 // Purpose : Print Information Given . Debugging 
 // Return : void
-void PrintToLcdWithBuf(char *buf, int size, char *format, ...);
+void PrintToLcdWithBuf(char *buf, int size, const char *format, ...);
 
 void *qMusicStatus[QUEUE_CAPACITY]; 
 
@@ -130,8 +135,9 @@ OS_EVENT * mstatus_Change; // Display Current State of Music Status during inter
 OS_EVENT * volume_Change; // Display Volume Change
 OS_EVENT *queueMusic; // Display Current Music and Status
 
-// Available Previous Files
-File prevFiles[CAPACITY];
+// Available Previous Files: where their directory entries are, to open
+// them again with no directory search
+FileEntry prevFiles[CAPACITY];
 
 typedef enum
 {
@@ -171,6 +177,7 @@ void StartupTask(void* pdata)
   
   PjdfErrCode pjdfErr;
   INT32U length;
+  INT8U err;
   static HANDLE hSD = 0;
   static HANDLE hSPI = 0;
   
@@ -215,6 +222,20 @@ void StartupTask(void* pdata)
   if (!SD.begin(hSD)) {
     PrintWithBuf(buf, PRINTBUFMAX, "Attempt to initialize SD card failed.\n");
   }
+  // The fastest SPI clock the card and the board manage, found at 80 MHz
+  // where the prescaler steps reach highest
+  else if (SD.calibrate()) {
+    const card_cal_t &cal = Sd2Card::calibration();
+    PrintWithBuf(buf, PRINTBUFMAX, "SD card: SCK %u kHz (card %u kHz%s), %u.%02u MB/s\n",
+      cal.sckHz / 1000, cal.cardHz / 1000, cal.highSpeed ? ", high speed" : "",
+      cal.bytesPerSec / 1000000, cal.bytesPerSec / 10000 % 100);
+  }
+  else {
+    PrintWithBuf(buf, PRINTBUFMAX, "SD card calibration failed, SCK limit %u kHz.\n", SD_SPI_MAX_HZ / 1000);
+  }
+  
+  // Run at 16 MHz while the player is idle
+  ClockGovInit();
   
   // Create the test tasks
   PrintWithBuf(buf, BUFSIZE, "StartupTask: Creating the application tasks\n");
@@ -225,17 +246,27 @@ void StartupTask(void* pdata)
   
   
   // ------------------------------ Task Creation ------------------------------
-  OSTaskCreate(LcdTouchTask, (void*)0, &LcdTouchTaskStk[APP_CFG_TASK_START_STK_SIZE-1], task_prio++);
+  // Named for the debugger and for the CPU use per task of the host benchmark
+  OSTaskCreate(LcdTouchTask, (void*)0, &LcdTouchTaskStk[APP_CFG_TASK_START_STK_SIZE-1], task_prio);
+  OSTaskNameSet(task_prio++, (INT8U*)"LcdTouchTask", &err);
   
   /* TODO NO-SD CARD
   OSTaskCreate(Mp3DemoTask, (void*)0, &Mp3DemoTaskStk[APP_CFG_TASK_START_STK_SIZE-1], task_prio++);
   */
   
-  OSTaskCreate(Mp3SDTask, (void*)0, &Mp3SDTaskStk[APP_CFG_TASK_START_STK_SIZE-1], task_prio++);
+  OSTaskCreate(Mp3SDTask, (void*)0, &Mp3SDTaskStk[APP_CFG_TASK_START_STK_SIZE-1], task_prio);
+  OSTaskNameSet(task_prio++, (INT8U*)"Mp3SDTask", &err);
+  
+  OSTaskCreate(ControlTask, (void*)0, &ControlTaskStk[APP_CFG_TASK_START_STK_SIZE-1], task_prio);
+  OSTaskNameSet(task_prio++, (INT8U*)"ControlTask", &err);
   
-  OSTaskCreate(ControlTask, (void*)0, &ControlTaskStk[APP_CFG_TASK_START_STK_SIZE-1], task_prio++);
+  OSTaskCreate(DisplayTask, (void*)0, &DisplayTaskStk[APP_CFG_TASK_START_STK_SIZE-1], task_prio);
+  OSTaskNameSet(task_prio++, (INT8U*)"DisplayTask", &err);
   
-  OSTaskCreate(DisplayTask, (void*)0, &DisplayTaskStk[APP_CFG_TASK_START_STK_SIZE-1], task_prio++);
+#ifdef PJDF_SIM
+  // SD library stress readers of the Linux build, if asked for (-r)
+  SimSDStressStart();
+#endif
   
   // Delete Task 
   OSTaskDel(OS_PRIO_SELF);
@@ -261,7 +292,7 @@ static void DrawLcdContents()
   
 }
 
-void DisplaySong(char* string, INT16S x, INT16S y, INT16S w, INT16S h)
+void DisplaySong(const char* string, INT16S x, INT16S y, INT16S w, INT16S h)
 {
   char buf[BUFSIZE];
   OS_CPU_SR cpu_sr;
@@ -288,8 +319,6 @@ RUN SD TASK CODE
 
 void Mp3SDTask(void* pdata)
 {
-  INT8U err;
-  
   PjdfErrCode pjdfErr;
   INT32U length;
   
@@ -318,14 +347,14 @@ void Mp3SDTask(void* pdata)
   int count = 0;
   
   // We are Halted By Default
-  char *music_status = "Halting";
+  const char *music_status = "Halting";
   
   // Notify DisplayTask of Messsage Queue, need to be extracted
   Read_Update = OS_TRUE;
   
   // "Halting" inserted for Name and Status To be Displayed  
-  err = OSQPost(queueMusic, (void*)music_status); // Display Name
-  err = OSQPost(queueMusic, (void*)music_status); // Display Music Status
+  OSQPost(queueMusic, (void*)music_status); // Display Name
+  OSQPost(queueMusic, (void*)music_status); // Display Music Status
   
   
   File dir = SD.open("/");
@@ -374,7 +403,7 @@ void Mp3SDTask(void* pdata)
             
             // Get File using the  Lp_Counter 
             // Lp_Counter - Least Previous Counter
-            entry = prevFiles[lp_counter];
+            entry = SD.open(prevFiles[lp_counter]);
             
             // Play Song 
             PrintWithBuf(buf, BUFSIZE, "\nP-Begin streaming isr file: %d \n", lp_counter);       
@@ -402,7 +431,7 @@ void Mp3SDTask(void* pdata)
                 
                 // Only Play when Lpcounter != at_counter
                 // Get File using Lp_Counter 
-                entry = prevFiles[lp_counter];
+                entry = SD.open(prevFiles[lp_counter]);
                 
                 // Play Song 
                 PrintWithBuf(buf, BUFSIZE, "\nNP-Begin streaming isr file: %d\n", lp_counter);   
@@ -422,12 +451,16 @@ void Mp3SDTask(void* pdata)
           Read_Update = OS_TRUE;
           
           // Display Name
-          err = OSQPost(queueMusic, (void*)entry.name()); 
+          OSQPost(queueMusic, (void*)entry.name()); 
           // Display Music Status
-          err = OSQPost(queueMusic, (void*)music_status); 
+          OSQPost(queueMusic, (void*)music_status); 
           
           // Stream a given File, based on Above Condition
-          Mp3StreamSDFile(hMp3, entry.name());          
+          if (entry)
+          {
+            Mp3StreamFile(hMp3, &entry);
+            entry.close();
+          }
           
           PrintWithBuf(buf, BUFSIZE, "\nDone streaming isr file at LP: %d", lp_counter);
           
@@ -455,12 +488,12 @@ void Mp3SDTask(void* pdata)
           Read_Update = OS_TRUE;
           
           // Display Name
-          err = OSQPost(queueMusic, (void*)entry.name()); 
+          OSQPost(queueMusic, (void*)entry.name()); 
           // Display Music Status
-          err = OSQPost(queueMusic, (void*)music_status); 
+          OSQPost(queueMusic, (void*)music_status); 
           
           // Stream a given File
-          Mp3StreamSDFile(hMp3, entry.name()); 
+          Mp3StreamFile(hMp3, &entry); 
           
           PrintWithBuf(buf, BUFSIZE, "\nDone streaming sd file  count=%d\n", ++count);    
           
@@ -474,10 +507,11 @@ void Mp3SDTask(void* pdata)
           counter = counter % CAPACITY; 
           
           // Store this played / Interrupted File at prevFiles[]
-          prevFiles[counter] = entry;
-          
-          // Increment Counter, There is something In Previous List . prevFiles[]
-          counter++;
+          if (entry.getEntry(&prevFiles[counter]))
+          {
+            // Increment Counter, There is something In Previous List . prevFiles[]
+            counter++;
+          }
           
           // This was Next Button CLick / Assertion
           if(nextSong) 
@@ -545,18 +579,15 @@ void ControlTask(void* pdata)
     ButtonControlsEnum* value = BtnControl_type;
     
     // Display its Value: Debugging Display
-    PrintWithBuf(buf, BUFSIZE,"Value: %d \t %d \n", value, (*value));
+    PrintWithBuf(buf, BUFSIZE,"Value: %d \n", (int)(intptr_t)value);
     
-    char *music_status;
+    const char *music_status;
     
     char volumeDigit[7];
     
     INT8U displayVolume;
     
-    // Get The CPU Status
-    OS_CPU_SR  cpu_sr;
-    
-    switch((int)BtnControl_type)
+    switch((int)(intptr_t)BtnControl_type)
     {
     case VOLUP_COMMAND:
       
@@ -573,13 +604,9 @@ void ControlTask(void* pdata)
         // Increase Volume by decrementing it to 0x00 or 0
         DefVolume =  DefVolume - 0xA; // subtract 10
         
-        // We need to set the volume, uninterrupted, otherwise it won't work
-        OS_ENTER_CRITICAL();
-        
-        // See mp3Util.c for its implementation
+        // See mp3Util.c for its implementation. It can block: WriteV()
+        // takes the SPI1 lock, which keeps song data out of the command.
         Mp3VolumeUpDown(hMp3);
-        
-        OS_EXIT_CRITICAL();
       }
       
       // Need to Display Updated Volume
@@ -615,13 +642,9 @@ void ControlTask(void* pdata)
         // Decrease Volume, by increasing it to 0x64
         DefVolume =  DefVolume + 0xA; // Add 10
         
-        // We need to set the volume, uninterrupted, otherwise it won't work
-        OS_ENTER_CRITICAL();
-        
+        // See mp3Util.c for its implementation. It can block: WriteV()
+        // takes the SPI1 lock, which keeps song data out of the command.
         Mp3VolumeUpDown(hMp3);
-        
-        // See mp3Util.c for its implementation
-        OS_EXIT_CRITICAL();
       }
       
       // Need to Display Updated Volume
@@ -736,9 +759,9 @@ void DisplayTask(void* pdata)
   
   INT16U rdOnce = 0; // Read Once
   
-  char *display_name;
-  char *display_status;
-  char *display_volume = "100 %%";
+  const char *display_name = "";
+  const char *display_status = "";
+  const char *display_volume = "100 %%";
   
   char buf[BUFSIZE];
   PrintWithBuf(buf, BUFSIZE,"Display Task building\n");
@@ -974,16 +997,25 @@ void LcdTouchTask(void* pdata)
   
   VolIncButton.press(0);
   
+#ifdef PJDF_SIM
+  // LCD filler of the Linux build's SPI hand-over test, if asked for (-y)
+  SimSpiYieldStart(hLcd);
+#endif
+  
   while (1) { 
     boolean touched;
     
     touched = touchCtrl.touched();
     
     if (! touched) {
+      ClockGovPoll();
       OSTimeDly(5);
       continue;
     }
     
+    // Redraw and button handling at full speed
+    ClockGovActivity();
+    
     TS_Point point;
     
     point = touchCtrl.getPoint();
@@ -1176,7 +1208,7 @@ void Mp3DemoTask(void* pdata)
   int count = 0;
   
   // We are Halted By Default
-  char *music_status = "Halting";
+  const char *music_status = "Halting";
   
   // Notify DisplayTask of Messsage Queue, need to be extracted
   Read_Update = OS_TRUE;
@@ -1224,7 +1256,7 @@ Print a formated string with the given buffer to LCD.
 Each task should use its own buffer to prevent data corruption.
 
 ************************************************************************************/
-void PrintToLcdWithBuf(char *buf, int size, char *format, ...)
+void PrintToLcdWithBuf(char *buf, int size, const char *format, ...)
 {
   va_list args;
   va_start(args, format);
@@ -55,8 +55,14 @@
 */
 
 //task priorities
+#define APP_TASK_SPI_MUTEX_PRIO             2   // priority inheritance priority of the SPI1 lock,
+                                                // above every task that uses SPI1
+#define APP_TASK_SD_MUTEX_PRIO              3   // priority inheritance priority of the SD volume lock,
+                                                // above every task that uses the SD library and below
+                                                // APP_TASK_SPI_MUTEX_PRIO, which its holder takes
 #define APP_TASK_START_PRIO                 4
 #define APP_TASK_TEST1_PRIO                 5
+#define APP_TASK_MP3_IO_PRIO                5   // serves WriteAsync() to the MP3 decoder, see PjdfAsyncInit()
 #define APP_TASK_TEST2_PRIO                 6
 #define APP_TASK_TEST3_PRIO                 7
 #define  OS_TASK_TMR_PRIO                (OS_LOWEST_PRIO - 2u)
@@ -72,6 +78,27 @@
 #define  APP_CFG_TASK_START_STK_SIZE            256u
 #define  APP_CFG_TASK_EQ_STK_SIZE               512u
 #define  APP_CFG_TASK_OBJ_STK_SIZE              256u
+#define  APP_CFG_TASK_PJDF_IO_STK_SIZE          256u
+
+
+/*
+*********************************************************************************************************
+*                                            TRACE RECORDER
+*                        Number of events kept by the trace ring buffer (power of 2)
+*********************************************************************************************************
+*/
+
+#define  APP_CFG_TRACE_BUF_SIZE                 512u
+
+
+/*
+*********************************************************************************************************
+*                                            CLOCK GOVERNOR
+*           Ticks without playback or touch activity before dropping to 16 MHz (0: stay at 80 MHz)
+*********************************************************************************************************
+*/
+
+#define  APP_CFG_CLOCK_GOV_IDLE_TICKS           3000u
 
 
 
@@ -37,6 +37,7 @@
 */
 
 #include  <ucos_ii.h>
+#include  <bsp.h>
 //#include  <stm32f4xx_hal.h>
 
 
@@ -152,6 +153,9 @@ void  App_TaskDelHook (OS_TCB *ptcb)
 #if OS_VERSION >= 251
 void  App_TaskIdleHook (void)
 {
+#if OS_TICKLESS_EN > 0u
+    PowerIdle();                                                /* Sleep until the next task delay expires  */
+#endif
 }
 #endif
 
@@ -213,6 +217,15 @@ void  App_TaskSwHook (void)
 {
 #if (APP_CFG_PROBE_OS_PLUGIN_EN > 0) && (OS_PROBE_HOOKS_EN > 0)
     OSProbe_TaskSwHook();
+#endif
+    OS_TRACE_TASK_SWITCHED_IN(OSTCBHighRdy);
+#if OS_TASK_PROFILE_EN > 0
+    {                                                           /* CPU cycles per task, the kernel only resets them     */
+        INT32U  cycles = CYCLE_COUNT();
+
+        OSTCBCur->OSTCBCyclesTot       += cycles - OSTCBCur->OSTCBCyclesStart;
+        OSTCBHighRdy->OSTCBCyclesStart  = cycles;
+    }
 #endif
 }
 #endif
@@ -29,6 +29,9 @@
                                        /* ---------------------- MISCELLANEOUS ----------------------- */
 #define OS_APP_HOOKS_EN           1u   /* Application-defined hooks are called from the uC/OS-II hooks */
 #define OS_ARG_CHK_EN             0u   /* Enable (1) or Disable (0) argument checking                  */
+#ifndef OS_CRITICAL_MEAS_EN            /* The Linux build sets it with make CRITMEAS=1 (Host/Makefile) */
+#define OS_CRITICAL_MEAS_EN       0u   /* Measure interrupt disabled time of OS_ENTER_CRITICAL() sites */
+#endif
 #define OS_CPU_HOOKS_EN           1u   /* uC/OS-II hooks are found in the processor port files         */
 
 #define OS_DEBUG_EN               0u   /* Enable(1) debug variables                                    */
@@ -48,10 +51,16 @@
 #define OS_SCHED_LOCK_EN          1u   /* Include code for OSSchedLock() and OSSchedUnlock()           */
 
 #define OS_TICK_STEP_EN           1u   /* Enable tick stepping feature for uC/OS-View                  */
+#define OS_TICK_DLY_LIST_EN       0u   /* Keep delayed tasks in a delta list: O(1) tick processing     */
+#define OS_TICKLESS_EN            0u   /* Suppress the tick while idle, see BSP/bspPower.c             */
 #define OS_TICKS_PER_SEC       1000u   /* Set the number of ticks in one second                        */
 
 #define OS_TLS_TBL_SIZE           0u   /* Size of Thread-Local Storage Table                           */
 
+#ifndef OS_TRACE_EN                    /* The Linux build sets it with make TRACE=1 (Host/Makefile)    */
+#define OS_TRACE_EN               0u   /* Enable (1) or Disable (0) the kernel event trace recorder    */
+#endif
+
 
                                        /* --------------------- TASK STACK SIZE ---------------------- */
 #define OS_TASK_TMR_STK_SIZE    128u   /* Timer      task stack size (# of OS_STK wide entries)        */
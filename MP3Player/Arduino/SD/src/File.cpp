@@ -68,6 +68,18 @@ char *File::name(void) {
   return _name;
 }
 
+// where the file's directory entry is, for SD.open(); false for the root
+// directory, which has none
+boolean File::getEntry(FileEntry *pEntry) {
+  if (!_file || _file->isRoot()) return false;
+
+  pEntry->dirBlock = _file->dirBlock();
+  pEntry->dirIndex = _file->dirIndex();
+  pEntry->firstCluster = _file->firstCluster();
+  strcpy(pEntry->name, _name);
+  return true;
+}
+
 // a directory is a special type of file
 boolean File::isDirectory(void) {
   return (_file && _file->isDir());
@@ -85,6 +97,7 @@ size_t File::write(const uint8_t *buf, size_t size) {
     return 0;
   }
   //_file->clearWriteError();
+  SdVolumeLock lock;
   t = _file->write(buf, size);
 //  if (_file->getWriteError()) {
 //    setWriteError();
@@ -97,21 +110,26 @@ int File::peek() {
   if (! _file) 
     return 0;
 
+  SdVolumeLock lock;
   int c = _file->read();
   if (c != -1) _file->seekCur(-1);
   return c;
 }
 
 int File::read() {
-  if (_file) 
+  if (_file) {
+    SdVolumeLock lock;
     return _file->read();
+  }
   return -1;
 }
 
 // buffered read for more efficient, high speed reading
 int File::read(void *buf, uint16_t nbyte) {
-  if (_file) 
+  if (_file) {
+    SdVolumeLock lock;
     return _file->read(buf, nbyte);
+  }
   return 0;
 }
 
@@ -124,13 +142,16 @@ int File::available() {
 }
 
 void File::flush() {
-  if (_file)
+  if (_file) {
+    SdVolumeLock lock;
     _file->sync();
+  }
 }
 
 boolean File::seek(uint32_t pos) {
   if (! _file) return false;
 
+  SdVolumeLock lock;
   return _file->seekSet(pos);
 }
 
@@ -144,10 +165,20 @@ uint32_t File::size() {
   return _file->fileSize();
 }
 
+boolean File::contiguousRange(uint32_t *bgnBlock, uint32_t *endBlock) {
+  if (! _file) return false;
+
+  SdVolumeLock lock;
+  return _file->contiguousRange(bgnBlock, endBlock);
+}
+
 void File::close() {
     INT8U uCOSerr;
   if (_file) {
-    _file->close();
+    {
+      SdVolumeLock lock;
+      _file->close();
+    }
     //free(_file);
     
     uCOSerr = OSMemPut(sdFileHeap, _file);
@@ -341,11 +341,19 @@ boolean SDClass::begin(uint8_t csPin) {
     Return true if initialization succeeds, false otherwise.
 
    */
+  SdVolume::lockInit();
+  SdVolumeLock lock;
   return card.init(SPI_HALF_SPEED, csPin) &&
          volume.init(card) &&
          root.openRoot(volume);
 }
 
+boolean SDClass::calibrate(void) {
+  // the volume's cache block is free to read into once flushed
+  SdVolumeLock lock;
+  return card.calibrate(SdVolume::cacheClear());
+}
+
 
 
 // this little helper is used to traverse paths
@@ -430,6 +438,7 @@ File SDClass::open(const char *filepath, uint8_t mode) {
    */
 
   int pathidx;
+  SdVolumeLock lock;
 
   // do the interative search
   SdFile parentdir = getParentDir(filepath, &pathidx);
@@ -438,7 +447,9 @@ File SDClass::open(const char *filepath, uint8_t mode) {
   filepath += pathidx;
 
   if (! filepath[0]) {
-    // it was the directory itself!
+    // it was the directory itself! A copy of root is wherever the last
+    // open left root, so start it at the first entry
+    parentdir.rewind();
     return File(parentdir, "/");
   }
 
@@ -516,12 +527,38 @@ File SDClass::open(char *filepath, uint8_t mode) {
 //}
 
 
+File SDClass::open(const FileEntry &entry, uint8_t mode) {
+  /*
+
+     Open the file whose directory entry File::getEntry() saved, from
+     the entry's block, which is most likely still in the cache.  Fails if
+     the entry now holds another file.
+
+   */
+
+  SdVolumeLock lock;
+  SdFile file;
+
+  if (!file.open(&volume, entry.dirBlock, entry.dirIndex, mode)) {
+    return File();
+  }
+  if (file.firstCluster() != entry.firstCluster) {
+    file.close();
+    return File();
+  }
+  if (mode & (O_APPEND | O_WRITE)) 
+    file.seekSet(file.fileSize());
+  return File(file, entry.name);
+}
+
+
 boolean SDClass::exists(char *filepath) {
   /*
 
      Returns true if the supplied file path exists.
 
    */
+  SdVolumeLock lock;
   return walkPath(filepath, root, callback_pathExists);
 }
 
@@ -545,6 +582,7 @@ boolean SDClass::mkdir(char *filepath) {
     A rough equivalent to `mkdir -p`.
   
    */
+  SdVolumeLock lock;
   return walkPath(filepath, root, callback_makeDirPath);
 }
 
@@ -556,10 +594,12 @@ boolean SDClass::rmdir(char *filepath) {
     A rough equivalent to `rm -rf`.
   
    */
+  SdVolumeLock lock;
   return walkPath(filepath, root, callback_rmdir);
 }
 
 boolean SDClass::remove(char *filepath) {
+  SdVolumeLock lock;
   return walkPath(filepath, root, callback_remove);
 }
 
@@ -567,46 +607,17 @@ boolean SDClass::remove(char *filepath) {
 // allows you to recurse into a directory
 File File::openNextFile(uint8_t mode) {
   dir_t p;
+  SdFile f;
+  char name[13];
+  SdVolumeLock lock;
 
-  //Serial.print("\t\treading dir...");
-  while (_file->readDir(&p) > 0) {
-
-    // done if past last used entry
-    if (p.name[0] == DIR_NAME_FREE) {
-      //Serial.println("end");
-      return File();
-    }
-
-    // skip deleted entry and entries for . and  ..
-    if (p.name[0] == DIR_NAME_DELETED || p.name[0] == '.') {
-      //Serial.println("dots");
-      continue;
-    }
-
-    // only list subdirectories and files
-    if (!DIR_IS_FILE_OR_SUBDIR(&p)) {
-      //Serial.println("notafile");
-      continue;
-    }
-
-    // print file name with possible blank fill
-    SdFile f;
-    char name[13];
-    _file->dirName(p, name);
-    //Serial.print("try to open file ");
-    //Serial.println(name);
-
-    if (f.open(_file, name, mode)) {
-      //Serial.println("OK!");
-      return File(f, name);    
-    } else {
-      //Serial.println("ugh");
-      return File();
-    }
+  // open the entry the directory read stopped at, rather than look its
+  // name up in the directory again
+  if (!f.openNext(_file, mode) || !f.dirEntry(&p)) {
+    return File();
   }
-
-  //Serial.println("nothing");
-  return File();
+  SdFile::dirName(p, name);
+  return File(f, name);
 }
 
 void File::rewindDirectory(void) {  
@@ -23,6 +23,18 @@
 #define FILE_READ O_READ
 #define FILE_WRITE (O_READ | O_WRITE | O_CREAT)
 
+// Where a file's directory entry is on the card, from File::getEntry():
+// SD.open() opens the file again from it without searching its directory.
+struct FileEntry {
+  uint32_t dirBlock;      // block holding the entry
+  uint32_t firstCluster;  // the file's, to tell if the entry has changed
+  uint8_t dirIndex;       // entry in dirBlock, 0 to 15
+  char name[13];
+};
+
+// A File is used by one task at a time; different Files can be used by
+// different tasks at once.  The calls that reach the card or the volume's
+// cache take SdVolume::lock() while they run.
 class File {
  private:
   char _name[13]; // our name
@@ -41,9 +53,12 @@ public:
   boolean seek(uint32_t pos);
   uint32_t position();
   uint32_t size();
+  // The blocks of a file stored in one run of them, see SdRawStream
+  boolean contiguousRange(uint32_t *bgnBlock, uint32_t *endBlock);
   void close();
   operator bool();
   char * name();
+  boolean getEntry(FileEntry *pEntry);
 
   boolean isDirectory(void);
   File openNextFile(uint8_t mode = O_RDONLY);
@@ -67,11 +82,17 @@ public:
   // before other methods are used.
   boolean begin(uint8_t csPin = SD_CHIP_SELECT_PIN);
   boolean begin(HANDLE hSD) { card.SetSDHandle(hSD); return begin(); }
+
+  // Find the fastest SPI clock the card works at and keep it, after
+  // begin(); see Sd2Card::calibrate() and Sd2Card::calibration().
+  boolean calibrate(void);
   
   // Open the specified file/directory with the supplied mode (e.g. read or
   // write, etc). Returns a File object for interacting with the file.
-  // Note that currently only one file can be open at a time.
+  // Up to MaxFiles (File.cpp) can be open at a time, by any tasks.
   File open(const char *filename, uint8_t mode = FILE_READ);
+  // Open a file where File::getEntry() found it, with no path search
+  File open(const FileEntry &entry, uint8_t mode = FILE_READ);
 
   // Methods to determine if the requested file path exists.
   boolean exists(char *filepath);
@@ -19,6 +19,13 @@
  */
 #ifndef FatStructs_h
 #define FatStructs_h
+
+// __packed is an IAR keyword; GCC (the Linux build in Host/) packs with a pragma
+#if defined(__GNUC__)
+#pragma pack(push, 1)
+#undef __packed
+#define __packed
+#endif
 /**
  * \file
  * FAT file structures
@@ -415,4 +422,8 @@ static inline uint8_t DIR_IS_SUBDIR(const dir_t* dir) {
 static inline uint8_t DIR_IS_FILE_OR_SUBDIR(const dir_t* dir) {
   return (dir->attributes & DIR_ATT_VOLUME_ID) == 0;
 }
+#if defined(__GNUC__)
+#pragma pack(pop)
+#endif
+
 #endif  // FatStructs_h
@@ -20,26 +20,82 @@
 #define USE_SPI_LIB
 #include "Sd2Card.h"
 #include "ucos_ii.h"
+#include "pjdfBind.h"
+#include "bsp.h"
+//------------------------------------------------------------------------------
+// CRC check counters, one set for every card
+card_stats_t Sd2Card::cardStats_;
+// what calibrate() found, nothing yet
+card_cal_t Sd2Card::cardCal_;
 //------------------------------------------------------------------------------
 
 // functions for hardware SPI
 /** Send a byte to the card */
 void Sd2Card::spiSend(uint8_t b) {
-    static uint32_t len = 1;
-    Write(hSD_, &b, &len);
+    rxPos_ = rxLen_ = 0;    // what was polled ahead came before this
+    BindSdSend(hSD_, &b, 1);
+}
+/** Send a buffer of data to the card */
+void Sd2Card::spiSendBuf(const uint8_t* buf, uint16_t count) {
+    rxPos_ = rxLen_ = 0;
+    BindSdSend(hSD_, (uint8_t*)buf, count);
 }
 /** Receive a byte from the card */
 uint8_t Sd2Card::spiRec(void) {
-    static uint32_t len = 1;
+    if (rxPos_ < rxLen_) return rxAhead_[rxPos_++];
     uint8_t buf= 0xFF;
-    Read(hSD_, &buf, &len);;
+    BindSdTransfer(hSD_, &buf, 1);
     return buf;
 }
 
 /** Receive a buffer of data from the card */
 void Sd2Card::spiRecBuf(uint8_t *buf, uint32_t *len) {
-    memset(buf, 0xFF, *len);
-    Read(hSD_, buf, len);;
+    uint32_t n = *len;
+    while (n > 0 && rxPos_ < rxLen_) {
+        *buf++ = rxAhead_[rxPos_++];
+        n--;
+    }
+    if (n > 0) {
+        memset(buf, 0xFF, n);
+        BindSdTransfer(hSD_, buf, n);
+    }
+}
+
+/**
+ * Receive a byte while waiting for the card, SD_POLL_BYTES of them are
+ * clocked in at a time. What comes after the byte looked for stays in
+ * rxAhead_ for spiRec() and spiRecBuf().
+ */
+uint8_t Sd2Card::spiPoll(void) {
+    if (rxPos_ == rxLen_) {
+        memset(rxAhead_, 0xFF, SD_POLL_BYTES);
+        BindSdTransfer(hSD_, rxAhead_, SD_POLL_BYTES);
+        rxPos_ = 0;
+        rxLen_ = SD_POLL_BYTES;
+    }
+    return rxAhead_[rxPos_++];
+}
+
+/** Skip count bytes of data from the card, adding them to the CRC */
+void Sd2Card::spiSkip(uint16_t count) {
+    uint8_t buf[32];
+    while (count > 0) {
+        uint32_t n = count < sizeof(buf) ? count : sizeof(buf);
+        spiRecBuf(buf, &n);
+#if SD_CRC
+        crc_ = sdCrc16(crc_, buf, n);
+#endif
+        count -= n;
+    }
+}
+
+/** Receive count bytes of block data, adding them to the CRC */
+void Sd2Card::spiRecData(uint8_t* buf, uint16_t count) {
+    uint32_t n = count;
+    spiRecBuf(buf, &n);
+#if SD_CRC
+    crc_ = sdCrc16(crc_, buf, count);
+#endif
 }
 //------------------------------------------------------------------------------
 /** nop to tune soft SPI timing */
@@ -51,31 +107,160 @@ uint8_t Sd2Card::cardCommand(uint8_t cmd, uint32_t arg) {
   // end read if in partialBlockRead mode
   readEnd();
 
+  // end a multiple block read, any other command would be ignored
+  if (inStream_) readStop();
+
   // select card
   chipSelectLow();
 
 
-  // wait up to 300 ms if busy
-  waitNotBusy(300);
-
-  // send command
-  spiSend(cmd | 0x40);
+  // wait up to 300 ms if busy, CMD12 comes while the card sends data
+  if (cmd != CMD12) waitNotBusy(300);
 
-  // send argument
-  for (int8_t s = 24; s >= 0; s -= 8) spiSend(arg >> s);
+  // send command, argument and CRC in one transfer
+  uint8_t frame[6];
+  frame[0] = cmd | 0x40;
+  for (uint8_t i = 0; i < 4; i++) frame[1 + i] = arg >> (24 - 8 * i);
+  // the card checks it on CMD0 and CMD8, and on every command after CMD59
+  frame[5] = sdCrc7(frame, 5) | 1;
+  spiSendBuf(frame, sizeof(frame));
 
-  // send CRC
-  uint8_t crc = 0XFF;
-  if (cmd == CMD0) crc = 0X95;  // correct crc for CMD0 with arg 0
-  if (cmd == CMD8) crc = 0X87;  // correct crc for CMD8 with arg 0X1AA
-  spiSend(crc);
+  // skip the stuff byte that follows CMD12
+  if (cmd == CMD12) spiPoll();
 
   // wait for response
-  for (uint8_t i = 0; ((status_ = spiRec()) & 0X80) && i != 0XFF; i++)
+  for (uint8_t i = 0; ((status_ = spiPoll()) & 0X80) && i != 0XFF; i++)
     ;
   return status_;
 }
 //------------------------------------------------------------------------------
+// TRAN_SPEED of a CSD in Hz: a mantissa in tenths times 100 kHz to 100 MHz,
+// zero for the reserved units
+static uint32_t tranSpeedHz(uint8_t tranSpeed) {
+  static const uint8_t tenths[16] = {0, 10, 12, 13, 15, 20, 25, 30,
+                                     35, 40, 45, 50, 55, 60, 70, 80};
+  static const uint32_t unitHz[4] = {10000, 100000, 1000000, 10000000};
+  if ((tranSpeed & 7) > 3) return 0;
+  return tenths[(tranSpeed >> 3) & 0XF] * unitHz[tranSpeed & 7];
+}
+//------------------------------------------------------------------------------
+/**
+ * Find the fastest SCK the card reads reliably at, and keep it.
+ *
+ * From SD_CAL_START_HZ, SCK doubles one SPI1 prescaler step at a time up to
+ * what the card is rated for: TRAN_SPEED of its CSD, read after it is
+ * switched to high speed if it can be.  At each step block zero is read
+ * SD_CAL_READS times; the step passes if no read fails, no block fails its
+ * CRC check or has a bad start token, even if it was read again, and every
+ * copy has the CRC16 the first one had.  SCK is kept SD_CAL_MARGIN_STEPS
+ * steps under the fastest step that passes, and has to pass
+ * SD_CAL_SOAK_READS reads and a stream of SD_CAL_STREAM_BLOCKS blocks
+ * there too, else the step under it does.  The stream gives the
+ * sequential read rate.  The SCK kept becomes the card's limit
+ * (SPI_SetMaxHz()), so a slower clock only slows it down.  The results are
+ * in calibration().
+ *
+ * \param[in] buf A 512 byte buffer to read into, SdVolume::cacheClear().
+ *
+ * \return The value one, true, is returned for success and the value zero,
+ * false, is returned if no step passed, or neither the step kept nor the
+ * one under it passed again; the card is then back at SD_SPI_MAX_HZ.
+ */
+uint8_t Sd2Card::calibrate(uint8_t* buf) {
+  card_cal_t cal;
+  csd_t csd;
+  uint32_t hz, lowestHz, next, cycles = 0;
+  uint16_t crc;
+  uint8_t tries;
+  // its reads at trial SCK rates are left out of the block read times
+  card_stats_t stats = cardStats_;
+
+  memset(&cal, 0, sizeof(cal));
+  if (inStream_ && !readStop()) goto fail;
+  hz = lowestHz = setSckHz(SD_CAL_START_HZ);
+  cal.highSpeed = switchHighSpeed(buf);
+  if (!readCSD(&csd)) goto fail;
+  cal.cardHz = tranSpeedHz(csd.v1.tran_speed);
+  if (cal.cardHz == 0) cal.cardHz = SD_DEFAULT_SPEED_HZ;
+
+  // the copy every other read has to match
+  if (!readBlock(0, buf)) goto fail;
+  crc = sdCrc16(0, buf, 512);
+  if (!calCheck(buf, crc, SD_CAL_READS)) goto fail;
+  cal.steps = 1;
+
+  // up until a step fails or would be faster than the card is rated for
+  for (;;) {
+    next = setSckHz(2 * hz);
+    if (next <= hz || next > cal.cardHz) break;
+    if (!calCheck(buf, crc, SD_CAL_READS)) {
+      cal.failedHz = next;
+      break;
+    }
+    hz = next;
+    cal.steps++;
+  }
+  // the margin, then more reads there, or at the step under it; errors at
+  // both are noise that SCK has nothing to do with
+  for (tries = 0; tries < SD_CAL_MARGIN_STEPS && hz > lowestHz; tries++) {
+    hz = setSckHz(hz / 2);
+  }
+  for (tries = 0; ; tries++) {
+    setSckHz(hz);
+    if (calCheck(buf, crc, SD_CAL_SOAK_READS) && calStream(buf, &cycles)) break;
+    cal.failedHz = hz;
+    if (tries > 0 || hz <= lowestHz) goto fail;
+    hz = setSckHz(hz / 2);
+  }
+  cal.sckHz = hz;
+  cal.bytesPerSec = (uint64_t)SD_CAL_STREAM_BLOCKS * 512 * SystemCoreClock / (cycles ? cycles : 1);
+  cardCal_ = cal;
+  cardStats_.blockReads = stats.blockReads;
+  cardStats_.blockReadCycles = stats.blockReadCycles;
+  return true;
+
+ fail:
+  setSckHz(SD_SPI_MAX_HZ);
+  cardCal_ = cal;
+  cardStats_.blockReads = stats.blockReads;
+  cardStats_.blockReadCycles = stats.blockReadCycles;
+  return false;
+}
+//------------------------------------------------------------------------------
+/** Blocks read so far that failed their CRC check or had a bad start
+ * token, whether they were read again or not. */
+uint32_t Sd2Card::calErrors(void) {
+  return cardStats_.crcErrors + cardStats_.tokenErrors;
+}
+//------------------------------------------------------------------------------
+/** Read block zero reads times, false if a read fails, a block fails its
+ * CRC check or has a bad start token, or a copy's CRC16 is not crc. */
+uint8_t Sd2Card::calCheck(uint8_t* buf, uint16_t crc, uint8_t reads) {
+  for (uint8_t i = 0; i < reads; i++) {
+    uint32_t errors = calErrors();
+    if (!readBlock(0, buf) || calErrors() != errors ||
+        sdCrc16(0, buf, 512) != crc) {
+      return false;
+    }
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+/** Read SD_CAL_STREAM_BLOCKS blocks from block zero with one multiple
+ * block read, false if one fails its CRC check or has a bad start token.
+ * cycles receives the CYCLE_COUNT() cycles it took. */
+uint8_t Sd2Card::calStream(uint8_t* buf, uint32_t* cycles) {
+  uint32_t errors = calErrors();
+  uint32_t start = CYCLE_COUNT();
+  if (!readStart(0)) return false;
+  for (uint16_t i = 0; i < SD_CAL_STREAM_BLOCKS; i++) {
+    if (!readData(buf)) return false;
+  }
+  if (!readStop()) return false;
+  *cycles = CYCLE_COUNT() - start;
+  return calErrors() == errors;
+}
+//------------------------------------------------------------------------------
 /**
  * Determine the size of an SD flash memory card.
  *
@@ -187,7 +372,9 @@ uint8_t Sd2Card::init(uint8_t sckRateID, uint8_t chipSelectPin) {
 
   // must supply min of 74 clock cycles with CS high.
   Ioctl(hSD_, PJDF_CTRL_SD_LOCK_SPI, 0, 0);
-  for (uint8_t i = 0; i < 10; i++) spiSend(0XFF);
+  uint8_t ones[10];
+  memset(ones, 0XFF, sizeof(ones));
+  spiSendBuf(ones, sizeof(ones));
   Ioctl(hSD_, PJDF_CTRL_SD_RELEASE_SPI, 0, 0);
 
   //chipSelectLow(); // done by cardCommand() below
@@ -200,6 +387,13 @@ uint8_t Sd2Card::init(uint8_t sckRateID, uint8_t chipSelectPin) {
       goto fail;
     }
   }
+#if SD_CRC
+  // CRCs on: commands and blocks written are checked from here on
+  if (cardCommand(CMD59, 1) != R1_IDLE_STATE) {
+    error(SD_CARD_ERROR_CMD59);
+    goto fail;
+  }
+#endif
   // check SD version
   if ((cardCommand(CMD8, 0x1AA) & R1_ILLEGAL_COMMAND)) {
     type(SD_CARD_TYPE_SD1);
@@ -279,86 +473,107 @@ uint8_t Sd2Card::readBlock(uint32_t block, uint8_t* dst) {
  * \param[in] offset Number of bytes to skip at start of block
  * \param[out] dst Pointer to the location that will receive the data.
  * \param[in] count Number of bytes to read
+ *
+ * With SD_CRC, the block is read again while it fails its CRC check, up to
+ * SD_CRC_RETRIES times. In partial block read mode it is checked when its
+ * end is read, and only the part read then is read again. A wrong or late
+ * start token counts the same, with or without SD_CRC.
+ *
  * \return The value one, true, is returned for success and
  * the value zero, false, is returned for failure.
  */
 uint8_t Sd2Card::readData(uint32_t block,
         uint16_t offset, uint16_t count, uint8_t* dst) {
-  //uint16_t n;
   if (count == 0) return true;
   if ((count + offset) > 512) {
-    goto fail;
-  }
-  if (!inBlock_ || block != block_ || offset < offset_) {
-    block_ = block;
-    // use address if not SDHC card
-    if (type()!= SD_CARD_TYPE_SDHC) block <<= 9;
-    if (cardCommand(CMD17, block)) {
-      error(SD_CARD_ERROR_CMD17);
-      goto fail;
-    }
-    if (!waitStartBlock()) {
-      goto fail;
-    }
-    offset_ = 0;
-    inBlock_ = 1;
-  }
-
-#ifdef OPTIMIZE_HARDWARE_SPI
-  // start first spi transfer
-  SPDR = 0XFF;
-
-  // skip data before offset
-  for (;offset_ < offset; offset_++) {
-    while (!(SPSR & (1 << SPIF)))
-      ;
-    SPDR = 0XFF;
-  }
-  // transfer data
-  n = count - 1;
-  for (uint16_t i = 0; i < n; i++) {
-    while (!(SPSR & (1 << SPIF)))
-      ;
-    dst[i] = SPDR;
-    SPDR = 0XFF;
-  }
-  // wait for last byte
-  while (!(SPSR & (1 << SPIF)))
-    ;
-  dst[n] = SPDR;
-
-#else  // OPTIMIZE_HARDWARE_SPI
-
-  if (offset == 0 && count == 512)
-  {
-      uint32_t tmpcount = count;
-      spiRecBuf(dst, &tmpcount);
+    return false;
   }
-  else
-  {
-      // skip data before offset
-      for (;offset_ < offset; offset_++) {
-        spiRec();
+  // next block of a multiple block read
+  if (inStream_ && block == streamBlock_ && offset == 0 && count == 512) {
+    return readData(dst);
+  }
+  uint32_t start = CYCLE_COUNT();
+  for (uint8_t retry = 0; ; retry++) {
+    if (!inBlock_ || block != block_ || offset < offset_) {
+      block_ = block;
+      // use address if not SDHC card
+      if (cardCommand(CMD17, type() == SD_CARD_TYPE_SDHC ? block : block << 9)) {
+        error(SD_CARD_ERROR_CMD17);
+        goto fail;
       }
-      // transfer data
-      for (uint16_t i = 0; i < count; i++) {
-        dst[i] = spiRec();
+      if (!waitStartBlock()) {
+        chipSelectHigh();
+        if (readAgain(retry)) continue;
+        return false;
       }
+      offset_ = 0;
+      crc_ = 0;
+      inBlock_ = 1;
+    }
+    // skip data before offset
+    spiSkip(offset - offset_);
+    // transfer data
+    spiRecData(dst, count);
+    offset_ = offset + count;
+    if (partialBlockRead_ && offset_ < 512) return true;
+
+    // read rest of data and checksum, set chip select high
+    if (readRest()) {
+      if (count == 512) blockRead(start);
+      return true;
+    }
+    if (!readAgain(retry)) {
+      error(SD_CARD_ERROR_READ_CRC);
+      return false;
+    }
   }
-#endif  // OPTIMIZE_HARDWARE_SPI
-
-  offset_ += count;
-  if (!partialBlockRead_ || offset_ >= 512) {
-    // read rest of data, checksum and set chip select high
-    readEnd();
-  }
-  return true;
 
  fail:
   chipSelectHigh();
   return false;
 }
 //------------------------------------------------------------------------------
+/**
+ * Receive the CRC16 that follows a block and check it against crc_.
+ *
+ * \return false if SD_CRC is on and they differ.
+ */
+uint8_t Sd2Card::readCrc(void) {
+  uint16_t crc = spiRec() << 8;
+  crc |= spiRec();
+#if SD_CRC
+  if (crc != crc_) {
+    cardStats_.crcErrors++;
+    return false;
+  }
+#endif  // SD_CRC
+  return true;
+}
+//------------------------------------------------------------------------------
+/** Count a whole block read that began at CYCLE_COUNT() start. */
+void Sd2Card::blockRead(uint32_t start) {
+  cardStats_.blockReads++;
+  cardStats_.blockReadCycles += CYCLE_COUNT() - start;
+}
+//------------------------------------------------------------------------------
+/** After the retry-th try at a read failed its CRC check or start token:
+ * true to try again, false to give up, after SD_CRC_RETRIES of them. */
+uint8_t Sd2Card::readAgain(uint8_t retry) {
+  if (retry < SD_CRC_RETRIES) return true;
+  cardStats_.crcFailures++;
+  return false;
+}
+//------------------------------------------------------------------------------
+/** Read the rest of a block and its CRC and end the read, false if the
+ * CRC check fails. */
+uint8_t Sd2Card::readRest(void) {
+  spiSkip(512 - offset_);
+  inBlock_ = 0;
+  uint8_t ok = readCrc();
+  chipSelectHigh();
+  return ok;
+}
+//------------------------------------------------------------------------------
 /** Skip remaining data in a block when in partial block read mode. */
 void Sd2Card::readEnd(void) {
   if (inBlock_) {
@@ -375,25 +590,37 @@ void Sd2Card::readEnd(void) {
     while (!(SPSR & (1 << SPIF)))
       ;
 #else  // OPTIMIZE_HARDWARE_SPI
-    while (offset_++ < 514) spiRec();
+    spiSkip(514 - offset_);
 #endif  // OPTIMIZE_HARDWARE_SPI
     chipSelectHigh();
     inBlock_ = 0;
   }
 }
 //------------------------------------------------------------------------------
-/** read CID or CSR register */
-uint8_t Sd2Card::readRegister(uint8_t cmd, void* buf) {
-  uint8_t* dst = (uint8_t*)(buf);
-  if (cardCommand(cmd, 0)) {
-    error(SD_CARD_ERROR_READ_REG);
+/** Start a read multiple blocks sequence.
+ *
+ * \param[in] blockNumber Address of first block in sequence.
+ *
+ * \note This function is used with readData() and readStop() for
+ * sequential reads. The card streams the blocks that follow, so each one
+ * costs a data token rather than a command and the CMD17 access time.
+ * readBlock() and readData() continue the sequence when asked for its next
+ * block; any other command ends it. Chip select and the SPI bus are given
+ * up between blocks.
+ *
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ */
+uint8_t Sd2Card::readStart(uint32_t blockNumber) {
+  if (inStream_ && blockNumber == streamBlock_) return true;
+  streamBlock_ = blockNumber;
+  // use address if not SDHC card
+  if (type() != SD_CARD_TYPE_SDHC) blockNumber <<= 9;
+  if (cardCommand(CMD18, blockNumber)) {
+    error(SD_CARD_ERROR_CMD18);
     goto fail;
   }
-  if (!waitStartBlock()) goto fail;
-  // transfer data
-  for (uint16_t i = 0; i < 16; i++) dst[i] = spiRec();
-  spiRec();  // get first crc byte
-  spiRec();  // get second crc byte
+  inStream_ = 1;
   chipSelectHigh();
   return true;
 
@@ -402,6 +629,90 @@ uint8_t Sd2Card::readRegister(uint8_t cmd, void* buf) {
   return false;
 }
 //------------------------------------------------------------------------------
+/** Read the next block of a multiple block read sequence.  With SD_CRC, a
+ * block that fails its CRC check is read again by ending the sequence and
+ * starting another at it, up to SD_CRC_RETRIES times; so is one whose
+ * start token is wrong or late. */
+uint8_t Sd2Card::readData(uint8_t* dst) {
+  uint32_t start = CYCLE_COUNT();
+  for (uint8_t retry = 0; ; retry++) {
+    chipSelectLow();
+    uint8_t token = waitStartBlock();
+    uint8_t ok = token;
+    if (token) {
+      crc_ = 0;
+      spiRecData(dst, 512);
+      ok = readCrc();
+    }
+    chipSelectHigh();
+    if (ok) break;
+    uint32_t block = streamBlock_;
+    if (!readStop()) return false;
+    if (!readAgain(retry)) {
+      if (token) error(SD_CARD_ERROR_READ_CRC);
+      return false;
+    }
+    if (!readStart(block)) return false;
+  }
+  streamBlock_++;
+  blockRead(start);
+  return true;
+}
+//------------------------------------------------------------------------------
+/** End a read multiple blocks sequence.
+ *
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.
+ */
+uint8_t Sd2Card::readStop(void) {
+  inStream_ = 0;
+  if (cardCommand(CMD12, 0)) {
+    error(SD_CARD_ERROR_CMD12);
+    goto fail;
+  }
+  // R1b, the card may be busy
+  if (!waitNotBusy(SD_READ_TIMEOUT)) {
+    error(SD_CARD_ERROR_STOP_TRAN);
+    goto fail;
+  }
+  chipSelectHigh();
+  return true;
+
+ fail:
+  chipSelectHigh();
+  return false;
+}
+//------------------------------------------------------------------------------
+/** read CID or CSR register, or count bytes of CMD6 switch status, again
+ * if it fails its CRC check or its start token is wrong or late */
+uint8_t Sd2Card::readRegister(uint8_t cmd, void* buf, uint32_t arg, uint8_t count) {
+  uint8_t* dst = (uint8_t*)(buf);
+  for (uint8_t retry = 0; ; retry++) {
+    if (cardCommand(cmd, arg)) {
+      error(SD_CARD_ERROR_READ_REG);
+      goto fail;
+    }
+    uint8_t token = waitStartBlock();
+    uint8_t ok = token;
+    if (token) {
+      // transfer data
+      crc_ = 0;
+      spiRecData(dst, count);
+      ok = readCrc();
+    }
+    chipSelectHigh();
+    if (ok) return true;
+    if (!readAgain(retry)) {
+      if (token) error(SD_CARD_ERROR_READ_CRC);
+      return false;
+    }
+  }
+
+ fail:
+  chipSelectHigh();
+  return false;
+}
+//------------------------------------------------------------------------------
 /**
  * Set the SPI clock rate.
  *
@@ -443,21 +754,55 @@ uint8_t Sd2Card::setSckRate(uint8_t sckRateID) {
   return true;
 }
 //------------------------------------------------------------------------------
+/**
+ * Set the SCK limit of the card, see SPI_SetMaxHz().  It holds across
+ * clock changes and applies from the next command.
+ *
+ * \param[in] maxHz The fastest SCK the card may get.
+ *
+ * \return The SCK it gets at the current clock.
+ */
+uint32_t Sd2Card::setSckHz(uint32_t maxHz) {
+  INT32U size = sizeof(maxHz);
+  Ioctl(hSD_, PJDF_CTRL_SD_LOCK_SPI, 0, 0);
+  Ioctl(hSD_, PJDF_CTRL_SD_SET_MAX_HZ, &maxHz, &size);
+  Ioctl(hSD_, PJDF_CTRL_SD_RELEASE_SPI, 0, 0);
+  return maxHz;
+}
+//------------------------------------------------------------------------------
+/**
+ * Switch the card to high speed, function 1 of CMD6 function group 1,
+ * which raises its TRAN_SPEED to 50 MHz.  Cards before version 1.10 of the
+ * specification reject CMD6.
+ *
+ * \param[in] buf At least 64 bytes for the switch status.
+ *
+ * \return true if the card switched.
+ */
+uint8_t Sd2Card::switchHighSpeed(uint8_t* buf) {
+  // check that it supports high speed, bit 401 of the status, then switch
+  if (!readRegister(CMD6, buf, 0X00FFFFF1, 64) || !(buf[13] & 2)) return false;
+  if (!readRegister(CMD6, buf, 0X80FFFFF1, 64)) return false;
+  // the function selected in group 1, 0XF if it was not switched
+  return (buf[16] & 0XF) == 1;
+}
+//------------------------------------------------------------------------------
 // wait for card to go not busy
 uint8_t Sd2Card::waitNotBusy(uint16_t timeoutMillis) {
   uint16_t t0 = OSTimeGet(); // use uCOS ticks?
   do {
-    if (spiRec() == 0XFF) 
+    if (spiPoll() == 0XFF) 
         return true;
   }
   while (((uint16_t)OSTimeGet() - t0) < timeoutMillis); // use uCOS ticks?
   return false;
 }
 //------------------------------------------------------------------------------
-/** Wait for start block token */
+/** Wait for start block token.  On failure chip select stays low: the
+ * caller ends the read, and reads again or gives up. */
 uint8_t Sd2Card::waitStartBlock(void) {
   uint16_t t0 = OSTimeGet(); // use uCOS ticks?
-  while ((status_ = spiRec()) == 0XFF) { // use uCOS ticks?
+  while ((status_ = spiPoll()) == 0XFF) { // use uCOS ticks?
     if (((uint16_t)OSTimeGet() - t0) > SD_READ_TIMEOUT) {
       error(SD_CARD_ERROR_READ_TIMEOUT);
       goto fail;
@@ -470,7 +815,7 @@ uint8_t Sd2Card::waitStartBlock(void) {
   return true;
 
  fail:
-  chipSelectHigh();
+  cardStats_.tokenErrors++;
   return false;
 }
 //------------------------------------------------------------------------------
@@ -551,12 +896,15 @@ uint8_t Sd2Card::writeData(uint8_t token, const uint8_t* src) {
 
 #else  // OPTIMIZE_HARDWARE_SPI
   spiSend(token);
-  for (uint16_t i = 0; i < 512; i++) {
-    spiSend(src[i]);
-  }
+  spiSendBuf(src, 512);
 #endif  // OPTIMIZE_HARDWARE_SPI
-  spiSend(0xff);  // dummy crc
-  spiSend(0xff);  // dummy crc
+#if SD_CRC
+  uint16_t crc16 = sdCrc16(0, src, 512);
+  uint8_t crc[2] = {(uint8_t)(crc16 >> 8), (uint8_t)crc16};
+#else  // SD_CRC
+  static const uint8_t crc[2] = {0XFF, 0XFF};  // dummy crc
+#endif  // SD_CRC
+  spiSendBuf(crc, sizeof(crc));
 
   status_ = spiRec();
   if ((status_ & DATA_RES_MASK) != DATA_RES_ACCEPTED) {
@@ -621,3 +969,43 @@ uint8_t Sd2Card::writeStop(void) {
   chipSelectHigh();
   return false;
 }
+//------------------------------------------------------------------------------
+/**
+ * Start reading blocks \a bgnBlock to \a endBlock of \a card.
+ *
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for an empty range.
+ */
+uint8_t SdRawStream::begin(Sd2Card* card, uint32_t bgnBlock,
+                           uint32_t endBlock) {
+  card_ = 0;
+  if (!card || bgnBlock > endBlock) return false;
+  card_ = card;
+  block_ = bgnBlock;
+  endBlock_ = endBlock;
+  return true;
+}
+//------------------------------------------------------------------------------
+/** Stop reading: end the multiple block read if it is still open. */
+void SdRawStream::end(void) {
+  if (card_ && card_->inStream()) card_->readStop();
+  card_ = 0;
+}
+//------------------------------------------------------------------------------
+/**
+ * Read the next block of the range.
+ *
+ * \param[out] dst Pointer to the 512 bytes that will receive it.
+ *
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned for failure.  Reasons for failure
+ * include the end of the range or an I/O error.
+ */
+uint8_t SdRawStream::read(uint8_t* dst) {
+  if (!available()) return false;
+  // continues the multiple block read unless another command ended it
+  if (!card_->readStart(block_)) return false;
+  if (!card_->readData(dst)) return false;
+  block_++;
+  return true;
+}
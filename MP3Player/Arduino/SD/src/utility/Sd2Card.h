@@ -25,6 +25,7 @@
  */
 #include <pjdf.h>
 #include "SdInfo.h"
+#include "SdCrc.h"
 /** Set SCK to max rate of F_CPU/2. See Sd2Card::setSckRate(). */
 uint8_t const SPI_FULL_SPEED = 0;
 /** Set SCK rate to F_CPU/4. See Sd2Card::setSckRate(). */
@@ -53,6 +54,33 @@ uint16_t const SD_ERASE_TIMEOUT = 10000;
 uint16_t const SD_READ_TIMEOUT = 300;
 /** write time out ms */
 uint16_t const SD_WRITE_TIMEOUT = 600;
+/** bytes clocked in at a time while polling for a response, token or ready */
+uint8_t const SD_POLL_BYTES = 8;
+/**
+ * Nonzero to turn the card's CRC checking on at init() with CMD59: every
+ * block read is checked against the CRC16 that follows it and read again
+ * if they differ, up to SD_CRC_RETRIES times, and blocks written carry
+ * their CRC16 for the card to check.  Zero leaves CRCs off, as the card
+ * starts up, and corrupted data goes to the caller unnoticed.
+ */
+#ifndef SD_CRC
+#define SD_CRC 1
+#endif
+/** times a block that fails its CRC check, or whose start token is wrong
+ * or late, is read again */
+uint8_t const SD_CRC_RETRIES = 3;
+/** SCK calibrate() starts from, at most the card identification rate */
+uint32_t const SD_CAL_START_HZ = 400000;
+/** reads of block zero at each SCK step of calibrate() */
+uint8_t const SD_CAL_READS = 4;
+/** SPI1 prescaler steps calibrate() keeps under the fastest that passed */
+uint8_t const SD_CAL_MARGIN_STEPS = 1;
+/** reads of block zero the SCK that calibrate() keeps has to pass */
+uint8_t const SD_CAL_SOAK_READS = 32;
+/** blocks streamed at that SCK, to check it again and time it */
+uint16_t const SD_CAL_STREAM_BLOCKS = 128;
+/** SCK a card in default speed mode is rated for */
+uint32_t const SD_DEFAULT_SPEED_HZ = 25000000;
 //------------------------------------------------------------------------------
 // SD card errors
 /** timeout error for command CMD0 */
@@ -81,7 +109,7 @@ uint8_t const SD_CARD_ERROR_ERASE_SINGLE_BLOCK = 0X0B;
 uint8_t const SD_CARD_ERROR_ERASE_TIMEOUT = 0X0C;
 /** card returned an error token instead of read data */
 uint8_t const SD_CARD_ERROR_READ = 0X0D;
-/** read CID or CSD failed */
+/** read CID, CSD or switch status failed */
 uint8_t const SD_CARD_ERROR_READ_REG = 0X0E;
 /** timeout while waiting for start of read data */
 uint8_t const SD_CARD_ERROR_READ_TIMEOUT = 0X0F;
@@ -99,6 +127,12 @@ uint8_t const SD_CARD_ERROR_WRITE_PROGRAMMING = 0X14;
 uint8_t const SD_CARD_ERROR_WRITE_TIMEOUT = 0X15;
 /** incorrect rate selected */
 uint8_t const SD_CARD_ERROR_SCK_RATE = 0X16;
+uint8_t const SD_CARD_ERROR_CMD18 = 0X17;
+uint8_t const SD_CARD_ERROR_CMD12 = 0X18;
+/** card did not accept CMD59, CRC on */
+uint8_t const SD_CARD_ERROR_CMD59 = 0X19;
+/** a block read failed its CRC check SD_CRC_RETRIES + 1 times */
+uint8_t const SD_CARD_ERROR_READ_CRC = 0X1A;
 //------------------------------------------------------------------------------
 // card types
 /** Standard capacity V1 SD card */
@@ -108,6 +142,40 @@ uint8_t const SD_CARD_TYPE_SD2 = 2;
 /** High Capacity SD card */
 uint8_t const SD_CARD_TYPE_SDHC = 3;
 //------------------------------------------------------------------------------
+/**
+ * \brief Sd2Card CRC check and block read counters
+ */
+struct card_stats_t {
+           /** Blocks read that failed their CRC check. */
+  uint32_t crcErrors;
+           /** Reads whose start token was wrong or did not come. */
+  uint32_t tokenErrors;
+           /** Reads given up after SD_CRC_RETRIES more of either. */
+  uint32_t crcFailures;
+           /** Whole blocks read, single or streamed. */
+  uint32_t blockReads;
+           /** CYCLE_COUNT() cycles they took, retries included. */
+  uint64_t blockReadCycles;
+};
+//------------------------------------------------------------------------------
+/**
+ * \brief Sd2Card::calibrate() results
+ */
+struct card_cal_t {
+           /** SCK kept, the card's limit from then on; zero if none was. */
+  uint32_t sckHz;
+           /** SCK the card is rated for, TRAN_SPEED of its CSD. */
+  uint32_t cardHz;
+           /** SCK of the step that failed, zero if none did. */
+  uint32_t failedHz;
+           /** Sequential read rate at sckHz, bytes per second. */
+  uint32_t bytesPerSec;
+           /** SCK steps that passed, from SD_CAL_START_HZ up. */
+  uint8_t steps;
+           /** Nonzero if the card switched to high speed, up to 50 MHz. */
+  uint8_t highSpeed;
+};
+//------------------------------------------------------------------------------
 /**
  * \class Sd2Card
  * \brief Raw access to SD and SDHC flash memory cards.
@@ -115,8 +183,14 @@ uint8_t const SD_CARD_TYPE_SDHC = 3;
 class Sd2Card {
  public:
   /** Construct an instance of Sd2Card. */
- Sd2Card(void) : errorCode_(0), inBlock_(0), partialBlockRead_(0), type_(0) {}
+ Sd2Card(void) : errorCode_(0), inBlock_(0), inStream_(0), partialBlockRead_(0), type_(0),
+   rxPos_(0), rxLen_(0), crc_(0) {}
+  /** \return The results of the last calibrate(). */
+  static const card_cal_t& calibration(void) {return cardCal_;}
+  uint8_t calibrate(uint8_t* buf);
   uint32_t cardSize(void);
+  /** \return The CRC check counters, see SD_CRC, and the block read times. */
+  static const card_stats_t& cardStats(void) {return cardStats_;}
   uint8_t erase(uint32_t firstBlock, uint32_t lastBlock);
   uint8_t eraseSingleBlockEnable(void);
   /**
@@ -161,7 +235,13 @@ class Sd2Card {
     return readRegister(CMD9, csd);
   }
   void readEnd(void);
+  uint8_t readStart(uint32_t blockNumber);
+  uint8_t readData(uint8_t* dst);
+  uint8_t readStop(void);
+  /** \return true while a multiple block read is open. */
+  uint8_t inStream(void) const {return inStream_;}
   uint8_t setSckRate(uint8_t sckRateID);
+  uint32_t setSckHz(uint32_t maxHz);
   /** Return the card type: SD V1, SD V2 or SDHC */
   uint8_t type(void) const {return type_;}
   uint8_t writeBlock(uint32_t blockNumber, const uint8_t* src);
@@ -181,18 +261,40 @@ class Sd2Card {
   uint8_t chipSelectPin_;
   uint8_t errorCode_;
   uint8_t inBlock_;
+  uint8_t inStream_;
+  uint32_t streamBlock_;
   uint16_t offset_;
   uint8_t partialBlockRead_;
   uint8_t status_;
   uint8_t type_;
+  // bytes polled ahead of need, handed out before new ones are clocked in
+  uint8_t rxAhead_[SD_POLL_BYTES];
+  uint8_t rxPos_;
+  uint8_t rxLen_;
+  // CRC16 of the block data received so far, with SD_CRC
+  uint16_t crc_;
+  static card_stats_t cardStats_;
+  static card_cal_t cardCal_;
   // private functions
   uint8_t cardAcmd(uint8_t cmd, uint32_t arg) {
     cardCommand(CMD55, 0);
     return cardCommand(cmd, arg);
   }
   uint8_t cardCommand(uint8_t cmd, uint32_t arg);
+  uint8_t spiPoll(void);
+  void spiSkip(uint16_t count);
+  void spiSendBuf(const uint8_t* buf, uint16_t count);
   void error(uint8_t code) {errorCode_ = code;}
-  uint8_t readRegister(uint8_t cmd, void* buf);
+  uint8_t readRegister(uint8_t cmd, void* buf, uint32_t arg = 0, uint8_t count = 16);
+  uint8_t switchHighSpeed(uint8_t* buf);
+  uint32_t calErrors(void);
+  uint8_t calCheck(uint8_t* buf, uint16_t crc, uint8_t reads);
+  uint8_t calStream(uint8_t* buf, uint32_t* cycles);
+  uint8_t readCrc(void);
+  uint8_t readRest(void);
+  uint8_t readAgain(uint8_t retry);
+  void blockRead(uint32_t start);
+  void spiRecData(uint8_t* buf, uint16_t count);
   uint8_t sendWriteCommand(uint32_t blockNumber, uint32_t eraseCount);
   void chipSelectHigh(void);
   void chipSelectLow(void);
@@ -201,4 +303,32 @@ class Sd2Card {
   uint8_t writeData(uint8_t token, const uint8_t* src);
   uint8_t waitStartBlock(void);
 };
+//------------------------------------------------------------------------------
+/**
+ * \class SdRawStream
+ * \brief A range of blocks read in order with one multiple block read.
+ *
+ * For a file that SdFile::contiguousRange() finds in one run of blocks:
+ * they come straight from the card, past the SdVolume cache and read-ahead,
+ * so the file must not be written while it is streamed.  Other commands
+ * to the card between blocks end the multiple block read; the next block
+ * starts another.  read() and end() use the card: hold the volume lock
+ * (SdVolumeLock) around them when other tasks use the SD library.
+ */
+class SdRawStream {
+ public:
+  /** Construct an instance of SdRawStream. */
+  SdRawStream(void) : card_(0), block_(0), endBlock_(0) {}
+  /** \return The number of blocks left to read. */
+  uint32_t available(void) const {
+    return card_ && block_ <= endBlock_ ? endBlock_ - block_ + 1 : 0;
+  }
+  uint8_t begin(Sd2Card* card, uint32_t bgnBlock, uint32_t endBlock);
+  void end(void);
+  uint8_t read(uint8_t* dst);
+ private:
+  Sd2Card* card_;
+  uint32_t block_;     // next block to read
+  uint32_t endBlock_;  // last block of the range
+};
 #endif  // Sd2Card_h
@@ -0,0 +1,93 @@
+/* Arduino Sd2Card Library
+ * This file is part of the Arduino Sd2Card Library
+ *
+ * This Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Arduino Sd2Card Library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#include "SdCrc.h"
+//------------------------------------------------------------------------------
+// A byte at a time from tables, eight times fewer steps than bit at a
+// time: 768 bytes of flash for the two.
+//
+// The CRC7 (x^7 + x^3 + 1) kept in bits 7..1, as it goes in the frame
+static const uint8_t crc7Table[256] = {
+  0X00, 0X12, 0X24, 0X36, 0X48, 0X5A, 0X6C, 0X7E, 0X90, 0X82, 0XB4, 0XA6,
+  0XD8, 0XCA, 0XFC, 0XEE, 0X32, 0X20, 0X16, 0X04, 0X7A, 0X68, 0X5E, 0X4C,
+  0XA2, 0XB0, 0X86, 0X94, 0XEA, 0XF8, 0XCE, 0XDC, 0X64, 0X76, 0X40, 0X52,
+  0X2C, 0X3E, 0X08, 0X1A, 0XF4, 0XE6, 0XD0, 0XC2, 0XBC, 0XAE, 0X98, 0X8A,
+  0X56, 0X44, 0X72, 0X60, 0X1E, 0X0C, 0X3A, 0X28, 0XC6, 0XD4, 0XE2, 0XF0,
+  0X8E, 0X9C, 0XAA, 0XB8, 0XC8, 0XDA, 0XEC, 0XFE, 0X80, 0X92, 0XA4, 0XB6,
+  0X58, 0X4A, 0X7C, 0X6E, 0X10, 0X02, 0X34, 0X26, 0XFA, 0XE8, 0XDE, 0XCC,
+  0XB2, 0XA0, 0X96, 0X84, 0X6A, 0X78, 0X4E, 0X5C, 0X22, 0X30, 0X06, 0X14,
+  0XAC, 0XBE, 0X88, 0X9A, 0XE4, 0XF6, 0XC0, 0XD2, 0X3C, 0X2E, 0X18, 0X0A,
+  0X74, 0X66, 0X50, 0X42, 0X9E, 0X8C, 0XBA, 0XA8, 0XD6, 0XC4, 0XF2, 0XE0,
+  0X0E, 0X1C, 0X2A, 0X38, 0X46, 0X54, 0X62, 0X70, 0X82, 0X90, 0XA6, 0XB4,
+  0XCA, 0XD8, 0XEE, 0XFC, 0X12, 0X00, 0X36, 0X24, 0X5A, 0X48, 0X7E, 0X6C,
+  0XB0, 0XA2, 0X94, 0X86, 0XF8, 0XEA, 0XDC, 0XCE, 0X20, 0X32, 0X04, 0X16,
+  0X68, 0X7A, 0X4C, 0X5E, 0XE6, 0XF4, 0XC2, 0XD0, 0XAE, 0XBC, 0X8A, 0X98,
+  0X76, 0X64, 0X52, 0X40, 0X3E, 0X2C, 0X1A, 0X08, 0XD4, 0XC6, 0XF0, 0XE2,
+  0X9C, 0X8E, 0XB8, 0XAA, 0X44, 0X56, 0X60, 0X72, 0X0C, 0X1E, 0X28, 0X3A,
+  0X4A, 0X58, 0X6E, 0X7C, 0X02, 0X10, 0X26, 0X34, 0XDA, 0XC8, 0XFE, 0XEC,
+  0X92, 0X80, 0XB6, 0XA4, 0X78, 0X6A, 0X5C, 0X4E, 0X30, 0X22, 0X14, 0X06,
+  0XE8, 0XFA, 0XCC, 0XDE, 0XA0, 0XB2, 0X84, 0X96, 0X2E, 0X3C, 0X0A, 0X18,
+  0X66, 0X74, 0X42, 0X50, 0XBE, 0XAC, 0X9A, 0X88, 0XF6, 0XE4, 0XD2, 0XC0,
+  0X1C, 0X0E, 0X38, 0X2A, 0X54, 0X46, 0X70, 0X62, 0X8C, 0X9E, 0XA8, 0XBA,
+  0XC4, 0XD6, 0XE0, 0XF2,
+};
+// CRC16-CCITT, x^16 + x^12 + x^5 + 1
+static const uint16_t crc16Table[256] = {
+  0X0000, 0X1021, 0X2042, 0X3063, 0X4084, 0X50A5, 0X60C6, 0X70E7,
+  0X8108, 0X9129, 0XA14A, 0XB16B, 0XC18C, 0XD1AD, 0XE1CE, 0XF1EF,
+  0X1231, 0X0210, 0X3273, 0X2252, 0X52B5, 0X4294, 0X72F7, 0X62D6,
+  0X9339, 0X8318, 0XB37B, 0XA35A, 0XD3BD, 0XC39C, 0XF3FF, 0XE3DE,
+  0X2462, 0X3443, 0X0420, 0X1401, 0X64E6, 0X74C7, 0X44A4, 0X5485,
+  0XA56A, 0XB54B, 0X8528, 0X9509, 0XE5EE, 0XF5CF, 0XC5AC, 0XD58D,
+  0X3653, 0X2672, 0X1611, 0X0630, 0X76D7, 0X66F6, 0X5695, 0X46B4,
+  0XB75B, 0XA77A, 0X9719, 0X8738, 0XF7DF, 0XE7FE, 0XD79D, 0XC7BC,
+  0X48C4, 0X58E5, 0X6886, 0X78A7, 0X0840, 0X1861, 0X2802, 0X3823,
+  0XC9CC, 0XD9ED, 0XE98E, 0XF9AF, 0X8948, 0X9969, 0XA90A, 0XB92B,
+  0X5AF5, 0X4AD4, 0X7AB7, 0X6A96, 0X1A71, 0X0A50, 0X3A33, 0X2A12,
+  0XDBFD, 0XCBDC, 0XFBBF, 0XEB9E, 0X9B79, 0X8B58, 0XBB3B, 0XAB1A,
+  0X6CA6, 0X7C87, 0X4CE4, 0X5CC5, 0X2C22, 0X3C03, 0X0C60, 0X1C41,
+  0XEDAE, 0XFD8F, 0XCDEC, 0XDDCD, 0XAD2A, 0XBD0B, 0X8D68, 0X9D49,
+  0X7E97, 0X6EB6, 0X5ED5, 0X4EF4, 0X3E13, 0X2E32, 0X1E51, 0X0E70,
+  0XFF9F, 0XEFBE, 0XDFDD, 0XCFFC, 0XBF1B, 0XAF3A, 0X9F59, 0X8F78,
+  0X9188, 0X81A9, 0XB1CA, 0XA1EB, 0XD10C, 0XC12D, 0XF14E, 0XE16F,
+  0X1080, 0X00A1, 0X30C2, 0X20E3, 0X5004, 0X4025, 0X7046, 0X6067,
+  0X83B9, 0X9398, 0XA3FB, 0XB3DA, 0XC33D, 0XD31C, 0XE37F, 0XF35E,
+  0X02B1, 0X1290, 0X22F3, 0X32D2, 0X4235, 0X5214, 0X6277, 0X7256,
+  0XB5EA, 0XA5CB, 0X95A8, 0X8589, 0XF56E, 0XE54F, 0XD52C, 0XC50D,
+  0X34E2, 0X24C3, 0X14A0, 0X0481, 0X7466, 0X6447, 0X5424, 0X4405,
+  0XA7DB, 0XB7FA, 0X8799, 0X97B8, 0XE75F, 0XF77E, 0XC71D, 0XD73C,
+  0X26D3, 0X36F2, 0X0691, 0X16B0, 0X6657, 0X7676, 0X4615, 0X5634,
+  0XD94C, 0XC96D, 0XF90E, 0XE92F, 0X99C8, 0X89E9, 0XB98A, 0XA9AB,
+  0X5844, 0X4865, 0X7806, 0X6827, 0X18C0, 0X08E1, 0X3882, 0X28A3,
+  0XCB7D, 0XDB5C, 0XEB3F, 0XFB1E, 0X8BF9, 0X9BD8, 0XABBB, 0XBB9A,
+  0X4A75, 0X5A54, 0X6A37, 0X7A16, 0X0AF1, 0X1AD0, 0X2AB3, 0X3A92,
+  0XFD2E, 0XED0F, 0XDD6C, 0XCD4D, 0XBDAA, 0XAD8B, 0X9DE8, 0X8DC9,
+  0X7C26, 0X6C07, 0X5C64, 0X4C45, 0X3CA2, 0X2C83, 0X1CE0, 0X0CC1,
+  0XEF1F, 0XFF3E, 0XCF5D, 0XDF7C, 0XAF9B, 0XBFBA, 0X8FD9, 0X9FF8,
+  0X6E17, 0X7E36, 0X4E55, 0X5E74, 0X2E93, 0X3EB2, 0X0ED1, 0X1EF0,
+};
+//------------------------------------------------------------------------------
+uint8_t sdCrc7(const uint8_t* buf, uint8_t count) {
+  uint8_t crc = 0;
+  while (count--) crc = crc7Table[crc ^ *buf++];
+  return crc;
+}
+//------------------------------------------------------------------------------
+uint16_t sdCrc16(uint16_t crc, const uint8_t* buf, uint32_t count) {
+  while (count--) crc = (crc << 8) ^ crc16Table[(crc >> 8) ^ *buf++];
+  return crc;
+}
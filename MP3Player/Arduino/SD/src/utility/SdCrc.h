@@ -0,0 +1,36 @@
+/* Arduino Sd2Card Library
+ * This file is part of the Arduino Sd2Card Library
+ *
+ * This Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the Arduino Sd2Card Library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+#ifndef SdCrc_h
+#define SdCrc_h
+/**
+ * \file
+ * CRCs of the SD card SPI protocol
+ */
+#include <stdint.h>
+/**
+ * CRC7 of a command frame: the CRC of the first \a count bytes in bits
+ * 7..1, with bit 0 clear for the end bit.
+ */
+uint8_t sdCrc7(const uint8_t* buf, uint8_t count);
+/**
+ * CRC16-CCITT of a data block, as the card sends it after the data and
+ * checks it on a write with CRCs on.  Start \a crc at zero; a block read
+ * in pieces is checked by passing each piece with the CRC so far.
+ */
+uint16_t sdCrc16(uint16_t crc, const uint8_t* buf, uint32_t count);
+#endif  // SdCrc_h
@@ -35,6 +35,77 @@
  */
 #define ALLOW_DEPRECATED_FUNCTIONS 1
 //------------------------------------------------------------------------------
+/**
+ * Number of 512 byte blocks in the SdVolume cache.
+ */
+#ifndef SD_CACHE_SLOTS
+#define SD_CACHE_SLOTS 4
+#endif
+/**
+ * Cache slots kept for FAT blocks, so following a cluster chain does not
+ * evict the file data or directory block being read.  With zero, FAT,
+ * directory and data blocks share all slots.
+ */
+#ifndef SD_CACHE_FAT_SLOTS
+#define SD_CACHE_FAT_SLOTS 1
+#endif
+#if SD_CACHE_SLOTS < 1 || SD_CACHE_FAT_SLOTS >= SD_CACHE_SLOTS
+#error SD_CACHE_FAT_SLOTS must leave at least one of SD_CACHE_SLOTS for data
+#endif
+/**
+ * Cluster chains of files open for read kept in SdVolume, as runs of
+ * consecutive clusters, so reading and seeking need no FAT lookups.
+ */
+#ifndef SD_CHAIN_MAPS
+#define SD_CHAIN_MAPS 2
+#endif
+/**
+ * Runs of consecutive clusters in one chain map.  A file in more pieces
+ * is mapped SD_CHAIN_EXTENTS runs at a time.
+ */
+#ifndef SD_CHAIN_EXTENTS
+#define SD_CHAIN_EXTENTS 8
+#endif
+#if SD_CHAIN_MAPS < 1 || SD_CHAIN_EXTENTS < 1
+#error SD_CHAIN_MAPS and SD_CHAIN_EXTENTS must be at least one
+#endif
+/**
+ * Most blocks the read-ahead of files open for read fetches at once, in
+ * one multiple block read.  With one, blocks are read as they are needed.
+ */
+#ifndef SD_READAHEAD_BLOCKS
+#define SD_READAHEAD_BLOCKS 8
+#endif
+/**
+ * How long, in ms, a read-ahead window should last at the rate the file
+ * was read so far.  Sets the window between 2 and SD_READAHEAD_BLOCKS.
+ */
+#ifndef SD_READAHEAD_MS
+#define SD_READAHEAD_MS 100
+#endif
+#if SD_READAHEAD_BLOCKS < 1 || SD_READAHEAD_BLOCKS > 255
+#error SD_READAHEAD_BLOCKS must be 1 to 255
+#endif
+/**
+ * Directories whose 8.3 names SdVolume keeps a hash index of, filled as
+ * open() by name reads their entries, so that a later open reads only the
+ * entry it finds.  With zero, open() by name searches the directory.
+ */
+#ifndef SD_NAME_INDEXES
+#define SD_NAME_INDEXES 1
+#endif
+/**
+ * Slots of one name index, three bytes each.  Up to three quarters of them
+ * are used; the entries of a larger directory after those are searched.
+ */
+#ifndef SD_NAME_INDEX_SLOTS
+#define SD_NAME_INDEX_SLOTS 1024
+#endif
+#if SD_NAME_INDEX_SLOTS < 4 || SD_NAME_INDEX_SLOTS > 32768 || \
+  (SD_NAME_INDEX_SLOTS & (SD_NAME_INDEX_SLOTS - 1))
+#error SD_NAME_INDEX_SLOTS must be a power of two, 4 to 32768
+#endif
+//------------------------------------------------------------------------------
 // forward declaration since SdVolume is used in SdFile
 class SdVolume;
 //==============================================================================
@@ -224,6 +295,8 @@ class SdFile {
   uint8_t makeDir(SdFile* dir, const char* dirName);
   uint8_t open(SdFile* dirFile, uint16_t index, uint8_t oflag);
   uint8_t open(SdFile* dirFile, const char* fileName, uint8_t oflag);
+  uint8_t open(SdVolume* vol, uint32_t dirBlock, uint8_t dirIndex, uint8_t oflag);
+  uint8_t openNext(SdFile* dirFile, uint8_t oflag);
 
   uint8_t openRoot(SdVolume* vol);
   static void printDirName(const dir_t& dir, uint8_t width);
@@ -373,14 +446,16 @@ class SdFile {
   // should be 0XF
   static uint8_t const F_OFLAG = (O_ACCMODE | O_APPEND | O_SYNC);
   // available bits
-  static uint8_t const F_UNUSED = 0X30;
+  static uint8_t const F_UNUSED = 0X10;
+  // clusters found with the volume's chain map, see SdVolume::chainCluster()
+  static uint8_t const F_FILE_CHAIN_MAP = 0X20;
   // use unbuffered SD read
   static uint8_t const F_FILE_UNBUFFERED_READ = 0X40;
   // sync of directory entry required
   static uint8_t const F_FILE_DIR_DIRTY = 0X80;
 
 // make sure F_OFLAG is ok
-#if ((F_UNUSED | F_FILE_UNBUFFERED_READ | F_FILE_DIR_DIRTY) & F_OFLAG)
+#if ((F_UNUSED | F_FILE_CHAIN_MAP | F_FILE_UNBUFFERED_READ | F_FILE_DIR_DIRTY) & F_OFLAG)
 #error flags_ bits conflict
 #endif  // flags_ bits
 
@@ -401,6 +476,14 @@ class SdFile {
   dir_t* cacheDirEntry(uint8_t action);
   static void (*dateTime_)(uint16_t* date, uint16_t* time);
   static uint8_t make83Name(const char* str, uint8_t* name);
+#if SD_NAME_INDEXES
+  // results of nameFind()
+  static uint8_t const NAME_FOUND = 0;   // the entry is in the cache
+  static uint8_t const NAME_ABSENT = 1;  // no entry has the name
+  static uint8_t const NAME_SEARCH = 2;  // search from the entry returned
+  static uint8_t nameFind(SdFile* dirFile, const uint8_t* dname,
+    uint16_t* index);
+#endif  // SD_NAME_INDEXES
   uint8_t openCachedEntry(uint8_t cacheIndex, uint8_t oflags);
   dir_t* readDirCache(void);
 };
@@ -423,6 +506,43 @@ union cache_t {
            /** Used to access to a cached FAT boot sector. */
   fbs_t    fbs;
 };
+/**
+ * \brief SdVolume cache and lock counters
+ */
+struct cache_stats_t {
+           /** FAT block lookups found in the cache. */
+  uint32_t fatHits;
+           /** FAT block lookups read from the card. */
+  uint32_t fatMisses;
+           /** Directory and data block lookups found in the cache. */
+  uint32_t dataHits;
+           /** Directory and data block lookups read from the card. */
+  uint32_t dataMisses;
+           /** Dirty blocks written to make room for another block. */
+  uint32_t writeBacks;
+           /** Cluster chain walks to fill a chain map. */
+  uint32_t chainWalks;
+           /** Read-ahead fills, one multiple block read each. */
+  uint32_t aheadFills;
+           /** Blocks fetched by the read-ahead. */
+  uint32_t aheadBlocks;
+           /** Blocks fetched by the read-ahead and dropped unread. */
+  uint32_t aheadUnused;
+           /** Files and directories opened by name. */
+  uint32_t nameLookups;
+           /** Directory entries read to find them. */
+  uint32_t nameEntries;
+           /** Times the volume lock was taken. */
+  uint32_t locks;
+           /** Times a task had to wait for it. */
+  uint32_t lockWaits;
+           /** Microseconds spent waiting, in all. */
+  uint32_t lockWaitUs;
+           /** Longest wait, microseconds. */
+  uint32_t maxLockWaitUs;
+           /** Longest time it was held, microseconds. */
+  uint32_t maxLockHoldUs;
+};
 //------------------------------------------------------------------------------
 /**
  * \class SdVolume
@@ -437,9 +557,24 @@ class SdVolume {
    */
   static uint8_t* cacheClear(void) {
     cacheFlush();
-    cacheBlockNumber_ = 0XFFFFFFFF;
-    return cacheBuffer_.data;
+    cacheInvalidate();
+    return cacheBuffer_->data;
   }
+  /** \return The cache hit and miss counters since the start. */
+  static const cache_stats_t& cacheStats(void) {return cacheStats_;}
+  /**
+   * Take the volume lock.  The cache, the chain maps, the read-ahead and
+   * the card are shared by every file, so the SD library is used by one
+   * task at a time: SD.h takes the lock in each call that reaches them,
+   * for that call only.  Code that calls SdFile, SdVolume, Sd2Card or
+   * SdRawStream directly takes it itself, see SdVolumeLock.  The lock is
+   * not recursive.
+   */
+  static void lock(void);
+  /** Create the volume lock.  SD.begin() does, before any other call. */
+  static void lockInit(void);
+  /** Release the volume lock. */
+  static void unlock(void);
   /**
    * Initialize a FAT volume.  Try partition one first then try super
    * floppy format.
@@ -499,11 +634,62 @@ class SdVolume {
   // value for action argument in cacheRawBlock to indicate cache dirty
   static uint8_t const CACHE_FOR_WRITE = 1;
 
-  static cache_t cacheBuffer_;        // 512 byte cache for device blocks
-  static uint32_t cacheBlockNumber_;  // Logical number of block in the cache
+  // state of one cache block
+  struct cache_slot_t {
+    uint32_t blockNumber;  // Logical number of block in the slot
+    uint32_t mirrorBlock;  // block number for mirror FAT
+    uint32_t lastUse;      // cacheUseCount_ when last used, for LRU
+    uint8_t valid;         // blockNumber is in the slot
+    uint8_t dirty;         // cacheFlush() will write block if true
+  };
+  static cache_t cacheBlock_[SD_CACHE_SLOTS];      // 512 byte device blocks
+  static cache_slot_t cacheSlot_[SD_CACHE_SLOTS];
+  static uint32_t cacheUseCount_;     // cache lookups so far
+  static cache_stats_t cacheStats_;
+  static uint8_t cacheCurrent_;       // slot of the last block cached
+  static cache_t* cacheBuffer_;       // its data, cacheBlock_[cacheCurrent_]
+  static uint32_t cacheBlockNumber_;  // and its block number
   static Sd2Card* sdCard_;            // Sd2Card object for cache
-  static uint8_t cacheDirty_;         // cacheFlush() will write block if true
-  static uint32_t cacheMirrorBlock_;  // block number for mirror FAT
+  static OS_EVENT* lock_;             // mutex of lock(), see lockInit()
+  static uint32_t lockedAt_;          // CYCLE_COUNT() when it was taken
+
+  // a run of consecutive clusters in a chain
+  struct chain_extent_t {
+    uint32_t cluster;      // first cluster of the run
+    uint32_t count;        // consecutive clusters
+  };
+  // part of the cluster chain of a file open for read
+  struct chain_map_t {
+    uint32_t firstCluster; // of the file, zero if the map is unused
+    uint32_t base;         // index in the chain of extent[0].cluster
+    uint32_t lastUse;      // chainUseCount_ when last used, for LRU
+    uint8_t count;         // extents mapped
+    uint8_t end;           // the last extent ends the file
+    chain_extent_t extent[SD_CHAIN_EXTENTS];
+  };
+  static chain_map_t chainMap_[SD_CHAIN_MAPS];
+  static uint32_t chainUseCount_;
+  // blocks read ahead of a file being read, see readAhead()
+  static cache_t aheadBlock_[SD_READAHEAD_BLOCKS];
+  static uint32_t aheadFirst_;        // block number of aheadBlock_[0]
+  static uint8_t aheadCount_;         // blocks held, zero if none
+  static uint8_t aheadUsed_;          // blocks up to the last one read
+  static uint32_t aheadTick_;         // OSTimeGet() when they were fetched
+#if SD_NAME_INDEXES
+  // hash index of the 8.3 names in a directory, see SdFile::nameFind()
+  struct name_index_t {
+    uint32_t dirCluster;   // first cluster of the directory, 0 for FAT16 root
+    uint32_t lastUse;      // nameUseCount_ when last used, for LRU
+    uint16_t next;         // first entry not indexed
+    uint16_t count;        // entries indexed
+    uint8_t valid;         // the index is of dirCluster
+    uint8_t end;           // the entries up to the end are indexed
+    uint16_t entry[SD_NAME_INDEX_SLOTS];  // entry index + 1, zero if free
+    uint8_t tag[SD_NAME_INDEX_SLOTS];     // high byte of the name's hash
+  };
+  static name_index_t nameIndex_[SD_NAME_INDEXES];
+  static uint32_t nameUseCount_;
+#endif  // SD_NAME_INDEXES
 //
   uint32_t allocSearchStart_;   // start cluster for alloc search
   uint8_t blocksPerCluster_;    // cluster size in blocks
@@ -517,6 +703,8 @@ class SdVolume {
   uint16_t rootDirEntryCount_;  // number of entries in FAT16 root dir
   uint32_t rootDirStart_;       // root start block for FAT16, cluster for FAT32
   //----------------------------------------------------------------------------
+  static uint8_t* aheadFind(uint32_t blockNumber);
+  static void aheadInvalidate(void);
   uint8_t allocContiguous(uint32_t count, uint32_t* curCluster);
   uint8_t blockOfCluster(uint32_t position) const {
           return (position >> 9) & (blocksPerCluster_ - 1);}
@@ -524,10 +712,33 @@ class SdVolume {
            return dataStartBlock_ + ((cluster - 2) << clusterSizeShift_);}
   uint32_t blockNumber(uint32_t cluster, uint32_t position) const {
            return clusterStartBlock(cluster) + blockOfCluster(position);}
+  static uint8_t cacheBlock(uint32_t blockNumber, uint8_t action, uint8_t fat);
+  static uint8_t cacheFatBlock(uint32_t blockNumber, uint8_t action) {
+    return cacheBlock(blockNumber, action, true);
+  }
+  static uint8_t cacheFind(uint32_t blockNumber);
   static uint8_t cacheFlush(void);
-  static uint8_t cacheRawBlock(uint32_t blockNumber, uint8_t action);
-  static void cacheSetDirty(void) {cacheDirty_ |= CACHE_FOR_WRITE;}
+  static uint8_t cacheHas(uint32_t blockNumber) {
+    return cacheFind(blockNumber) < SD_CACHE_SLOTS;
+  }
+  static void cacheInvalidate(void);
+  static void cacheInvalidate(uint32_t blockNumber);
+  static uint8_t cacheNewBlock(uint32_t blockNumber);
+  static uint8_t cacheRawBlock(uint32_t blockNumber, uint8_t action) {
+    return cacheBlock(blockNumber, action, false);
+  }
+  static void cacheSelect(uint8_t slot);
+  static void cacheSetDirty(void) {
+    cacheSlot_[cacheCurrent_].dirty |= CACHE_FOR_WRITE;
+  }
+  static uint8_t cacheVictim(uint8_t fat);
+  static uint8_t cacheWriteBack(uint8_t slot);
   static uint8_t cacheZeroBlock(uint32_t blockNumber);
+  uint8_t chainCluster(uint32_t firstCluster, uint32_t size,
+    uint32_t index, uint32_t* cluster, uint32_t* run = 0);
+  static void chainInvalidate(void);
+  uint8_t chainMapFill(chain_map_t* map, uint32_t base,
+    uint32_t cluster, uint32_t size);
   uint8_t chainSize(uint32_t beginCluster, uint32_t* size) const;
   uint8_t fatGet(uint32_t cluster, uint32_t* value) const;
   uint8_t fatPut(uint32_t cluster, uint32_t value);
@@ -535,17 +746,39 @@ class SdVolume {
     return fatPut(cluster, 0x0FFFFFFF);
   }
   uint8_t freeChain(uint32_t cluster);
+#if SD_NAME_INDEXES
+  static uint32_t nameHash(const uint8_t* name);
+  static name_index_t* nameIndex(uint32_t dirCluster);
+  static uint8_t nameInsert(name_index_t* index, const uint8_t* name,
+    uint16_t entry);
+#endif  // SD_NAME_INDEXES
+  static void nameInvalidate(void);
   uint8_t isEOC(uint32_t cluster) const {
     return  cluster >= (fatType_ == 16 ? FAT16EOC_MIN : FAT32EOC_MIN);
   }
+  uint8_t* readAhead(uint32_t block, uint32_t count);
   uint8_t readBlock(uint32_t block, uint8_t* dst) {
     return sdCard_->readBlock(block, dst);}
   uint8_t readData(uint32_t block, uint16_t offset,
     uint16_t count, uint8_t* dst) {
       return sdCard_->readData(block, offset, count, dst);
   }
+  uint8_t readStart(uint32_t block) {
+    return sdCard_->readStart(block);
+  }
   uint8_t writeBlock(uint32_t block, const uint8_t* dst) {
+    aheadInvalidate();
     return sdCard_->writeBlock(block, dst);
   }
 };
+//------------------------------------------------------------------------------
+/**
+ * \class SdVolumeLock
+ * \brief Holds SdVolume::lock() for the scope it is declared in.
+ */
+class SdVolumeLock {
+ public:
+  SdVolumeLock(void) {SdVolume::lock();}
+  ~SdVolumeLock(void) {SdVolume::unlock();}
+};
 #endif  // SdFat_h
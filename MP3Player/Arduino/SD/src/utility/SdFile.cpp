@@ -61,7 +61,7 @@ uint8_t SdFile::addDirCluster(void) {
 // return pointer to cached entry or null for failure
 dir_t* SdFile::cacheDirEntry(uint8_t action) {
   if (!SdVolume::cacheRawBlock(dirBlock_, action)) return NULL;
-  return SdVolume::cacheBuffer_.dir + dirIndex_;
+  return SdVolume::cacheBuffer_->dir + dirIndex_;
 }
 //------------------------------------------------------------------------------
 /**
@@ -93,6 +93,21 @@ uint8_t SdFile::contiguousRange(uint32_t* bgnBlock, uint32_t* endBlock) {
   // error if no blocks
   if (firstCluster_ == 0) return false;
 
+  // one run in the chain map covers a file open for read
+  if (flags_ & F_FILE_CHAIN_MAP) {
+    uint32_t cluster;
+    uint32_t run;
+    if (!vol_->chainCluster(firstCluster_, fileSize_, 0, &cluster, &run)) {
+      return false;
+    }
+    if (run < ((fileSize_ - 1) >> (vol_->clusterSizeShift_ + 9)) + 1) {
+      return false;
+    }
+    *bgnBlock = vol_->clusterStartBlock(firstCluster_);
+    *endBlock = vol_->clusterStartBlock(firstCluster_ + run - 1)
+                + vol_->blocksPerCluster_ - 1;
+    return true;
+  }
   for (uint32_t c = firstCluster_; ; c++) {
     uint32_t next;
     if (!vol_->fatGet(c, &next)) return false;
@@ -321,7 +336,7 @@ uint8_t SdFile::makeDir(SdFile* dir, const char* dirName) {
   if (!SdVolume::cacheRawBlock(block, SdVolume::CACHE_FOR_WRITE)) return false;
 
   // copy '.' to block
-  memcpy(&SdVolume::cacheBuffer_.dir[0], &d, sizeof(d));
+  memcpy(&SdVolume::cacheBuffer_->dir[0], &d, sizeof(d));
 
   // make entry for '..'
   d.name[1] = '.';
@@ -333,7 +348,7 @@ uint8_t SdFile::makeDir(SdFile* dir, const char* dirName) {
     d.firstClusterHigh = dir->firstCluster_ >> 16;
   }
   // copy '..' to block
-  memcpy(&SdVolume::cacheBuffer_.dir[1], &d, sizeof(d));
+  memcpy(&SdVolume::cacheBuffer_->dir[1], &d, sizeof(d));
 
   // set position after '..'
   curPosition_ = 2 * sizeof(d);
@@ -397,7 +412,26 @@ uint8_t SdFile::open(SdFile* dirFile, const char* fileName, uint8_t oflag) {
 
   if (!make83Name(fileName, dname)) return false;
   vol_ = dirFile->vol_;
-  dirFile->rewind();
+  SdVolume::cacheStats_.nameLookups++;
+
+  // entry to search from
+  uint16_t from = 0;
+#if SD_NAME_INDEXES
+  switch (nameFind(dirFile, dname, &from)) {
+    case NAME_FOUND:
+      // don't open existing file if O_CREAT and O_EXCL
+      if ((oflag & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL)) return false;
+      return openCachedEntry(0XF & from, oflag);
+
+    case NAME_ABSENT:
+      // search for a free entry only to create the file
+      if ((oflag & (O_CREAT | O_WRITE)) != (O_CREAT | O_WRITE)) return false;
+      break;
+  }
+  // a free entry may be before the ones not indexed
+  if (oflag & O_CREAT) from = 0;
+#endif  // SD_NAME_INDEXES
+  if (!dirFile->seekSet(32UL * from)) return false;
 
   // bool for empty entry found
   uint8_t emptyFound = false;
@@ -407,6 +441,7 @@ uint8_t SdFile::open(SdFile* dirFile, const char* fileName, uint8_t oflag) {
     uint8_t index = 0XF & (dirFile->curPosition_ >> 5);
     p = dirFile->readDirCache();
     if (p == NULL) return false;
+    SdVolume::cacheStats_.nameEntries++;
 
     if (p->name[0] == DIR_NAME_FREE || p->name[0] == DIR_NAME_DELETED) {
       // remember first empty slot
@@ -428,6 +463,9 @@ uint8_t SdFile::open(SdFile* dirFile, const char* fileName, uint8_t oflag) {
   // only create file if O_CREAT and O_WRITE
   if ((oflag & (O_CREAT | O_WRITE)) != (O_CREAT | O_WRITE)) return false;
 
+  // the name indexes do not have the new entry
+  SdVolume::nameInvalidate();
+
   // cache found slot or add cluster if end of file
   if (emptyFound) {
     p = cacheDirEntry(SdVolume::CACHE_FOR_WRITE);
@@ -440,7 +478,7 @@ uint8_t SdFile::open(SdFile* dirFile, const char* fileName, uint8_t oflag) {
 
     // use first entry in cluster
     dirIndex_ = 0;
-    p = SdVolume::cacheBuffer_.dir;
+    p = SdVolume::cacheBuffer_->dir;
   }
   // initialize as empty file
   memset(p, 0, sizeof(dir_t));
@@ -504,11 +542,159 @@ uint8_t SdFile::open(SdFile* dirFile, uint16_t index, uint8_t oflag) {
   // open cached entry
   return openCachedEntry(index & 0XF, oflag);
 }
+#if SD_NAME_INDEXES
+//------------------------------------------------------------------------------
+// Find the entry named dname in dirFile with the directory's name index,
+// indexing the entries read on the way: each is read once while the index
+// is kept.  NAME_FOUND, the entry, the *index-th, is in the cache.
+// NAME_SEARCH, the index is full or a read failed: search from *index.
+uint8_t SdFile::nameFind(SdFile* dirFile, const uint8_t* dname,
+  uint16_t* index) {
+  SdVolume::name_index_t* x = SdVolume::nameIndex(dirFile->firstCluster_);
+  uint32_t h = SdVolume::nameHash(dname);
+  dir_t* p;
+  *index = 0;
+
+  // the entries indexed with the name's hash
+  for (uint16_t slot = h & (SD_NAME_INDEX_SLOTS - 1); x->entry[slot];
+    slot = (slot + 1) & (SD_NAME_INDEX_SLOTS - 1)) {
+    if (x->tag[slot] != (uint8_t)(h >> 24)) continue;
+    uint16_t i = x->entry[slot] - 1;
+    if (!dirFile->seekSet(32UL * i)) return NAME_SEARCH;
+    p = dirFile->readDirCache();
+    if (p == NULL) return NAME_SEARCH;
+    SdVolume::cacheStats_.nameEntries++;
+    if (!memcmp(dname, p->name, 11)) {
+      *index = i;
+      return NAME_FOUND;
+    }
+  }
+  if (x->end) return NAME_ABSENT;
+
+  // read on from the first entry not indexed until the name turns up
+  if (!dirFile->seekSet(32UL * x->next)) return NAME_SEARCH;
+  while (dirFile->curPosition_ < dirFile->fileSize_) {
+    uint16_t i = x->next;
+    if (i == 0XFFFF) {
+      // past what an index holds
+      *index = i;
+      return NAME_SEARCH;
+    }
+    p = dirFile->readDirCache();
+    if (p == NULL) return NAME_SEARCH;
+    SdVolume::cacheStats_.nameEntries++;
+
+    // done if past last used entry
+    if (p->name[0] == DIR_NAME_FREE) break;
+    if (p->name[0] != DIR_NAME_DELETED) {
+      if (!SdVolume::nameInsert(x, p->name, i)) {
+        // full, the rest is searched
+        *index = i;
+        return NAME_SEARCH;
+      }
+      if (!memcmp(dname, p->name, 11)) {
+        x->next = i + 1;
+        *index = i;
+        return NAME_FOUND;
+      }
+    }
+    x->next = i + 1;
+  }
+  x->end = true;
+  return NAME_ABSENT;
+}
+#endif  // SD_NAME_INDEXES
+//------------------------------------------------------------------------------
+/**
+ * Open the next file or subdirectory in a directory.
+ *
+ * \param[in] dirFile An open SdFat instance for the directory, positioned
+ * at an entry.  It is left after the entry of the file opened.
+ *
+ * \param[in] oflag Values for \a oflag are constructed by a bitwise-inclusive
+ * OR of flags O_READ, O_WRITE, O_TRUNC, and O_SYNC.
+ *
+ * The entry is opened where the directory read left it in the cache, with
+ * no search by name.
+ *
+ * \return The value one, true, is returned for success and
+ * the value zero, false, is returned at the end of the directory or for
+ * failure.
+ */
+uint8_t SdFile::openNext(SdFile* dirFile, uint8_t oflag) {
+  // error if already open or misplaced in the directory
+  if (isOpen() || (0X1F & dirFile->curPosition_)) return false;
+
+  // don't open existing file if O_CREAT and O_EXCL - user call error
+  if ((oflag & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL)) return false;
+
+  vol_ = dirFile->vol_;
+
+  while (dirFile->curPosition_ < dirFile->fileSize_) {
+    // index of entry in cache, before readDirCache() advances past it
+    uint8_t index = (dirFile->curPosition_ >> 5) & 0XF;
+    dir_t* p = dirFile->readDirCache();
+    if (p == NULL) return false;
+
+    // done if past last used entry
+    if (p->name[0] == DIR_NAME_FREE) return false;
+
+    // skip deleted entry and entries for . and ..
+    if (p->name[0] == DIR_NAME_DELETED || p->name[0] == '.') continue;
+
+    // only open subdirectories and files
+    if (DIR_IS_FILE_OR_SUBDIR(p)) return openCachedEntry(index, oflag);
+  }
+  return false;
+}
+//------------------------------------------------------------------------------
+/**
+ * Open a file by the location of its directory entry.
+ *
+ * \param[in] vol The FAT volume containing the file.
+ *
+ * \param[in] dirBlock The block holding the file's directory entry, as
+ * returned by dirBlock() for the file when it was open before.
+ *
+ * \param[in] dirIndex The index of the entry in \a dirBlock, as returned
+ * by dirIndex().
+ *
+ * \param[in] oflag Values for \a oflag are constructed by a bitwise-inclusive
+ * OR of flags O_READ, O_WRITE, O_TRUNC, and O_SYNC.
+ *
+ * The directory is not searched: this reads one block at most, none if the
+ * block is in the cache.  See open() by fileName for definition of flags and
+ * return values.
+ */
+uint8_t SdFile::open(SdVolume* vol, uint32_t dirBlock, uint8_t dirIndex,
+                     uint8_t oflag) {
+  // error if already open, or not an entry of a directory
+  if (isOpen() || dirBlock == 0 || dirIndex > 0XF) return false;
+
+  // don't open existing file if O_CREAT and O_EXCL - user call error
+  if ((oflag & (O_CREAT | O_EXCL)) == (O_CREAT | O_EXCL)) return false;
+
+  vol_ = vol;
+
+  // read entry into cache
+  if (!SdVolume::cacheRawBlock(dirBlock, SdVolume::CACHE_FOR_READ)) {
+    return false;
+  }
+  dir_t* p = SdVolume::cacheBuffer_->dir + dirIndex;
+
+  // error if empty slot or '.' or '..'
+  if (p->name[0] == DIR_NAME_FREE ||
+      p->name[0] == DIR_NAME_DELETED || p->name[0] == '.') {
+    return false;
+  }
+  // open cached entry
+  return openCachedEntry(dirIndex, oflag);
+}
 //------------------------------------------------------------------------------
 // open a cached directory entry. Assumes vol_ is initializes
 uint8_t SdFile::openCachedEntry(uint8_t dirIndex, uint8_t oflag) {
   // location of entry in cache
-  dir_t* p = SdVolume::cacheBuffer_.dir + dirIndex;
+  dir_t* p = SdVolume::cacheBuffer_->dir + dirIndex;
 
   // write or truncate is an error for a directory or read-only file
   if (p->attributes & (DIR_ATT_READ_ONLY | DIR_ATT_DIRECTORY)) {
@@ -535,6 +721,11 @@ uint8_t SdFile::openCachedEntry(uint8_t dirIndex, uint8_t oflag) {
   // save open flags for read/write
   flags_ = oflag & (O_ACCMODE | O_SYNC | O_APPEND);
 
+  // a file that is only read keeps its chain, so the volume can map it
+  if (type_ == FAT_FILE_TYPE_NORMAL && !(oflag & O_WRITE) && firstCluster_) {
+    flags_ |= F_FILE_CHAIN_MAP;
+  }
+
   // set to start of file
   curCluster_ = 0;
   curPosition_ = 0;
@@ -678,13 +869,19 @@ int16_t SdFile::read(void* buf, uint16_t nbyte) {
   while (toRead > 0) {
     uint32_t block;  // raw device block number
     uint16_t offset = curPosition_ & 0X1FF;  // offset in block
+    uint8_t* src = 0;  // block data in the read-ahead
     if (type_ == FAT_FILE_TYPE_ROOT16) {
       block = vol_->rootDirStart() + (curPosition_ >> 9);
     } else {
       uint8_t blockOfCluster = vol_->blockOfCluster(curPosition_);
       if (offset == 0 && blockOfCluster == 0) {
         // start of new cluster
-        if (curPosition_ == 0) {
+        if (flags_ & F_FILE_CHAIN_MAP) {
+          if (!vol_->chainCluster(firstCluster_, fileSize_,
+            curPosition_ >> (vol_->clusterSizeShift_ + 9), &curCluster_)) {
+            return -1;
+          }
+        } else if (curPosition_ == 0) {
           // use first cluster in file
           curCluster_ = firstCluster_;
         } else {
@@ -693,6 +890,27 @@ int16_t SdFile::read(void* buf, uint16_t nbyte) {
         }
       }
       block = vol_->clusterStartBlock(curCluster_) + blockOfCluster;
+
+      if (flags_ & F_FILE_CHAIN_MAP) {
+        // read ahead, as far as the clusters run on and the file goes; the
+        // cache first, it may hold the block written since it was read ahead
+        if (!SdVolume::cacheHas(block) && !(src = SdVolume::aheadFind(block))) {
+          uint32_t cluster;
+          uint32_t run;
+          if (!vol_->chainCluster(firstCluster_, fileSize_,
+            curPosition_ >> (vol_->clusterSizeShift_ + 9), &cluster, &run)) {
+            return -1;
+          }
+          uint32_t count = (run << vol_->clusterSizeShift_) - blockOfCluster;
+          uint32_t left = ((fileSize_ - 1) >> 9) - (curPosition_ >> 9) + 1;
+          if (count > left) count = left;
+          src = vol_->readAhead(block, count);
+          if (!src) return -1;
+        }
+      } else if (offset == 0 && isFile() && blockOfCluster < vol_->blocksPerCluster() - 1
+        && fileSize_ - curPosition_ > 512 && !SdVolume::cacheHas(block)) {
+        if (!vol_->readStart(block)) return -1;
+      }
     }
     uint16_t n = toRead;
 
@@ -700,14 +918,18 @@ int16_t SdFile::read(void* buf, uint16_t nbyte) {
     if (n > (512 - offset)) n = 512 - offset;
 
     // no buffering needed if n == 512 or user requests no buffering
-    if ((unbufferedRead() || n == 512) &&
-      block != SdVolume::cacheBlockNumber_) {
+    if (!src && (unbufferedRead() || n == 512) && !SdVolume::cacheHas(block)) {
       if (!vol_->readData(block, offset, n, dst)) return -1;
       dst += n;
     } else {
-      // read block to cache and copy data to caller
-      if (!SdVolume::cacheRawBlock(block, SdVolume::CACHE_FOR_READ)) return -1;
-      uint8_t* src = SdVolume::cacheBuffer_.data + offset;
+      // read block to cache unless read ahead and copy data to caller
+      if (!src) {
+        if (!SdVolume::cacheRawBlock(block, SdVolume::CACHE_FOR_READ)) {
+          return -1;
+        }
+        src = SdVolume::cacheBuffer_->data;
+      }
+      src += offset;
       uint8_t* end = src + n;
       while (src != end) *dst++ = *src++;
     }
@@ -761,7 +983,7 @@ dir_t* SdFile::readDirCache(void) {
   curPosition_ += 31;
 
   // return pointer to entry
-  return (SdVolume::cacheBuffer_.dir + i);
+  return (SdVolume::cacheBuffer_->dir + i);
 }
 //------------------------------------------------------------------------------
 /**
@@ -788,6 +1010,7 @@ uint8_t SdFile::remove(void) {
 
   // mark entry deleted
   d->name[0] = DIR_NAME_DELETED;
+  SdVolume::nameInvalidate();
 
   // set this SdFile closed
   type_ = FAT_FILE_TYPE_CLOSED;
@@ -903,7 +1126,7 @@ uint8_t SdFile::rmRfStar(void) {
       if (!f.remove()) return false;
     }
     // position to next entry if required
-    if (curPosition_ != (32*(index + 1))) {
+    if (curPosition_ != 32U*(index + 1)) {
       if (!seekSet(32*(index + 1))) return false;
     }
   }
@@ -934,6 +1157,14 @@ uint8_t SdFile::seekSet(uint32_t pos) {
     curPosition_ = 0;
     return true;
   }
+  if (flags_ & F_FILE_CHAIN_MAP) {
+    if (!vol_->chainCluster(firstCluster_, fileSize_,
+      (pos - 1) >> (vol_->clusterSizeShift_ + 9), &curCluster_)) {
+      return false;
+    }
+    curPosition_ = pos;
+    return true;
+  }
   // calculate cluster index for cur and new position
   uint32_t nCur = (curPosition_ - 1) >> (vol_->clusterSizeShift_ + 9);
   uint32_t nNew = (pos - 1) >> (vol_->clusterSizeShift_ + 9);
@@ -1177,24 +1408,20 @@ size_t SdFile::write(const void* buf, uint16_t nbyte) {
     if (n == 512) {
       // full block - don't need to use cache
       // invalidate cache if block is in cache
-      if (SdVolume::cacheBlockNumber_ == block) {
-        SdVolume::cacheBlockNumber_ = 0XFFFFFFFF;
-      }
+      SdVolume::cacheInvalidate(block);
       if (!vol_->writeBlock(block, src)) goto writeErrorReturn;
       src += 512;
     } else {
       if (blockOffset == 0 && curPosition_ >= fileSize_) {
         // start of new block don't need to read into cache
-        if (!SdVolume::cacheFlush()) goto writeErrorReturn;
-        SdVolume::cacheBlockNumber_ = block;
-        SdVolume::cacheSetDirty();
+        if (!SdVolume::cacheNewBlock(block)) goto writeErrorReturn;
       } else {
         // rewrite part of block
         if (!SdVolume::cacheRawBlock(block, SdVolume::CACHE_FOR_WRITE)) {
           goto writeErrorReturn;
         }
       }
-      uint8_t* dst = SdVolume::cacheBuffer_.data + blockOffset;
+      uint8_t* dst = SdVolume::cacheBuffer_->data + blockOffset;
       uint8_t* end = dst + n;
       while (dst != end) *dst++ = *src++;
     }
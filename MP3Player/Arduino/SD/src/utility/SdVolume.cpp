@@ -18,14 +18,50 @@
  * <http://www.gnu.org/licenses/>.
  */
 #include "SdFat.h"
+#include "bsp.h"
 //------------------------------------------------------------------------------
-// raw block cache
+// raw block cache, SD_CACHE_SLOTS blocks with least recently used replacement
+cache_t  SdVolume::cacheBlock_[SD_CACHE_SLOTS];  // 512 byte blocks for Sd2Card
+SdVolume::cache_slot_t SdVolume::cacheSlot_[SD_CACHE_SLOTS];  // all invalid
+uint32_t SdVolume::cacheUseCount_ = 0;
+cache_stats_t SdVolume::cacheStats_;
+uint8_t  SdVolume::cacheCurrent_ = 0;
+cache_t* SdVolume::cacheBuffer_ = &SdVolume::cacheBlock_[0];
 // init cacheBlockNumber_to invalid SD block number
 uint32_t SdVolume::cacheBlockNumber_ = 0XFFFFFFFF;
-cache_t  SdVolume::cacheBuffer_;     // 512 byte cache for Sd2Card
 Sd2Card* SdVolume::sdCard_;          // pointer to SD card object
-uint8_t  SdVolume::cacheDirty_ = 0;  // cacheFlush() will write block if true
-uint32_t SdVolume::cacheMirrorBlock_ = 0;  // mirror  block for second FAT
+// volume lock, created by SD.begin()
+OS_EVENT* SdVolume::lock_;
+uint32_t SdVolume::lockedAt_;
+// cluster chains of files open for read, SD_CHAIN_MAPS of them, all unused
+SdVolume::chain_map_t SdVolume::chainMap_[SD_CHAIN_MAPS];
+uint32_t SdVolume::chainUseCount_ = 0;
+// read-ahead of the file being read, empty
+cache_t  SdVolume::aheadBlock_[SD_READAHEAD_BLOCKS];
+uint32_t SdVolume::aheadFirst_;
+uint8_t  SdVolume::aheadCount_ = 0;
+uint8_t  SdVolume::aheadUsed_ = 0;
+uint32_t SdVolume::aheadTick_;
+#if SD_NAME_INDEXES
+// 8.3 names of directories, SD_NAME_INDEXES of them, all unused
+SdVolume::name_index_t SdVolume::nameIndex_[SD_NAME_INDEXES];
+uint32_t SdVolume::nameUseCount_ = 0;
+#endif  // SD_NAME_INDEXES
+//------------------------------------------------------------------------------
+// return the data of blockNumber if the read-ahead holds it, else NULL
+uint8_t* SdVolume::aheadFind(uint32_t blockNumber) {
+  uint32_t i = blockNumber - aheadFirst_;
+  if (i >= aheadCount_) return 0;
+  if (i >= aheadUsed_) aheadUsed_ = i + 1;
+  return aheadBlock_[i].data;
+}
+//------------------------------------------------------------------------------
+// drop the read-ahead, blocks on the card are about to change
+void SdVolume::aheadInvalidate(void) {
+  cacheStats_.aheadUnused += aheadCount_ - aheadUsed_;
+  aheadCount_ = 0;
+  aheadUsed_ = 0;
+}
 //------------------------------------------------------------------------------
 // find a contiguous group of clusters
 uint8_t SdVolume::allocContiguous(uint32_t count, uint32_t* curCluster) {
@@ -96,43 +132,246 @@ uint8_t SdVolume::allocContiguous(uint32_t count, uint32_t* curCluster) {
   return true;
 }
 //------------------------------------------------------------------------------
+// cache blockNumber in a FAT slot if fat is true else in a data slot
+uint8_t SdVolume::cacheBlock(uint32_t blockNumber, uint8_t action,
+                             uint8_t fat) {
+  uint8_t slot = cacheFind(blockNumber);
+  if (slot < SD_CACHE_SLOTS) {
+    if (fat) {
+      cacheStats_.fatHits++;
+    } else {
+      cacheStats_.dataHits++;
+    }
+  } else {
+    if (fat) {
+      cacheStats_.fatMisses++;
+    } else {
+      cacheStats_.dataMisses++;
+    }
+    slot = cacheVictim(fat);
+    if (cacheSlot_[slot].dirty) cacheStats_.writeBacks++;
+    if (!cacheWriteBack(slot)) return false;
+    cache_slot_t* s = &cacheSlot_[slot];
+    s->valid = false;
+    if (!sdCard_->readBlock(blockNumber, cacheBlock_[slot].data)) {
+      if (slot == cacheCurrent_) cacheBlockNumber_ = 0XFFFFFFFF;
+      return false;
+    }
+    s->blockNumber = blockNumber;
+    s->valid = true;
+  }
+  cacheSelect(slot);
+  cacheSlot_[slot].dirty |= action;
+  if (action == CACHE_FOR_WRITE) aheadInvalidate();
+  return true;
+}
+//------------------------------------------------------------------------------
+// return the slot holding blockNumber or SD_CACHE_SLOTS if not cached
+uint8_t SdVolume::cacheFind(uint32_t blockNumber) {
+  for (uint8_t i = 0; i < SD_CACHE_SLOTS; i++) {
+    if (cacheSlot_[i].valid && cacheSlot_[i].blockNumber == blockNumber) {
+      return i;
+    }
+  }
+  return SD_CACHE_SLOTS;
+}
+//------------------------------------------------------------------------------
+// write all dirty blocks
 uint8_t SdVolume::cacheFlush(void) {
-  if (cacheDirty_) {
-    if (!sdCard_->writeBlock(cacheBlockNumber_, cacheBuffer_.data)) {
+  for (uint8_t i = 0; i < SD_CACHE_SLOTS; i++) {
+    if (!cacheWriteBack(i)) return false;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+// drop all blocks without writing them
+void SdVolume::cacheInvalidate(void) {
+  for (uint8_t i = 0; i < SD_CACHE_SLOTS; i++) {
+    cacheSlot_[i].valid = false;
+    cacheSlot_[i].dirty = 0;
+    cacheSlot_[i].mirrorBlock = 0;
+  }
+  cacheBlockNumber_ = 0XFFFFFFFF;
+  aheadInvalidate();
+}
+//------------------------------------------------------------------------------
+// drop blockNumber if cached or read ahead, it is about to be written
+// around the cache
+void SdVolume::cacheInvalidate(uint32_t blockNumber) {
+  if (blockNumber - aheadFirst_ < aheadCount_) aheadInvalidate();
+  uint8_t slot = cacheFind(blockNumber);
+  if (slot < SD_CACHE_SLOTS) {
+    cacheSlot_[slot].valid = false;
+    cacheSlot_[slot].dirty = 0;
+    cacheSlot_[slot].mirrorBlock = 0;
+    if (slot == cacheCurrent_) cacheBlockNumber_ = 0XFFFFFFFF;
+  }
+}
+//------------------------------------------------------------------------------
+// cache blockNumber for write without reading it, the caller fills it in
+uint8_t SdVolume::cacheNewBlock(uint32_t blockNumber) {
+  uint8_t slot = cacheFind(blockNumber);
+  if (slot >= SD_CACHE_SLOTS) {
+    slot = cacheVictim(false);
+    if (cacheSlot_[slot].dirty) cacheStats_.writeBacks++;
+    if (!cacheWriteBack(slot)) return false;
+    cacheSlot_[slot].blockNumber = blockNumber;
+    cacheSlot_[slot].valid = true;
+  }
+  cacheSelect(slot);
+  cacheSetDirty();
+  aheadInvalidate();
+  return true;
+}
+//------------------------------------------------------------------------------
+// make slot the one cacheBuffer_ and cacheBlockNumber_ refer to
+void SdVolume::cacheSelect(uint8_t slot) {
+  cacheCurrent_ = slot;
+  cacheBuffer_ = &cacheBlock_[slot];
+  cacheBlockNumber_ = cacheSlot_[slot].blockNumber;
+  cacheSlot_[slot].lastUse = ++cacheUseCount_;
+}
+//------------------------------------------------------------------------------
+// slot to reuse: an empty one or the least recently used of the FAT slots
+// if fat is true else of the data slots
+uint8_t SdVolume::cacheVictim(uint8_t fat) {
+  uint8_t first = 0;
+  uint8_t end = SD_CACHE_SLOTS;
+  if (SD_CACHE_FAT_SLOTS) {
+    if (fat) {
+      end = SD_CACHE_FAT_SLOTS;
+    } else {
+      first = SD_CACHE_FAT_SLOTS;
+    }
+  }
+  uint8_t victim = first;
+  uint32_t oldest = 0;
+  for (uint8_t i = first; i < end; i++) {
+    if (!cacheSlot_[i].valid) return i;
+    // age rather than lastUse itself, so wrap around does not matter
+    uint32_t age = cacheUseCount_ - cacheSlot_[i].lastUse;
+    if (age > oldest) {
+      oldest = age;
+      victim = i;
+    }
+  }
+  return victim;
+}
+//------------------------------------------------------------------------------
+// write slot if dirty
+uint8_t SdVolume::cacheWriteBack(uint8_t slot) {
+  cache_slot_t* s = &cacheSlot_[slot];
+  if (s->valid && s->dirty) {
+    if (!sdCard_->writeBlock(s->blockNumber, cacheBlock_[slot].data)) {
       return false;
     }
     // mirror FAT tables
-    if (cacheMirrorBlock_) {
-      if (!sdCard_->writeBlock(cacheMirrorBlock_, cacheBuffer_.data)) {
+    if (s->mirrorBlock) {
+      if (!sdCard_->writeBlock(s->mirrorBlock, cacheBlock_[slot].data)) {
         return false;
       }
-      cacheMirrorBlock_ = 0;
+      s->mirrorBlock = 0;
     }
-    cacheDirty_ = 0;
+    s->dirty = 0;
   }
   return true;
 }
 //------------------------------------------------------------------------------
-uint8_t SdVolume::cacheRawBlock(uint32_t blockNumber, uint8_t action) {
-  if (cacheBlockNumber_ != blockNumber) {
-    if (!cacheFlush()) return false;
-    if (!sdCard_->readBlock(blockNumber, cacheBuffer_.data)) return false;
-    cacheBlockNumber_ = blockNumber;
+// cache a zero block for blockNumber
+uint8_t SdVolume::cacheZeroBlock(uint32_t blockNumber) {
+  if (!cacheNewBlock(blockNumber)) return false;
+
+  // loop take less flash than memset(cacheBuffer_->data, 0, 512);
+  for (uint16_t i = 0; i < 512; i++) {
+    cacheBuffer_->data[i] = 0;
   }
-  cacheDirty_ |= action;
   return true;
 }
 //------------------------------------------------------------------------------
-// cache a zero block for blockNumber
-uint8_t SdVolume::cacheZeroBlock(uint32_t blockNumber) {
-  if (!cacheFlush()) return false;
+// Find the index-th cluster of the chain that starts with firstCluster, a
+// file of size bytes, in its chain map.  The chain is walked when the map is
+// filled: once for a file in up to SD_CHAIN_EXTENTS pieces.  If run is not
+// NULL it receives the number of consecutive clusters from that one on.
+uint8_t SdVolume::chainCluster(uint32_t firstCluster, uint32_t size,
+  uint32_t index, uint32_t* cluster, uint32_t* run) {
+  uint32_t clusters = size ? ((size - 1) >> (clusterSizeShift_ + 9)) + 1 : 0;
+  if (index >= clusters) return false;
 
-  // loop take less flash than memset(cacheBuffer_.data, 0, 512);
-  for (uint16_t i = 0; i < 512; i++) {
-    cacheBuffer_.data[i] = 0;
+  // the file's map, or the least recently used one
+  chain_map_t* map = chainMap_;
+  for (uint8_t i = 0; i < SD_CHAIN_MAPS; i++) {
+    chain_map_t* m = &chainMap_[i];
+    if (m->firstCluster == firstCluster) {
+      map = m;
+      break;
+    }
+    if ((chainUseCount_ - m->lastUse) > (chainUseCount_ - map->lastUse)) {
+      map = m;
+    }
   }
-  cacheBlockNumber_ = blockNumber;
-  cacheSetDirty();
+  map->lastUse = ++chainUseCount_;
+  if (map->firstCluster != firstCluster || index < map->base) {
+    map->firstCluster = firstCluster;
+    if (!chainMapFill(map, 0, firstCluster, clusters)) return false;
+  }
+  while (1) {
+    uint32_t i = index - map->base;
+    chain_extent_t* e = map->extent;
+    for (uint8_t n = 0; n < map->count; n++, e++) {
+      if (i < e->count) {
+        *cluster = e->cluster + i;
+        // consecutive clusters from this one on
+        if (run) *run = e->count - i;
+        return true;
+      }
+      i -= e->count;
+    }
+    if (map->end) return false;
+
+    // past the part mapped, map on from the cluster that follows it
+    e--;
+    uint32_t next;
+    if (!fatGet(e->cluster + e->count - 1, &next)) return false;
+    if (next < 2 || isEOC(next)) return false;
+    if (!chainMapFill(map, index - i, next, clusters)) return false;
+  }
+}
+//------------------------------------------------------------------------------
+// forget all chain maps, the FAT has changed
+void SdVolume::chainInvalidate(void) {
+  for (uint8_t i = 0; i < SD_CHAIN_MAPS; i++) chainMap_[i].firstCluster = 0;
+}
+//------------------------------------------------------------------------------
+// map the chain from cluster, its index-th cluster, until SD_CHAIN_EXTENTS
+// runs are mapped or the clusters of the file are
+uint8_t SdVolume::chainMapFill(chain_map_t* map, uint32_t index,
+  uint32_t cluster, uint32_t clusters) {
+  chain_extent_t* e = map->extent;
+  map->base = index;
+  map->count = 1;
+  map->end = false;
+  e->cluster = cluster;
+  e->count = 1;
+  cacheStats_.chainWalks++;
+
+  while (++index < clusters) {
+    uint32_t next;
+    if (!fatGet(cluster, &next) || next < 2 || isEOC(next)) {
+      // bad chain or shorter than the file
+      map->firstCluster = 0;
+      return false;
+    }
+    if (next != cluster + 1) {
+      // the rest is mapped when reading gets there
+      if (map->count == SD_CHAIN_EXTENTS) return true;
+      e = &map->extent[map->count++];
+      e->cluster = next;
+      e->count = 0;
+    }
+    e->count++;
+    cluster = next;
+  }
+  map->end = true;
   return true;
 }
 //------------------------------------------------------------------------------
@@ -152,13 +391,11 @@ uint8_t SdVolume::fatGet(uint32_t cluster, uint32_t* value) const {
   if (cluster > (clusterCount_ + 1)) return false;
   uint32_t lba = fatStartBlock_;
   lba += fatType_ == 16 ? cluster >> 8 : cluster >> 7;
-  if (lba != cacheBlockNumber_) {
-    if (!cacheRawBlock(lba, CACHE_FOR_READ)) return false;
-  }
+  if (!cacheFatBlock(lba, CACHE_FOR_READ)) return false;
   if (fatType_ == 16) {
-    *value = cacheBuffer_.fat16[cluster & 0XFF];
+    *value = cacheBuffer_->fat16[cluster & 0XFF];
   } else {
-    *value = cacheBuffer_.fat32[cluster & 0X7F] & FAT32MASK;
+    *value = cacheBuffer_->fat32[cluster & 0X7F] & FAT32MASK;
   }
   return true;
 }
@@ -175,19 +412,18 @@ uint8_t SdVolume::fatPut(uint32_t cluster, uint32_t value) {
   uint32_t lba = fatStartBlock_;
   lba += fatType_ == 16 ? cluster >> 8 : cluster >> 7;
 
-  if (lba != cacheBlockNumber_) {
-    if (!cacheRawBlock(lba, CACHE_FOR_READ)) return false;
-  }
+  if (!cacheFatBlock(lba, CACHE_FOR_WRITE)) return false;
+  chainInvalidate();
   // store entry
   if (fatType_ == 16) {
-    cacheBuffer_.fat16[cluster & 0XFF] = value;
+    cacheBuffer_->fat16[cluster & 0XFF] = value;
   } else {
-    cacheBuffer_.fat32[cluster & 0X7F] = value;
+    cacheBuffer_->fat32[cluster & 0X7F] = value;
   }
-  cacheSetDirty();
-
   // mirror second FAT
-  if (fatCount_ > 1) cacheMirrorBlock_ = lba + blocksPerFat_;
+  if (fatCount_ > 1) {
+    cacheSlot_[cacheCurrent_].mirrorBlock = lba + blocksPerFat_;
+  }
   return true;
 }
 //------------------------------------------------------------------------------
@@ -208,6 +444,64 @@ uint8_t SdVolume::freeChain(uint32_t cluster) {
 
   return true;
 }
+#if SD_NAME_INDEXES
+//------------------------------------------------------------------------------
+// FNV-1a hash of an 11 byte directory entry name
+uint32_t SdVolume::nameHash(const uint8_t* name) {
+  uint32_t h = 2166136261UL;
+  for (uint8_t i = 0; i < 11; i++) {
+    h ^= name[i];
+    h *= 16777619UL;
+  }
+  return h;
+}
+//------------------------------------------------------------------------------
+// the name index of the directory that starts at dirCluster, or the least
+// recently used one emptied for it
+SdVolume::name_index_t* SdVolume::nameIndex(uint32_t dirCluster) {
+  name_index_t* index = nameIndex_;
+  for (uint8_t i = 0; i < SD_NAME_INDEXES; i++) {
+    name_index_t* x = &nameIndex_[i];
+    if (x->valid && x->dirCluster == dirCluster) {
+      index = x;
+      break;
+    }
+    if ((nameUseCount_ - x->lastUse) > (nameUseCount_ - index->lastUse)) {
+      index = x;
+    }
+  }
+  index->lastUse = ++nameUseCount_;
+  if (!index->valid || index->dirCluster != dirCluster) {
+    index->dirCluster = dirCluster;
+    index->next = 0;
+    index->count = 0;
+    index->end = false;
+    memset(index->entry, 0, sizeof(index->entry));
+    index->valid = true;
+  }
+  return index;
+}
+//------------------------------------------------------------------------------
+// add the entry with the given index and name, false if the index is full
+uint8_t SdVolume::nameInsert(name_index_t* index, const uint8_t* name,
+  uint16_t entry) {
+  if (index->count >= SD_NAME_INDEX_SLOTS / 4 * 3) return false;
+  uint32_t h = nameHash(name);
+  uint16_t slot = h & (SD_NAME_INDEX_SLOTS - 1);
+  while (index->entry[slot]) slot = (slot + 1) & (SD_NAME_INDEX_SLOTS - 1);
+  index->entry[slot] = entry + 1;
+  index->tag[slot] = h >> 24;
+  index->count++;
+  return true;
+}
+#endif  // SD_NAME_INDEXES
+//------------------------------------------------------------------------------
+// forget all name indexes, an entry has been added or removed
+void SdVolume::nameInvalidate(void) {
+#if SD_NAME_INDEXES
+  for (uint8_t i = 0; i < SD_NAME_INDEXES; i++) nameIndex_[i].valid = false;
+#endif  // SD_NAME_INDEXES
+}
 //------------------------------------------------------------------------------
 /**
  * Initialize a FAT volume.
@@ -227,12 +521,15 @@ uint8_t SdVolume::freeChain(uint32_t cluster) {
 uint8_t SdVolume::init(Sd2Card* dev, uint8_t part) {
   uint32_t volumeStartBlock = 0;
   sdCard_ = dev;
+  chainInvalidate();
+  aheadInvalidate();
+  nameInvalidate();
   // if part == 0 assume super floppy with FAT boot sector in block zero
   // if part > 0 assume mbr volume with partition table
   if (part) {
     if (part > 4)return false;
     if (!cacheRawBlock(volumeStartBlock, CACHE_FOR_READ)) return false;
-    part_t* p = &cacheBuffer_.mbr.part[part-1];
+    part_t* p = &cacheBuffer_->mbr.part[part-1];
     if ((p->boot & 0X7F) !=0  ||
       p->totalSectors < 100 ||
       p->firstSector == 0) {
@@ -242,7 +539,7 @@ uint8_t SdVolume::init(Sd2Card* dev, uint8_t part) {
     volumeStartBlock = p->firstSector;
   }
   if (!cacheRawBlock(volumeStartBlock, CACHE_FOR_READ)) return false;
-  bpb_t* bpb = &cacheBuffer_.fbs.bpb;
+  bpb_t* bpb = &cacheBuffer_->fbs.bpb;
   if (bpb->bytesPerSector != 512 ||
     bpb->fatCount == 0 ||
     bpb->reservedSectorCount == 0 ||
@@ -293,3 +590,77 @@ uint8_t SdVolume::init(Sd2Card* dev, uint8_t part) {
   }
   return true;
 }
+//------------------------------------------------------------------------------
+// Read up to count blocks from block on into the read-ahead, in one multiple
+// block read, and return the data of block.  A window that follows the last
+// one continues the same multiple block read.  Its size is the blocks the
+// last window lasted SD_READAHEAD_MS for at the rate it was read, at most
+// twice the last, so it ramps up from two as reading goes on in order.
+uint8_t* SdVolume::readAhead(uint32_t block, uint32_t count) {
+  uint32_t now = OSTimeGet();
+  uint32_t window = 2;
+  if (aheadCount_ && block == aheadFirst_ + aheadCount_) {
+    uint32_t ticks = now - aheadTick_;
+    uint32_t lead = (uint32_t)SD_READAHEAD_MS * OS_TICKS_PER_SEC / 1000;
+    window = ticks ? (aheadCount_ * lead + ticks - 1) / ticks
+                   : SD_READAHEAD_BLOCKS;
+    if (window > 2UL * aheadCount_) window = 2UL * aheadCount_;
+    if (window < 2) window = 2;
+  }
+  if (window > SD_READAHEAD_BLOCKS) window = SD_READAHEAD_BLOCKS;
+  if (window > count) window = count;
+
+  aheadInvalidate();
+  cacheStats_.aheadFills++;
+  cacheStats_.aheadBlocks += window;
+  if (window == 1) {
+    if (!sdCard_->readBlock(block, aheadBlock_[0].data)) return 0;
+  } else {
+    if (!sdCard_->readStart(block)) return 0;
+    for (uint8_t i = 0; i < window; i++) {
+      if (!sdCard_->readData(aheadBlock_[i].data)) {
+        // end the multiple block read rather than leave the card streaming
+        if (sdCard_->inStream()) sdCard_->readStop();
+        return 0;
+      }
+    }
+  }
+  aheadFirst_ = block;
+  aheadCount_ = window;
+  aheadUsed_ = 1;
+  aheadTick_ = now;
+  return aheadBlock_[0].data;
+}
+//------------------------------------------------------------------------------
+// The mutex's priority inheritance priority APP_TASK_SD_MUTEX_PRIO must be
+// free, above every task that uses the SD library and below the SPI lock's,
+// which the holder takes to reach the card.
+void SdVolume::lockInit(void) {
+  INT8U err;
+  if (lock_) return;
+  lock_ = OSMutexCreate(APP_TASK_SD_MUTEX_PRIO, &err);
+  if (!lock_) while (1);  // priority in use or no event control block left
+}
+//------------------------------------------------------------------------------
+void SdVolume::lock(void) {
+  uint32_t start = CYCLE_COUNT();
+  INT8U err;
+  if (!OSMutexAccept(lock_, &err)) {
+    OSMutexPend(lock_, 0, &err);
+    if (err != OS_ERR_NONE) while (1);  // no lockInit()
+    uint32_t waitUs = ClockElapsedUs(start);
+    cacheStats_.lockWaits++;
+    cacheStats_.lockWaitUs += waitUs;
+    if (waitUs > cacheStats_.maxLockWaitUs) cacheStats_.maxLockWaitUs = waitUs;
+  } else if (err != OS_ERR_NONE) {
+    while (1);  // APP_TASK_SD_MUTEX_PRIO is not above the task
+  }
+  cacheStats_.locks++;
+  lockedAt_ = CYCLE_COUNT();
+}
+//------------------------------------------------------------------------------
+void SdVolume::unlock(void) {
+  uint32_t holdUs = ClockElapsedUs(lockedAt_);
+  if (holdUs > cacheStats_.maxLockHoldUs) cacheStats_.maxLockHoldUs = holdUs;
+  if (OSMutexPost(lock_) != OS_ERR_NONE) while (1);  // not the holder
+}
@@ -21,19 +21,32 @@
 
 #include "discoveryboard.h"
 #include "hw_init.h"
+#include "bspClock.h"
 #include "bspI2c.h"
 #include "bspLcd.h"
 #include "bspLed.h"
 #include "bspMp3.h"
+#include "bspPower.h"
 #include "bspSD.h"
 #include "bspSpi.h"
 #include "bspUart.h"
 #include "print.h"
 #include "pjdf.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 //get external reference to the print buffer
 PRINT_BUFFER();
 
 void SetLED(BOOLEAN On);
 
+// App/tasks.c, the first task main() starts
+void StartupTask(void* pdata);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* __BSP_H */
\ No newline at end of file
@@ -0,0 +1,277 @@
+/*
+    bspClock.c
+
+    Run time system clock switching, see bspClock.h.
+
+    Going down, the core moves to HSI before the flash wait states are
+    reduced and the PLL is stopped; going up, the wait states are raised and
+    the PLL locked before switching to it. ClockSetSpeed() waits for the
+    oscillators with interrupts enabled: only the switch itself and the
+    update of everything that divides HCLK are in a critical section. The
+    tick in progress when SysTick is reprogrammed is restarted, so each
+    switch stretches one tick by up to a tick period.
+
+    The last CLOCK_SWITCH_LOG switches are kept so ClockElapsedUs() can time
+    each stretch of an interval at the clock it ran at.
+*/
+
+#include "bsp.h"
+#include "print.h"
+
+static const INT32U clockHz[CLOCK_SPEED_COUNT] = { 16000000, 80000000 };
+
+#define CLOCK_SWITCH_LOG 4    // switches ClockElapsedUs() can see within an interval
+
+typedef struct
+{
+    INT32U cycle;           // CYCLE_COUNT() at the switch
+    INT32U mhzBefore;       // HCLK up to it
+} ClockSwitch_t;
+
+static ClockSpeed_t clockSpeed;
+static ClockStats_t clockStats;
+static ClockSwitch_t clockSwitchLog[CLOCK_SWITCH_LOG];
+static INT32U clockSwitchCount;    // entries ever put in clockSwitchLog[]
+
+
+// Start the oscillator the system clock moves to and raise the flash wait
+// states if it is faster. Interrupts stay enabled.
+static void ClockPrepare(ClockSpeed_t speed)
+{
+    if (speed == CLOCK_SPEED_80MHZ)
+    {
+        LL_FLASH_SetLatency(LL_FLASH_LATENCY_4);
+        LL_RCC_MSI_Enable();
+        while (LL_RCC_MSI_IsReady() != 1);
+
+        LL_RCC_PLL_ConfigDomain_SYS(LL_RCC_PLLSOURCE_MSI, LL_RCC_PLLM_DIV_1, 40, LL_RCC_PLLR_DIV_2);
+        LL_RCC_PLL_Enable();
+        LL_RCC_PLL_EnableDomain_SYS();
+        while (LL_RCC_PLL_IsReady() != 1);
+    }
+    else
+    {
+        LL_RCC_HSI_Enable();
+        while (LL_RCC_HSI_IsReady() != 1);
+    }
+}
+
+// Move the system clock to the prepared oscillator
+static void ClockSwitch(ClockSpeed_t speed)
+{
+    if (speed == CLOCK_SPEED_80MHZ)
+    {
+        LL_RCC_SetAHBPrescaler(LL_RCC_SYSCLK_DIV_1);
+        LL_RCC_SetSysClkSource(LL_RCC_SYS_CLKSOURCE_PLL);
+        while (LL_RCC_GetSysClkSource() != LL_RCC_SYS_CLKSOURCE_STATUS_PLL);
+        LL_RCC_SetAPB1Prescaler(LL_RCC_APB1_DIV_1);
+        LL_RCC_SetAPB2Prescaler(LL_RCC_APB2_DIV_1);
+        LL_SetSystemCoreClock(80000000);
+    }
+    else
+    {
+        LL_RCC_SetSysClkSource(LL_RCC_SYS_CLKSOURCE_HSI);
+        while (LL_RCC_GetSysClkSource() != LL_RCC_SYS_CLKSOURCE_STATUS_HSI);
+        LL_SetSystemCoreClock(16000000);
+    }
+}
+
+// Stop what only the old clock used. Interrupts stay enabled.
+static void ClockFinish(ClockSpeed_t speed)
+{
+    if (speed == CLOCK_SPEED_80MHZ)
+    {
+        // Unless USART1 runs on it to receive in STOP1 (UartStopWakeInit())
+        if (LL_RCC_GetUSARTClockSource(USARTx_CLKSOURCE) != LL_RCC_USART1_CLKSOURCE_HSI)
+        {
+            LL_RCC_HSI_Disable();
+        }
+    }
+    else
+    {
+        LL_RCC_PLL_Disable();
+        while (LL_RCC_PLL_IsReady() != 0);
+
+        LL_FLASH_SetLatency(LL_FLASH_LATENCY_0);
+        while (LL_FLASH_GetLatency() != LL_FLASH_LATENCY_0);
+    }
+}
+
+static void ClockApply(ClockSpeed_t speed)
+{
+    ClockPrepare(speed);
+    ClockSwitch(speed);
+    ClockFinish(speed);
+}
+
+// Recompute everything that divides HCLK
+static void ClockUpdateDividers(void)
+{
+    SPI_UpdateDataRates(SystemCoreClock);
+    UartUpdateBaud();       // the caller does UartWaitReady() after the critical section
+    if (SysTick->CTRL & SysTick_CTRL_ENABLE_Msk)
+    {
+        OS_CPU_SysTickInit(OS_TICKS_PER_SEC);
+    }
+}
+
+/*
+ NAME:
+   ClockInit
+ PURPOSE:
+   Select the boot clock. Called by Hw_init() before the UART is set up.
+ */
+void ClockInit(ClockSpeed_t speed)
+{
+    if (speed == CLOCK_SPEED_80MHZ)
+    {
+        SystemClock_Config80();
+    }
+    else
+    {
+        SystemClock_Config16();
+    }
+    clockSpeed = speed;
+    SPI_UpdateDataRates(SystemCoreClock);
+    memset(&clockStats, 0, sizeof(clockStats));
+}
+
+/*
+ NAME:
+   ClockSetSpeed
+ PURPOSE:
+   Switch the system clock and recompute the SPI prescalers, UART baud rate
+   divider and SysTick reload. The caller holds the SPI1 lock.
+ PARAMETERS:
+   speed: CLOCK_SPEED_16MHZ or CLOCK_SPEED_80MHZ
+ RETURN:
+   none
+ */
+void ClockSetSpeed(ClockSpeed_t speed)
+{
+    OS_CPU_SR cpu_sr;
+    ClockSwitch_t *pSwitch;
+    INT32U mhzBefore;
+    INT32U now;
+
+    if (speed >= CLOCK_SPEED_COUNT || speed == clockSpeed) return;
+
+    // Let the last character leave at the old baud rate
+    while (!LL_USART_IsActiveFlag_TC(COMM));
+
+    ClockPrepare(speed);
+
+    OS_ENTER_CRITICAL();
+    now = OSTimeGet();
+    clockStats.residency[clockSpeed] += now - clockStats.since;
+    clockStats.since = now;
+    clockStats.switches++;
+
+    mhzBefore = SystemCoreClock / 1000000u;
+    ClockSwitch(speed);
+    clockSpeed = speed;
+    ClockUpdateDividers();
+
+    pSwitch = &clockSwitchLog[clockSwitchCount++ % CLOCK_SWITCH_LOG];
+    pSwitch->cycle = CYCLE_COUNT();
+    pSwitch->mhzBefore = mhzBefore;
+#if OS_TRACE_EN > 0u
+    TraceClock();
+#endif
+    OS_EXIT_CRITICAL();
+
+    ClockFinish(speed);
+    UartWaitReady();
+}
+
+/*
+ NAME:
+   ClockElapsedUs
+ PURPOSE:
+   Microseconds since CYCLE_COUNT() read start, each stretch between clock
+   switches at the clock it ran at. An interval with more than
+   CLOCK_SWITCH_LOG switches counts its oldest stretches at the clock before
+   the oldest switch kept.
+ PARAMETERS:
+   start: CYCLE_COUNT() at the start of the interval
+ RETURN:
+   elapsed microseconds
+ */
+INT32U ClockElapsedUs(INT32U start)
+{
+    OS_CPU_SR cpu_sr;
+    const ClockSwitch_t *pSwitch;
+    INT32U end;
+    INT32U mhz;
+    INT32U us = 0;
+    INT32U i;
+
+    OS_ENTER_CRITICAL();
+    end = CYCLE_COUNT();
+    mhz = SystemCoreClock / 1000000u;
+    for (i = 0; i < CLOCK_SWITCH_LOG && i < clockSwitchCount; i++)
+    {
+        pSwitch = &clockSwitchLog[(clockSwitchCount - 1 - i) % CLOCK_SWITCH_LOG];
+        if (pSwitch->cycle - start >= end - start) break;  // before the interval
+        us += (end - pSwitch->cycle) / mhz;
+        end = pSwitch->cycle;
+        mhz = pSwitch->mhzBefore;
+    }
+    us += (end - start) / mhz;
+    OS_EXIT_CRITICAL();
+    return us;
+}
+
+ClockSpeed_t ClockGetSpeed(void)
+{
+    return clockSpeed;
+}
+
+// Bring back the selected clock after STOP, which wakes up on MSI
+void ClockRestore(void)
+{
+    ClockApply(clockSpeed);
+}
+
+void ClockStatsReset(void)
+{
+    OS_CPU_SR cpu_sr;
+
+    OS_ENTER_CRITICAL();
+    memset(&clockStats, 0, sizeof(clockStats));
+    clockStats.since = OSTimeGet();
+    OS_EXIT_CRITICAL();
+}
+
+/*
+ NAME:
+   ClockStatsPrint
+ PURPOSE:
+   Print the time spent at each clock speed since the last ClockStatsReset().
+ */
+void ClockStatsPrint(void)
+{
+    char buf[PRINTBUFMAX];
+    ClockStats_t s;
+    ClockSpeed_t cur;
+    OS_CPU_SR cpu_sr;
+    INT32U total = 0;
+    INT32U i;
+
+    OS_ENTER_CRITICAL();
+    s = clockStats;
+    cur = clockSpeed;
+    s.residency[cur] += OSTimeGet() - s.since;
+    OS_EXIT_CRITICAL();
+
+    for (i = 0; i < CLOCK_SPEED_COUNT; i++) total += s.residency[i];
+    if (total == 0) total = 1;
+
+    PrintWithBuf(buf, sizeof(buf), "Clock %u MHz, %u switches\n", clockHz[cur] / 1000000, s.switches);
+    for (i = 0; i < CLOCK_SPEED_COUNT; i++)
+    {
+        INT32U pm = (INT32U)(((uint64_t)s.residency[i] * 1000u) / total);
+        PrintWithBuf(buf, sizeof(buf), "  %2u MHz: %u.%u%% (%u ms)\n", clockHz[i] / 1000000, pm / 10, pm % 10,
+                     (INT32U)(((uint64_t)s.residency[i] * 1000u) / OS_TICKS_PER_SEC));
+    }
+}
@@ -0,0 +1,52 @@
+/*
+    bspClock.h
+
+    Run time switching of the system clock between 16 MHz (HSI) and
+    80 MHz (MSI + PLL). Everything derived from HCLK is brought along on a
+    switch: the SysTick reload, the USART1 baud rate divider and the SPI1
+    prescalers of the MP3 decoder, LCD and SD card (see SPI_UpdateDataRates()).
+
+    The caller must make sure no SPI transfer is in progress, i.e. hold the
+    SPI1 lock. App/clockGov.c decides when to switch.
+
+    The DWT cycle counter runs at HCLK, so an interval of CYCLE_COUNT()
+    cycles that spans a switch has no single rate: ClockElapsedUs() converts
+    it a stretch at a time.
+*/
+
+#ifndef __BSPCLOCK_H
+#define __BSPCLOCK_H
+
+#include <os_cpu.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    CLOCK_SPEED_16MHZ,
+    CLOCK_SPEED_80MHZ,
+    CLOCK_SPEED_COUNT
+} ClockSpeed_t;
+
+typedef struct
+{
+    INT32U switches;                        // number of speed changes
+    INT32U residency[CLOCK_SPEED_COUNT];    // ticks spent at each speed
+    INT32U since;                           // OSTime of the last switch or reset
+} ClockStats_t;
+
+void ClockInit(ClockSpeed_t speed);
+void ClockSetSpeed(ClockSpeed_t speed);
+ClockSpeed_t ClockGetSpeed(void);
+void ClockRestore(void);
+INT32U ClockElapsedUs(INT32U start);
+void ClockStatsReset(void);
+void ClockStatsPrint(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BSPCLOCK_H */
@@ -13,6 +13,10 @@
 
 #include "stm32l4xx_ll_i2c.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define PJDF_I2C1 I2C1 // Address of I2C1 memory mapped register block
 
 void BspI2C1_init(void);
@@ -24,4 +28,8 @@ void I2C_stop(I2C_TypeDef* I2Cx);
 void I2C_write(I2C_TypeDef* I2Cx, uint8_t data);
 
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
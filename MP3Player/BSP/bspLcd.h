@@ -13,6 +13,10 @@
 #ifndef __BSPLCD_H
 #define __BSPLCD_H
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define LCD_ILI9341_CS_GPIO               GPIOA
 #define LCD_ILI9341_CS_GPIO_Pin           LL_GPIO_PIN_2
 
@@ -25,13 +29,19 @@
 
 #define LCD_ILI9341_DC_LOW()        LL_GPIO_ResetOutputPin(LCD_ILI9341_DC_GPIO, LCD_ILI9341_DC_GPIO_Pin);
 #define LCD_ILI9341_DC_HIGH()       LL_GPIO_SetOutputPin(LCD_ILI9341_DC_GPIO, LCD_ILI9341_DC_GPIO_Pin);
+#define LCD_ILI9341_DC_IS_HIGH()    LL_GPIO_IsOutputPinSet(LCD_ILI9341_DC_GPIO, LCD_ILI9341_DC_GPIO_Pin)
 
 #define LCD_SPI_DEVICE_ID  PJDF_DEVICE_ID_SPI1
 
-#define LCD_SPI_DATARATE  LL_SPI_BAUDRATEPRESCALER_DIV2  // Tune to find optimal value LCD controller will work with. OK with 16MHz and 80MHzHCLK
+#define LCD_SPI_MAX_HZ    40000000  // Tune to find optimal value LCD controller will work with. DIV2 OK with 16MHz and 80MHz HCLK
+#define LCD_SPI_DATARATE  (spiDataRate[SPI_RATE_LCD])  // Prescaler for the current HCLK, see SPI_UpdateDataRates()
 
 void BspLcdInitILI9341();
 
 
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
\ No newline at end of file
@@ -11,6 +11,10 @@
 #ifndef __BSPLED_H
 #define __BSPLED_H
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define LED2_PIN                           LL_GPIO_PIN_5
 #define LED2_GPIO_PORT                     GPIOA
 #define LED2_GPIO_CLK_ENABLE()             LL_AHB2_GRP1_EnableClock(LL_AHB2_GRP1_PERIPH_GPIOA)
@@ -18,4 +22,8 @@
 void LedInit();
 void SetLED(BOOLEAN On);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* __BSPLED_H */
\ No newline at end of file
@@ -16,6 +16,10 @@
 #ifndef __BSPMP3_H
 #define __BSPMP3_H
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define MP3_VS1053_MCS_GPIO               GPIOA
 #define MP3_VS1053_MCS_GPIO_Pin           LL_GPIO_PIN_4
 
@@ -36,8 +40,8 @@
 
 #define MP3_SPI_DEVICE_ID  PJDF_DEVICE_ID_SPI1
 
-//#define MP3_SPI_DATARATE LL_SPI_BAUDRATEPRESCALER_DIV8  // Tune to find optimal value MP3 decoder will work with. Works with 16MHz HCLK
-#define MP3_SPI_DATARATE LL_SPI_BAUDRATEPRESCALER_DIV32  // Tune to find optimal value MP3 decoder will work with. Works with 80MHz HCLK
+#define MP3_SPI_MAX_HZ    2500000  // Tune to find optimal value MP3 decoder will work with. DIV32 at 80MHz, DIV8 at 16MHz HCLK
+#define MP3_SPI_DATARATE  (spiDataRate[SPI_RATE_MP3])  // Prescaler for the current HCLK, see SPI_UpdateDataRates()
 
 // some command strings to send to the VS1053 MP3 decoder:
 extern const INT8U BspMp3SineWave[];
@@ -65,4 +69,8 @@ extern const INT8U BspMp3ReadVolLen;
 
 void BspMp3InitVS1053();
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
\ No newline at end of file
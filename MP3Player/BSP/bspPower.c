@@ -0,0 +1,291 @@
+/*
+    bspPower.c
+
+    Tickless idle, see bspPower.h.
+
+    PowerIdle() runs in the idle task with interrupts disabled from the time
+    it asks the kernel for the next wakeup until the kernel has been told how
+    many ticks went by, so no task can be delayed in between. WFI still wakes
+    on a pending interrupt with PRIMASK set; that interrupt is serviced once
+    the idle task restores PRIMASK, after the tick correction.
+
+    Time is kept exactly: the part of the current tick already elapsed when
+    SysTick is stopped is added to the LPTIM count, and the part of a tick
+    left over on wakeup shortens the first SysTick period after restart.
+
+    Costs: any interrupt other than LPTIM1 (touch, UART) ends the sleep
+    early, which is handled the same way. OSTimeTickHook() runs once per
+    sleep rather than once per tick, and the statistics task's CPU usage
+    only counts the idle loop while awake.
+
+    USART1 keeps receiving in STOP1 on HSI16 and wakes the CPU with the
+    character in RDR (UartStopWakeInit()), so shell keystrokes are not lost;
+    ReadByte() pends rather than spins so the idle task gets to sleep.
+
+    Statistics: the SLEEP/STOP1 shares printed by "power" are LPTIM counts,
+    which run on the LSE through both. The DWT cycle counter behind
+    CYCLE_COUNT() stops with the core clock in STOP1, so after each sleep
+    it is moved on by the cycles the LPTIM says went by. Intervals measured
+    with it (trace timestamps, PJDF and SPI lock times, critical sections)
+    are then wall time that includes the sleep, as with the tick running.
+
+    The LL library in this tree has no LPTIM driver, so LPTIM1 is
+    programmed through its registers.
+*/
+
+#include "bsp.h"
+#include "print.h"
+
+#if OS_TICKLESS_EN > 0u
+
+#define LSE_READY_TIMEOUT   2000000u    // ~2 s of polling at 80 MHz
+
+static BOOLEAN powerReady;
+static PowerStats_t powerStats;
+
+
+/*
+ NAME:
+   PowerInit
+ PURPOSE:
+   Start the LSE crystal and clock LPTIM1 from it. Called from SetSysTick()
+   once the tick is running. If the LSE does not start the idle task keeps
+   the tick running and only WFIs.
+ */
+void PowerInit(void)
+{
+    INT32U timeout = LSE_READY_TIMEOUT;
+
+    LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_PWR);
+    LL_PWR_EnableBkUpAccess();
+    LL_RCC_LSE_Enable();
+    while (LL_RCC_LSE_IsReady() != 1)
+    {
+        if (--timeout == 0)
+        {
+            PrintString("LSE did not start, tickless idle disabled\n");
+            return;
+        }
+    }
+
+    LL_RCC_SetLPTIMClockSource(LL_RCC_LPTIM1_CLKSOURCE_LSE);
+    LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_LPTIM1);
+    LL_APB1_GRP1_EnableClockStopSleep(LL_APB1_GRP1_PERIPH_LPTIM1);
+
+    LPTIM1->CR = 0;
+    LPTIM1->CFGR = 0;                   // internal clock, no prescaler, software start
+    LPTIM1->IER = LPTIM_IER_CMPMIE;     // IER may only be written while disabled
+    EXTI->IMR2 |= EXTI_IMR2_IM32;       // LPTIM1 wakeup from STOP
+    NVIC_EnableIRQ(LPTIM1_IRQn);
+
+    UartStopWakeInit();
+
+    PowerStatsReset();
+    powerReady = OS_TRUE;
+}
+
+// Only wakes the CPU; PowerIdle() clears the flag before this can run
+void LPTIM1_IRQHandler(void)
+{
+    LPTIM1->ICR = LPTIM_ICR_CMPMCF;
+}
+
+// Start LPTIM1 from 0 with a compare match after 'counts'
+static void PowerLptimStart(INT32U counts)
+{
+    LPTIM1->CR = LPTIM_CR_ENABLE;
+    LPTIM1->ICR = LPTIM_ICR_ARROKCF | LPTIM_ICR_CMPOKCF | LPTIM_ICR_CMPMCF;
+    LPTIM1->ARR = 0xFFFF;
+    while (!(LPTIM1->ISR & LPTIM_ISR_ARROK));
+    LPTIM1->CMP = counts;
+    while (!(LPTIM1->ISR & LPTIM_ISR_CMPOK));
+    LPTIM1->CR = LPTIM_CR_ENABLE | LPTIM_CR_CNTSTRT;
+}
+
+// Stop LPTIM1 and return the counts since PowerLptimStart()
+static INT32U PowerLptimStop(void)
+{
+    INT32U cnt;
+    INT32U prev;
+
+    // CNT is clocked asynchronously; two equal reads in a row are valid
+    cnt = LPTIM1->CNT;
+    do
+    {
+        prev = cnt;
+        cnt = LPTIM1->CNT;
+    } while (cnt != prev);
+
+    LPTIM1->CR = 0;
+    LPTIM1->ICR = LPTIM_ICR_CMPMCF;
+    NVIC_ClearPendingIRQ(LPTIM1_IRQn);
+    return cnt;
+}
+
+/*
+ NAME:
+   PowerIdle
+ PURPOSE:
+   Sleep until the next task delay or timeout expires. Called from the idle
+   task hook.
+
+   Arithmetic is done in units of 1 / (POWER_LPTIM_HZ * OS_TICKS_PER_SEC)
+   seconds, in which one tick is POWER_LPTIM_HZ and one LPTIM count is
+   OS_TICKS_PER_SEC, so nothing is lost to rounding.
+ PARAMETERS:
+   none
+ RETURN:
+   none
+ */
+void PowerIdle(void)
+{
+    OS_CPU_SR cpu_sr;
+    INT32U period;
+    INT32U idle;
+    INT32U partial;
+    INT32U counts;
+    INT32U elapsed;
+    INT32U ticks;
+    INT32U first;
+    INT32U cycles;
+    INT32U slept;
+    BOOLEAN stop;
+
+    // Not OS_ENTER_CRITICAL(): the sleep is not interrupt latency and must
+    // not show up in the critical section statistics
+    cpu_sr = OS_CPU_SR_Save();
+
+    idle = OSTimeNextWake();
+    if (idle == 0 || idle > POWER_MAX_IDLE_TICKS) idle = POWER_MAX_IDLE_TICKS;
+    if (!powerReady || idle < POWER_MIN_IDLE_TICKS)
+    {
+        __DSB();
+        __WFI();
+        OS_CPU_SR_Restore(cpu_sr);
+        return;
+    }
+
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+    {
+        // A tick is due, let it run
+        SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+        OS_CPU_SR_Restore(cpu_sr);
+        return;
+    }
+    period = SysTick->LOAD + 1;
+    partial = (INT32U)(((uint64_t)(period - SysTick->VAL) * POWER_LPTIM_HZ) / period);
+
+    stop = idle >= POWER_STOP_MIN_TICKS;
+    cycles = DWT->CYCCNT;
+    PowerLptimStart((idle * POWER_LPTIM_HZ - partial) / OS_TICKS_PER_SEC);
+    if (stop)
+    {
+        LL_PWR_SetPowerMode(LL_PWR_MODE_STOP1);
+        SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+    }
+    __DSB();
+    __WFI();
+    if (stop)
+    {
+        SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+        ClockRestore();                 // STOP1 wakes up on MSI
+    }
+    counts = PowerLptimStop();
+
+    // Catch the cycle counter up with the time the LPTIM counted, for the
+    // part of it the core clock was stopped
+    cycles = DWT->CYCCNT - cycles;
+    slept = (INT32U)(((uint64_t)counts * SystemCoreClock) / POWER_LPTIM_HZ);
+    if (slept > cycles) DWT->CYCCNT += slept - cycles;
+
+    elapsed = partial + counts * OS_TICKS_PER_SEC;
+    ticks = elapsed / POWER_LPTIM_HZ;
+    if (ticks > idle)
+    {
+        ticks = idle;
+        elapsed = idle * POWER_LPTIM_HZ;
+    }
+
+    // First SysTick period covers what is left of the current tick
+    first = (INT32U)(((uint64_t)(POWER_LPTIM_HZ - elapsed % POWER_LPTIM_HZ) * period) / POWER_LPTIM_HZ);
+    SysTick->LOAD = first > 1 ? first - 1 : 1;
+    SysTick->VAL = 0;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = period - 1;
+
+    powerStats.wakeups++;
+    powerStats.ticksSuppressed += ticks;
+    if (stop)
+    {
+        powerStats.stopCount++;
+        powerStats.stopLptim += counts;
+    }
+    else
+    {
+        powerStats.sleepCount++;
+        powerStats.sleepLptim += counts;
+    }
+
+    OSTimeTickN(ticks);
+    OS_CPU_SR_Restore(cpu_sr);
+}
+
+void PowerStatsReset(void)
+{
+    OS_CPU_SR cpu_sr;
+
+    OS_ENTER_CRITICAL();
+    memset(&powerStats, 0, sizeof(powerStats));
+    powerStats.startTime = OSTimeGet();
+    OS_EXIT_CRITICAL();
+}
+
+// Share of 'ms' milliseconds taken by 'counts' LPTIM counts, in tenths of a percent
+static INT32U PowerPermille(INT32U counts, INT32U ms)
+{
+    return ms ? (INT32U)(((uint64_t)counts * 1000000u) / ((uint64_t)ms * POWER_LPTIM_HZ)) : 0;
+}
+
+/*
+ NAME:
+   PowerStatsPrint
+ PURPOSE:
+   Print the CPU wakeup rate and the share of time spent in SLEEP and STOP1
+   since the last PowerStatsReset().
+ */
+void PowerStatsPrint(void)
+{
+    char buf[PRINTBUFMAX];
+    PowerStats_t s;
+    OS_CPU_SR cpu_sr;
+    INT32U ticks;
+    INT32U ms;
+    INT32U sleepPm;
+    INT32U stopPm;
+    INT32U awakePm;
+
+    OS_ENTER_CRITICAL();
+    s = powerStats;
+    ticks = OSTimeGet() - s.startTime;
+    OS_EXIT_CRITICAL();
+
+    ms = (INT32U)(((uint64_t)ticks * 1000u) / OS_TICKS_PER_SEC);
+    if (ms == 0) ms = 1;
+    sleepPm = PowerPermille(s.sleepLptim, ms);
+    stopPm = PowerPermille(s.stopLptim, ms);
+    awakePm = sleepPm + stopPm < 1000 ? 1000 - sleepPm - stopPm : 0;
+
+    PrintWithBuf(buf, sizeof(buf), "Tickless idle over %u ms\n", ms);
+    PrintWithBuf(buf, sizeof(buf), "  low power wakeups/s: %u\n",
+                 (INT32U)(((uint64_t)s.wakeups * 1000u) / ms));
+    PrintWithBuf(buf, sizeof(buf), "  tick interrupts/s:   %u (%u suppressed)\n",
+                 (INT32U)(((uint64_t)(ticks - s.ticksSuppressed) * 1000u) / ms), s.ticksSuppressed);
+    PrintWithBuf(buf, sizeof(buf), "  SLEEP: %u.%u%% in %u periods\n",
+                 sleepPm / 10, sleepPm % 10, s.sleepCount);
+    PrintWithBuf(buf, sizeof(buf), "  STOP1: %u.%u%% in %u periods\n",
+                 stopPm / 10, stopPm % 10, s.stopCount);
+    PrintWithBuf(buf, sizeof(buf), "  awake: %u.%u%%\n", awakePm / 10, awakePm % 10);
+}
+
+#endif // OS_TICKLESS_EN
@@ -0,0 +1,54 @@
+/*
+    bspPower.h
+
+    Board support for tickless idle: the idle task stops SysTick, sleeps on
+    LPTIM1 until the next task delay expires and then catches the kernel up
+    with OSTimeTickN().
+
+    Enabled by OS_TICKLESS_EN in os_cfg.h. "power" in the shell prints the
+    wakeup rate and idle residency.
+*/
+
+#ifndef __BSPPOWER_H
+#define __BSPPOWER_H
+
+#include <os_cpu.h>
+#include <os_cfg.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define POWER_LPTIM_HZ          32768u  // LPTIM1 clocked by the LSE crystal
+
+// Idle periods shorter than this just WFI with the tick running
+#define POWER_MIN_IDLE_TICKS    2u
+
+// Idle periods at least this long enter STOP1 instead of SLEEP; waking
+// from STOP costs the MSI startup and a PLL relock (~50 us)
+#define POWER_STOP_MIN_TICKS    10u
+
+// Longest idle period the 16-bit LPTIM counter can time
+#define POWER_MAX_IDLE_TICKS    ((0xFFFFu * OS_TICKS_PER_SEC) / POWER_LPTIM_HZ - 1u)
+
+typedef struct
+{
+    INT32U wakeups;             // low power periods ended
+    INT32U sleepCount;          // periods spent in SLEEP
+    INT32U stopCount;           // periods spent in STOP1
+    INT32U sleepLptim;          // LPTIM counts spent in SLEEP
+    INT32U stopLptim;           // LPTIM counts spent in STOP1
+    INT32U ticksSuppressed;     // tick interrupts that did not happen
+    INT32U startTime;           // OSTime when the stats were reset
+} PowerStats_t;
+
+void PowerInit(void);
+void PowerIdle(void);
+void PowerStatsReset(void);
+void PowerStatsPrint(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BSPPOWER_H */
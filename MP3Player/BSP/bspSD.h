@@ -13,6 +13,10 @@
 #ifndef __BSPSD_H
 #define __BSPSD_H
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define SD_ADAFRUIT_CS_GPIO               GPIOA
 #define SD_ADAFRUIT_CS_GPIO_Pin           LL_GPIO_PIN_3
 
@@ -25,9 +29,13 @@
 
 #define SD_SPI_DEVICE_ID  PJDF_DEVICE_ID_SPI1
 
-//#define SD_SPI_DATARATE  LL_SPI_BAUDRATEPRESCALER_DIV2  // Tune to find optimal value SD controller will work with. OK with 16mhz HCLK
-#define SD_SPI_DATARATE  LL_SPI_BAUDRATEPRESCALER_DIV4  // Tune to find optimal value SD controller will work with. OK with 80MHz HCLK
+#define SD_SPI_MAX_HZ     20000000  // Until Sd2Card::calibrate() finds the fastest the card works at. DIV4 at 80MHz, DIV2 at 16MHz HCLK
+#define SD_SPI_DATARATE   (spiDataRate[SPI_RATE_SD])  // Prescaler for the current HCLK, see SPI_UpdateDataRates()
 
 void BspSDInitAdafruit();
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
\ No newline at end of file
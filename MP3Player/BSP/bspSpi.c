@@ -10,6 +10,20 @@
 
 #include "bsp.h"
 
+uint16_t spiDataRate[SPI_RATE_COUNT];
+
+// SCK limits, the SD card's raised or lowered by SPI_SetMaxHz() once calibrated
+static uint32_t spiMaxHz[SPI_RATE_COUNT] = { MP3_SPI_MAX_HZ, LCD_SPI_MAX_HZ, SD_SPI_MAX_HZ };
+static uint32_t spiPclkHz;  // as last given to SPI_UpdateDataRates()
+
+static const uint16_t spiPrescalers[] =
+{
+  LL_SPI_BAUDRATEPRESCALER_DIV2,   LL_SPI_BAUDRATEPRESCALER_DIV4,
+  LL_SPI_BAUDRATEPRESCALER_DIV8,   LL_SPI_BAUDRATEPRESCALER_DIV16,
+  LL_SPI_BAUDRATEPRESCALER_DIV32,  LL_SPI_BAUDRATEPRESCALER_DIV64,
+  LL_SPI_BAUDRATEPRESCALER_DIV128, LL_SPI_BAUDRATEPRESCALER_DIV256,
+};
+
 // BspSPI1Init
 // Initializes the SPI1 memory mapped register block and enables it for use
 // as a master SPI device.
@@ -85,3 +99,74 @@ void SPI_SetDataRate(SPI_TypeDef *spi, uint16_t value)
   LL_SPI_SetBaudRatePrescaler(spi, value);
 }
 
+// SPI_Configure
+// Programs the bus for a device: prescaler, frame size (8 or 16 bits), SPI
+// mode (CPOL in bit 1, CPHA in bit 0) and DMA requests. The transfer in
+// progress, if any, finishes first; SPE is cleared while CR1 and CR2 change.
+void SPI_Configure(SPI_TypeDef *spi, uint16_t prescaler, uint8_t dataWidth, uint8_t mode, uint8_t dma)
+{
+  while (LL_SPI_IsActiveFlag_BSY(spi));
+  LL_SPI_Disable(spi);
+
+  LL_SPI_SetBaudRatePrescaler(spi, prescaler);
+  LL_SPI_SetClockPolarity(spi, (mode & 2) ? LL_SPI_POLARITY_HIGH : LL_SPI_POLARITY_LOW);
+  LL_SPI_SetClockPhase(spi, (mode & 1) ? LL_SPI_PHASE_2EDGE : LL_SPI_PHASE_1EDGE);
+  if (dataWidth == 16) {
+    LL_SPI_SetDataWidth(spi, LL_SPI_DATAWIDTH_16BIT);
+    LL_SPI_SetRxFIFOThreshold(spi, LL_SPI_RX_FIFO_TH_HALF);
+  } else {
+    LL_SPI_SetDataWidth(spi, LL_SPI_DATAWIDTH_8BIT);
+    LL_SPI_SetRxFIFOThreshold(spi, LL_SPI_RX_FIFO_TH_QUARTER);
+  }
+  if (dma) {
+    LL_SPI_EnableDMAReq_RX(spi);
+    LL_SPI_EnableDMAReq_TX(spi);
+  } else {
+    LL_SPI_DisableDMAReq_RX(spi);
+    LL_SPI_DisableDMAReq_TX(spi);
+  }
+
+  LL_SPI_Enable(spi);
+}
+
+// SPI_PrescalerIndex
+// Index in spiPrescalers[] of the smallest prescaler that keeps SCK within
+// maxHz, the largest one if none does.
+static int SPI_PrescalerIndex(uint32_t pclkHz, uint32_t maxHz)
+{
+  int i = 0;
+  while (i < (int)(sizeof(spiPrescalers) / sizeof(spiPrescalers[0])) - 1 &&
+         (pclkHz >> (i + 1)) > maxHz) {
+    i++;
+  }
+  return i;
+}
+
+// SPI_UpdateDataRates
+// Picks for every device the smallest prescaler that keeps SCK within its
+// xxx_SPI_MAX_HZ. Called when the clock changes (bspClock.c); each driver
+// applies its rate at the start of a transfer.
+// pclkHz: the SPI1 kernel clock (PCLK2)
+void SPI_UpdateDataRates(uint32_t pclkHz)
+{
+  spiPclkHz = pclkHz;
+  for (int dev = 0; dev < SPI_RATE_COUNT; dev++) {
+    spiDataRate[dev] = spiPrescalers[SPI_PrescalerIndex(pclkHz, spiMaxHz[dev])];
+  }
+}
+
+// SPI_SetMaxHz
+// Replaces a device's SCK limit, e.g. with the rate the SD card was found
+// to work at (Sd2Card::calibrate()), and picks its prescaler again. The
+// limit holds across clock changes. Call it with the SPI1 lock held, as
+// the clock code calls SPI_UpdateDataRates(); the driver applies the new
+// prescaler the next time it takes the lock.
+// Returns: the SCK the device gets at the current clock
+uint32_t SPI_SetMaxHz(SpiRateId_t dev, uint32_t maxHz)
+{
+  int i = SPI_PrescalerIndex(spiPclkHz, maxHz);
+
+  spiMaxHz[dev] = maxHz;
+  spiDataRate[dev] = spiPrescalers[i];
+  return spiPclkHz >> (i + 1);
+}
@@ -13,13 +13,36 @@
 
 #include "stm32l4xx_ll_spi.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define PJDF_SPI1 SPI1 // Address of SPI1 memory mapped register block
 
+// Devices sharing SPI1, each with its own SCK limit (xxx_SPI_MAX_HZ)
+typedef enum
+{
+    SPI_RATE_MP3,
+    SPI_RATE_LCD,
+    SPI_RATE_SD,
+    SPI_RATE_COUNT
+} SpiRateId_t;
+
+// Prescaler per device for the current HCLK, used as xxx_SPI_DATARATE
+extern uint16_t spiDataRate[SPI_RATE_COUNT];
+
 // Application interface to hardware
 
 void BspSPI1Init();
 void SPI_SendBuffer(SPI_TypeDef *spi, uint8_t *buffer, uint16_t bufLength);
 void SPI_GetBuffer(SPI_TypeDef *spi, uint8_t *buffer, uint16_t bufLength);
 void SPI_SetDataRate(SPI_TypeDef *spi, uint16_t value);
+void SPI_Configure(SPI_TypeDef *spi, uint16_t prescaler, uint8_t dataWidth, uint8_t mode, uint8_t dma);
+void SPI_UpdateDataRates(uint32_t pclkHz);
+uint32_t SPI_SetMaxHz(SpiRateId_t dev, uint32_t maxHz);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif /* __SPI_H */
\ No newline at end of file
@@ -11,8 +11,16 @@
 
 #include "bsp.h"
 
+static uint32_t uartBaud; // baud rate requested by UartInit()
+
+#if OS_TICKLESS_EN > 0u
+static OS_EVENT *uartRxSem; // posted by USART1_IRQHandler() when a character is in
+#endif
+
 void UartInit(uint32_t baud)
 {
+  uartBaud = baud;
+
   USARTx_GPIO_CLK_ENABLE();
 
   /* Configure Tx Pin as : Alternate function, High Speed, Push pull, Pull up */
@@ -76,6 +84,34 @@ void UartInit(uint32_t baud)
   }
 }
 
+/**
+  * @brief  Recompute the baud rate divider after a change of PCLK2
+  *         (bspClock.c). The caller waits for the transmitter to drain
+  *         before, and calls UartWaitReady() after.
+  * @retval None
+  */
+void UartUpdateBaud(void)
+{
+  uint32_t Periphclk = LL_RCC_GetUSARTClockFreq(USARTx_CLKSOURCE);
+
+  LL_USART_Disable(USARTx_INSTANCE);
+  LL_USART_SetBaudRate(USARTx_INSTANCE, Periphclk, LL_USART_OVERSAMPLING_16, uartBaud);
+  LL_USART_Enable(USARTx_INSTANCE);
+}
+
+/**
+  * @brief  Wait for the transmitter and receiver to come back on after
+  *         UartUpdateBaud(). Kept apart so the clock switch does not wait
+  *         for them with interrupts disabled.
+  * @retval None
+  */
+void UartWaitReady(void)
+{
+  while((!(LL_USART_IsActiveFlag_TEACK(USARTx_INSTANCE))) || (!(LL_USART_IsActiveFlag_REACK(USARTx_INSTANCE))))
+  {
+  }
+}
+
 /**
   * @brief  Print a character on the HyperTerminal
   * @param  c: The character to be printed
@@ -87,14 +123,73 @@ void PrintByte(char c)
   while (!LL_USART_IsActiveFlag_TXE(COMM));
 }
 
+#if OS_TICKLESS_EN > 0u
+/**
+  * @brief  Keep receiving in STOP1 (bspPower.c). USART1 moves to HSI16,
+  *         which it starts by itself on a start bit while stopped, and the
+  *         CPU wakes up once the character is in RDR. Called by PowerInit()
+  *         with the kernel running.
+  * @retval None
+  */
+void UartStopWakeInit(void)
+{
+  LL_RCC_HSI_Enable();
+  while (LL_RCC_HSI_IsReady() != 1);
+
+  while (!LL_USART_IsActiveFlag_TC(COMM));
+  LL_USART_Disable(COMM);
+  LL_RCC_SetUSARTClockSource(LL_RCC_USART1_CLKSOURCE_HSI);
+  LL_USART_SetBaudRate(COMM, LL_RCC_GetUSARTClockFreq(USARTx_CLKSOURCE), LL_USART_OVERSAMPLING_16, uartBaud);
+  LL_USART_SetWKUPType(COMM, LL_USART_WAKEUP_ON_RXNE);   // WUS may only be written while disabled
+  LL_USART_EnableInStopMode(COMM);
+  LL_USART_Enable(COMM);
+  while((!(LL_USART_IsActiveFlag_TEACK(COMM))) || (!(LL_USART_IsActiveFlag_REACK(COMM))))
+  {
+  }
+
+  uartRxSem = OSSemCreate(0);
+  LL_USART_EnableIT_WKUP(COMM);
+  EXTI->IMR1 |= EXTI_IMR1_IM26;       // USART1 wakeup from STOP
+  NVIC_EnableIRQ(USART1_IRQn);
+}
+
+// Wakes the CPU from STOP1 (WUF) and ReadByte() once a character is in (RXNE)
+void USART1_IRQHandler(void)
+{
+  OS_CPU_SR cpu_sr;
+
+  OS_ENTER_CRITICAL();
+  OSIntEnter();
+  OS_EXIT_CRITICAL();
+
+  LL_USART_ClearFlag_WKUP(COMM);
+  if (LL_USART_IsEnabledIT_RXNE(COMM) && LL_USART_IsActiveFlag_RXNE(COMM))
+  {
+    LL_USART_DisableIT_RXNE(COMM);
+    OSSemPost(uartRxSem);
+  }
+
+  OSIntExit();
+}
+#endif
+
 /**
-  * @brief  Busy wait for a character on the HyperTerminal
+  * @brief  Wait for a character on the HyperTerminal. With tickless idle
+  *         the task pends until one arrives, so the idle task can stop the
+  *         CPU; otherwise it busy waits.
   * @retval: The character that was read
   */
 char ReadByte()
 {
-    while (!LL_USART_IsEnabledIT_RXNE(COMM));
-    uint16_t c =LL_USART_ReceiveData8(COMM);
-    LL_USART_DisableIT_RXNE(COMM);
-    return c;
+#if OS_TICKLESS_EN > 0u
+    INT8U err;
+
+    while (uartRxSem != NULL && !LL_USART_IsActiveFlag_RXNE(COMM))
+    {
+        LL_USART_EnableIT_RXNE(COMM);
+        OSSemPend(uartRxSem, 0, &err);
+    }
+#endif
+    while (!LL_USART_IsActiveFlag_RXNE(COMM));
+    return LL_USART_ReceiveData8(COMM);
 }
\ No newline at end of file
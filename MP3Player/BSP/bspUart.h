@@ -12,8 +12,12 @@
 #ifndef __BSPUART_H
 #define __BSPUART_H
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define USARTx_INSTANCE               USART1
-#define USARTx_CLKSOURCE              LL_RCC_USART2_CLKSOURCE
+#define USARTx_CLKSOURCE              LL_RCC_USART1_CLKSOURCE
 #define USARTx_CLK_ENABLE()           LL_APB2_GRP1_EnableClock(LL_APB2_GRP1_PERIPH_USART1)
 #define USARTx_CLK_SOURCE()           LL_RCC_SetUSARTClockSource(LL_RCC_USART1_CLKSOURCE_PCLK2)
 
@@ -27,8 +31,15 @@
 
 // Application interface to hardware
 void UartInit(uint32_t baud);
+void UartUpdateBaud(void);
+void UartWaitReady(void);
 void PrintByte(char c);
 char ReadByte();
+void UartStopWakeInit(void);
+
 
+#ifdef __cplusplus
+}
+#endif
 
 #endif /* __BSPUART_H */
\ No newline at end of file
@@ -7,16 +7,14 @@
 */
 #include "bsp.h"
 
-void SystemClock_Config16(void);
-void SystemClock_Config80(void);
-
 
 // Boot up processor
 void Hw_init(void) {
   
-    SystemClock_Config80();
+    ClockInit(CLOCK_SPEED_80MHZ);
     UartInit(115200);
     NVIC_SetPriority(PendSV_IRQn, 0xFF); // Lowest possible priority
+    CycleCounterInit();
 }
 
 void SetSysTick(uint32_t ticksPerSec)
@@ -26,6 +24,17 @@ void SetSysTick(uint32_t ticksPerSec)
     LL_RCC_GetSystemClocksFreq(&rcc_ClocksStatus);    
     PrintString("HCLK frequency = "); Print_uint32(rcc_ClocksStatus.HCLK_Frequency / 1000000); PrintString(" MHz\n");
     PrintString("Configured ticksPerSec = "); Print_uint32(ticksPerSec); PrintString("\n");
+#if OS_TICKLESS_EN > 0u
+    PowerInit();
+#endif
+}
+
+// Start the DWT cycle counter used for time stamping (trace recorder, critical section stats)
+void CycleCounterInit(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 }
 
 
@@ -6,10 +6,29 @@
 #ifndef __HW_INIT_H
 #define __HW_INIT_H
 
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 // Application interface to hardware
 
 void Hw_init(void);
 void SetSysTick(uint32_t ticksPerSec);
+void CycleCounterInit(void);
+void SystemClock_Config16(void);
+void SystemClock_Config80(void);
+void delay(uint32_t count);          // App/main.c: busy wait of count loop passes
+
+// Free running CPU cycle count from the DWT, started by CycleCounterInit()
+#ifdef BSP_HOST
+uint32_t HostCycleCount(void);      // Host/hw_init.c: monotonic clock counted at each SystemCoreClock
+#define CYCLE_COUNT() HostCycleCount()
+#else
+#define CYCLE_COUNT() (DWT->CYCCNT)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif /* __HW_INIT_H */
\ No newline at end of file
@@ -0,0 +1,149 @@
+/*
+    bspClock.c
+
+    Host version of BSP/bspClock.c. A speed change only updates
+    SystemCoreClock and the SPI prescalers; the residency statistics are
+    kept as on the target so the clock governor can be exercised, and so is
+    the switch log behind ClockElapsedUs().
+*/
+
+#include "bsp.h"
+#include "print.h"
+
+static const INT32U clockHz[CLOCK_SPEED_COUNT] = { 16000000, 80000000 };
+
+#define CLOCK_SWITCH_LOG 4    // switches ClockElapsedUs() can see within an interval
+
+typedef struct
+{
+    INT32U cycle;           // CYCLE_COUNT() at the switch
+    INT32U mhzBefore;       // HCLK up to it
+} ClockSwitch_t;
+
+static ClockSpeed_t clockSpeed;
+static ClockStats_t clockStats;
+static ClockSwitch_t clockSwitchLog[CLOCK_SWITCH_LOG];
+static INT32U clockSwitchCount;    // entries ever put in clockSwitchLog[]
+
+
+void ClockInit(ClockSpeed_t speed)
+{
+    if (speed == CLOCK_SPEED_80MHZ)
+    {
+        SystemClock_Config80();
+    }
+    else
+    {
+        SystemClock_Config16();
+    }
+    clockSpeed = speed;
+    SPI_UpdateDataRates(SystemCoreClock);
+    memset(&clockStats, 0, sizeof(clockStats));
+}
+
+void ClockSetSpeed(ClockSpeed_t speed)
+{
+    OS_CPU_SR cpu_sr;
+    ClockSwitch_t *pSwitch;
+    INT32U mhzBefore;
+    INT32U now;
+
+    if (speed >= CLOCK_SPEED_COUNT || speed == clockSpeed) return;
+
+    OS_ENTER_CRITICAL();
+    now = OSTimeGet();
+    clockStats.residency[clockSpeed] += now - clockStats.since;
+    clockStats.since = now;
+    clockStats.switches++;
+
+    mhzBefore = SystemCoreClock / 1000000u;
+    if (speed == CLOCK_SPEED_80MHZ)
+    {
+        SystemClock_Config80();
+    }
+    else
+    {
+        SystemClock_Config16();
+    }
+    clockSpeed = speed;
+    SPI_UpdateDataRates(SystemCoreClock);
+
+    pSwitch = &clockSwitchLog[clockSwitchCount++ % CLOCK_SWITCH_LOG];
+    pSwitch->cycle = CYCLE_COUNT();
+    pSwitch->mhzBefore = mhzBefore;
+#if OS_TRACE_EN > 0u
+    TraceClock();
+#endif
+    OS_EXIT_CRITICAL();
+}
+
+INT32U ClockElapsedUs(INT32U start)
+{
+    OS_CPU_SR cpu_sr;
+    const ClockSwitch_t *pSwitch;
+    INT32U end;
+    INT32U mhz;
+    INT32U us = 0;
+    INT32U i;
+
+    OS_ENTER_CRITICAL();
+    end = CYCLE_COUNT();
+    mhz = SystemCoreClock / 1000000u;
+    for (i = 0; i < CLOCK_SWITCH_LOG && i < clockSwitchCount; i++)
+    {
+        pSwitch = &clockSwitchLog[(clockSwitchCount - 1 - i) % CLOCK_SWITCH_LOG];
+        if (pSwitch->cycle - start >= end - start) break;  // before the interval
+        us += (end - pSwitch->cycle) / mhz;
+        end = pSwitch->cycle;
+        mhz = pSwitch->mhzBefore;
+    }
+    us += (end - start) / mhz;
+    OS_EXIT_CRITICAL();
+    return us;
+}
+
+ClockSpeed_t ClockGetSpeed(void)
+{
+    return clockSpeed;
+}
+
+void ClockRestore(void)
+{
+}
+
+void ClockStatsReset(void)
+{
+    OS_CPU_SR cpu_sr;
+
+    OS_ENTER_CRITICAL();
+    memset(&clockStats, 0, sizeof(clockStats));
+    clockStats.since = OSTimeGet();
+    OS_EXIT_CRITICAL();
+}
+
+void ClockStatsPrint(void)
+{
+    char buf[PRINTBUFMAX];
+    ClockStats_t s;
+    ClockSpeed_t cur;
+    OS_CPU_SR cpu_sr;
+    INT32U total = 0;
+    INT32U i;
+
+    OS_ENTER_CRITICAL();
+    s = clockStats;
+    cur = clockSpeed;
+    s.residency[cur] += OSTimeGet() - s.since;
+    OS_EXIT_CRITICAL();
+
+    for (i = 0; i < CLOCK_SPEED_COUNT; i++) total += s.residency[i];
+    if (total == 0) total = 1;
+
+    PrintWithBuf(buf, sizeof(buf), "Clock %u MHz (host), %u switches\n", clockHz[cur] / 1000000, s.switches);
+    for (i = 0; i < CLOCK_SPEED_COUNT; i++)
+    {
+        INT32U pm = (INT32U)(((uint64_t)s.residency[i] * 1000u) / total);
+        PrintWithBuf(buf, sizeof(buf), "  %2u MHz: %u.%u%% (%u ms)\n", clockHz[i] / 1000000, pm / 10, pm % 10,
+                     (INT32U)(((uint64_t)s.residency[i] * 1000u) / OS_TICKS_PER_SEC));
+    }
+}
@@ -0,0 +1,97 @@
+/*
+    bspSpi.c
+
+    Host version of BSP/bspSpi.c. With SIM=1 the transfers go to the
+    simulated bus at the prescaler in the SPI1 registers (pjdfBind.h calls
+    these directly with PJDF_BIND_DIRECT). Otherwise no device is attached
+    to SPI1: writes are dropped and reads return 0xFF, what an idle MISO
+    line reads as, so the SD card reports no card. The prescaler
+    bookkeeping is the same as on the target.
+*/
+
+#include "bsp.h"
+#ifdef PJDF_SIM
+#include "sim.h"
+#endif
+
+uint16_t spiDataRate[SPI_RATE_COUNT];
+
+// SCK limits, the SD card's raised or lowered by SPI_SetMaxHz() once calibrated
+static uint32_t spiMaxHz[SPI_RATE_COUNT] = { MP3_SPI_MAX_HZ, LCD_SPI_MAX_HZ, SD_SPI_MAX_HZ };
+static uint32_t spiPclkHz;  // as last given to SPI_UpdateDataRates()
+
+static const uint16_t spiPrescalers[] =
+{
+  LL_SPI_BAUDRATEPRESCALER_DIV2,   LL_SPI_BAUDRATEPRESCALER_DIV4,
+  LL_SPI_BAUDRATEPRESCALER_DIV8,   LL_SPI_BAUDRATEPRESCALER_DIV16,
+  LL_SPI_BAUDRATEPRESCALER_DIV32,  LL_SPI_BAUDRATEPRESCALER_DIV64,
+  LL_SPI_BAUDRATEPRESCALER_DIV128, LL_SPI_BAUDRATEPRESCALER_DIV256,
+};
+
+void BspSPI1Init()
+{
+  LL_SPI_SetBaudRatePrescaler(SPI1, LL_SPI_BAUDRATEPRESCALER_DIV256);
+}
+
+void SPI_SendBuffer(SPI_TypeDef *spi, uint8_t *buffer, uint16_t bufLength)
+{
+#ifdef PJDF_SIM
+  SimSpiTransfer(LL_SPI_GetBaudRatePrescaler(spi), buffer, NULL, bufLength);
+#else
+  (void)spi;
+  (void)buffer;
+  (void)bufLength;
+#endif
+}
+
+void SPI_GetBuffer(SPI_TypeDef *spi, uint8_t *buffer, uint16_t bufLength)
+{
+#ifdef PJDF_SIM
+  SimSpiTransfer(LL_SPI_GetBaudRatePrescaler(spi), buffer, buffer, bufLength);
+#else
+  (void)spi;
+  memset(buffer, 0xFF, bufLength);
+#endif
+}
+
+void SPI_SetDataRate(SPI_TypeDef *spi, uint16_t value)
+{
+  LL_SPI_SetBaudRatePrescaler(spi, value);
+}
+
+// Only the prescaler, the unconnected bus has no use for the rest
+void SPI_Configure(SPI_TypeDef *spi, uint16_t prescaler, uint8_t dataWidth, uint8_t mode, uint8_t dma)
+{
+  (void)dataWidth;
+  (void)mode;
+  (void)dma;
+  LL_SPI_SetBaudRatePrescaler(spi, prescaler);
+}
+
+// See BSP/bspSpi.c
+static int SPI_PrescalerIndex(uint32_t pclkHz, uint32_t maxHz)
+{
+  int i = 0;
+  while (i < (int)(sizeof(spiPrescalers) / sizeof(spiPrescalers[0])) - 1 &&
+         (pclkHz >> (i + 1)) > maxHz) {
+    i++;
+  }
+  return i;
+}
+
+void SPI_UpdateDataRates(uint32_t pclkHz)
+{
+  spiPclkHz = pclkHz;
+  for (int dev = 0; dev < SPI_RATE_COUNT; dev++) {
+    spiDataRate[dev] = spiPrescalers[SPI_PrescalerIndex(pclkHz, spiMaxHz[dev])];
+  }
+}
+
+uint32_t SPI_SetMaxHz(SpiRateId_t dev, uint32_t maxHz)
+{
+  int i = SPI_PrescalerIndex(spiPclkHz, maxHz);
+
+  spiMaxHz[dev] = maxHz;
+  spiDataRate[dev] = spiPrescalers[i];
+  return spiPclkHz >> (i + 1);
+}
@@ -0,0 +1,41 @@
+/*
+    bspUart.c
+
+    Host version of BSP/bspUart.c: the debug UART is the process's stdin and
+    stdout. Output goes straight to write(2) rather than stdio, since a task
+    may be preempted while holding a stdio lock (see the POSIX port).
+*/
+
+#include <unistd.h>
+#include "bsp.h"
+
+void UartInit(uint32_t baud)
+{
+  (void)baud;
+}
+
+void UartUpdateBaud(void)
+{
+}
+
+void UartWaitReady(void)
+{
+}
+
+void PrintByte(char c)
+{
+  while (write(STDOUT_FILENO, &c, 1) < 0);
+}
+
+// Blocks the calling task like the busy wait on the target; polls again
+// every 100 ms once stdin is at end of file
+char ReadByte()
+{
+  char c;
+
+  while (read(STDIN_FILENO, &c, 1) != 1)
+  {
+    OSTimeDly(OS_TICKS_PER_SEC / 10);
+  }
+  return c;
+}
@@ -0,0 +1,79 @@
+/*
+    cmsis_gcc.h
+
+    Host stand-in for the CMSIS compiler header, picked up by cmsis_compiler.h
+    when building with gcc for Linux (see Host/Makefile). The core intrinsics
+    have no meaning on the host: barriers become compiler barriers, WFI/WFE
+    and interrupt enables do nothing, and PRIMASK and BASEPRI read as 0.
+    uC/OS-II critical sections do not go through these, see the POSIX port.
+    IPSR is the exception the calling thread is handling, which the POSIX
+    port sets while a task's thread runs the tick handler.
+*/
+
+#ifndef __CMSIS_GCC_H
+#define __CMSIS_GCC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+// See os_cpu.h of the POSIX port
+extern __thread volatile uint32_t OSCPUIpsr;
+#ifdef __cplusplus
+}
+#endif
+
+#define __ASM                   __asm__
+#define __INLINE                inline
+#define __STATIC_INLINE         static inline
+#define __STATIC_FORCEINLINE    __attribute__((always_inline)) static inline
+#define __NO_RETURN             __attribute__((__noreturn__))
+#define __USED                  __attribute__((used))
+#define __WEAK                  __attribute__((weak))
+#define __PACKED                __attribute__((packed, aligned(1)))
+#define __PACKED_STRUCT         struct __attribute__((packed, aligned(1)))
+#define __PACKED_UNION          union __attribute__((packed, aligned(1)))
+#define __ALIGNED(x)            __attribute__((aligned(x)))
+#define __RESTRICT              __restrict
+
+#define __UNALIGNED_UINT16_READ(addr)       (*(const uint16_t *)(addr))
+#define __UNALIGNED_UINT16_WRITE(addr, val) ((void)(*(uint16_t *)(addr) = (uint16_t)(val)))
+#define __UNALIGNED_UINT32_READ(addr)       (*(const uint32_t *)(addr))
+#define __UNALIGNED_UINT32_WRITE(addr, val) ((void)(*(uint32_t *)(addr) = (uint32_t)(val)))
+#define __UNALIGNED_UINT32(addr)            (*(uint32_t *)(addr))
+
+__STATIC_FORCEINLINE void __NOP(void) { }
+__STATIC_FORCEINLINE void __WFI(void) { }
+__STATIC_FORCEINLINE void __WFE(void) { }
+__STATIC_FORCEINLINE void __SEV(void) { }
+__STATIC_FORCEINLINE void __ISB(void) { __asm__ volatile ("" ::: "memory"); }
+__STATIC_FORCEINLINE void __DSB(void) { __asm__ volatile ("" ::: "memory"); }
+__STATIC_FORCEINLINE void __DMB(void) { __asm__ volatile ("" ::: "memory"); }
+
+__STATIC_FORCEINLINE void     __enable_irq(void)  { }
+__STATIC_FORCEINLINE void     __disable_irq(void) { }
+__STATIC_FORCEINLINE uint32_t __get_PRIMASK(void) { return 0u; }
+__STATIC_FORCEINLINE void     __set_PRIMASK(uint32_t priMask) { (void)priMask; }
+__STATIC_FORCEINLINE uint32_t __get_BASEPRI(void) { return 0u; }
+__STATIC_FORCEINLINE void     __set_BASEPRI(uint32_t basePri) { (void)basePri; }
+__STATIC_FORCEINLINE uint32_t __get_CONTROL(void) { return 0u; }
+__STATIC_FORCEINLINE uint32_t __get_IPSR(void)    { return OSCPUIpsr; }
+__STATIC_FORCEINLINE uint32_t __get_FPSCR(void)   { return 0u; }
+__STATIC_FORCEINLINE void     __set_FPSCR(uint32_t fpscr) { (void)fpscr; }
+
+__STATIC_FORCEINLINE uint32_t __REV(uint32_t value)   { return __builtin_bswap32(value); }
+__STATIC_FORCEINLINE uint32_t __REV16(uint32_t value) { return ((value & 0xFF00FF00u) >> 8) | ((value & 0x00FF00FFu) << 8); }
+__STATIC_FORCEINLINE uint32_t __CLZ(uint32_t value)   { return value ? (uint32_t)__builtin_clz(value) : 32u; }
+__STATIC_FORCEINLINE uint32_t __RBIT(uint32_t value)
+{
+    uint32_t result = 0u;
+    for (int i = 0; i < 32; i++)
+    {
+        result = (result << 1) | (value & 1u);
+        value >>= 1;
+    }
+    return result;
+}
+
+#endif /* __CMSIS_GCC_H */
@@ -0,0 +1,202 @@
+/*
+    hostMain.c
+
+    Entry point of the Linux build (see Makefile). App/main.c is compiled
+    with main renamed to AppMain.
+
+    The target code that is built unmodified (PJDF, Adafruit drivers, the
+    BSP GPIO set up) still reads and writes STM32 peripheral registers
+    through the CMSIS pointers. HostMapPeripherals() backs the peripheral
+    address range with zeroed memory so those accesses land somewhere
+    harmless; no register has any effect except those the host BSP looks at.
+    The Cortex-M system control space (SysTick, NVIC, SCB, DWT) is not
+    mapped: only the target BSP uses it, and the host BSP replaces it.
+
+    With the simulated devices (make SIM=1, see sim.h):
+
+        mp3player [-s sd.img] [-t touches.txt] [-f lcd.png] [-j report.json] [-d seconds] [-r readers]
+                  [-e n] [-g n] [-k hz] [-y bytes]
+
+        -s  SD card image, e.g. from Tools/mkfatimg.py
+        -t  touches to replay, see simFT6206.c
+        -f  write the LCD contents here on exit (.ppm or .png)
+        -j  write the statistics as JSON on exit too (see Tools/playbench.py)
+        -d  run for this long, then print the statistics and exit
+        -r  SD library stress readers to run beside the player, see simSDStress.c
+        -e  corrupt every nth block the card sends after its CRC, see SimSDCorrupt()
+        -g  garble the start token of every nth block the card sends, see SimSDGarble()
+        -k  corrupt every block the card sends while SCK is above hz, see SimSDMaxSck()
+        -y  fill the LCD with this many bytes of pixels at a time beside the player, see simSpiYield.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "bsp.h"
+#ifdef PJDF_SIM
+#include "sim.h"
+#endif
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+#define HOST_PERIPH_START   PERIPH_BASE                         // APB1
+#define HOST_PERIPH_END     (AHB2PERIPH_BASE + 0x08061000UL)    // through RNG
+
+void AppMain(void);
+
+static void HostMapPeripherals(void)
+{
+    void *p;
+
+    p = mmap((void *)(uintptr_t)HOST_PERIPH_START, HOST_PERIPH_END - HOST_PERIPH_START,
+             PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE, -1, 0);
+    if (p != (void *)(uintptr_t)HOST_PERIPH_START)
+    {
+        perror("mapping the peripheral registers");
+        exit(1);
+    }
+
+    // No decoder: DREQ is always high so the MP3 driver never waits.
+    // With SIM the VS1053 model drives it.
+    MP3_VS1053_DREQ_GPIO->IDR |= MP3_VS1053_DREQ_GPIO_Pin;
+}
+
+#ifdef PJDF_SIM
+
+static double runSeconds;
+static const char *pFrameBufferPath;
+static const char *pJsonPath;
+
+// Ends the run after -d seconds. Not a uC/OS task: it only sleeps and reads
+// the models' counters, which is racy but good enough for a report. The
+// task cycle counters are sampled every second so they cannot wrap unseen.
+static void *HostStopThread(void *pArg)
+{
+    uint64_t end = (uint64_t)(runSeconds * 1e9);
+    uint64_t now;
+
+    while ((now = SimNowNs()) < end)
+    {
+        usleep((useconds_t)((end - now < 1000000000u ? end - now : 1000000000u) / 1000u));
+        SimSampleTasks();
+    }
+    SimReport();
+    if (pJsonPath != NULL && !SimReportJson(pJsonPath))
+    {
+        perror(pJsonPath);
+    }
+    if (pFrameBufferPath != NULL && !SimILI9341Dump(pFrameBufferPath))
+    {
+        perror(pFrameBufferPath);
+    }
+    _exit(0);
+    return NULL;
+}
+
+static void HostUsage(const char *pProgram)
+{
+    fprintf(stderr, "usage: %s [-s sd.img] [-t touches.txt] [-f lcd.png|lcd.ppm] [-j report.json] [-d seconds] "
+            "[-r readers] [-e corrupt every nth block read] [-g garble every nth start token] "
+            "[-k SD card max SCK Hz] [-y LCD fill bytes]\n", pProgram);
+    exit(2);
+}
+
+static void HostOptions(int argc, char *argv[])
+{
+    pthread_t thread;
+    int c;
+
+    while ((c = getopt(argc, argv, "s:t:f:j:d:r:e:g:k:y:")) != -1)
+    {
+        switch (c)
+        {
+        case 's':
+            if (!SimSDOpen(optarg))
+            {
+                fprintf(stderr, "%s: not an SD card image\n", optarg);
+                exit(1);
+            }
+            break;
+        case 't':
+            if (!SimFT6206Load(optarg))
+            {
+                fprintf(stderr, "%s: cannot read touches\n", optarg);
+                exit(1);
+            }
+            break;
+        case 'f':
+            pFrameBufferPath = optarg;
+            break;
+        case 'j':
+            pJsonPath = optarg;
+            break;
+        case 'd':
+            runSeconds = atof(optarg);
+            break;
+        case 'r':
+            if (!SimSDStressSetup((INT8U)atoi(optarg)))
+            {
+                fprintf(stderr, "-r: at most %d readers\n", SIM_SD_STRESS_MAX_READERS);
+                exit(2);
+            }
+            break;
+        case 'e':
+            SimSDCorrupt((INT32U)atoi(optarg));
+            break;
+        case 'g':
+            SimSDGarble((INT32U)atoi(optarg));
+            break;
+        case 'k':
+            SimSDMaxSck((INT32U)atol(optarg));
+            break;
+        case 'y':
+            if (!SimSpiYieldSetup((INT32U)atol(optarg)))
+            {
+                fprintf(stderr, "-y: more than %d and at most %d bytes\n", LCD_SPI_HOLD_MAX, SIM_SPI_YIELD_MAX_BYTES);
+                exit(2);
+            }
+            break;
+        default:
+            HostUsage(argv[0]);
+        }
+    }
+    if (optind != argc) HostUsage(argv[0]);
+
+    SimNowNs();                         // simulation time starts here
+    if (runSeconds > 0)
+    {
+        pthread_create(&thread, NULL, HostStopThread, NULL);
+    }
+}
+
+#else
+
+// Host/stm32l4xx_ll_gpio.h reports pin accesses here; without SIM no
+// device is watching them.
+void HostGpioWrite(GPIO_TypeDef *GPIOx, uint32_t PinMask)
+{
+}
+
+uint32_t HostGpioRead(GPIO_TypeDef *GPIOx)
+{
+    return GPIOx->IDR;
+}
+
+#endif
+
+int main(int argc, char *argv[])
+{
+    HostMapPeripherals();
+#ifdef PJDF_SIM
+#if OS_TRACE_EN > 0u
+    SimTraceCalibrate();
+#endif
+    HostOptions(argc, argv);
+#endif
+    AppMain();
+    return 0;
+}
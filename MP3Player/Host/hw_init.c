@@ -0,0 +1,102 @@
+/*
+    hw_init.c
+
+    Host version of BSP/hw_init.c for the Linux build (see Makefile).
+
+    There is no clock tree to set up: SystemClock_Config16/80() only update
+    SystemCoreClock, which still scales SPI data rates and the cycle counter.
+    The cycle counter runs at each clock for as long as it was in effect, so
+    CYCLE_COUNT() keeps counting forward across a speed change.
+    The tick comes from the POSIX port's timer thread.
+*/
+
+#include <time.h>
+#include "bsp.h"
+
+// A stretch of time at one clock: when it started and the cycle count then
+typedef struct
+{
+    uint64_t ns;                    // since CycleCounterInit()
+    uint64_t cycles;
+    uint32_t hz;
+} CycleSegment_t;
+
+static struct timespec cycleStart; // time of CycleCounterInit()
+static CycleSegment_t cycleSeg[2]; // the current stretch and the one being set up
+static int cycleSegCur;            // index of the current stretch in cycleSeg[]
+
+
+// Boot up processor
+void Hw_init(void) {
+    ClockInit(CLOCK_SPEED_80MHZ);
+    UartInit(115200);
+    CycleCounterInit();
+}
+
+void SetSysTick(uint32_t ticksPerSec)
+{
+    OS_CPU_SysTickInit(ticksPerSec);
+
+    PrintString("HCLK frequency = "); Print_uint32(SystemCoreClock / 1000000); PrintString(" MHz (host)\n");
+    PrintString("Configured ticksPerSec = "); Print_uint32(ticksPerSec); PrintString("\n");
+}
+
+static uint64_t HostNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)(now.tv_sec - cycleStart.tv_sec) * 1000000000u + now.tv_nsec - cycleStart.tv_nsec;
+}
+
+// Cycles at the clock of pSeg since it started
+static uint64_t HostSegmentCycles(const CycleSegment_t *pSeg, uint64_t ns)
+{
+    return ((ns - pSeg->ns) * (pSeg->hz / 1000000u)) / 1000u;
+}
+
+// Close the current stretch and start one at SystemCoreClock. The new one
+// is filled in before it is published, so HostCycleCount() can run from any
+// thread without a lock.
+static void CycleClockChanged(void)
+{
+    int cur = __atomic_load_n(&cycleSegCur, __ATOMIC_ACQUIRE);
+    CycleSegment_t *pSeg = &cycleSeg[cur];
+    CycleSegment_t *pNext = &cycleSeg[cur ^ 1];
+    uint64_t ns = HostNs();
+
+    pNext->ns = ns;
+    pNext->cycles = pSeg->cycles + HostSegmentCycles(pSeg, ns);
+    pNext->hz = SystemCoreClock;
+    __atomic_store_n(&cycleSegCur, cur ^ 1, __ATOMIC_RELEASE);
+}
+
+// Start the host stand-in for the DWT cycle counter
+void CycleCounterInit(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &cycleStart);
+    memset(cycleSeg, 0, sizeof(cycleSeg));
+    cycleSeg[0].hz = SystemCoreClock;
+    __atomic_store_n(&cycleSegCur, 0, __ATOMIC_RELEASE);
+}
+
+// Cycles since CycleCounterInit(), each stretch counted at the clock in
+// effect then, wrapping like DWT->CYCCNT
+uint32_t HostCycleCount(void)
+{
+    const CycleSegment_t *pSeg = &cycleSeg[__atomic_load_n(&cycleSegCur, __ATOMIC_ACQUIRE)];
+
+    return (uint32_t)(pSeg->cycles + HostSegmentCycles(pSeg, HostNs()));
+}
+
+void SystemClock_Config16(void)
+{
+    LL_SetSystemCoreClock(16000000);
+    CycleClockChanged();
+}
+
+void SystemClock_Config80(void)
+{
+    LL_SetSystemCoreClock(80000000);
+    CycleClockChanged();
+}
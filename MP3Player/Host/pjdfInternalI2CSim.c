@@ -0,0 +1,133 @@
+/*
+    pjdfInternalI2CSim.c
+    The implementation of the internal PJDF interface pjdfInternal.h for the
+    simulated I2C1 bus of the Linux build, see sim.h.
+
+    Same buffer conventions as pjdfInternalI2C.c, and like it each transfer
+    runs with interrupts disabled.
+*/
+
+#include "bsp.h"
+#include "pjdf.h"
+#include "pjdfInternal.h"
+#include "sim.h"
+
+// Addressing for the simulated I2C hardware
+typedef struct _PjdfContextI2CSim
+{
+    INT8U i2CDevAddr;
+} PjdfContextI2cSim;
+
+static PjdfContextI2cSim i2c1SimContext = { 0 };
+
+
+// OpenI2CSim
+// No special action required to open I2C device
+static PjdfErrCode OpenI2CSim(DriverInternal *pDriver, INT8U flags)
+{
+    return PJDF_ERR_NONE;
+}
+
+// CloseI2CSim
+// No special action required to close I2C device
+static PjdfErrCode CloseI2CSim(DriverInternal *pDriver)
+{
+    return PJDF_ERR_NONE;
+}
+
+// ReadI2CSim
+// See ReadI2C() in pjdfInternalI2C.c: one byte reads the register in the
+// first byte of the buffer, more bytes read from register 0 on.
+// A device that does not answer reads as 0xFF.
+static PjdfErrCode ReadI2CSim(DriverInternal *pDriver, void* pBuffer, INT32U* pCount)
+{
+    PjdfContextI2cSim *pContext = (PjdfContextI2cSim*) pDriver->deviceContext;
+    SimI2cDevice *pDevice = SimI2cFind(pContext->i2CDevAddr);
+    INT8U *buffer = (INT8U*) pBuffer;
+    INT8U reg = (*pCount == 1) ? buffer[0] : 0;
+    INT32U i;
+    OS_CPU_SR cpu_sr = 0;
+
+    OS_ENTER_CRITICAL();
+
+    // address + register, then address + data
+    SimI2cTransfer(pDevice, 3 + *pCount);
+    for (i = 0; i < *pCount; i++)
+    {
+        buffer[i] = (pDevice != NULL) ? pDevice->ReadReg(reg + i) : 0xFF;
+    }
+
+    OS_EXIT_CRITICAL();
+
+    return PJDF_ERR_NONE;
+}
+
+// WriteI2CSim
+// See WriteI2C() in pjdfInternalI2C.c: writes the byte after the register
+// address in the first byte of the buffer.
+static PjdfErrCode WriteI2CSim(DriverInternal *pDriver, void* pBuffer, INT32U* pCount)
+{
+    PjdfContextI2cSim *pContext = (PjdfContextI2cSim*) pDriver->deviceContext;
+    SimI2cDevice *pDevice = SimI2cFind(pContext->i2CDevAddr);
+    INT8U *buffer = (INT8U*) pBuffer;
+    OS_CPU_SR cpu_sr = 0;
+
+    OS_ENTER_CRITICAL();
+
+    // address + register, then address + value
+    SimI2cTransfer(pDevice, 4);
+    if (pDevice != NULL)
+    {
+        pDevice->WriteReg(buffer[0], buffer[1]);
+    }
+
+    OS_EXIT_CRITICAL();
+
+    return PJDF_ERR_NONE;
+}
+
+// IoctlI2CSim
+// Handles the request codes defined in pjdfCtrlI2c.h
+static PjdfErrCode IoctlI2CSim(DriverInternal *pDriver, INT8U request, void* pArgs, INT32U* pSize)
+{
+    PjdfContextI2cSim *pContext = (PjdfContextI2cSim*) pDriver->deviceContext;
+    if (pContext == NULL) while(1);
+    switch (request)
+    {
+    case PJDF_CTRL_I2C_SET_DEVICE_ADDRESS: // Set the I2C device address for subsequent IO
+        pContext->i2CDevAddr = ((INT8U*)pArgs)[0];
+        break;
+    default:
+        while(1);
+        break;
+    }
+    return PJDF_ERR_NONE;
+}
+
+
+// Initializes the simulated I2C driver.
+PjdfErrCode InitI2CSim(DriverInternal *pDriver, const char *pName)
+{
+    if (strcmp (pName, pDriver->pName) != 0) while(1); // pName should have been initialized in driversInternal[] declaration
+
+    // Initialize semaphore for serializing operations on the device
+    pDriver->sem = OSSemCreate(1);
+    if (pDriver->sem == NULL) while (1);  // not enough semaphores available
+    pDriver->refCount = 0; // initial number of Open handles to the device
+
+    if (strcmp(pName, PJDF_DEVICE_ID_I2C) == 0)
+    {
+        pDriver->maxRefCount = 1; // Maximum refcount allowed for the device
+        pDriver->deviceContext = (void*) &i2c1SimContext;
+    }
+
+    // Assign implemented functions to the interface pointers
+    pDriver->Open = OpenI2CSim;
+    pDriver->Close = CloseI2CSim;
+    pDriver->Read = ReadI2CSim;
+    pDriver->Write = WriteI2CSim;
+    pDriver->Ioctl = IoctlI2CSim;
+
+    pDriver->initialized = OS_TRUE;
+    return PJDF_ERR_NONE;
+}
@@ -0,0 +1,160 @@
+/*
+    pjdfInternalSPISim.c
+    The implementation of the internal PJDF interface pjdfInternal.h for the
+    simulated SPI1 bus of the Linux build, see sim.h.
+
+    Same requests and locking as pjdfInternalSPI.c. Transfers go to the
+    device whose chip select is asserted and take as long as SCK needs.
+    The prescaler is also kept in the SPI1 register block, for the
+    transfers that bypass PJDF (PJDF_BIND_DIRECT, see pjdfBind.h).
+*/
+
+#include "bsp.h"
+#include "pjdf.h"
+#include "pjdfInternal.h"
+#include "sim.h"
+
+// Bus settings for the simulated SPI hardware
+typedef struct _PjdfContextSpiSim
+{
+    uint32_t prescaler; // BR[2:0] bits as passed to PJDF_CTRL_SPI_SET_DATARATE
+    PjdfSpiLock lock;   // Exclusive access to the bus, see pjdfInternalSPI.c
+    PjdfSpiProfiles profiles; // Bus configuration of each client
+} PjdfContextSpiSim;
+
+static PjdfContextSpiSim spi1SimContext = { LL_SPI_BAUDRATEPRESCALER_DIV256 };
+
+
+// OpenSPISim
+// No special action required to open SPI device
+static PjdfErrCode OpenSPISim(DriverInternal *pDriver, INT8U flags)
+{
+    return PJDF_ERR_NONE;
+}
+
+// CloseSPISim
+// No special action required to close SPI device
+static PjdfErrCode CloseSPISim(DriverInternal *pDriver)
+{
+    return PJDF_ERR_NONE;
+}
+
+// ReadSPISim
+// Full duplex transfer, see ReadSPI() in pjdfInternalSPI.c.
+static PjdfErrCode ReadSPISim(DriverInternal *pDriver, void* pBuffer, INT32U* pCount)
+{
+    PjdfContextSpiSim *pContext = (PjdfContextSpiSim*) pDriver->deviceContext;
+    if (pContext == NULL) while(1);
+    SimSpiTransfer(pContext->prescaler, (INT8U*) pBuffer, (INT8U*) pBuffer, *pCount);
+    return PJDF_ERR_NONE;
+}
+
+// WriteSPISim
+// Transmit only, see WriteSPI() in pjdfInternalSPI.c.
+static PjdfErrCode WriteSPISim(DriverInternal *pDriver, void* pBuffer, INT32U* pCount)
+{
+    PjdfContextSpiSim *pContext = (PjdfContextSpiSim*) pDriver->deviceContext;
+    if (pContext == NULL) while(1);
+    SimSpiTransfer(pContext->prescaler, (INT8U*) pBuffer, NULL, *pCount);
+    return PJDF_ERR_NONE;
+}
+
+// SpiSimWaitForLock
+// PJDF_CTRL_SPI_WAIT_FOR_LOCK, which also times the MP3 client's waits for
+// the lock the LCD holds for the hand-over test, see simSpiYield.c
+static void SpiSimWaitForLock(PjdfSpiLock *pLock, void* pArgs, INT32U* pSize)
+{
+    OS_MUTEX_DATA data;
+    BOOLEAN behindLcd = OS_FALSE;
+    uint64_t start = SimNowNs();
+
+    if (pArgs != NULL && *(INT8U*)pArgs == PJDF_SPI_CLIENT_MP3)
+    {
+        if (OSMutexQuery(pLock->mutex, &data) != OS_ERR_NONE) while (1);
+        behindLcd = !data.OSValue && pLock->client == PJDF_SPI_CLIENT_LCD;
+    }
+    SpiLockIoctl(pLock, PJDF_CTRL_SPI_WAIT_FOR_LOCK, pArgs, pSize);
+    if (behindLcd) SimSpiYieldWaited(SimNowNs() - start);
+}
+
+// IoctlSPISim
+// Handles the request codes defined in pjdfCtrlSpi.h
+static PjdfErrCode IoctlSPISim(DriverInternal *pDriver, INT8U request, void* pArgs, INT32U* pSize)
+{
+    const PjdfSpiProfile *pProfile;
+    INT16U prescaler;
+    PjdfContextSpiSim *pContext = (PjdfContextSpiSim*) pDriver->deviceContext;
+    if (pContext == NULL) while(1);
+    if (request == PJDF_CTRL_SPI_WAIT_FOR_LOCK)
+    {
+        SpiSimWaitForLock(&pContext->lock, pArgs, pSize);
+        return PJDF_ERR_NONE;
+    }
+    if (SpiLockIoctl(&pContext->lock, request, pArgs, pSize)) return PJDF_ERR_NONE;
+    if (SpiProfilesIoctl(&pContext->profiles, request, pArgs, pSize)) return PJDF_ERR_NONE;
+    switch (request)
+    {
+    case PJDF_CTRL_SPI_SELECT_PROFILE:
+        if (*pSize != sizeof(INT8U)) while (1);
+        pProfile = SpiProfileSelect(&pContext->profiles, *(INT8U*)pArgs, &prescaler);
+        if (pProfile != NULL)
+        {
+            // The models only speak mode 0 with 8 bit frames
+            if (pProfile->dataWidth != 8 || pProfile->mode != 0) while (1);
+            pContext->prescaler = prescaler;
+            SPI_SetDataRate(PJDF_SPI1, prescaler);
+        }
+        break;
+    case PJDF_CTRL_SPI_SET_DATARATE:
+        if (*pSize != sizeof(INT16U)) while (1);
+        SpiProfilesInvalidate(&pContext->profiles);
+        pContext->prescaler = *(INT16U*)pArgs;
+        SPI_SetDataRate(PJDF_SPI1, pContext->prescaler);
+        break;
+    default:
+        while(1);
+        break;
+    }
+    return PJDF_ERR_NONE;
+}
+
+
+void SimSpiLockStats(PjdfSpiLockStats *pStats)
+{
+    memcpy(pStats, spi1SimContext.lock.stats, sizeof(spi1SimContext.lock.stats));
+}
+
+void SimSpiProfileStats(PjdfSpiProfileStats *pStats)
+{
+    memcpy(pStats, spi1SimContext.profiles.stats, sizeof(spi1SimContext.profiles.stats));
+}
+
+
+// Initializes the simulated SPI driver.
+PjdfErrCode InitSPISim(DriverInternal *pDriver, const char *pName)
+{
+    if (strcmp (pName, pDriver->pName) != 0) while(1); // pName should have been initialized in driversInternal[] declaration
+
+    // Initialize semaphore for serializing operations on the device
+    pDriver->sem = OSSemCreate(1);
+    if (pDriver->sem == NULL) while (1);  // not enough semaphores available
+    pDriver->refCount = 0; // initial number of Open handles to the device
+
+    if (strcmp(pName, PJDF_DEVICE_ID_SPI1) == 0)
+    {
+        pDriver->maxRefCount = 10; // Maximum refcount allowed for the device
+        pDriver->deviceContext = (void*) &spi1SimContext;
+        SpiLockInit(&spi1SimContext.lock);
+        SpiProfilesInit(&spi1SimContext.profiles);
+    }
+
+    // Assign implemented functions to the interface pointers
+    pDriver->Open = OpenSPISim;
+    pDriver->Close = CloseSPISim;
+    pDriver->Read = ReadSPISim;
+    pDriver->Write = WriteSPISim;
+    pDriver->Ioctl = IoctlSPISim;
+
+    pDriver->initialized = OS_TRUE;
+    return PJDF_ERR_NONE;
+}
@@ -0,0 +1,291 @@
+/*
+    sim.h
+
+    Simulated devices of the Linux build (make SIM=1, the default), so
+    throughput and underrun experiments can be repeated without a board.
+
+    PJDF binds /dev/spi1 and /dev/i2c1 to simulated buses (InitSPISim(),
+    InitI2CSim()). The MP3, LCD and SD drivers are the target ones: they
+    select their device with its chip-select pin as on the board, and the
+    bus hands the bytes to the model behind that pin:
+
+        SPI1  PA4  VS1053 SCI        simVS1053.c  2 KB stream FIFO, DREQ
+              PB1  VS1053 SDI
+              PA2  ILI9341           simILI9341.c framebuffer, PPM/PNG dump
+              PA3  SD card           simSD.c      SPI mode card on a FAT image
+        I2C1  0x38 FT6206            simFT6206.c  replays recorded touches
+
+    Every transfer busy-waits for the time its bits take on the bus at the
+    prescaler and SystemCoreClock in effect, so clock and prescaler changes
+    show up in throughput the way they do on the target.
+*/
+
+#ifndef __SIM_H__
+#define __SIM_H__
+
+#include "bsp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Model timing, see the models. Override with -D on the make command line.
+#ifndef SIM_MP3_FIFO_SIZE
+#define SIM_MP3_FIFO_SIZE          2048     // VS1053 SDI stream buffer, bytes
+#endif
+#ifndef SIM_MP3_DREQ_FREE
+#define SIM_MP3_DREQ_FREE          32       // DREQ is high while this much is free
+#endif
+#ifndef SIM_SD_READ_LATENCY_US
+#define SIM_SD_READ_LATENCY_US     250      // command to data token, first block
+#endif
+#ifndef SIM_SD_STREAM_LATENCY_US
+#define SIM_SD_STREAM_LATENCY_US   20       // between blocks of a CMD18 read
+#endif
+#ifndef SIM_SD_WRITE_BUSY_US
+#define SIM_SD_WRITE_BUSY_US       1000     // busy after a data block is accepted
+#endif
+#ifndef SIM_SD_INIT_US
+#define SIM_SD_INIT_US             20000    // ACMD41 reports idle for this long after CMD0
+#endif
+#ifndef SIM_MP3_EVENT_MAX
+#define SIM_MP3_EVENT_MAX          4096     // audible changes logged, see SimVS1053Events()
+#endif
+#ifndef SIM_I2C_HZ
+#define SIM_I2C_HZ                 100000   // I2C1 timing set up by BspI2C1_init()
+#endif
+#ifndef SIM_SD_STRESS_PRIO
+#define SIM_SD_STRESS_PRIO         10       // first SD stress reader, under the application tasks
+#endif
+#define SIM_SD_STRESS_MAX_READERS  3        // see simSDStress.c
+#ifndef SIM_SPI_YIELD_PRIO
+#define SIM_SPI_YIELD_PRIO         (SIM_SD_STRESS_PRIO + SIM_SD_STRESS_MAX_READERS) // LCD filler, see simSpiYield.c
+#endif
+#define SIM_SPI_YIELD_MAX_BYTES    (240 * 320 * 2)  // a screenful of pixels
+
+// For the functions that read the models' counters from outside the uC/OS
+// tasks (the report at the end of a -d run): the reads are racy by design
+// and the numbers only need to be approximately coherent.
+#define SIM_UNLOCKED_READ   __attribute__((no_sanitize("thread")))
+
+// Host time in ns since the simulation started
+uint64_t SimNowNs(void);
+
+// Spin until SimNowNs() reaches deadline
+void SimBusyUntil(uint64_t deadline);
+
+
+// A device on the simulated SPI1 bus, selected while its chip-select pin is low
+typedef struct _SimSpiDevice
+{
+    const char *name;
+    GPIO_TypeDef *csGpio;
+    uint32_t csPin;
+
+    // Clock count bytes: pMosi is what the master sends; if pMiso is not
+    // NULL it receives what the device drives on MISO (0xFF if nothing)
+    void (*Transfer)(const INT8U *pMosi, INT8U *pMiso, INT32U count);
+    void (*Select)(BOOLEAN selected);   // chip-select edge, may be NULL
+
+    INT32U transfers;
+    uint64_t bytes;
+    uint64_t busyNs;                    // SCK time spent on this device
+} SimSpiDevice;
+
+extern SimSpiDevice simVS1053Sci;
+extern SimSpiDevice simVS1053Sdi;
+extern SimSpiDevice simILI9341;
+extern SimSpiDevice simSD;
+
+#define SIM_SPI_DEVICE_COUNT 4
+extern SimSpiDevice *const simSpiDevices[SIM_SPI_DEVICE_COUNT];
+extern SimSpiDevice simSpiIdle;         // clocks with no device selected
+extern INT32U simSpiConflicts;          // transfers with more than one device selected
+extern INT32U simSpiSckHz;              // SCK of the transfer in progress
+
+// Clock count bytes on SPI1 with the given BR[2:0] prescaler bits, see pjdfInternalSPISim.c
+void SimSpiTransfer(uint32_t prescaler, const INT8U *pMosi, INT8U *pMiso, INT32U count);
+
+// Copy the SPI1 lock statistics, PjdfSpiLockStats[PJDF_SPI_CLIENT_COUNT]
+SIM_UNLOCKED_READ void SimSpiLockStats(PjdfSpiLockStats *pStats);
+// and the bus reconfigurations, PjdfSpiProfileStats[PJDF_SPI_CLIENT_COUNT]
+SIM_UNLOCKED_READ void SimSpiProfileStats(PjdfSpiProfileStats *pStats);
+
+// Copy the PJDF counters of the index-th device, see PjdfGetStatsAt();
+// returns its name, NULL past the last one
+SIM_UNLOCKED_READ const char *SimPjdfStats(INT8U index, PjdfDeviceStats *pStats);
+
+
+// A device on the simulated I2C1 bus
+typedef struct _SimI2cDevice
+{
+    const char *name;
+    INT8U address;                      // 7 bit
+
+    INT8U (*ReadReg)(INT8U reg);
+    void (*WriteReg)(INT8U reg, INT8U value);
+
+    INT32U transfers;
+    uint64_t bytes;
+    uint64_t busyNs;
+} SimI2cDevice;
+
+extern SimI2cDevice simFT6206;
+
+#define SIM_I2C_DEVICE_COUNT 1
+extern SimI2cDevice *const simI2cDevices[SIM_I2C_DEVICE_COUNT];
+
+SimI2cDevice *SimI2cFind(INT8U address);
+
+// Account and wait for count bytes, address bytes included, on I2C1
+void SimI2cTransfer(SimI2cDevice *pDevice, INT32U count);
+
+
+// VS1053 stream statistics since the start or SimVS1053StatsReset()
+typedef struct _SimVS1053Stats
+{
+    uint64_t sdiBytes;      // bytes written to the stream FIFO
+    INT32U frames;          // MPEG audio frames played
+    INT32U underruns;       // the FIFO ran dry inside the stream
+    uint64_t underrunNs;    // time spent starved
+    INT32U overflows;       // writes with DREQ low that did not fit
+    uint64_t droppedBytes;  // bytes lost to overflows
+    INT32U minFifoLevel;    // lowest level seen while playing
+    INT32U bitrate;         // of the last frame, bits per second
+} SimVS1053Stats;
+
+SIM_UNLOCKED_READ void SimVS1053GetStats(SimVS1053Stats *pStats);
+void SimVS1053StatsReset(void);
+BOOLEAN SimVS1053Dreq(void);
+
+// Changes in the audio output, logged by the VS1053 model
+typedef enum
+{
+    SIM_MP3_EVENT_RESET,    // soft reset: the output stops
+    SIM_MP3_EVENT_START,    // first frame after a soft reset
+    SIM_MP3_EVENT_STARVE,   // the FIFO ran dry inside the stream
+    SIM_MP3_EVENT_RESUME,   // data again after SIM_MP3_EVENT_STARVE
+    SIM_MP3_EVENT_VOLUME,   // SCI_VOL written
+} SimMp3EventType;
+
+typedef struct _SimMp3Event
+{
+    uint64_t ns;            // SimNowNs() when it happened
+    SimMp3EventType type;
+} SimMp3Event;
+
+// The events so far, the first SIM_MP3_EVENT_MAX of them; returns the count
+SIM_UNLOCKED_READ INT32U SimVS1053Events(const SimMp3Event **ppEvents);
+
+// Open the SD card image; without one the card slot is empty
+BOOLEAN SimSDOpen(const char *pPath);
+
+// Flip a bit of every nth block the card sends for a read, after its CRC
+// is made, for the SD library's CRC checks to catch (mp3player -e n);
+// zero, the default, for none
+void SimSDCorrupt(INT32U every);
+
+// Flip a bit of the start token of every nth block the card sends for a
+// read, for the SD library to read it again (mp3player -g n); zero, the
+// default, for none
+void SimSDGarble(INT32U every);
+
+// Flip a bit of every block the card sends while SCK is faster than hz,
+// as a card or wiring that cannot keep up would (mp3player -k hz), for
+// Sd2Card::calibrate() to find; zero, the default, for no limit
+void SimSDMaxSck(INT32U hz);
+
+// SD card statistics since the start
+typedef struct _SimSDStats
+{
+    INT32U blocksRead;      // data blocks sent, CMD18 ones included
+    INT32U blocksWritten;
+    INT32U crcErrors;       // commands and blocks written that failed the card's check
+    INT32U corrupted;       // blocks read corrupted by SimSDCorrupt() or SimSDMaxSck()
+    INT32U garbled;         // blocks read with a start token garbled by SimSDGarble()
+    // Since initialization finished:
+    INT32U commands;        // commands taken, ACMDs and their CMD55 included
+    INT32U readCommands;    // CMD17 and CMD18
+    uint64_t selectedNs;    // chip select low: the bus is the card's
+} SimSDStats;
+
+SIM_UNLOCKED_READ void SimSDGetStats(SimSDStats *pStats);
+
+// SD library stress test, see simSDStress.c. SimSDStressSetup() sets the
+// number of reader tasks before the start, zero for none; StartupTask
+// calls SimSDStressStart() once the card is up.
+BOOLEAN SimSDStressSetup(INT8U readers);
+void SimSDStressStart(void);
+
+// What the readers checked, all of them together
+typedef struct _SimSDStressStats
+{
+    INT32U passes;          // directory listings and the pattern files in them
+    INT32U files;           // pattern files read through
+    uint64_t bytes;         // bytes checked
+    INT32U mismatches;      // reads not the pattern, short of or past the end
+    INT32U errors;          // failed opens, seeks and reads
+} SimSDStressStats;
+
+// Returns the number of readers
+SIM_UNLOCKED_READ INT8U SimSDStressGetStats(SimSDStressStats *pStats);
+
+// SPI1 hand-over test, see simSpiYield.c. SimSpiYieldSetup() sets the
+// bytes of pixels of each LCD fill before the start, more than
+// LCD_SPI_HOLD_MAX; LcdTouchTask calls SimSpiYieldStart() once the screen is
+// drawn, which does nothing unless a fill size was set.
+BOOLEAN SimSpiYieldSetup(INT32U bytes);
+void SimSpiYieldStart(HANDLE hLcd);
+
+// pjdfInternalSPISim.c: the MP3 client waited waitNs for the lock the LCD held
+void SimSpiYieldWaited(uint64_t waitNs);
+
+typedef struct _SimSpiYieldStats
+{
+    INT32U fills;           // LCD fills done
+    uint64_t bytes;         // pixel bytes sent by them
+    INT32U waits;           // waits of the MP3 client's for the lock the LCD held
+    uint64_t maxWaitNs;     // the longest of them
+    uint64_t holdNs;        // the hold bound when it ended
+    int64_t maxOverNs;      // the most a wait took over the hold bound then, negative if none did
+} SimSpiYieldStats;
+
+// Returns the bytes of each fill, zero if the test is not running
+SIM_UNLOCKED_READ INT32U SimSpiYieldGetStats(SimSpiYieldStats *pStats);
+
+// Read touches to replay from a text file, see simFT6206.c
+BOOLEAN SimFT6206Load(const char *pPath);
+
+typedef struct _SimTouch
+{
+    INT32U ms;
+    BOOLEAN down;           // otherwise the finger is lifted
+    INT16U x;
+    INT16U y;
+    BOOLEAN seen;           // a touch down the player read the point of
+    INT32U seenMs;          // when it first did
+} SimTouch;
+
+// The touches loaded, with which the player saw; returns the count
+INT32U SimFT6206Touches(const SimTouch **ppTouches);
+
+// Write the LCD contents as .ppm or .png, chosen by the extension
+BOOLEAN SimILI9341Dump(const char *pPath);
+
+#if OS_TRACE_EN > 0u
+// Time TraceRecord() on this host for the report, before the kernel starts
+// (OSInit() clears the buffer again)
+void SimTraceCalibrate(void);
+#endif
+
+// Reports, see simReport.c. SimSampleTasks() must run more often than a
+// task's OSTCBCyclesTot wraps (53 s at 80 MHz) for its CPU use to be right.
+SIM_UNLOCKED_READ void SimSampleTasks(void);
+SIM_UNLOCKED_READ void SimReport(void);
+SIM_UNLOCKED_READ BOOLEAN SimReportJson(const char *pPath);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,141 @@
+/*
+    simBus.c
+
+    Simulated SPI1 and I2C1 buses and the GPIO pins the devices on them
+    use, see sim.h. The PJDF drivers in pjdfInternalSPISim.c and
+    pjdfInternalI2CSim.c move the bytes; this module decides which model
+    gets them and how long they take. simReport.c reports the counters.
+*/
+
+#include <time.h>
+#include "sim.h"
+
+SimSpiDevice *const simSpiDevices[SIM_SPI_DEVICE_COUNT] = { &simVS1053Sci, &simVS1053Sdi, &simILI9341, &simSD };
+SimI2cDevice *const simI2cDevices[SIM_I2C_DEVICE_COUNT] = { &simFT6206 };
+
+// Clocks with no device selected, e.g. the 74 clocks of SD card power up
+SimSpiDevice simSpiIdle = { "(no device)" };
+INT32U simSpiConflicts;
+INT32U simSpiSckHz;
+
+static uint64_t simStartNs;         // host clock at the first SimNowNs()
+
+
+uint64_t SimNowNs(void)
+{
+    struct timespec now;
+    uint64_t ns;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ns = (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+    if (simStartNs == 0) simStartNs = ns;
+    return ns - simStartNs;
+}
+
+void SimBusyUntil(uint64_t deadline)
+{
+    while (SimNowNs() < deadline);
+}
+
+static BOOLEAN SimSpiSelected(SimSpiDevice *pDevice)
+{
+    return (pDevice->csGpio->ODR & pDevice->csPin) == 0;
+}
+
+// Output pins changed: pass chip-select edges on to the models
+void HostGpioWrite(GPIO_TypeDef *GPIOx, uint32_t PinMask)
+{
+    int i;
+
+    for (i = 0; i < SIM_SPI_DEVICE_COUNT; i++)
+    {
+        SimSpiDevice *pDevice = simSpiDevices[i];
+        if (pDevice->csGpio == GPIOx && (pDevice->csPin & PinMask) && pDevice->Select != NULL)
+        {
+            pDevice->Select(SimSpiSelected(pDevice));
+        }
+    }
+}
+
+// The only input a model drives is the VS1053 DREQ pin
+uint32_t HostGpioRead(GPIO_TypeDef *GPIOx)
+{
+    if (GPIOx == MP3_VS1053_DREQ_GPIO)
+    {
+        if (SimVS1053Dreq())
+        {
+            SET_BIT(GPIOx->IDR, MP3_VS1053_DREQ_GPIO_Pin);
+        }
+        else
+        {
+            CLEAR_BIT(GPIOx->IDR, MP3_VS1053_DREQ_GPIO_Pin);
+        }
+    }
+    return GPIOx->IDR;
+}
+
+void SimSpiTransfer(uint32_t prescaler, const INT8U *pMosi, INT8U *pMiso, INT32U count)
+{
+    SimSpiDevice *pSelected = NULL;
+    uint64_t start = SimNowNs();
+    uint64_t ns;
+    int selected = 0;
+    int i;
+
+    // SCK = PCLK2 / 2^(BR+1), and PCLK2 is HCLK on this board
+    simSpiSckHz = SystemCoreClock / (2u << (prescaler >> SPI_CR1_BR_Pos));
+    ns = (uint64_t)count * 8u * (2u << (prescaler >> SPI_CR1_BR_Pos)) * 1000000000u / SystemCoreClock;
+
+    for (i = 0; i < SIM_SPI_DEVICE_COUNT; i++)
+    {
+        if (SimSpiSelected(simSpiDevices[i]))
+        {
+            pSelected = simSpiDevices[i];
+            selected++;
+        }
+    }
+
+    if (selected == 1)
+    {
+        pSelected->Transfer(pMosi, pMiso, count);
+        pSelected->transfers++;
+        pSelected->bytes += count;
+        pSelected->busyNs += ns;
+    }
+    else
+    {
+        // Nobody drives MISO; with several devices selected it is garbage anyway
+        if (pMiso != NULL) memset(pMiso, 0xFF, count);
+        if (selected > 1) simSpiConflicts++;
+        simSpiIdle.transfers++;
+        simSpiIdle.bytes += count;
+        simSpiIdle.busyNs += ns;
+    }
+
+    SimBusyUntil(start + ns);
+}
+
+SimI2cDevice *SimI2cFind(INT8U address)
+{
+    int i;
+
+    for (i = 0; i < SIM_I2C_DEVICE_COUNT; i++)
+    {
+        if (simI2cDevices[i]->address == address) return simI2cDevices[i];
+    }
+    return NULL;
+}
+
+void SimI2cTransfer(SimI2cDevice *pDevice, INT32U count)
+{
+    uint64_t start = SimNowNs();
+    uint64_t ns = (uint64_t)count * 9u * 1000000000u / SIM_I2C_HZ;   // 8 bits and ACK
+
+    if (pDevice != NULL)
+    {
+        pDevice->transfers++;
+        pDevice->bytes += count;
+        pDevice->busyNs += ns;
+    }
+    SimBusyUntil(start + ns);
+}
@@ -0,0 +1,161 @@
+/*
+    simFT6206.c
+
+    FT6206 touch controller model for the simulated I2C1 bus, see sim.h.
+
+    SimFT6206Load() reads the touches to replay, one event per line:
+
+        # ms    x    y
+        2000  100   30      finger down (or moved) at controller x, y
+        2100  up            finger lifted
+
+    Times are ms since the program started and must not decrease. x and y
+    are what the controller reports; LcdTouchTask maps them to the screen
+    as (240 - x, 320 - y). Without a file the panel is never touched.
+
+    A finger is not lifted before the player has read where it is: the
+    "up" waits for that read, unless the finger has landed again by then.
+    So a press shorter than the player's polling is still seen once, and
+    whether it is does not depend on how the host schedules the threads.
+    Each touch down records whether and when its point was read.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sim.h"
+
+#define FT6206_ADDR_7BIT    0x38
+#define FT6206_TD_STATUS    0x02
+#define FT6206_P1_XH        0x03
+#define FT6206_P1_XL        0x04
+#define FT6206_P1_YH        0x05
+#define FT6206_P1_YL        0x06
+#define FT6206_FIRMVERS     0xA6
+#define FT6206_CHIPID       0xA3
+#define FT6206_VENDID       0xA8
+
+#define FT6206_EVENT_CONTACT 0x80
+
+static INT8U SimFT6206ReadReg(INT8U reg);
+static void SimFT6206WriteReg(INT8U reg, INT8U value);
+
+SimI2cDevice simFT6206 = { "ft6206", FT6206_ADDR_7BIT, SimFT6206ReadReg, SimFT6206WriteReg };
+
+static SimTouch *touches;
+static INT32U touchCount;
+static INT32U touchNext;            // first event still in the future
+static SimTouch *pTouchUnread;      // finger down whose point was not read yet
+static INT8U regs[256];
+
+
+BOOLEAN SimFT6206Load(const char *pPath)
+{
+    char line[128];
+    INT32U lineNo = 0;
+    FILE *f;
+
+    f = fopen(pPath, "r");
+    if (f == NULL) return OS_FALSE;
+
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        SimTouch t = { 0 };
+        unsigned long ms;
+        unsigned x, y;
+        char word[8];
+
+        lineNo++;
+        if (sscanf(line, " %1[#]", word) == 1 || sscanf(line, " %7s", word) != 1) continue;
+
+        if (sscanf(line, "%lu %u %u", &ms, &x, &y) == 3)
+        {
+            t.down = OS_TRUE;
+            t.x = x;
+            t.y = y;
+        }
+        else if (sscanf(line, "%lu %7s", &ms, word) != 2 || strcmp(word, "up") != 0)
+        {
+            fprintf(stderr, "%s:%lu: expected 'ms x y' or 'ms up'\n", pPath, (unsigned long)lineNo);
+            fclose(f);
+            return OS_FALSE;
+        }
+        t.ms = ms;
+
+        touches = (SimTouch *)realloc(touches, (touchCount + 1) * sizeof(SimTouch));
+        touches[touchCount++] = t;
+    }
+    fclose(f);
+    return OS_TRUE;
+}
+
+// True if a touch down from touches[i] on is due by ms
+static BOOLEAN SimFT6206DownDue(INT32U i, INT32U ms)
+{
+    for (; i < touchCount && touches[i].ms <= ms; i++)
+    {
+        if (touches[i].down) return OS_TRUE;
+    }
+    return OS_FALSE;
+}
+
+// Bring the touch registers up to the current time
+static void SimFT6206Update(void)
+{
+    INT32U ms = (INT32U)(SimNowNs() / 1000000u);
+    SimTouch *pTouch;
+
+    while (touchNext < touchCount && touches[touchNext].ms <= ms)
+    {
+        pTouch = &touches[touchNext];
+        if (!pTouch->down && pTouchUnread != NULL && !SimFT6206DownDue(touchNext + 1, ms)) break;
+        touchNext++;
+        regs[FT6206_TD_STATUS] = pTouch->down ? 1 : 0;
+        pTouchUnread = pTouch->down ? pTouch : NULL;
+        if (pTouch->down)
+        {
+            regs[FT6206_P1_XH] = FT6206_EVENT_CONTACT | ((pTouch->x >> 8) & 0x0F);
+            regs[FT6206_P1_XL] = pTouch->x & 0xFF;
+            regs[FT6206_P1_YH] = (pTouch->y >> 8) & 0x0F;   // touch ID 0
+            regs[FT6206_P1_YL] = pTouch->y & 0xFF;
+        }
+    }
+}
+
+static INT8U SimFT6206ReadReg(INT8U reg)
+{
+    switch (reg)
+    {
+    case 0:                             // start of a block read
+    case FT6206_TD_STATUS:
+        SimFT6206Update();
+        break;
+    case FT6206_P1_YL:                  // the last of the point
+        if (pTouchUnread != NULL)
+        {
+            pTouchUnread->seen = OS_TRUE;
+            pTouchUnread->seenMs = (INT32U)(SimNowNs() / 1000000u);
+            pTouchUnread = NULL;
+        }
+        break;
+    case FT6206_VENDID:
+        return 17;
+    case FT6206_CHIPID:
+        return 6;
+    case FT6206_FIRMVERS:
+        return 3;
+    default:
+        break;
+    }
+    return regs[reg];
+}
+
+static void SimFT6206WriteReg(INT8U reg, INT8U value)
+{
+    regs[reg] = value;
+}
+
+INT32U SimFT6206Touches(const SimTouch **ppTouches)
+{
+    *ppTouches = touches;
+    return touchCount;
+}
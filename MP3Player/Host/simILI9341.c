@@ -0,0 +1,267 @@
+/*
+    simILI9341.c
+
+    ILI9341 model for the simulated SPI1 bus, see sim.h.
+
+    Bytes sent with D/C low are commands, with D/C high their parameters.
+    CASET and PASET set the address window and RAMWR fills it with RGB565
+    pixels, which land in a 240x320 framebuffer. MADCTL is honoured relative
+    to the 0x48 (MX, BGR) that Adafruit_ILI9341::begin() sets, so with that
+    setting the framebuffer is what the panel shows. Reads return 0.
+*/
+
+#include <stdio.h>
+#include "sim.h"
+
+#define SIM_LCD_WIDTH       240
+#define SIM_LCD_HEIGHT      320
+
+#define LCD_SWRESET         0x01
+#define LCD_CASET           0x2A
+#define LCD_PASET           0x2B
+#define LCD_RAMWR           0x2C
+#define LCD_MADCTL          0x36
+
+#define MADCTL_MY           0x80
+#define MADCTL_MX           0x40
+#define MADCTL_MV           0x20
+#define MADCTL_DEFAULT      0x48    // what begin() sets
+
+static void SimILI9341Transfer(const INT8U *pMosi, INT8U *pMiso, INT32U count);
+
+SimSpiDevice simILI9341 = { "ili9341", LCD_ILI9341_CS_GPIO, LCD_ILI9341_CS_GPIO_Pin,
+                            SimILI9341Transfer, NULL };
+
+static INT16U frameBuffer[SIM_LCD_HEIGHT][SIM_LCD_WIDTH];
+
+static INT8U command;               // last command byte
+static INT32U paramCount;           // parameter bytes since the command
+static INT8U params[4];
+static INT8U madctl = MADCTL_DEFAULT;
+static INT16U colStart, colEnd = SIM_LCD_WIDTH - 1;
+static INT16U pageStart, pageEnd = SIM_LCD_HEIGHT - 1;
+static INT16U col, page;            // RAMWR position
+static INT8U pixelHigh;             // first byte of a pixel
+
+
+static void SimILI9341Pixel(INT16U color)
+{
+    INT32U x = col, y = page;
+    INT8U flip = madctl ^ MADCTL_DEFAULT;
+
+    if (madctl & MADCTL_MV)
+    {
+        x = page;
+        y = col;
+    }
+    if (flip & MADCTL_MX) x = SIM_LCD_WIDTH - 1 - x;
+    if (flip & MADCTL_MY) y = SIM_LCD_HEIGHT - 1 - y;
+    if (x < SIM_LCD_WIDTH && y < SIM_LCD_HEIGHT) frameBuffer[y][x] = color;
+
+    // Columns first, then pages, wrapping inside the window
+    if (col < colEnd)
+    {
+        col++;
+    }
+    else
+    {
+        col = colStart;
+        page = (page < pageEnd) ? page + 1 : pageStart;
+    }
+}
+
+static void SimILI9341Data(INT8U data)
+{
+    if (command == LCD_RAMWR)
+    {
+        if (paramCount++ & 1) SimILI9341Pixel((pixelHigh << 8) | data);
+        else pixelHigh = data;
+        return;
+    }
+
+    if (paramCount < sizeof(params)) params[paramCount] = data;
+    paramCount++;
+
+    switch (command)
+    {
+    case LCD_CASET:
+        if (paramCount == 4)
+        {
+            colStart = (params[0] << 8) | params[1];
+            colEnd = (params[2] << 8) | params[3];
+        }
+        break;
+    case LCD_PASET:
+        if (paramCount == 4)
+        {
+            pageStart = (params[0] << 8) | params[1];
+            pageEnd = (params[2] << 8) | params[3];
+        }
+        break;
+    case LCD_MADCTL:
+        if (paramCount == 1) madctl = data;
+        break;
+    default:
+        break;
+    }
+}
+
+static void SimILI9341Command(INT8U cmd)
+{
+    command = cmd;
+    paramCount = 0;
+    switch (cmd)
+    {
+    case LCD_SWRESET:
+        madctl = 0;
+        colStart = pageStart = 0;
+        colEnd = SIM_LCD_WIDTH - 1;
+        pageEnd = SIM_LCD_HEIGHT - 1;
+        break;
+    case LCD_RAMWR:
+        col = colStart;
+        page = pageStart;
+        break;
+    default:
+        break;
+    }
+}
+
+static void SimILI9341Transfer(const INT8U *pMosi, INT8U *pMiso, INT32U count)
+{
+    BOOLEAN data = (LCD_ILI9341_DC_GPIO->ODR & LCD_ILI9341_DC_GPIO_Pin) != 0;
+    INT32U i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (data) SimILI9341Data(pMosi[i]);
+        else SimILI9341Command(pMosi[i]);
+    }
+    if (pMiso != NULL) memset(pMiso, 0, count);
+}
+
+static INT32U SimCrc32(INT32U crc, const INT8U *p, INT32U len)
+{
+    INT32U i;
+    int k;
+
+    crc = ~crc;
+    for (i = 0; i < len; i++)
+    {
+        crc ^= p[i];
+        for (k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+static void SimPutBe32(INT8U *p, INT32U v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+// One PNG chunk: length, type, data, CRC of type and data
+static void SimPngChunk(FILE *f, const char *pType, const INT8U *pData, INT32U len)
+{
+    INT8U be[4];
+    INT32U crc;
+
+    SimPutBe32(be, len);
+    fwrite(be, 1, 4, f);
+    fwrite(pType, 1, 4, f);
+    fwrite(pData, 1, len, f);
+    crc = SimCrc32(0, (const INT8U *)pType, 4);
+    crc = SimCrc32(crc, pData, len);
+    SimPutBe32(be, crc);
+    fwrite(be, 1, 4, f);
+}
+
+// RGB888 rows; PNG rows start with a filter type byte
+static void SimILI9341Row(INT8U *pRow, INT32U y)
+{
+    INT32U x;
+
+    for (x = 0; x < SIM_LCD_WIDTH; x++)
+    {
+        INT16U c = frameBuffer[y][x];
+        pRow[3 * x + 0] = ((c >> 11) & 0x1F) * 255 / 31;
+        pRow[3 * x + 1] = ((c >> 5) & 0x3F) * 255 / 63;
+        pRow[3 * x + 2] = (c & 0x1F) * 255 / 31;
+    }
+}
+
+// PNG without compression: the zlib stream is a sequence of stored blocks
+static void SimILI9341WritePng(FILE *f)
+{
+    static const INT8U signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    const INT32U rowLen = 1 + 3 * SIM_LCD_WIDTH;
+    const INT32U rawLen = rowLen * SIM_LCD_HEIGHT;
+    static INT8U raw[(1 + 3 * SIM_LCD_WIDTH) * SIM_LCD_HEIGHT];
+    static INT8U idat[2 + (1 + 3 * SIM_LCD_WIDTH) * SIM_LCD_HEIGHT + 5 * SIM_LCD_HEIGHT + 4];
+    INT8U ihdr[13] = { 0 };
+    INT32U a = 1, b = 0, pos = 0, i, y;
+
+    for (y = 0; y < SIM_LCD_HEIGHT; y++)
+    {
+        raw[y * rowLen] = 0;
+        SimILI9341Row(&raw[y * rowLen + 1], y);
+    }
+
+    idat[pos++] = 0x78;                 // deflate, 32K window
+    idat[pos++] = 0x01;
+    for (i = 0; i < rawLen; i += rowLen)
+    {
+        idat[pos++] = (i + rowLen >= rawLen);   // BFINAL on the last block, BTYPE 00
+        idat[pos++] = rowLen & 0xFF;
+        idat[pos++] = rowLen >> 8;
+        idat[pos++] = ~rowLen & 0xFF;
+        idat[pos++] = (~rowLen >> 8) & 0xFF;
+        memcpy(&idat[pos], &raw[i], rowLen);
+        pos += rowLen;
+    }
+    for (i = 0; i < rawLen; i++)
+    {
+        a = (a + raw[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    SimPutBe32(&idat[pos], (b << 16) | a);
+    pos += 4;
+
+    SimPutBe32(&ihdr[0], SIM_LCD_WIDTH);
+    SimPutBe32(&ihdr[4], SIM_LCD_HEIGHT);
+    ihdr[8] = 8;                        // bits per channel
+    ihdr[9] = 2;                        // RGB
+
+    fwrite(signature, 1, sizeof(signature), f);
+    SimPngChunk(f, "IHDR", ihdr, sizeof(ihdr));
+    SimPngChunk(f, "IDAT", idat, pos);
+    SimPngChunk(f, "IEND", NULL, 0);
+}
+
+BOOLEAN SimILI9341Dump(const char *pPath)
+{
+    const char *pExt = strrchr(pPath, '.');
+    INT8U row[3 * SIM_LCD_WIDTH];
+    FILE *f;
+    INT32U y;
+
+    f = fopen(pPath, "wb");
+    if (f == NULL) return OS_FALSE;
+
+    if (pExt != NULL && strcmp(pExt, ".png") == 0)
+    {
+        SimILI9341WritePng(f);
+    }
+    else
+    {
+        fprintf(f, "P6\n%d %d\n255\n", SIM_LCD_WIDTH, SIM_LCD_HEIGHT);
+        for (y = 0; y < SIM_LCD_HEIGHT; y++)
+        {
+            SimILI9341Row(row, y);
+            fwrite(row, 1, sizeof(row), f);
+        }
+    }
+    return fclose(f) == 0;
+}
@@ -0,0 +1,542 @@
+/*
+    simReport.c
+
+    Reports of a simulated run, see sim.h: a table on stdout and, for
+    Tools/playbench.py, the same numbers plus the task CPU use, the touches
+    and the audio events as JSON. Both include the SPI1 lock and bus
+    reconfiguration counts per client of pjdfInternalSPI.c and the PJDF
+    counters per device of pjdf.c, the SdVolume block cache counters, and
+    the cycles per SD block read and per LCD fill (Tools/bindbench.py).
+    With make TRACE=1, also what the kernel trace recorder costs and saw
+    (Tools/tracebench.py); with make CRITMEAS=1, the OS_ENTER_CRITICAL()
+    duration histogram and the worst call sites (Tools/critbench.py).
+
+    Called from the host thread that ends a -d run, not from a uC/OS task:
+    the counters are read while the tasks keep running.
+*/
+
+#include <stdio.h>
+#include <time.h>
+#include "sim.h"
+#include "SdFat.h"
+#include "Adafruit_ILI9341.h"
+
+static const char *const mp3EventNames[] = { "reset", "start", "starve", "resume", "volume" };
+static const char *const spiClientNames[PJDF_SPI_CLIENT_COUNT] = { "other", "mp3", "lcd", "sd" };
+
+// CPU use per task, accumulated in 64 bits from OSTCBCyclesTot, which wraps.
+// Every cycle is charged to some task, the idle task included, so their sum
+// is the total.
+typedef struct _SimTaskCpu
+{
+    INT32U last;            // OSTCBCyclesTot at the last sample
+    uint64_t cycles;
+} SimTaskCpu;
+
+static SimTaskCpu taskCpu[OS_LOWEST_PRIO + 1];
+static uint64_t cyclesTotal;
+
+
+void SimSampleTasks(void)
+{
+    OS_TCB *pTcb;
+    INT32U cycles;
+
+    for (pTcb = OSTCBList; pTcb != NULL; pTcb = pTcb->OSTCBNext)
+    {
+        SimTaskCpu *pCpu = &taskCpu[pTcb->OSTCBPrio];
+        cycles = pTcb->OSTCBCyclesTot - pCpu->last;
+        pCpu->cycles += cycles;
+        pCpu->last += cycles;
+        cyclesTotal += cycles;
+    }
+}
+
+#if OS_TRACE_EN > 0u
+
+#define SIM_TRACE_CALIBRATE_EVENTS  1000000u
+
+static double traceEventNs;         // what TraceRecord() costs on this host
+
+// What the trace recorder saw, for make TRACE=1 (Tools/tracebench.py)
+typedef struct _SimTraceCounts
+{
+    INT32U total;           // events recorded, the overwritten ones included
+    INT32U copied;          // events still in the buffer, counted below
+    INT32U isrEnters;
+    INT32U isrSysTick;      // ISR entries tagged with the SysTick exception
+    INT32U switches;
+} SimTraceCounts;
+
+static TraceEvent_t traceCopy[APP_CFG_TRACE_BUF_SIZE];
+
+void SimTraceCalibrate(void)
+{
+    struct timespec start, end;
+    INT32U i;
+
+    TraceInit();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < SIM_TRACE_CALIBRATE_EVENTS; i++)
+    {
+        TraceRecord(TRACE_EVT_SEM_POST, (INT16U)i);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    TraceStop();
+    traceEventNs = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / SIM_TRACE_CALIBRATE_EVENTS;
+}
+
+static void SimTraceCount(SimTraceCounts *pCounts)
+{
+    INT32U i;
+
+    memset(pCounts, 0, sizeof(*pCounts));
+    pCounts->copied = TraceCopy(traceCopy, APP_CFG_TRACE_BUF_SIZE, &pCounts->total);
+    for (i = 0; i < pCounts->copied; i++)
+    {
+        if (traceCopy[i].event == TRACE_EVT_ISR_ENTER)
+        {
+            pCounts->isrEnters++;
+            if (traceCopy[i].arg == OS_CPU_SYSTICK_EXC_NBR) pCounts->isrSysTick++;
+        }
+        else if (traceCopy[i].event == TRACE_EVT_TASK_SWITCH)
+        {
+            pCounts->switches++;
+        }
+    }
+}
+
+// Share of the CPU the recorder took: events per second times their cost
+static double SimTracePercent(INT32U events, uint64_t elapsedNs)
+{
+    return elapsedNs ? 100.0 * events * traceEventNs / elapsedNs : 0.0;
+}
+
+#endif // OS_TRACE_EN
+
+#if OS_CRITICAL_MEAS_EN > 0u
+
+#define SIM_CRIT_SITES  10u
+
+// The longest OS_ENTER_CRITICAL() sections, for make CRITMEAS=1 (Tools/critbench.py)
+typedef struct _SimCritCounts
+{
+    INT32U hist[CRIT_HIST_BUCKETS];
+    INT32U sections;
+    CritSite_t *worst[SIM_CRIT_SITES];
+    INT32U sites;
+} SimCritCounts;
+
+static void SimCritCount(SimCritCounts *pCounts)
+{
+    INT32U i;
+
+    CritMeasHistogram(pCounts->hist);
+    pCounts->sections = 0;
+    for (i = 0; i < CRIT_HIST_BUCKETS; i++) pCounts->sections += pCounts->hist[i];
+    pCounts->sites = CritMeasWorst(pCounts->worst, SIM_CRIT_SITES);
+}
+
+static const char *SimBaseName(const char *pPath)
+{
+    const char *p = strrchr(pPath, '/');
+
+    return p ? p + 1 : pPath;
+}
+
+#endif // OS_CRITICAL_MEAS_EN
+
+static double SimBusyPercent(uint64_t busyNs, uint64_t elapsedNs)
+{
+    return elapsedNs ? 100.0 * busyNs / elapsedNs : 0.0;
+}
+
+static void SimReportLine(const char *pName, INT32U transfers, uint64_t bytes, uint64_t busyNs, uint64_t elapsedNs)
+{
+    printf("  %-14s %10lu %12llu %10.1f %6.2f%%\n", pName, (unsigned long)transfers,
+           (unsigned long long)bytes, busyNs / 1e6, SimBusyPercent(busyNs, elapsedNs));
+}
+
+void SimReport(void)
+{
+    uint64_t elapsed = SimNowNs();
+    uint64_t spiBusy = simSpiIdle.busyNs;
+    PjdfSpiLockStats lock[PJDF_SPI_CLIENT_COUNT];
+    PjdfSpiProfileStats profile[PJDF_SPI_CLIENT_COUNT];
+    PjdfDeviceStats device;
+    const char *pName;
+    SimVS1053Stats mp3;
+    SimSDStats sd;
+    cache_stats_t cache;
+    card_stats_t card;
+    card_cal_t cal;
+    ili9341_fill_stats_t fill;
+    SimSDStressStats stress;
+    INT8U readers;
+    SimSpiYieldStats yield;
+    INT32U yieldBytes;
+#if OS_TRACE_EN > 0u
+    SimTraceCounts trace;
+#endif
+#if OS_CRITICAL_MEAS_EN > 0u
+    SimCritCounts crit;
+#endif
+    OS_TCB *pTcb;
+    int i;
+
+    printf("\nSimulation: %.3f s\n", elapsed / 1e9);
+    printf("  %-14s %10s %12s %10s %7s\n", "SPI1", "transfers", "bytes", "busy ms", "busy");
+    for (i = 0; i < SIM_SPI_DEVICE_COUNT; i++)
+    {
+        SimSpiDevice *pDevice = simSpiDevices[i];
+        SimReportLine(pDevice->name, pDevice->transfers, pDevice->bytes, pDevice->busyNs, elapsed);
+        spiBusy += pDevice->busyNs;
+    }
+    SimReportLine(simSpiIdle.name, simSpiIdle.transfers, simSpiIdle.bytes, simSpiIdle.busyNs, elapsed);
+    SimReportLine("total", 0, 0, spiBusy, elapsed);
+    if (simSpiConflicts) printf("  %lu transfers with more than one device selected\n", (unsigned long)simSpiConflicts);
+
+    SimSpiLockStats(lock);
+    SimSpiProfileStats(profile);
+    printf("  %-14s %10s %10s %8s %10s %11s %11s %10s\n", "SPI1 client", "locks", "contended", "yields",
+           "wait ms", "max wait us", "max hold us", "reconfigs");
+    for (i = 0; i < PJDF_SPI_CLIENT_COUNT; i++)
+    {
+        printf("  %-14s %10lu %10lu %8lu %10.1f %11lu %11lu %10lu\n", spiClientNames[i], (unsigned long)lock[i].locks,
+               (unsigned long)lock[i].contended, (unsigned long)lock[i].yields, lock[i].waitUs / 1e3,
+               (unsigned long)lock[i].maxWaitUs, (unsigned long)lock[i].maxHoldUs, (unsigned long)profile[i].reconfigs);
+    }
+
+    printf("  %-18s %8s %8s %8s %10s %10s %10s %9s %9s %6s\n", "PJDF device", "reads", "writes", "ioctls",
+           "KB read", "KB written", "busy ms", "max us", "wait ms", "errors");
+    for (i = 0; (pName = SimPjdfStats(i, &device)) != NULL; i++)
+    {
+        printf("  %-18s %8lu %8lu %8lu %10.1f %10.1f %10.1f %9lu %9.1f %6lu\n", pName,
+               (unsigned long)device.reads, (unsigned long)device.writes, (unsigned long)device.ioctls,
+               device.bytesRead / 1024.0, device.bytesWritten / 1024.0, device.busyUs / 1e3,
+               (unsigned long)device.maxBusyUs, device.waitUs / 1e3, (unsigned long)device.errors);
+    }
+
+    printf("  %-14s %10s %12s %10s %7s\n", "I2C1", "transfers", "bytes", "busy ms", "busy");
+    for (i = 0; i < SIM_I2C_DEVICE_COUNT; i++)
+    {
+        SimI2cDevice *pDevice = simI2cDevices[i];
+        SimReportLine(pDevice->name, pDevice->transfers, pDevice->bytes, pDevice->busyNs, elapsed);
+    }
+
+    if (cyclesTotal > 0)
+    {
+        printf("  %-20s %4s %7s\n", "Task", "prio", "CPU");
+        for (pTcb = OSTCBList; pTcb != NULL; pTcb = pTcb->OSTCBNext)
+        {
+            printf("  %-20s %4u %6.2f%%\n", (char *)pTcb->OSTCBTaskName, pTcb->OSTCBPrio,
+                   100.0 * taskCpu[pTcb->OSTCBPrio].cycles / cyclesTotal);
+        }
+    }
+
+    SimVS1053GetStats(&mp3);
+    printf("VS1053: %llu bytes, %lu frames, last %lu kbit/s, min FIFO %lu, "
+           "%lu underruns (%.1f ms), %lu overflows (%llu bytes dropped)\n",
+           (unsigned long long)mp3.sdiBytes, (unsigned long)mp3.frames, (unsigned long)(mp3.bitrate / 1000),
+           (unsigned long)mp3.minFifoLevel, (unsigned long)mp3.underruns, mp3.underrunNs / 1e6,
+           (unsigned long)mp3.overflows, (unsigned long long)mp3.droppedBytes);
+    SimSDGetStats(&sd);
+    printf("SD: %lu blocks read with %lu read commands, %lu blocks written, %lu commands, %lu CRC errors, "
+           "%lu blocks corrupted, %lu start tokens garbled\n", (unsigned long)sd.blocksRead,
+           (unsigned long)sd.readCommands, (unsigned long)sd.blocksWritten, (unsigned long)sd.commands,
+           (unsigned long)sd.crcErrors, (unsigned long)sd.corrupted, (unsigned long)sd.garbled);
+    if (sd.blocksRead + sd.blocksWritten > 0)
+    {
+        printf("SD: %.1f us selected and %.2f commands per block, %.3f MB/s\n",
+               sd.selectedNs / 1e3 / (sd.blocksRead + sd.blocksWritten),
+               (double)sd.commands / (sd.blocksRead + sd.blocksWritten),
+               sd.selectedNs ? (sd.blocksRead + sd.blocksWritten) * 512e3 / sd.selectedNs : 0.0);
+    }
+    cache = SdVolume::cacheStats();
+    printf("SD cache: %d slots, %d for the FAT; FAT %lu hits %lu misses, data %lu hits %lu misses, "
+           "%lu write-backs, %lu chain walks\n", SD_CACHE_SLOTS, SD_CACHE_FAT_SLOTS,
+           (unsigned long)cache.fatHits, (unsigned long)cache.fatMisses, (unsigned long)cache.dataHits,
+           (unsigned long)cache.dataMisses, (unsigned long)cache.writeBacks, (unsigned long)cache.chainWalks);
+    printf("SD read-ahead: %d blocks at most; %lu fills, %lu blocks, %lu unread\n", SD_READAHEAD_BLOCKS,
+           (unsigned long)cache.aheadFills, (unsigned long)cache.aheadBlocks, (unsigned long)cache.aheadUnused);
+    printf("SD names: %d indexes of %d slots; %lu opens by name, %lu entries read\n", SD_NAME_INDEXES,
+           SD_NAME_INDEX_SLOTS, (unsigned long)cache.nameLookups, (unsigned long)cache.nameEntries);
+    card = Sd2Card::cardStats();
+    printf("SD CRC: %s; %lu blocks failed the check, %lu bad start tokens, %lu reads given up\n",
+           SD_CRC ? "on" : "off", (unsigned long)card.crcErrors, (unsigned long)card.tokenErrors,
+           (unsigned long)card.crcFailures);
+    if (card.blockReads > 0)
+    {
+        printf("SD block reads: %lu, %.0f cycles each\n", (unsigned long)card.blockReads,
+               (double)card.blockReadCycles / card.blockReads);
+    }
+    cal = Sd2Card::calibration();
+    printf("SD SCK: %.3f MHz in %u steps, card rated %.0f MHz%s, %.3f MHz failed; %.3f MB/s read\n",
+           cal.sckHz / 1e6, cal.steps, cal.cardHz / 1e6, cal.highSpeed ? " at high speed" : "",
+           cal.failedHz / 1e6, cal.bytesPerSec / 1e6);
+    printf("SD lock: %lu locks, %lu waits (%.1f ms), longest wait %lu us, longest hold %lu us\n",
+           (unsigned long)cache.locks, (unsigned long)cache.lockWaits, cache.lockWaitUs / 1e3,
+           (unsigned long)cache.maxLockWaitUs, (unsigned long)cache.maxLockHoldUs);
+    fill = Adafruit_ILI9341::fillStats();
+    if (fill.fills > 0)
+    {
+        printf("LCD fills: %lu, %.0f cycles each, %.1f per pixel\n", (unsigned long)fill.fills,
+               (double)fill.cycles / fill.fills, fill.pixels ? (double)fill.cycles / fill.pixels : 0.0);
+    }
+    readers = SimSDStressGetStats(&stress);
+    if (readers > 0)
+    {
+        printf("SD stress: %u readers, %lu passes, %lu files, %.1f KB checked, %lu mismatches, %lu errors\n",
+               readers, (unsigned long)stress.passes, (unsigned long)stress.files, stress.bytes / 1024.0,
+               (unsigned long)stress.mismatches, (unsigned long)stress.errors);
+    }
+#if OS_TRACE_EN > 0u
+    SimTraceCount(&trace);
+    printf("Trace: %lu events, %.0f/s, %.1f ns each: %.3f%% of the CPU; of the last %lu, %lu ISR entries "
+           "(%lu SysTick), %lu task switches\n", (unsigned long)trace.total, trace.total * 1e9 / elapsed, traceEventNs,
+           SimTracePercent(trace.total, elapsed), (unsigned long)trace.copied, (unsigned long)trace.isrEnters,
+           (unsigned long)trace.isrSysTick, (unsigned long)trace.switches);
+#endif
+#if OS_CRITICAL_MEAS_EN > 0u
+    SimCritCount(&crit);
+    printf("Critical sections: %lu", (unsigned long)crit.sections);
+    if (crit.sites > 0)
+    {
+        printf(", longest %.1f us at %s:%lu (prio %u)", crit.worst[0]->maxNs / 1e3,
+               SimBaseName(crit.worst[0]->file), (unsigned long)crit.worst[0]->line, crit.worst[0]->maxPrio);
+    }
+    printf("\n");
+#endif
+    yieldBytes = SimSpiYieldGetStats(&yield);
+    if (yieldBytes > 0)
+    {
+        printf("SPI yield: %lu LCD fills of %lu bytes, %lu MP3 waits for the LCD, longest %.1f us "
+               "(hold bound %.1f us)\n", (unsigned long)yield.fills, (unsigned long)yieldBytes,
+               (unsigned long)yield.waits, yield.maxWaitNs / 1e3, yield.holdNs / 1e3);
+    }
+    fflush(stdout);
+}
+
+static void SimJsonDevice(FILE *f, const char *pName, INT32U transfers, uint64_t bytes, uint64_t busyNs,
+                          uint64_t elapsedNs, BOOLEAN last)
+{
+    fprintf(f, "      {\"name\": \"%s\", \"transfers\": %lu, \"bytes\": %llu, \"busy_ms\": %.3f, \"busy_pct\": %.3f}%s\n",
+            pName, (unsigned long)transfers, (unsigned long long)bytes, busyNs / 1e6,
+            SimBusyPercent(busyNs, elapsedNs), last ? "" : ",");
+}
+
+// Task names are set by the application and could hold anything
+static void SimJsonString(FILE *f, const char *p)
+{
+    fputc('"', f);
+    for (; *p; p++)
+    {
+        if (*p == '"' || *p == '\\') fputc('\\', f);
+        if ((unsigned char)*p >= ' ') fputc(*p, f);
+    }
+    fputc('"', f);
+}
+
+BOOLEAN SimReportJson(const char *pPath)
+{
+    uint64_t elapsed = SimNowNs();
+    uint64_t spiBusy = simSpiIdle.busyNs;
+    const SimMp3Event *pEvents;
+    const SimTouch *pTouches;
+    PjdfSpiLockStats lock[PJDF_SPI_CLIENT_COUNT];
+    PjdfSpiProfileStats profile[PJDF_SPI_CLIENT_COUNT];
+    PjdfDeviceStats device;
+    const char *pName;
+    SimVS1053Stats mp3;
+    SimSDStats sd;
+    cache_stats_t cache;
+    card_stats_t card;
+    card_cal_t cal;
+    ili9341_fill_stats_t fill;
+    SimSDStressStats stress;
+    INT8U readers;
+    SimSpiYieldStats yield;
+    INT32U yieldBytes;
+#if OS_TRACE_EN > 0u
+    SimTraceCounts trace;
+#endif
+#if OS_CRITICAL_MEAS_EN > 0u
+    SimCritCounts crit;
+#endif
+    INT32U count, i;
+    OS_TCB *pTcb;
+    FILE *f;
+
+    f = fopen(pPath, "w");
+    if (f == NULL) return OS_FALSE;
+
+    fprintf(f, "{\n  \"elapsed_s\": %.6f,\n  \"system_core_clock\": %lu,\n",
+            elapsed / 1e9, (unsigned long)SystemCoreClock);
+
+    fprintf(f, "  \"spi1\": {\n    \"devices\": [\n");
+    for (i = 0; i < SIM_SPI_DEVICE_COUNT; i++)
+    {
+        SimSpiDevice *pDevice = simSpiDevices[i];
+        SimJsonDevice(f, pDevice->name, pDevice->transfers, pDevice->bytes, pDevice->busyNs, elapsed, OS_FALSE);
+        spiBusy += pDevice->busyNs;
+    }
+    SimJsonDevice(f, simSpiIdle.name, simSpiIdle.transfers, simSpiIdle.bytes, simSpiIdle.busyNs, elapsed, OS_TRUE);
+    fprintf(f, "    ],\n    \"busy_pct\": %.3f,\n    \"conflicts\": %lu,\n    \"clients\": [\n",
+            SimBusyPercent(spiBusy, elapsed), (unsigned long)simSpiConflicts);
+    SimSpiLockStats(lock);
+    SimSpiProfileStats(profile);
+    for (i = 0; i < PJDF_SPI_CLIENT_COUNT; i++)
+    {
+        fprintf(f, "      {\"client\": \"%s\", \"locks\": %lu, \"contended\": %lu, \"yields\": %lu, "
+                "\"wait_ms\": %.3f, \"max_wait_us\": %lu, \"max_hold_us\": %lu, \"selects\": %lu, \"reconfigs\": %lu}%s\n",
+                spiClientNames[i], (unsigned long)lock[i].locks, (unsigned long)lock[i].contended,
+                (unsigned long)lock[i].yields, lock[i].waitUs / 1e3, (unsigned long)lock[i].maxWaitUs,
+                (unsigned long)lock[i].maxHoldUs, (unsigned long)profile[i].selects, (unsigned long)profile[i].reconfigs,
+                i == PJDF_SPI_CLIENT_COUNT - 1 ? "" : ",");
+    }
+    fprintf(f, "    ]\n  },\n");
+
+    fprintf(f, "  \"pjdf\": [");
+    for (i = 0; (pName = SimPjdfStats(i, &device)) != NULL; i++)
+    {
+        fprintf(f, "%s\n    {\"device\": \"%s\", \"reads\": %lu, \"writes\": %lu, \"ioctls\": %lu, "
+                "\"bytes_read\": %llu, \"bytes_written\": %llu, \"busy_ms\": %.3f, \"max_busy_us\": %lu, "
+                "\"wait_ms\": %.3f, \"errors\": %lu}", i ? "," : "", pName,
+                (unsigned long)device.reads, (unsigned long)device.writes, (unsigned long)device.ioctls,
+                (unsigned long long)device.bytesRead, (unsigned long long)device.bytesWritten,
+                device.busyUs / 1e3, (unsigned long)device.maxBusyUs, device.waitUs / 1e3,
+                (unsigned long)device.errors);
+    }
+    fprintf(f, "\n  ],\n");
+
+    fprintf(f, "  \"i2c1\": {\n    \"devices\": [\n");
+    for (i = 0; i < SIM_I2C_DEVICE_COUNT; i++)
+    {
+        SimI2cDevice *pDevice = simI2cDevices[i];
+        SimJsonDevice(f, pDevice->name, pDevice->transfers, pDevice->bytes, pDevice->busyNs, elapsed,
+                      i == SIM_I2C_DEVICE_COUNT - 1);
+    }
+    fprintf(f, "    ]\n  },\n");
+
+    fprintf(f, "  \"tasks\": [");
+    for (pTcb = OSTCBList; pTcb != NULL; pTcb = pTcb->OSTCBNext)
+    {
+        fprintf(f, "%s\n    {\"name\": ", pTcb == OSTCBList ? "" : ",");
+        SimJsonString(f, (char *)pTcb->OSTCBTaskName);
+        fprintf(f, ", \"prio\": %u, \"cpu_pct\": %.3f, \"switches\": %lu}", pTcb->OSTCBPrio,
+                cyclesTotal ? 100.0 * taskCpu[pTcb->OSTCBPrio].cycles / cyclesTotal : 0.0,
+                (unsigned long)pTcb->OSTCBCtxSwCtr);
+    }
+    fprintf(f, "\n  ],\n");
+
+    SimVS1053GetStats(&mp3);
+    fprintf(f, "  \"vs1053\": {\"sdi_bytes\": %llu, \"frames\": %lu, \"underruns\": %lu, \"underrun_ms\": %.3f, "
+            "\"overflows\": %lu, \"dropped_bytes\": %llu, \"min_fifo\": %lu, \"fifo_size\": %d, \"bitrate\": %lu},\n",
+            (unsigned long long)mp3.sdiBytes, (unsigned long)mp3.frames, (unsigned long)mp3.underruns,
+            mp3.underrunNs / 1e6, (unsigned long)mp3.overflows, (unsigned long long)mp3.droppedBytes,
+            (unsigned long)mp3.minFifoLevel, SIM_MP3_FIFO_SIZE, (unsigned long)mp3.bitrate);
+
+    SimSDGetStats(&sd);
+    fprintf(f, "  \"sd\": {\"blocks_read\": %lu, \"blocks_written\": %lu, \"crc_errors\": %lu, \"corrupted\": %lu, "
+            "\"garbled\": %lu, \"commands\": %lu, \"read_commands\": %lu, \"selected_ms\": %.3f, \"mb_per_s\": %.3f},\n",
+            (unsigned long)sd.blocksRead, (unsigned long)sd.blocksWritten, (unsigned long)sd.crcErrors,
+            (unsigned long)sd.corrupted, (unsigned long)sd.garbled, (unsigned long)sd.commands, (unsigned long)sd.readCommands, sd.selectedNs / 1e6,
+            sd.selectedNs ? (sd.blocksRead + sd.blocksWritten) * 512e3 / sd.selectedNs : 0.0);
+
+    cache = SdVolume::cacheStats();
+    fprintf(f, "  \"sd_cache\": {\"slots\": %d, \"fat_slots\": %d, \"fat_hits\": %lu, \"fat_misses\": %lu, "
+            "\"data_hits\": %lu, \"data_misses\": %lu, \"write_backs\": %lu, \"chain_walks\": %lu},\n",
+            SD_CACHE_SLOTS, SD_CACHE_FAT_SLOTS, (unsigned long)cache.fatHits, (unsigned long)cache.fatMisses,
+            (unsigned long)cache.dataHits, (unsigned long)cache.dataMisses, (unsigned long)cache.writeBacks,
+            (unsigned long)cache.chainWalks);
+    fprintf(f, "  \"sd_readahead\": {\"blocks\": %d, \"fills\": %lu, \"blocks_read\": %lu, \"unread\": %lu},\n",
+            SD_READAHEAD_BLOCKS, (unsigned long)cache.aheadFills, (unsigned long)cache.aheadBlocks,
+            (unsigned long)cache.aheadUnused);
+    fprintf(f, "  \"sd_names\": {\"indexes\": %d, \"slots\": %d, \"lookups\": %lu, \"entries\": %lu},\n",
+            SD_NAME_INDEXES, SD_NAME_INDEX_SLOTS, (unsigned long)cache.nameLookups,
+            (unsigned long)cache.nameEntries);
+    card = Sd2Card::cardStats();
+    fprintf(f, "  \"sd_crc\": {\"on\": %d, \"errors\": %lu, \"token_errors\": %lu, \"failures\": %lu},\n",
+            SD_CRC, (unsigned long)card.crcErrors, (unsigned long)card.tokenErrors, (unsigned long)card.crcFailures);
+    fprintf(f, "  \"sd_block_reads\": {\"blocks\": %lu, \"cycles\": %llu},\n", (unsigned long)card.blockReads,
+            (unsigned long long)card.blockReadCycles);
+    cal = Sd2Card::calibration();
+    fprintf(f, "  \"sd_cal\": {\"sck_hz\": %lu, \"card_hz\": %lu, \"high_speed\": %u, \"failed_hz\": %lu, "
+            "\"steps\": %u, \"mb_per_s\": %.3f},\n", (unsigned long)cal.sckHz, (unsigned long)cal.cardHz,
+            cal.highSpeed, (unsigned long)cal.failedHz, cal.steps, cal.bytesPerSec / 1e6);
+    fprintf(f, "  \"sd_lock\": {\"locks\": %lu, \"waits\": %lu, \"wait_ms\": %.3f, \"max_wait_us\": %lu, "
+            "\"max_hold_us\": %lu},\n", (unsigned long)cache.locks, (unsigned long)cache.lockWaits,
+            cache.lockWaitUs / 1e3, (unsigned long)cache.maxLockWaitUs, (unsigned long)cache.maxLockHoldUs);
+    fill = Adafruit_ILI9341::fillStats();
+    fprintf(f, "  \"lcd_fills\": {\"fills\": %lu, \"pixels\": %lu, \"cycles\": %llu},\n",
+            (unsigned long)fill.fills, (unsigned long)fill.pixels, (unsigned long long)fill.cycles);
+    readers = SimSDStressGetStats(&stress);
+    fprintf(f, "  \"sd_stress\": {\"readers\": %u, \"passes\": %lu, \"files\": %lu, \"bytes\": %llu, "
+            "\"mismatches\": %lu, \"errors\": %lu},\n", readers, (unsigned long)stress.passes,
+            (unsigned long)stress.files, (unsigned long long)stress.bytes, (unsigned long)stress.mismatches,
+            (unsigned long)stress.errors);
+    yieldBytes = SimSpiYieldGetStats(&yield);
+    fprintf(f, "  \"spi_yield\": {\"fill_bytes\": %lu, \"fills\": %lu, \"waits\": %lu, \"max_wait_us\": %.3f, "
+            "\"hold_bound_us\": %.3f, \"max_over_us\": %.3f},\n", (unsigned long)yieldBytes,
+            (unsigned long)yield.fills, (unsigned long)yield.waits, yield.maxWaitNs / 1e3, yield.holdNs / 1e3,
+            yield.maxOverNs / 1e3);
+#if OS_TRACE_EN > 0u
+    SimTraceCount(&trace);
+    fprintf(f, "  \"trace\": {\"events\": %lu, \"per_s\": %.1f, \"event_ns\": %.2f, \"cpu_pct\": %.4f, "
+            "\"copied\": %lu, \"isr_enters\": %lu, \"isr_systick\": %lu, \"task_switches\": %lu},\n",
+            (unsigned long)trace.total, trace.total * 1e9 / elapsed, traceEventNs, SimTracePercent(trace.total, elapsed),
+            (unsigned long)trace.copied, (unsigned long)trace.isrEnters, (unsigned long)trace.isrSysTick,
+            (unsigned long)trace.switches);
+#endif
+#if OS_CRITICAL_MEAS_EN > 0u
+    SimCritCount(&crit);
+    fprintf(f, "  \"critical\": {\"sections\": %lu,\n    \"histogram\": [", (unsigned long)crit.sections);
+    for (count = 0, i = 0; i < CRIT_HIST_BUCKETS; i++)
+    {
+        if (crit.hist[i] == 0) continue;
+        fprintf(f, "%s\n      {\"min_ns\": %lu, \"count\": %lu}", count++ ? "," : "", 1ul << i,
+                (unsigned long)crit.hist[i]);
+    }
+    fprintf(f, "\n    ],\n    \"worst\": [");
+    for (i = 0; i < crit.sites; i++)
+    {
+        CritSite_t *pSite = crit.worst[i];
+
+        fprintf(f, "%s\n      {\"file\": ", i ? "," : "");
+        SimJsonString(f, SimBaseName(pSite->file));
+        fprintf(f, ", \"line\": %lu, \"count\": %lu, \"max_us\": %.3f, \"avg_us\": %.3f, \"prio\": %u}",
+                (unsigned long)pSite->line, (unsigned long)pSite->count, pSite->maxNs / 1e3,
+                pSite->count ? pSite->totalNs / 1e3 / pSite->count : 0.0, pSite->maxPrio);
+    }
+    fprintf(f, "\n    ]\n  },\n");
+#endif
+
+    fprintf(f, "  \"touches\": [");
+    count = SimFT6206Touches(&pTouches);
+    for (i = 0; i < count; i++)
+    {
+        if (pTouches[i].down)
+        {
+            fprintf(f, "%s\n    {\"ms\": %lu, \"x\": %u, \"y\": %u", i ? "," : "",
+                    (unsigned long)pTouches[i].ms, pTouches[i].x, pTouches[i].y);
+            if (pTouches[i].seen) fprintf(f, ", \"seen_ms\": %lu", (unsigned long)pTouches[i].seenMs);
+            fprintf(f, "}");
+        }
+        else
+        {
+            fprintf(f, "%s\n    {\"ms\": %lu, \"up\": true}", i ? "," : "", (unsigned long)pTouches[i].ms);
+        }
+    }
+    fprintf(f, "\n  ],\n");
+
+    fprintf(f, "  \"audio_events\": [");
+    count = SimVS1053Events(&pEvents);
+    for (i = 0; i < count; i++)
+    {
+        fprintf(f, "%s\n    {\"ms\": %.3f, \"event\": \"%s\"}", i ? "," : "",
+                pEvents[i].ns / 1e6, mp3EventNames[pEvents[i].type]);
+    }
+    fprintf(f, "\n  ]\n}\n");
+
+    return fclose(f) == 0;
+}
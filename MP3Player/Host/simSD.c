@@ -0,0 +1,557 @@
+/*
+    simSD.c
+
+    SD card model for the simulated SPI1 bus, see sim.h. The card is an
+    SDHC card in SPI mode whose blocks are those of a FAT image file
+    (Tools/mkfatimg.py makes one). Without an image the slot is empty and
+    MISO stays high, as on the board.
+
+    Supported: CMD0, 6, 8, 9, 10, 12, 13, 16, 17, 18, 24, 25, 32, 33, 38,
+    55, 58, 59 and ACMD23, 41. Responses come one byte after the command, as
+    most cards do. Data tokens come SIM_SD_READ_LATENCY_US after a read
+    command and SIM_SD_STREAM_LATENCY_US apart in a CMD18 read; the card is
+    busy for SIM_SD_WRITE_BUSY_US after taking a block. CRCs are sent on all
+    data and checked on CMD0, CMD8 and, after CMD59, on everything. With
+    SimSDCorrupt(), a bit of some blocks read flips after their CRC is
+    made, as noise on DO would flip it; with SimSDGarble(), a bit of the
+    start token of some does; with SimSDMaxSck(), a bit of every block
+    sent at a faster SCK does. The card has high speed mode (CMD6
+    function 1 of group 1), which only raises TRAN_SPEED from 25 to 50 MHz.
+*/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "sim.h"
+
+#define SD_BLOCK_SIZE           512
+
+#define R1_IDLE                 0x01
+#define R1_ILLEGAL_COMMAND      0x04
+#define R1_COM_CRC_ERROR        0x08
+#define R1_ADDRESS_ERROR        0x20
+
+#define TOKEN_START_BLOCK       0xFE
+#define TOKEN_START_MULTIPLE    0xFC
+#define TOKEN_STOP_TRAN         0xFD
+
+#define DATA_ACCEPTED           0x05
+#define DATA_CRC_ERROR          0x0B
+#define DATA_WRITE_ERROR        0x0D
+
+typedef enum
+{
+    SD_IDLE,            // waiting for a command
+    SD_READ_WAIT,       // data token not ready yet
+    SD_READ_DATA,       // sending a block
+    SD_WRITE_TOKEN,     // waiting for the host's data token
+    SD_WRITE_DATA,      // receiving a block
+    SD_BUSY,            // programming, DO held low
+} SimSDState;
+
+static void SimSDTransfer(const INT8U *pMosi, INT8U *pMiso, INT32U count);
+static void SimSDSelect(BOOLEAN selected);
+
+SimSpiDevice simSD = { "sd", SD_ADAFRUIT_CS_GPIO, SD_ADAFRUIT_CS_GPIO_Pin, SimSDTransfer, SimSDSelect };
+
+static int imageFd = -1;
+static BOOLEAN imageReadOnly;
+static INT32U blockCount;
+
+static SimSDState state;
+static SimSDState stateAfterBusy;
+static BOOLEAN spiMode;             // CMD0 seen with chip select low
+static BOOLEAN ready;               // ACMD41 finished initialization
+static BOOLEAN appCmd;              // CMD55 came before this command
+static BOOLEAN crcOn;               // CMD59
+static BOOLEAN highSpeed;           // switched to high speed with CMD6
+static BOOLEAN multiple;            // CMD18 or CMD25 in progress
+static uint64_t initDoneNs;         // ACMD41 reports ready from this time on
+static uint64_t readyNs;            // data token or end of busy due
+
+static INT8U cmd[6];
+static INT32U cmdPos;
+static INT32U block;                // next block to read or write
+
+static INT8U out[SD_BLOCK_SIZE + 8];
+static INT32U outPos, outLen;
+static INT8U in[SD_BLOCK_SIZE + 2];
+static INT32U inPos;
+
+static INT32U blocksRead, blocksWritten, crcErrors;
+static INT32U corruptEvery;             // SimSDCorrupt()
+static INT32U garbleEvery;              // SimSDGarble()
+static INT32U maxSckHz;                 // SimSDMaxSck()
+static INT32U blocksSent, blocksCorrupted, blocksGarbled;
+static BOOLEAN outGarbled, outCorrupted;    // the block in out[], counted once the host has it
+static INT32U commands, readCommands;   // since initialization: all, CMD17 and CMD18
+static uint64_t selectedNs;             // chip select low since initialization
+static uint64_t selectNs;               // SimNowNs() at the last select
+static BOOLEAN isSelected;
+
+
+static INT8U SimCrc7(const INT8U *p, INT32U len)
+{
+    INT8U crc = 0;
+    INT32U i;
+    int k;
+
+    for (i = 0; i < len; i++)
+    {
+        INT8U d = p[i];
+        for (k = 0; k < 8; k++)
+        {
+            crc <<= 1;
+            if ((d ^ crc) & 0x80) crc ^= 0x09;
+            d <<= 1;
+        }
+    }
+    return crc & 0x7F;
+}
+
+static INT16U SimCrc16(const INT8U *p, INT32U len)
+{
+    INT16U crc = 0;
+    INT32U i;
+    int k;
+
+    for (i = 0; i < len; i++)
+    {
+        crc ^= p[i] << 8;
+        for (k = 0; k < 8; k++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+void SimSDCorrupt(INT32U every)
+{
+    corruptEvery = every;
+}
+
+void SimSDGarble(INT32U every)
+{
+    garbleEvery = every;
+}
+
+void SimSDMaxSck(INT32U hz)
+{
+    maxSckHz = hz;
+}
+
+BOOLEAN SimSDOpen(const char *pPath)
+{
+    off_t size;
+
+    imageFd = open(pPath, O_RDWR);
+    if (imageFd < 0)
+    {
+        imageFd = open(pPath, O_RDONLY);
+        imageReadOnly = OS_TRUE;
+    }
+    if (imageFd < 0) return OS_FALSE;
+
+    size = lseek(imageFd, 0, SEEK_END);
+    blockCount = (INT32U)(size / SD_BLOCK_SIZE);
+    return blockCount >= 1024;
+}
+
+// Queue a data block: token, data, CRC16
+static void SimSDQueueData(const INT8U *pData, INT32U len)
+{
+    INT16U crc = SimCrc16(pData, len);
+
+    out[outLen++] = TOKEN_START_BLOCK;
+    memcpy(&out[outLen], pData, len);
+    outLen += len;
+    out[outLen++] = crc >> 8;
+    out[outLen++] = crc & 0xFF;
+}
+
+static void SimSDRegister(BOOLEAN csd)
+{
+    INT8U reg[16] = { 0 };
+    INT32U cSize = blockCount / 1024 - 1;
+
+    if (csd)
+    {
+        // CSD version 2.0
+        reg[0] = 0x40;
+        reg[1] = 0x0E;                  // TAAC
+        reg[3] = highSpeed ? 0x5A : 0x32;   // TRAN_SPEED 50 or 25 MHz
+        reg[4] = 0x5B;                  // CCC
+        reg[5] = 0x59;                  // CCC, READ_BL_LEN 9
+        reg[7] = (cSize >> 16) & 0x3F;
+        reg[8] = cSize >> 8;
+        reg[9] = cSize;
+        reg[10] = 0x7F;                 // ERASE_BLK_EN, SECTOR_SIZE
+        reg[11] = 0x80;
+        reg[12] = 0x0A;                 // R2W_FACTOR, WRITE_BL_LEN 9
+        reg[13] = 0x40;
+    }
+    else
+    {
+        memcpy(reg, "\x03SDSIMSD\x10\x00\x00\x00\x01\x01\x4A", 15);
+    }
+    reg[15] = (SimCrc7(reg, 15) << 1) | 1;
+    SimSDQueueData(reg, sizeof(reg));
+}
+
+// CMD6 switch status: group 1 has default and high speed, the other groups
+// only their default function; mode 1 switches to the function asked for
+static void SimSDSwitch(INT32U arg)
+{
+    INT8U status[64] = { 0 };
+    INT32U function = arg & 0xF;
+    INT32U group;
+
+    status[1] = 100;                    // mA at most
+    for (group = 0; group < 6; group++)
+    {
+        status[2 + 2 * group] = 0x80;   // function 15 and 0 of every group
+        status[3 + 2 * group] = 0x01;
+    }
+    status[13] |= 0x02;                 // high speed
+    if (function == 0xF) function = highSpeed;
+    if (function > 1) function = 0xF;   // cannot switch to it
+    else if (arg & 0x80000000u) highSpeed = (BOOLEAN)function;
+    status[16] = (INT8U)function;
+    SimSDQueueData(status, sizeof(status));
+}
+
+static void SimSDReadBlock(void)
+{
+    INT8U data[SD_BLOCK_SIZE];
+
+    if (pread(imageFd, data, SD_BLOCK_SIZE, (off_t)block * SD_BLOCK_SIZE) != SD_BLOCK_SIZE)
+    {
+        memset(data, 0, sizeof(data));
+    }
+    outPos = outLen = 0;
+    SimSDQueueData(data, SD_BLOCK_SIZE);
+    block++;
+
+    // Any bit of the token but the lowest, which would make it 0xFF; the
+    // block is read again whatever its data, so that is left alone
+    blocksSent++;
+    outGarbled = outCorrupted = OS_FALSE;
+    if (garbleEvery > 0 && blocksSent % garbleEvery == 0)
+    {
+        out[0] ^= 1 << (1 + blocksSent % 7);
+        outGarbled = OS_TRUE;
+    }
+    // A bit from the middle of the block, a different one each time
+    else if ((corruptEvery > 0 && blocksSent % corruptEvery == 0) || (maxSckHz > 0 && simSpiSckHz > maxSckHz))
+    {
+        INT32U bit = (blocksSent * 2654435761u) % (SD_BLOCK_SIZE * 8);
+        out[1 + bit / 8] ^= 1 << (bit % 8);
+        outCorrupted = OS_TRUE;
+    }
+}
+
+static INT8U SimSDWriteBlock(void)
+{
+    if (crcOn && SimCrc16(in, SD_BLOCK_SIZE) != ((in[SD_BLOCK_SIZE] << 8) | in[SD_BLOCK_SIZE + 1]))
+    {
+        crcErrors++;
+        return DATA_CRC_ERROR;
+    }
+    if (block >= blockCount || imageReadOnly ||
+        pwrite(imageFd, in, SD_BLOCK_SIZE, (off_t)block * SD_BLOCK_SIZE) != SD_BLOCK_SIZE)
+    {
+        return DATA_WRITE_ERROR;
+    }
+    blocksWritten++;
+    block++;
+    return DATA_ACCEPTED;
+}
+
+static void SimSDBusy(uint64_t ns, SimSDState next)
+{
+    readyNs = SimNowNs() + ns;
+    stateAfterBusy = next;
+    state = SD_BUSY;
+}
+
+static void SimSDCommand(void)
+{
+    INT8U index = cmd[0] & 0x3F;
+    INT32U arg = (cmd[1] << 24) | (cmd[2] << 16) | (cmd[3] << 8) | cmd[4];
+    BOOLEAN app = appCmd;
+    BOOLEAN checkCrc = crcOn || index == 8 || (index == 0 && !spiMode);
+    INT8U r1;
+
+    appCmd = OS_FALSE;
+    outPos = outLen = 0;
+    out[outLen++] = 0xFF;               // NCR
+    if (ready) commands++;
+    if (index == 17 || index == 18) readCommands++;
+
+    if (checkCrc && (cmd[5] >> 1) != SimCrc7(cmd, 5))
+    {
+        crcErrors++;
+        out[outLen++] = R1_COM_CRC_ERROR | (ready ? 0 : R1_IDLE);
+        return;
+    }
+
+    if (index == 0)
+    {
+        spiMode = OS_TRUE;
+        ready = crcOn = multiple = highSpeed = OS_FALSE;
+        initDoneNs = SimNowNs() + SIM_SD_INIT_US * 1000u;
+        state = SD_IDLE;
+        out[outLen++] = R1_IDLE;
+        return;
+    }
+
+    r1 = ready ? 0 : R1_IDLE;
+    if (app)
+    {
+        switch (index)
+        {
+        case 41:
+            if (SimNowNs() >= initDoneNs) ready = OS_TRUE;
+            out[outLen++] = ready ? 0 : R1_IDLE;
+            return;
+        case 23:
+            out[outLen++] = r1;
+            return;
+        default:
+            out[outLen++] = r1 | R1_ILLEGAL_COMMAND;
+            return;
+        }
+    }
+
+    // Only CMD8, CMD55, CMD58 and CMD59 before initialization is done
+    if (!ready && index != 8 && index != 55 && index != 58 && index != 59)
+    {
+        out[outLen++] = r1 | R1_ILLEGAL_COMMAND;
+        return;
+    }
+
+    switch (index)
+    {
+    case 6:
+        out[outLen++] = r1;
+        out[outLen++] = 0xFF;
+        SimSDSwitch(arg);
+        break;
+    case 8:
+        out[outLen++] = r1;
+        out[outLen++] = 0x00;
+        out[outLen++] = 0x00;
+        out[outLen++] = (arg >> 8) & 0x0F;
+        out[outLen++] = arg & 0xFF;
+        break;
+    case 9:
+    case 10:
+        out[outLen++] = r1;
+        out[outLen++] = 0xFF;
+        SimSDRegister(index == 9);
+        break;
+    case 12:
+        // The byte after the command is a stuff byte, then R1
+        out[outLen++] = r1;
+        multiple = OS_FALSE;
+        state = SD_IDLE;
+        break;
+    case 13:
+        out[outLen++] = r1;
+        out[outLen++] = 0x00;
+        break;
+    case 16:
+    case 32:
+    case 33:
+    case 55:
+        out[outLen++] = r1;
+        appCmd = (index == 55);
+        break;
+    case 38:
+        out[outLen++] = r1;
+        SimSDBusy(SIM_SD_WRITE_BUSY_US * 1000u, SD_IDLE);
+        break;
+    case 17:
+    case 18:
+    case 24:
+    case 25:
+        if (arg >= blockCount)
+        {
+            out[outLen++] = r1 | R1_ADDRESS_ERROR;
+            break;
+        }
+        out[outLen++] = r1;
+        block = arg;
+        multiple = (index == 18 || index == 25);
+        if (index == 17 || index == 18)
+        {
+            readyNs = SimNowNs() + SIM_SD_READ_LATENCY_US * 1000u;
+            state = SD_READ_WAIT;
+        }
+        else
+        {
+            state = SD_WRITE_TOKEN;
+        }
+        break;
+    case 58:
+        out[outLen++] = r1;
+        out[outLen++] = ready ? 0xC0 : 0x00;    // power up done, CCS
+        out[outLen++] = 0xFF;
+        out[outLen++] = 0x80;
+        out[outLen++] = 0x00;
+        break;
+    case 59:
+        crcOn = arg & 1;
+        out[outLen++] = r1;
+        break;
+    default:
+        out[outLen++] = r1 | R1_ILLEGAL_COMMAND;
+        break;
+    }
+}
+
+// What the card drives on DO for the next byte
+static INT8U SimSDOutput(void)
+{
+    if (outPos < outLen)
+    {
+        // A block counts as read once its CRC is out, not when a CMD12
+        // cuts it short
+        if (state == SD_READ_DATA && outPos == outLen - 1)
+        {
+            blocksRead++;
+            if (outCorrupted) blocksCorrupted++;
+        }
+        return out[outPos++];
+    }
+
+    switch (state)
+    {
+    case SD_READ_WAIT:
+        if (SimNowNs() < readyNs) return 0xFF;
+        SimSDReadBlock();
+        state = SD_READ_DATA;
+        if (outGarbled) blocksGarbled++;
+        return out[outPos++];
+    case SD_READ_DATA:
+        // Block sent
+        if (multiple)
+        {
+            if (block >= blockCount)
+            {
+                state = SD_IDLE;
+                return 0xFF;
+            }
+            readyNs = SimNowNs() + SIM_SD_STREAM_LATENCY_US * 1000u;
+            state = SD_READ_WAIT;
+        }
+        else
+        {
+            state = SD_IDLE;
+        }
+        return 0xFF;
+    case SD_BUSY:
+        if (SimNowNs() < readyNs) return 0x00;
+        state = stateAfterBusy;
+        return 0xFF;
+    default:
+        return 0xFF;
+    }
+}
+
+// The byte the host drives on DI
+static void SimSDInput(INT8U mosi)
+{
+    switch (state)
+    {
+    case SD_WRITE_TOKEN:
+        if (mosi == (multiple ? TOKEN_START_MULTIPLE : TOKEN_START_BLOCK))
+        {
+            inPos = 0;
+            state = SD_WRITE_DATA;
+        }
+        else if (multiple && mosi == TOKEN_STOP_TRAN)
+        {
+            multiple = OS_FALSE;
+            outPos = outLen = 0;
+            out[outLen++] = 0xFF;
+            SimSDBusy(SIM_SD_WRITE_BUSY_US * 1000u, SD_IDLE);
+        }
+        return;
+
+    case SD_WRITE_DATA:
+        in[inPos++] = mosi;
+        if (inPos == sizeof(in))
+        {
+            outPos = outLen = 0;
+            out[outLen++] = SimSDWriteBlock();
+            SimSDBusy(SIM_SD_WRITE_BUSY_US * 1000u, multiple ? SD_WRITE_TOKEN : SD_IDLE);
+        }
+        return;
+
+    case SD_BUSY:
+        return;
+
+    case SD_READ_WAIT:
+    case SD_READ_DATA:
+        if (!multiple) return;          // only CMD12 can interrupt a CMD18 read
+        break;
+
+    default:
+        break;
+    }
+
+    if (cmdPos == 0 && (mosi & 0xC0) != 0x40) return;
+    cmd[cmdPos++] = mosi;
+    if (cmdPos == sizeof(cmd))
+    {
+        cmdPos = 0;
+        SimSDCommand();
+    }
+}
+
+static void SimSDTransfer(const INT8U *pMosi, INT8U *pMiso, INT32U count)
+{
+    INT32U i;
+
+    for (i = 0; i < count; i++)
+    {
+        INT8U miso = (imageFd >= 0) ? SimSDOutput() : 0xFF;
+
+        if (imageFd >= 0) SimSDInput(pMosi[i]);
+        if (pMiso != NULL) pMiso[i] = miso;
+    }
+}
+
+// Deselecting ends a command or a single block read in progress; a CMD18
+// read pauses until the card is selected again and programming goes on
+static void SimSDSelect(BOOLEAN selected)
+{
+    // Called for every write to the pin, count edges only
+    if (selected)
+    {
+        if (!isSelected) selectNs = SimNowNs();
+        isSelected = OS_TRUE;
+        return;
+    }
+    if (isSelected && ready) selectedNs += SimNowNs() - selectNs;
+    isSelected = OS_FALSE;
+
+    cmdPos = 0;
+    if ((state == SD_READ_WAIT || state == SD_READ_DATA) && multiple) return;
+    outPos = outLen = 0;
+    if (state == SD_READ_WAIT || state == SD_READ_DATA)
+    {
+        state = SD_IDLE;
+    }
+}
+
+void SimSDGetStats(SimSDStats *pStats)
+{
+    pStats->blocksRead = blocksRead;
+    pStats->blocksWritten = blocksWritten;
+    pStats->crcErrors = crcErrors;
+    pStats->corrupted = blocksCorrupted;
+    pStats->garbled = blocksGarbled;
+    pStats->commands = commands;
+    pStats->readCommands = readCommands;
+    pStats->selectedNs = selectedNs;
+}
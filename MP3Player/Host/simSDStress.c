@@ -0,0 +1,266 @@
+/*
+    simSDStress.c
+
+    SD library stress test of the Linux build (mp3player -r readers, see
+    Tools/sdstress.py): reader tasks read pattern files through SD.h while
+    the player streams a song, and check every byte they get. A pattern
+    file SDSnnn.BIN holds StressByte(nnn, offset) at each offset.
+
+    Each pass, a reader lists the root directory, then opens the pattern
+    files it found one at a time, starting at a random one, by path or
+    from the FileEntry it kept while listing. It reads each in one of
+    three ways: in order in chunks of random size,
+    some larger than a block; at random offsets after seeks; or a byte at a
+    time with peek() and read(). The readers run at SIM_SD_STRESS_PRIO and
+    below, under every application task, so Mp3SDTask preempts them inside
+    SD library calls and has to wait for the volume lock.
+
+    A reader holds two Files while it lists the directory and the player
+    three, out of the MaxFiles (10) of File.cpp: hence at most
+    SIM_SD_STRESS_MAX_READERS readers.
+*/
+
+#include <stdlib.h>
+#include "bsp.h"
+#include "SD.h"
+#include "sim.h"
+
+#define SIM_SD_STRESS_FILES     16      // pattern files a reader keeps track of
+#define SIM_SD_STRESS_CHUNK     700     // largest read in order
+#define SIM_SD_STRESS_SEEKS     32      // reads at random offsets per file
+#define SIM_SD_STRESS_BYTES     2048    // bytes read one at a time per file
+
+static INT8U stressReaders;
+static OS_STK stressStk[SIM_SD_STRESS_MAX_READERS][APP_CFG_TASK_START_STK_SIZE];
+static const char *const stressTaskName[SIM_SD_STRESS_MAX_READERS] = { "SDStress0", "SDStress1", "SDStress2" };
+static INT8U stressBuf[SIM_SD_STRESS_MAX_READERS][SIM_SD_STRESS_CHUNK];
+static SimSDStressStats stressStats[SIM_SD_STRESS_MAX_READERS];
+
+// The byte at offset of the pattern file with the given seed, as
+// Tools/sdstress.py writes it
+static INT8U StressByte(INT32U seed, INT32U offset)
+{
+    INT32U h = seed * 0x9E3779B1u ^ (offset >> 2) * 0x85EBCA77u;
+
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    return (INT8U)(h >> (8 * (offset & 3)));
+}
+
+// The seed in the name of a pattern file, SDSnnn.BIN; -1 for other files
+static int StressSeed(const char *pName)
+{
+    if (strlen(pName) != 10 || strncmp(pName, "SDS", 3) != 0 || strcmp(pName + 6, ".BIN") != 0) return -1;
+    for (int i = 3; i < 6; i++)
+    {
+        if (pName[i] < '0' || pName[i] > '9') return -1;
+    }
+    return atoi(pName + 3);
+}
+
+// xorshift32
+static INT32U StressRandom(INT32U *pState)
+{
+    INT32U x = *pState;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *pState = x;
+}
+
+// Count count bytes read at offset, and whether they are the pattern's
+static BOOLEAN StressCheck(SimSDStressStats *pStats, INT32U seed, INT32U offset, const INT8U *pData, INT32U count)
+{
+    pStats->bytes += count;
+    for (INT32U i = 0; i < count; i++)
+    {
+        if (pData[i] != StressByte(seed, offset + i))
+        {
+            pStats->mismatches++;
+            return OS_FALSE;
+        }
+    }
+    return OS_TRUE;
+}
+
+// Read and check an open pattern file, one of the three ways at random
+static void StressReadFile(INT8U reader, File *pFile, INT32U seed, INT32U *pRandom)
+{
+    SimSDStressStats *pStats = &stressStats[reader];
+    INT8U *pBuf = stressBuf[reader];
+    INT32U size = pFile->size();
+    INT32U pos, count, i;
+    int got, c;
+
+    switch (StressRandom(pRandom) % 3)
+    {
+    case 0:     // in order
+        for (pos = 0; pos < size; pos += count)
+        {
+            count = 1 + StressRandom(pRandom) % SIM_SD_STRESS_CHUNK;
+            if (count > size - pos) count = size - pos;
+            got = pFile->read(pBuf, count);
+            if (got < 0)
+            {
+                pStats->errors++;
+                return;
+            }
+            if ((INT32U)got != count)
+            {
+                pStats->mismatches++;       // short of the end
+                return;
+            }
+            if (!StressCheck(pStats, seed, pos, pBuf, count)) return;
+        }
+        if (pFile->read(pBuf, 1) != 0)
+        {
+            pStats->mismatches++;           // past the end
+            return;
+        }
+        break;
+    case 1:     // at random offsets
+        for (i = 0; i < SIM_SD_STRESS_SEEKS && size > 0; i++)
+        {
+            pos = StressRandom(pRandom) % size;
+            count = 1 + StressRandom(pRandom) % 64;
+            if (count > size - pos) count = size - pos;
+            if (!pFile->seek(pos))
+            {
+                pStats->errors++;
+                return;
+            }
+            got = pFile->read(pBuf, count);
+            if (got < 0)
+            {
+                pStats->errors++;
+                return;
+            }
+            if ((INT32U)got != count || pFile->position() != pos + count)
+            {
+                pStats->mismatches++;
+                return;
+            }
+            if (!StressCheck(pStats, seed, pos, pBuf, count)) return;
+        }
+        break;
+    default:    // a byte at a time from a random offset
+        pos = size > 0 ? StressRandom(pRandom) % size : 0;
+        if (!pFile->seek(pos))
+        {
+            pStats->errors++;
+            return;
+        }
+        for (i = 0; i < SIM_SD_STRESS_BYTES && pos < size; i++, pos++)
+        {
+            c = pFile->peek();
+            if (c < 0)
+            {
+                pStats->errors++;
+                return;
+            }
+            if (pFile->read() != c)
+            {
+                pStats->mismatches++;       // peek() and read() disagree
+                return;
+            }
+            pBuf[0] = (INT8U)c;
+            if (!StressCheck(pStats, seed, pos, pBuf, 1)) return;
+        }
+        break;
+    }
+    pStats->files++;
+}
+
+static void StressTask(void *pArg)
+{
+    INT8U reader = (INT8U)(uintptr_t)pArg;
+    SimSDStressStats *pStats = &stressStats[reader];
+    INT32U random = 0x2545F491u + reader * 0x9E3779B9u;
+    FileEntry entries[SIM_SD_STRESS_FILES];
+    char path[14];
+    INT8U count, first, i;
+
+    while (1)
+    {
+        // the pattern files in the root directory
+        File dir = SD.open("/");
+        if (!dir)
+        {
+            pStats->errors++;
+            OSTimeDly(100);
+            continue;
+        }
+        count = 0;
+        File entry;
+        while ((entry = dir.openNextFile()))
+        {
+            if (count < SIM_SD_STRESS_FILES && StressSeed(entry.name()) >= 0 && entry.getEntry(&entries[count]))
+            {
+                count++;
+            }
+            entry.close();
+        }
+        dir.close();
+
+        first = count > 0 ? StressRandom(&random) % count : 0;
+        for (i = 0; i < count; i++)
+        {
+            FileEntry *pEntry = &entries[(first + i) % count];
+            File file;
+            if (StressRandom(&random) & 1)
+            {
+                file = SD.open(*pEntry);
+            }
+            else
+            {
+                path[0] = '/';
+                strcpy(path + 1, pEntry->name);
+                file = SD.open(path);
+            }
+            if (!file)
+            {
+                pStats->errors++;
+                continue;
+            }
+            StressReadFile(reader, &file, (INT32U)StressSeed(pEntry->name), &random);
+            file.close();
+        }
+        pStats->passes++;
+        OSTimeDly(1);
+    }
+}
+
+BOOLEAN SimSDStressSetup(INT8U readers)
+{
+    if (readers > SIM_SD_STRESS_MAX_READERS) return OS_FALSE;
+    stressReaders = readers;
+    return OS_TRUE;
+}
+
+void SimSDStressStart(void)
+{
+    INT8U prio, err;
+
+    for (INT8U i = 0; i < stressReaders; i++)
+    {
+        prio = SIM_SD_STRESS_PRIO + i;
+        OSTaskCreate(StressTask, (void *)(uintptr_t)i, &stressStk[i][APP_CFG_TASK_START_STK_SIZE - 1], prio);
+        OSTaskNameSet(prio, (INT8U *)stressTaskName[i], &err);
+    }
+}
+
+INT8U SimSDStressGetStats(SimSDStressStats *pStats)
+{
+    memset(pStats, 0, sizeof(*pStats));
+    for (INT8U i = 0; i < stressReaders; i++)
+    {
+        pStats->passes += stressStats[i].passes;
+        pStats->files += stressStats[i].files;
+        pStats->bytes += stressStats[i].bytes;
+        pStats->mismatches += stressStats[i].mismatches;
+        pStats->errors += stressStats[i].errors;
+    }
+    return stressReaders;
+}
@@ -0,0 +1,111 @@
+/*
+    simSpiYield.c
+
+    SPI1 hand-over test of the Linux build (mp3player -y bytes, see
+    Tools/spiyield.py): a task fills the LCD over and over while the player
+    streams a song, so the MP3 feeder keeps needing the bus in the middle of
+    an LCD transaction.
+
+    Each fill is one WriteV() of the address window and bytes of pixels,
+    more than LCD_SPI_HOLD_MAX, which the application's own drawing never
+    sends at once (Adafruit_ILI9341 flushes ILI9341_SPIBUFLEN bytes at a
+    time). The filler runs at SIM_SPI_YIELD_PRIO, under every application
+    task, so the LCD driver has to yield the lock every LCD_SPI_HOLD_MAX
+    bytes to whichever of them waits for it. pjdfInternalSPISim.c times each
+    wait of the MP3 client's behind the LCD and hands it to
+    SimSpiYieldWaited(), which compares it with the hold bound:
+    LCD_SPI_HOLD_MAX bytes at the LCD's SCK.
+
+    The filler shares the LCD handle with LcdTouchTask, which starts it once
+    the screen is drawn. The screen is not meant to be looked at afterwards.
+*/
+
+#include "bsp.h"
+#include "sim.h"
+
+#define SIM_SPI_YIELD_WIDTH     240
+#define SIM_SPI_YIELD_HEIGHT    320
+
+#define LCD_CASET               0x2A
+#define LCD_PASET               0x2B
+#define LCD_RAMWR               0x2C
+
+static INT32U yieldBytes;
+static HANDLE yieldLcd;
+static OS_STK yieldStk[APP_CFG_TASK_START_STK_SIZE];
+static INT8U yieldPixels[SIM_SPI_YIELD_MAX_BYTES];
+static SimSpiYieldStats yieldStats;
+
+// The hold bound at the current clock: LCD_SPI_HOLD_MAX bytes at the
+// prescaler the LCD profile gets, see SimSpiTransfer()
+static uint64_t YieldHoldNs(void)
+{
+    return (uint64_t)LCD_SPI_HOLD_MAX * 8u * (2u << (LCD_SPI_DATARATE >> SPI_CR1_BR_Pos)) * 1000000000u /
+           SystemCoreClock;
+}
+
+static void YieldTask(void *pArg)
+{
+    // CASET and PASET cover the whole screen, RAMWR starts at its corner
+    static INT8U window[] = { LCD_CASET, 0, 0, (SIM_SPI_YIELD_WIDTH - 1) >> 8, (SIM_SPI_YIELD_WIDTH - 1) & 0xFF,
+                              LCD_PASET, 0, 0, (SIM_SPI_YIELD_HEIGHT - 1) >> 8, (SIM_SPI_YIELD_HEIGHT - 1) & 0xFF,
+                              LCD_RAMWR };
+    PjdfSegment segments[] = {
+        { &window[0], 1, PJDF_SEG_COMMAND },
+        { &window[1], 4, PJDF_SEG_DATA },
+        { &window[5], 1, PJDF_SEG_COMMAND },
+        { &window[6], 4, PJDF_SEG_DATA },
+        { &window[10], 1, PJDF_SEG_COMMAND },
+        { yieldPixels, 0, PJDF_SEG_DATA },
+    };
+
+    segments[5].length = yieldBytes;
+    while (1)
+    {
+        // a different colour each time
+        memset(yieldPixels, (INT8U)(yieldStats.fills * 0x35u), yieldBytes);
+        if (PJDF_IS_ERROR(WriteV(yieldLcd, segments, 6))) while (1);
+        yieldStats.fills++;
+        yieldStats.bytes += yieldBytes;
+        OSTimeDly(1);
+    }
+}
+
+BOOLEAN SimSpiYieldSetup(INT32U bytes)
+{
+    if (bytes <= LCD_SPI_HOLD_MAX || bytes > SIM_SPI_YIELD_MAX_BYTES) return OS_FALSE;
+    yieldBytes = bytes;
+    return OS_TRUE;
+}
+
+void SimSpiYieldStart(HANDLE hLcd)
+{
+    INT8U err;
+
+    if (yieldBytes == 0) return;
+    yieldLcd = hLcd;
+    OSTaskCreate(YieldTask, NULL, &yieldStk[APP_CFG_TASK_START_STK_SIZE - 1], SIM_SPI_YIELD_PRIO);
+    OSTaskNameSet(SIM_SPI_YIELD_PRIO, (INT8U *)"SpiYield", &err);
+}
+
+void SimSpiYieldWaited(uint64_t waitNs)
+{
+    uint64_t holdNs = YieldHoldNs();
+
+    if (yieldStats.waits == 0 || (int64_t)(waitNs - holdNs) > yieldStats.maxOverNs)
+    {
+        yieldStats.maxOverNs = (int64_t)(waitNs - holdNs);
+    }
+    if (waitNs > yieldStats.maxWaitNs)
+    {
+        yieldStats.maxWaitNs = waitNs;
+        yieldStats.holdNs = holdNs;
+    }
+    yieldStats.waits++;
+}
+
+INT32U SimSpiYieldGetStats(SimSpiYieldStats *pStats)
+{
+    *pStats = yieldStats;
+    return yieldBytes;
+}
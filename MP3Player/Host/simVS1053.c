@@ -0,0 +1,323 @@
+/*
+    simVS1053.c
+
+    VS1053 model for the simulated SPI1 bus, see sim.h.
+
+    SCI (command chip select): 4 byte read and write commands on a register
+    file; setting SM_RESET in SCI_MODE is a soft reset that empties the
+    stream buffer.
+
+    SDI (data chip select): bytes go into a SIM_MP3_FIFO_SIZE stream buffer.
+    The decoder takes MPEG audio frames out of it at the rate given by each
+    frame header, so CBR and VBR files drain at their real speed; ID3v2 tags
+    and anything that is not a frame are skipped at once. DREQ is high while
+    SIM_MP3_DREQ_FREE bytes are free.
+
+    An underrun is counted when the decoder had played a frame, found the
+    buffer empty, and data then arrived without a soft reset in between:
+    a gap in the middle of the stream rather than the end of a song.
+
+    Changes a listener would hear are logged with their time (SimMp3Event)
+    so button-to-audio latency can be measured against the touch script.
+*/
+
+#include "sim.h"
+
+#define SCI_READ            0x03
+#define SCI_WRITE           0x02
+#define SCI_MODE            0x00
+#define SCI_DECODE_TIME     0x04
+#define SCI_VOL             0x0B
+#define SM_RESET            0x0004
+
+static void SimVS1053SciTransfer(const INT8U *pMosi, INT8U *pMiso, INT32U count);
+static void SimVS1053SciSelect(BOOLEAN selected);
+static void SimVS1053SdiTransfer(const INT8U *pMosi, INT8U *pMiso, INT32U count);
+
+SimSpiDevice simVS1053Sci = { "vs1053 sci", MP3_VS1053_MCS_GPIO, MP3_VS1053_MCS_GPIO_Pin,
+                              SimVS1053SciTransfer, SimVS1053SciSelect };
+SimSpiDevice simVS1053Sdi = { "vs1053 sdi", MP3_VS1053_DCS_GPIO, MP3_VS1053_DCS_GPIO_Pin,
+                              SimVS1053SdiTransfer, NULL };
+
+// Bit rates in kbit/s by [MPEG1 ? 0 : 1][layer - 1][index]
+static const INT16U mpegBitrates[2][3][16] =
+{
+    {
+        { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0 },
+        { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0 },
+        { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 },
+    },
+    {
+        { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0 },
+        { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 },
+        { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 },
+    },
+};
+
+static const INT32U mpegSampleRates[3] = { 44100, 48000, 32000 };
+
+static INT16U sciRegs[16];
+static INT8U sciCmd[4];
+static INT32U sciPos;               // bytes of the current SCI command so far
+
+static INT8U fifo[SIM_MP3_FIFO_SIZE];
+static INT32U fifoHead;             // next byte the decoder takes
+static INT32U fifoLevel;
+
+static uint64_t decodeNs;           // host time the decoder caught up to
+static double budgetNs;             // decode time not yet spent on bytes
+static INT32U skipLeft;             // rest of an ID3v2 tag
+static INT32U frameLeft;            // bytes of the current frame still to play
+static double frameNsPerByte;
+static uint64_t playedNs;           // audio time since the soft reset, for SCI_DECODE_TIME
+static uint64_t frameNs;
+static BOOLEAN inStream;            // a frame was played since the soft reset
+static BOOLEAN primed;              // the buffer was full since the soft reset
+static BOOLEAN starved;
+static BOOLEAN started;             // a frame header was found since the soft reset
+static uint64_t starvedSince;
+
+static SimVS1053Stats stats = { 0, 0, 0, 0, 0, 0, SIM_MP3_FIFO_SIZE, 0 };
+
+static SimMp3Event events[SIM_MP3_EVENT_MAX];
+static INT32U eventCount;
+
+
+static void SimVS1053Event(SimMp3EventType type, uint64_t now)
+{
+    if (eventCount < SIM_MP3_EVENT_MAX)
+    {
+        events[eventCount].ns = now;
+        events[eventCount].type = type;
+        eventCount++;
+    }
+}
+
+static INT8U SimVS1053Peek(INT32U offset)
+{
+    return fifo[(fifoHead + offset) % SIM_MP3_FIFO_SIZE];
+}
+
+static void SimVS1053Pop(INT32U count)
+{
+    fifoHead = (fifoHead + count) % SIM_MP3_FIFO_SIZE;
+    fifoLevel -= count;
+}
+
+// Length in bytes and duration of the frame whose header is at the head
+// of the buffer, 0 if it is not a valid header
+static INT32U SimVS1053FrameHeader(uint64_t *pNs, INT32U *pBitrate)
+{
+    INT8U b1 = SimVS1053Peek(1);
+    INT8U b2 = SimVS1053Peek(2);
+    INT32U version = (b1 >> 3) & 3;     // 0 MPEG2.5, 2 MPEG2, 3 MPEG1
+    INT32U layer = 4 - ((b1 >> 1) & 3); // 1..3, 4 is reserved
+    INT32U bitrateIndex = b2 >> 4;
+    INT32U rateIndex = (b2 >> 2) & 3;
+    INT32U padding = (b2 >> 1) & 1;
+    INT32U bitrate, sampleRate, samples, length;
+
+    if (SimVS1053Peek(0) != 0xFF || (b1 & 0xE0) != 0xE0) return 0;
+    if (version == 1 || layer == 4 || rateIndex == 3) return 0;
+    bitrate = mpegBitrates[version == 3 ? 0 : 1][layer - 1][bitrateIndex] * 1000u;
+    if (bitrate == 0) return 0;         // free format or bad index
+
+    sampleRate = mpegSampleRates[rateIndex] >> (version == 3 ? 0 : version == 2 ? 1 : 2);
+    if (layer == 1)
+    {
+        samples = 384;
+        length = (12 * bitrate / sampleRate + padding) * 4;
+    }
+    else
+    {
+        samples = (layer == 3 && version != 3) ? 576 : 1152;
+        length = samples / 8 * bitrate / sampleRate + padding;
+    }
+
+    *pNs = (uint64_t)samples * 1000000000u / sampleRate;
+    *pBitrate = bitrate;
+    return length;
+}
+
+// Let the decoder play up to host time now
+static void SimVS1053Decode(uint64_t now)
+{
+    INT32U n;
+
+    if (decodeNs == 0) decodeNs = now;
+    budgetNs += (double)(now - decodeNs);
+    decodeNs = now;
+
+    while (1)
+    {
+        if (skipLeft > 0)
+        {
+            n = (skipLeft < fifoLevel) ? skipLeft : fifoLevel;
+            SimVS1053Pop(n);
+            skipLeft -= n;
+            if (skipLeft > 0) break;
+            continue;
+        }
+
+        if (frameLeft == 0)
+        {
+            // Between frames: look for the next header
+            if (fifoLevel < 4)
+            {
+                if (budgetNs < frameNsPerByte) return;  // not due yet
+                break;
+            }
+            if (SimVS1053Peek(0) == 'I' && SimVS1053Peek(1) == 'D' && SimVS1053Peek(2) == '3')
+            {
+                if (fifoLevel < 10) break;
+                skipLeft = 10 + (SimVS1053Peek(5) & 0x10 ? 10 : 0) +
+                           ((SimVS1053Peek(6) & 0x7F) << 21) + ((SimVS1053Peek(7) & 0x7F) << 14) +
+                           ((SimVS1053Peek(8) & 0x7F) << 7) + (SimVS1053Peek(9) & 0x7F);
+                continue;
+            }
+            frameLeft = SimVS1053FrameHeader(&frameNs, &stats.bitrate);
+            if (frameLeft == 0)
+            {
+                SimVS1053Pop(1);        // not audio, skipped at once
+                continue;
+            }
+            frameNsPerByte = (double)frameNs / frameLeft;
+            if (!started)
+            {
+                started = OS_TRUE;
+                SimVS1053Event(SIM_MP3_EVENT_START, now);
+            }
+        }
+
+        // Inside a frame: play as many bytes as the elapsed time allows
+        n = (INT32U)(budgetNs / frameNsPerByte);
+        if (n > frameLeft) n = frameLeft;
+        if (n > fifoLevel) n = fifoLevel;
+        SimVS1053Pop(n);
+        frameLeft -= n;
+        budgetNs -= n * frameNsPerByte;
+        if (frameLeft == 0)
+        {
+            stats.frames++;
+            playedNs += frameNs;
+            inStream = OS_TRUE;
+            continue;
+        }
+        if (budgetNs < frameNsPerByte) return;  // out of time, the frame goes on
+        break;
+    }
+
+    // Out of data: what is left of the budget is how long the decoder has
+    // been waiting, which does not build up any further
+    if (inStream && !starved)
+    {
+        starved = OS_TRUE;
+        starvedSince = now - (uint64_t)budgetNs;
+        SimVS1053Event(SIM_MP3_EVENT_STARVE, starvedSince);
+    }
+    budgetNs = 0;
+}
+
+static void SimVS1053SoftReset(void)
+{
+    fifoHead = fifoLevel = 0;
+    skipLeft = frameLeft = 0;
+    budgetNs = 0;
+    playedNs = 0;
+    inStream = primed = starved = started = OS_FALSE;
+    SimVS1053Event(SIM_MP3_EVENT_RESET, SimNowNs());
+}
+
+BOOLEAN SimVS1053Dreq(void)
+{
+    SimVS1053Decode(SimNowNs());
+    return SIM_MP3_FIFO_SIZE - fifoLevel >= SIM_MP3_DREQ_FREE;
+}
+
+static void SimVS1053SciSelect(BOOLEAN selected)
+{
+    sciPos = 0;
+}
+
+static void SimVS1053SciTransfer(const INT8U *pMosi, INT8U *pMiso, INT32U count)
+{
+    INT32U i;
+    INT8U reg;
+
+    for (i = 0; i < count; i++)
+    {
+        INT8U miso = 0;
+
+        if (sciPos < 4) sciCmd[sciPos] = pMosi[i];
+        reg = sciCmd[1] & 0x0F;
+        if (sciCmd[0] == SCI_READ && (sciPos == 2 || sciPos == 3))
+        {
+            if (reg == SCI_DECODE_TIME) sciRegs[reg] = (INT16U)(playedNs / 1000000000u);
+            miso = (sciPos == 2) ? (sciRegs[reg] >> 8) : (sciRegs[reg] & 0xFF);
+        }
+        if (pMiso != NULL) pMiso[i] = miso;
+
+        if (++sciPos == 4 && sciCmd[0] == SCI_WRITE)
+        {
+            sciRegs[reg] = (sciCmd[2] << 8) | sciCmd[3];
+            if (reg == SCI_VOL) SimVS1053Event(SIM_MP3_EVENT_VOLUME, SimNowNs());
+            if (reg == SCI_MODE && (sciRegs[reg] & SM_RESET))
+            {
+                sciRegs[reg] &= ~SM_RESET;
+                SimVS1053SoftReset();
+            }
+        }
+    }
+}
+
+static void SimVS1053SdiTransfer(const INT8U *pMosi, INT8U *pMiso, INT32U count)
+{
+    uint64_t now = SimNowNs();
+    INT32U space, n, i;
+
+    SimVS1053Decode(now);
+
+    if (starved && count > 0)
+    {
+        starved = OS_FALSE;
+        stats.underruns++;
+        stats.underrunNs += now - starvedSince;
+        SimVS1053Event(SIM_MP3_EVENT_RESUME, now);
+    }
+
+    space = SIM_MP3_FIFO_SIZE - fifoLevel;
+    n = (count < space) ? count : space;
+    for (i = 0; i < n; i++)
+    {
+        fifo[(fifoHead + fifoLevel + i) % SIM_MP3_FIFO_SIZE] = pMosi[i];
+    }
+    fifoLevel += n;
+    if (n < count)
+    {
+        stats.overflows++;
+        stats.droppedBytes += count - n;
+    }
+    stats.sdiBytes += count;
+
+    if (fifoLevel > SIM_MP3_FIFO_SIZE - SIM_MP3_DREQ_FREE) primed = OS_TRUE;
+    if (primed && fifoLevel - n < stats.minFifoLevel) stats.minFifoLevel = fifoLevel - n;
+
+    if (pMiso != NULL) memset(pMiso, 0xFF, count);
+}
+
+void SimVS1053GetStats(SimVS1053Stats *pStats)
+{
+    *pStats = stats;
+}
+
+void SimVS1053StatsReset(void)
+{
+    memset(&stats, 0, sizeof(stats));
+    stats.minFifoLevel = SIM_MP3_FIFO_SIZE;
+}
+
+INT32U SimVS1053Events(const SimMp3Event **ppEvents)
+{
+    *ppEvents = events;
+    return eventCount;
+}
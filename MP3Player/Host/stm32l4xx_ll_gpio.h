@@ -0,0 +1,56 @@
+/*
+    stm32l4xx_ll_gpio.h
+
+    Host wrapper of the ST header of the same name, found first on the
+    include path of the Linux build. The register block is plain memory on
+    the host (see hostMain.c), so writing BSRR or BRR does not change ODR
+    and nothing outside the program ever changes IDR. The three pin
+    functions the BSP macros use are replaced by versions that keep ODR up
+    to date and tell the host about it, and that ask the host for IDR.
+*/
+
+#ifndef __HOST_STM32L4xx_LL_GPIO_H
+#define __HOST_STM32L4xx_LL_GPIO_H
+
+#define LL_GPIO_SetOutputPin    LL_GPIO_SetOutputPin_Target
+#define LL_GPIO_ResetOutputPin  LL_GPIO_ResetOutputPin_Target
+#define LL_GPIO_IsInputPinSet   LL_GPIO_IsInputPinSet_Target
+
+#include_next "stm32l4xx_ll_gpio.h"
+
+#undef LL_GPIO_SetOutputPin
+#undef LL_GPIO_ResetOutputPin
+#undef LL_GPIO_IsInputPinSet
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Host hooks, see hostMain.c (and simBus.c for the simulated devices)
+void HostGpioWrite(GPIO_TypeDef *GPIOx, uint32_t PinMask);  // output pins in PinMask changed
+uint32_t HostGpioRead(GPIO_TypeDef *GPIOx);                 // current IDR
+
+#ifdef __cplusplus
+}
+#endif
+
+__STATIC_INLINE void LL_GPIO_SetOutputPin(GPIO_TypeDef *GPIOx, uint32_t PinMask)
+{
+  WRITE_REG(GPIOx->BSRR, PinMask);
+  SET_BIT(GPIOx->ODR, PinMask);
+  HostGpioWrite(GPIOx, PinMask);
+}
+
+__STATIC_INLINE void LL_GPIO_ResetOutputPin(GPIO_TypeDef *GPIOx, uint32_t PinMask)
+{
+  WRITE_REG(GPIOx->BRR, PinMask);
+  CLEAR_BIT(GPIOx->ODR, PinMask);
+  HostGpioWrite(GPIOx, PinMask);
+}
+
+__STATIC_INLINE uint32_t LL_GPIO_IsInputPinSet(GPIO_TypeDef *GPIOx, uint32_t PinMask)
+{
+  return ((HostGpioRead(GPIOx) & PinMask) == (PinMask)) ? 1UL : 0UL;
+}
+
+#endif /* __HOST_STM32L4xx_LL_GPIO_H */
@@ -50,6 +50,12 @@
 #define  OS_CPU_EXT  extern
 #endif
 
+#include  <os_cfg.h>                              /* For OS_CRITICAL_MEAS_EN                            */
+
+#ifndef  OS_CRITICAL_MEAS_EN
+#define  OS_CRITICAL_MEAS_EN       0u
+#endif
+
 #ifndef  OS_CPU_EXCEPT_STK_SIZE
 #define  OS_CPU_EXCEPT_STK_SIZE    128u          /* Default exception stack size is 128 OS_STK entries */
 #endif
@@ -139,9 +145,16 @@ typedef unsigned int   OS_CPU_SR;                /* Define size of CPU status re
 #define  OS_CRITICAL_METHOD   3u
 
 #if OS_CRITICAL_METHOD == 3u
+#if OS_CRITICAL_MEAS_EN > 0u                      /* Measure interrupts disabled time per call site     */
+#include  <critmeas.h>
+#define  OS_ENTER_CRITICAL()  {static CritSite_t crit_site = {__FILE__, __LINE__}; \
+                               cpu_sr = OS_CPU_SR_Save(); CritMeasEnter(&crit_site);}
+#define  OS_EXIT_CRITICAL()   {CritMeasExit(); OS_CPU_SR_Restore(cpu_sr);}
+#else
 #define  OS_ENTER_CRITICAL()  {cpu_sr = OS_CPU_SR_Save();}
 #define  OS_EXIT_CRITICAL()   {OS_CPU_SR_Restore(cpu_sr);}
 #endif
+#endif
 
 
 /*
@@ -527,6 +527,7 @@ void  OS_CPU_SysTickHandler (void)
 
     OS_ENTER_CRITICAL();                                        /* Tell uC/OS-II that we are starting an ISR            */
     OSIntNesting++;
+    OS_TRACE_ISR_ENTER();                                       /* Record ISR entry in trace buffer                     */
     OS_EXIT_CRITICAL();
 
     OSTimeTick();                                               /* Call uC/OS-II's OSTimeTick()                         */
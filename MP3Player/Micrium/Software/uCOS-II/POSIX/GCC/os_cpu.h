@@ -0,0 +1,164 @@
+/*
+*********************************************************************************************************
+*                                                uC/OS-II
+*                                          The Real-Time Kernel
+*
+*
+*                         (c) Copyright 2009-2013; Micrium, Inc.; Weston, FL
+*                    All rights reserved.  Protected by international copyright laws.
+*
+*                                         POSIX (Linux host) Port
+*
+* File      : OS_CPU.H
+* Version   : V2.92.09
+*
+* LICENSING TERMS:
+* ---------------
+*           uC/OS-II is provided in source form for FREE short-term evaluation, for educational use or
+*           for peaceful research.  If you plan or intend to use uC/OS-II in a commercial application/
+*           product then, you need to contact Micrium to properly license uC/OS-II for its use in your
+*           application/product.   We provide ALL the source code for your convenience and to help you
+*           experience uC/OS-II.  The fact that the source is provided does NOT mean that you can use
+*           it commercially without paying a licensing fee.
+*
+*           Knowledge of the source code may NOT be used to develop a similar product.
+*
+*           Please help us continue to provide the embedded community with the finest software available.
+*           Your honesty is greatly appreciated.
+*
+*           You can contact us at www.micrium.com, or by phone at +1 (954) 217-2036.
+*
+* For       : Linux (POSIX threads)
+* Toolchain : GCC
+*
+* Host build of the MP3 player, see Host/Makefile. Every task is a thread, but only the thread of
+* OSTCBCur is ever allowed to run; the others wait on their own semaphore. The tick comes from a timer
+* thread that raises OS_CPU_IRQ_SIGNAL in the running task, and a critical section defers that signal.
+*********************************************************************************************************
+*/
+
+#ifndef  OS_CPU_H
+#define  OS_CPU_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+
+#ifdef   OS_CPU_GLOBALS
+#define  OS_CPU_EXT
+#else
+#define  OS_CPU_EXT  extern
+#endif
+
+#include  <os_cfg.h>                              /* For OS_CRITICAL_MEAS_EN                            */
+
+#ifndef  OS_CRITICAL_MEAS_EN
+#define  OS_CRITICAL_MEAS_EN       0u
+#endif
+
+
+/*
+*********************************************************************************************************
+*                                               DEFINES
+*********************************************************************************************************
+*/
+
+#define  OS_CPU_ARM_FP_EN          0u
+
+#define  OS_CPU_IRQ_SIGNAL         SIGUSR1        /* Plays the part of the interrupt line              */
+#define  OS_CPU_SYSTICK_EXC_NBR    15u            /* Exception number of SysTick, for OSCPUIpsr        */
+
+#ifndef  OS_CPU_THREAD_STK_SIZE
+#define  OS_CPU_THREAD_STK_SIZE    (256u * 1024u) /* Host stack of each task thread, in bytes          */
+#endif
+
+
+/*
+*********************************************************************************************************
+*                                              DATA TYPES
+*                                         (Compiler Specific)
+*********************************************************************************************************
+*/
+
+typedef unsigned char  BOOLEAN;
+typedef unsigned char  INT8U;                    /* Unsigned  8 bit quantity                           */
+typedef signed   char  INT8S;                    /* Signed    8 bit quantity                           */
+typedef unsigned short INT16U;                   /* Unsigned 16 bit quantity                           */
+typedef signed   short INT16S;                   /* Signed   16 bit quantity                           */
+typedef unsigned int   INT32U;                   /* Unsigned 32 bit quantity                           */
+typedef signed   int   INT32S;                   /* Signed   32 bit quantity                           */
+typedef float          FP32;                     /* Single precision floating point                    */
+typedef double         FP64;                     /* Double precision floating point                    */
+
+typedef unsigned int   OS_STK;                   /* Stack entries are only used for stack checking     */
+typedef unsigned int   OS_CPU_SR;                /* Non-zero if the tick was already masked            */
+
+
+/*
+*********************************************************************************************************
+*                                      Critical Section Management
+*
+* Method #3:  OS_CPU_SR_Save() masks the tick in the calling thread and returns whether it was masked
+*             before, OS_CPU_SR_Restore() unmasks it again unless it was and takes a tick that arrived in
+*             between.  The mask is per thread, so a task switched out inside a critical section keeps it
+*             until it runs again, like PRIMASK being part of the context on the target.
+*********************************************************************************************************
+*/
+
+#define  OS_CRITICAL_METHOD   3u
+
+#if OS_CRITICAL_METHOD == 3u
+#if OS_CRITICAL_MEAS_EN > 0u                      /* Measure interrupts disabled time per call site     */
+#include  <critmeas.h>
+#define  OS_ENTER_CRITICAL()  {static CritSite_t crit_site = {__FILE__, __LINE__}; \
+                               cpu_sr = OS_CPU_SR_Save(); CritMeasEnter(&crit_site);}
+#define  OS_EXIT_CRITICAL()   {CritMeasExit(); OS_CPU_SR_Restore(cpu_sr);}
+#else
+#define  OS_ENTER_CRITICAL()  {cpu_sr = OS_CPU_SR_Save();}
+#define  OS_EXIT_CRITICAL()   {OS_CPU_SR_Restore(cpu_sr);}
+#endif
+#endif
+
+/*
+*********************************************************************************************************
+*                                          POSIX Miscellaneous
+*********************************************************************************************************
+*/
+
+#define  OS_STK_GROWTH        1u                  /* Stack grows from HIGH to LOW memory               */
+
+#define  OS_TASK_SW()         OSCtxSw()
+
+/*
+*********************************************************************************************************
+*                                           GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+OS_CPU_EXT  __thread  volatile  INT32U  OSCPUIpsr;   /* Exception the thread is handling, 0 in thread mode; __get_IPSR() */
+
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+#if OS_CRITICAL_METHOD == 3u
+OS_CPU_SR  OS_CPU_SR_Save    (void);
+void       OS_CPU_SR_Restore (OS_CPU_SR cpu_sr);
+#endif
+
+void  OSCtxSw                (void);
+void  OSIntCtxSw             (void);
+void  OSStartHighRdy         (void);
+
+void  OS_CPU_SysTickHandler  (void);
+void  OS_CPU_SysTickInit     (INT32U ticksPerSec);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif
@@ -0,0 +1,795 @@
+/*
+*********************************************************************************************************
+*                                                uC/OS-II
+*                                          The Real-Time Kernel
+*
+*
+*                           (c) Copyright 2009-2013; Micrium, Inc.; Weston, FL
+*                    All rights reserved.  Protected by international copyright laws.
+*
+*                                         POSIX (Linux host) Port
+*
+* File      : OS_CPU_C.C
+* Version   : V2.92.09
+*
+* LICENSING TERMS:
+* ---------------
+*           uC/OS-II is provided in source form for FREE short-term evaluation, for educational use or
+*           for peaceful research.  If you plan or intend to use uC/OS-II in a commercial application/
+*           product then, you need to contact Micrium to properly license uC/OS-II for its use in your
+*           application/product.   We provide ALL the source code for your convenience and to help you
+*           experience uC/OS-II.  The fact that the source is provided does NOT mean that you can use
+*           it commercially without paying a licensing fee.
+*
+*           Knowledge of the source code may NOT be used to develop a similar product.
+*
+*           Please help us continue to provide the embedded community with the finest software available.
+*           Your honesty is greatly appreciated.
+*
+*           You can contact us at www.micrium.com, or by phone at +1 (954) 217-2036.
+*
+* For       : Linux (POSIX threads)
+* Toolchain : GCC
+*
+* Notes     : 1) Each task is a detached thread with its own semaphore.  A context switch posts the
+*                semaphore of OSTCBHighRdy and waits on the one of the task switched out, so exactly one
+*                task thread runs at any time.  The task stacks given to OSTaskCreate() are not used; the
+*                threads run on host stacks of OS_CPU_THREAD_STK_SIZE bytes.
+*
+*             2) The tick thread sets OSCPUIrqPending and sends OS_CPU_IRQ_SIGNAL to the running task,
+*                whose signal handler plays the part of the SysTick exception.  A context switch from
+*                OSIntExit() happens inside that handler, so the preempted task later resumes there.
+*
+*             3) Interrupts are masked in software: OS_CPU_SR_Save() sets the calling thread's
+*                OSCPUIrqMasked, a tick arriving while it is set is only noted in OSCPUIrqDeferred and
+*                taken by OS_CPU_SR_Restore(), like an interrupt pending while PRIMASK is set.  This
+*                avoids two system calls per critical section.
+*
+*             4) A task may be preempted anywhere, including inside the C library while it holds a lock.
+*                Tasks must not share such locks (stdio, malloc); the host BSP prints with write(2).
+*
+*             5) A deleted task's thread stays blocked on its semaphore forever, the way its stack is
+*                simply abandoned on the target.  Nothing on that stack is destroyed.
+*
+*             6) Switches happen inside the critical section of OS_Sched() or OSIntExit(), which on the
+*                target ends before PendSV runs.  With OS_CRITICAL_MEAS_EN, OS_CPU_Switch() puts the
+*                timing of it aside when the task is switched out and picks it up when the task runs
+*                again (CritMeasSave(), CritMeasLoad()), so a section is timed only while its own task
+*                runs.  A new task starts outside any section.
+*********************************************************************************************************
+*/
+
+#define   OS_CPU_GLOBALS
+
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <ucos_ii.h>
+#include  <errno.h>
+#include  <pthread.h>
+#include  <semaphore.h>
+#include  <signal.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <time.h>
+#include  <unistd.h>
+
+
+/*
+*********************************************************************************************************
+*                                           LOCAL DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef  struct  os_cpu_task {                                  /* Host context of a task, kept in OSTCBStkPtr          */
+    pthread_t    Thread;
+    sem_t        Run;                                           /* Posted when the task is switched in                  */
+    void       (*Task)(void *p_arg);
+    void        *Arg;
+#if OS_CRITICAL_MEAS_EN > 0u
+    CritMeasCtx_t  Crit;                                        /* Critical section switched out in, see note 6         */
+#endif
+} OS_CPU_TASK;
+
+
+/*
+*********************************************************************************************************
+*                                          LOCAL VARIABLES
+*********************************************************************************************************
+*/
+
+#if OS_TMR_EN > 0u
+static  INT16U             OSTmrCtr;
+#endif
+
+static  OS_CPU_TASK       *OSCPURunning;                        /* Task thread allowed to run, read by the tick thread  */
+static  int                OSCPUIrqPending;                     /* Tick raised and not yet handled                      */
+
+static  __thread  volatile  sig_atomic_t  OSCPUIrqMasked;       /* Per thread PRIMASK, see note 3                       */
+static  __thread  volatile  sig_atomic_t  OSCPUIrqDeferred;     /* Signal arrived while masked                          */
+
+static  sigset_t           OSCPUIrqSet;                         /* Only OS_CPU_IRQ_SIGNAL                               */
+static  sigset_t           OSCPUIdleSet;                        /* Mask while the idle task waits for the tick          */
+
+static  pthread_t          OSCPUTickThread;
+static  BOOLEAN            OSCPUTickStarted;
+static  long               OSCPUTickPeriodNs;
+
+
+/*
+*********************************************************************************************************
+*                                       LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static  void   OS_CPU_Fatal      (const char *msg);
+static  void   OS_CPU_IrqService (void);
+static  void   OS_CPU_IrqHandler (int sig);
+static  void   OS_CPU_Park       (OS_CPU_TASK *p_ctx);
+static  void   OS_CPU_Switch     (void);
+static  void  *OS_CPU_TaskThread (void *p_arg);
+static  void  *OS_CPU_TickThread (void *p_arg);
+
+
+/*$PAGE*/
+/*
+*********************************************************************************************************
+*                                       OS INITIALIZATION HOOK
+*                                            (BEGINNING)
+*
+* Description: This function is called by OSInit() at the beginning of OSInit().  Installs the handler
+*              of OS_CPU_IRQ_SIGNAL and blocks it in the calling (main) thread, which never runs a task.
+*
+* Arguments  : none
+*
+* Note(s)    : 1) Interrupts should be disabled during this call.
+*********************************************************************************************************
+*/
+#if OS_CPU_HOOKS_EN > 0u
+void  OSInitHookBegin (void)
+{
+    struct sigaction  act;
+
+
+    sigemptyset(&OSCPUIrqSet);
+    sigaddset(&OSCPUIrqSet, OS_CPU_IRQ_SIGNAL);
+    pthread_sigmask(SIG_BLOCK, &OSCPUIrqSet, (sigset_t *)0);
+
+    memset(&act, 0, sizeof(act));
+    act.sa_handler = OS_CPU_IrqHandler;
+    act.sa_flags   = SA_RESTART;                                /* Blocking host calls carry on after a tick            */
+    sigemptyset(&act.sa_mask);
+    if (sigaction(OS_CPU_IRQ_SIGNAL, &act, (struct sigaction *)0) != 0) {
+        OS_CPU_Fatal("sigaction");
+    }
+
+    sigemptyset(&OSCPUIdleSet);
+
+#if OS_TMR_EN > 0u
+    OSTmrCtr = 0u;
+#endif
+}
+#endif
+
+
+/*
+*********************************************************************************************************
+*                                       OS INITIALIZATION HOOK
+*                                               (END)
+*
+* Description: This function is called by OSInit() at the end of OSInit().
+*
+* Arguments  : none
+*
+* Note(s)    : 1) Interrupts should be disabled during this call.
+*********************************************************************************************************
+*/
+#if OS_CPU_HOOKS_EN > 0u
+void  OSInitHookEnd (void)
+{
+
+}
+#endif
+
+
+/*
+*********************************************************************************************************
+*                                          TASK CREATION HOOK
+*
+* Description: This function is called when a task is created.
+*
+* Arguments  : ptcb   is a pointer to the task control block of the task being created.
+*
+* Note(s)    : 1) Interrupts are disabled during this call.
+*********************************************************************************************************
+*/
+#if OS_CPU_HOOKS_EN > 0u
+void  OSTaskCreateHook (OS_TCB *ptcb)
+{
+#if OS_APP_HOOKS_EN > 0u
+    App_TaskCreateHook(ptcb);
+#else
+    (void)ptcb;                                                 /* Prevent compiler warning                             */
+#endif
+}
+#endif
+
+
+/*
+*********************************************************************************************************
+*                                           TASK DELETION HOOK
+*
+* Description: This function is called when a task is deleted.
+*
+* Arguments  : ptcb   is a pointer to the task control block of the task being deleted.
+*
+* Note(s)    : 1) Interrupts are disabled during this call.
+*              2) The task's thread is not stopped, see note 5 at the top of this file.
+*********************************************************************************************************
+*/
+#if OS_CPU_HOOKS_EN > 0u
+void  OSTaskDelHook (OS_TCB *ptcb)
+{
+#if OS_APP_HOOKS_EN > 0u
+    App_TaskDelHook(ptcb);
+#else
+    (void)ptcb;                                                 /* Prevent compiler warning                             */
+#endif
+}
+#endif
+
+
+/*
+*********************************************************************************************************
+*                                             IDLE TASK HOOK
+*
+* Description: This function is called by the idle task.  Rather than spinning on a host CPU, the idle
+*              task waits for the next signal, the way the target waits in WFI.
+*
+* Arguments  : none
+*
+* Note(s)    : 1) Interrupts are enabled during this call.
+*              2) OSIdleCtr no longer counts at full speed, so OSCPUUsage only tells whether the tasks kept
+*                 the idle task from waiting, not how busy the target would be.
+*********************************************************************************************************
+*/
+#if OS_CPU_HOOKS_EN > 0u
+void  OSTaskIdleHook (void)
+{
+#if OS_APP_HOOKS_EN > 0u
+    App_TaskIdleHook();
+#endif
+
+    sigsuspend(&OSCPUIdleSet);
+}
+#endif
+
+
+/*
+*********************************************************************************************************
+*                                            TASK RETURN HOOK
+*
+* Description: This function is called if a task accidentally returns.  In other words, a task should
+*              either be an infinite loop or delete itself when done.
+*
+* Arguments  : ptcb      is a pointer to the task control block of the task that is returning.
+*
+* Note(s)    : none
+*********************************************************************************************************
+*/
+#if OS_CPU_HOOKS_EN > 0u
+void  OSTaskReturnHook (OS_TCB  *ptcb)
+{
+#if OS_APP_HOOKS_EN > 0u
+    App_TaskReturnHook(ptcb);
+#else
+    (void)ptcb;
+#endif
+}
+#endif
+
+
+/*
+*********************************************************************************************************
+*                                           STATISTIC TASK HOOK
+*
+* Description: This function is called every second by uC/OS-II's statistics task.  This allows your
+*              application to add functionality to the statistics task.
+*
+* Arguments  : none
+*********************************************************************************************************
+*/
+#if OS_CPU_HOOKS_EN > 0u
+void  OSTaskStatHook (void)
+{
+#if OS_APP_HOOKS_EN > 0u
+    App_TaskStatHook();
+#endif
+}
+#endif
+
+
+/*$PAGE*/
+/*
+*********************************************************************************************************
+*                                        INITIALIZE A TASK'S STACK
+*
+* Description: This function is called by either OSTaskCreate() or OSTaskCreateExt() to set up the
+*              context of the task being created.  Creates the task's thread, which waits on its
+*              semaphore until the task is switched in for the first time.
+*
+* Arguments  : task          is a pointer to the task code
+*
+*              p_arg         is a pointer to a user supplied data area that will be passed to the task
+*                            when the task first executes.
+*
+*              ptos          is a pointer to the top of stack (unused, see note 1 at the top of the file).
+*
+*              opt           specifies options that can be used to alter the behavior of OSTaskStkInit().
+*                            (see uCOS_II.H for OS_TASK_OPT_xxx).
+*
+* Returns    : The task's host context, which uC/OS-II keeps in OSTCBStkPtr.
+*
+* Note(s)    : (1) Interrupts are enabled when task starts executing.
+*
+*              (2) The thread is created with interrupts masked so the caller cannot be preempted while
+*                  the C library holds its locks.
+**********************************************************************************************************
+*/
+
+OS_STK *OSTaskStkInit (void (*task)(void *p_arg), void *p_arg, OS_STK *ptos, INT16U opt)
+{
+    OS_CPU_TASK     *p_ctx;
+    pthread_attr_t   attr;
+    sigset_t         old;
+    OS_CPU_SR        cpu_sr;
+
+
+    (void)ptos;
+    (void)opt;
+
+    cpu_sr = OS_CPU_SR_Save();
+    p_ctx  = (OS_CPU_TASK *)calloc(1u, sizeof(OS_CPU_TASK));
+    if (p_ctx == (OS_CPU_TASK *)0) {
+        OS_CPU_Fatal("calloc");
+    }
+    p_ctx->Task = task;
+    p_ctx->Arg  = p_arg;
+    sem_init(&p_ctx->Run, 0, 0u);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, OS_CPU_THREAD_STK_SIZE);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_sigmask(SIG_BLOCK, &OSCPUIrqSet, &old);             /* The thread unblocks the signal once it is switched in*/
+    if (pthread_create(&p_ctx->Thread, &attr, OS_CPU_TaskThread, p_ctx) != 0) {
+        OS_CPU_Fatal("pthread_create");
+    }
+    pthread_sigmask(SIG_SETMASK, &old, (sigset_t *)0);
+    pthread_attr_destroy(&attr);
+    OS_CPU_SR_Restore(cpu_sr);
+
+    return ((OS_STK *)p_ctx);
+}
+
+
+/*
+*********************************************************************************************************
+*                                           TASK SWITCH HOOK
+*
+* Description: This function is called when a task switch is performed.  This allows you to perform other
+*              operations during a context switch.
+*
+* Arguments  : none
+*
+* Note(s)    : 1) Interrupts are disabled during this call.
+*              2) It is assumed that the global pointer 'OSTCBHighRdy' points to the TCB of the task that
+*                 will be 'switched in' (i.e. the highest priority task) and, 'OSTCBCur' points to the
+*                 task being switched out (i.e. the preempted task).
+*********************************************************************************************************
+*/
+#if (OS_CPU_HOOKS_EN > 0u) && (OS_TASK_SW_HOOK_EN > 0u)
+void  OSTaskSwHook (void)
+{
+#if OS_APP_HOOKS_EN > 0u
+    App_TaskSwHook();
+#endif
+}
+#endif
+
+
+/*
+*********************************************************************************************************
+*                                           OS_TCBInit() HOOK
+*
+* Description: This function is called by OS_TCBInit() after setting up most of the TCB.
+*
+* Arguments  : ptcb    is a pointer to the TCB of the task being created.
+*
+* Note(s)    : 1) Interrupts may or may not be ENABLED during this call.
+*********************************************************************************************************
+*/
+#if OS_CPU_HOOKS_EN > 0u
+void  OSTCBInitHook (OS_TCB *ptcb)
+{
+#if OS_APP_HOOKS_EN > 0u
+    App_TCBInitHook(ptcb);
+#else
+    (void)ptcb;                                                 /* Prevent compiler warning                             */
+#endif
+}
+#endif
+
+
+/*
+*********************************************************************************************************
+*                                               TICK HOOK
+*
+* Description: This function is called every tick.
+*
+* Arguments  : none
+*
+* Note(s)    : 1) Interrupts may or may not be ENABLED during this call.
+*********************************************************************************************************
+*/
+#if (OS_CPU_HOOKS_EN > 0u) && (OS_TIME_TICK_HOOK_EN > 0u)
+void  OSTimeTickHook (void)
+{
+#if OS_APP_HOOKS_EN > 0u
+    App_TimeTickHook();
+#endif
+
+#if OS_TMR_EN > 0u
+    OSTmrCtr++;
+    if (OSTmrCtr >= (OS_TICKS_PER_SEC / OS_TMR_CFG_TICKS_PER_SEC)) {
+        OSTmrCtr = 0;
+        OSTmrSignal();
+    }
+#endif
+}
+#endif
+
+
+/*$PAGE*/
+/*
+*********************************************************************************************************
+*                                      CRITICAL SECTION MANAGEMENT
+*
+* Description: Mask and unmask the tick of the calling thread, see note 3 at the top of the file.
+*
+* Arguments  : cpu_sr    is the value returned by the matching OS_CPU_SR_Save().
+*
+* Returns    : OS_CPU_SR_Save() returns 1 if interrupts were already masked, 0 otherwise.
+*********************************************************************************************************
+*/
+
+OS_CPU_SR  OS_CPU_SR_Save (void)
+{
+    OS_CPU_SR  cpu_sr;
+
+
+    cpu_sr         = (OS_CPU_SR)OSCPUIrqMasked;
+    OSCPUIrqMasked = 1;
+    return (cpu_sr);
+}
+
+
+void  OS_CPU_SR_Restore (OS_CPU_SR cpu_sr)
+{
+    if (cpu_sr == 0u) {
+        OSCPUIrqMasked = 0;
+        if (OSCPUIrqDeferred != 0) {                            /* Take the tick that came in while masked              */
+            OS_CPU_IrqService();
+        }
+    }
+}
+
+
+/*$PAGE*/
+/*
+*********************************************************************************************************
+*                                         START MULTITASKING
+*
+* Description: Called by OSStart() to switch in the highest priority task.  The main thread is not a
+*              task; it stays blocked from here on.
+*
+* Arguments  : none
+*********************************************************************************************************
+*/
+
+void  OSStartHighRdy (void)
+{
+    OS_CPU_TASK  *p_ctx;
+
+
+#if (OS_CPU_HOOKS_EN > 0u) && (OS_TASK_SW_HOOK_EN > 0u)
+    OSTaskSwHook();
+#endif
+    OSRunning = OS_TRUE;
+
+    p_ctx = (OS_CPU_TASK *)OSTCBHighRdy->OSTCBStkPtr;
+    __atomic_store_n(&OSCPURunning, p_ctx, __ATOMIC_SEQ_CST);
+    sem_post(&p_ctx->Run);
+
+    for (;;) {
+        pause();
+    }
+}
+
+
+/*
+*********************************************************************************************************
+*                                   TASK LEVEL AND ISR LEVEL CONTEXT SWITCH
+*
+* Description: Switch from OSTCBCur to OSTCBHighRdy.  Called with interrupts masked, from task level by
+*              OS_Sched() and from the tick handler by OSIntExit().  Returns when the task switched out
+*              is switched in again.
+*
+* Arguments  : none
+*********************************************************************************************************
+*/
+
+void  OSCtxSw (void)
+{
+    OS_CPU_Switch();
+}
+
+
+void  OSIntCtxSw (void)
+{
+    OS_CPU_Switch();
+}
+
+
+static  void  OS_CPU_Switch (void)
+{
+    OS_CPU_TASK  *p_from;
+    OS_CPU_TASK  *p_to;
+
+
+#if (OS_CPU_HOOKS_EN > 0u) && (OS_TASK_SW_HOOK_EN > 0u)
+    OSTaskSwHook();
+#endif
+    OSPrioCur = OSPrioHighRdy;
+    OSTCBCur  = OSTCBHighRdy;
+
+    p_from = OSCPURunning;                                      /* OSTCBStkPtr of a deleted task is no longer valid     */
+    p_to   = (OS_CPU_TASK *)OSTCBHighRdy->OSTCBStkPtr;
+    if (p_to == p_from) {
+        return;
+    }
+#if OS_CRITICAL_MEAS_EN > 0u
+    CritMeasSave(&p_from->Crit);                                /* See note (6)                                         */
+#endif
+    __atomic_store_n(&OSCPURunning, p_to, __ATOMIC_SEQ_CST);
+    sem_post(&p_to->Run);
+
+    OS_CPU_Park(p_from);
+#if OS_CRITICAL_MEAS_EN > 0u
+    CritMeasLoad(&p_from->Crit);
+#endif
+}
+
+
+/*
+*********************************************************************************************************
+*                                          WAIT TO BE SWITCHED IN
+*
+* Description: Block the calling task thread until its semaphore is posted.  A tick raised while the
+*              thread was switching is left pending for it, see OS_CPU_TickThread().
+*
+* Arguments  : p_ctx     is the host context of the calling task.
+*
+* Note(s)    : 1) Called with interrupts masked.
+*********************************************************************************************************
+*/
+
+static  void  OS_CPU_Park (OS_CPU_TASK *p_ctx)
+{
+    while (sem_wait(&p_ctx->Run) != 0) {
+        ;
+    }
+    if (__atomic_load_n(&OSCPUIrqPending, __ATOMIC_SEQ_CST) != 0) {
+        OSCPUIrqDeferred = 1;
+    }
+}
+
+
+/*
+*********************************************************************************************************
+*                                             TASK THREAD
+*
+* Description: Body of every task thread.  Runs the task once it is switched in for the first time and
+*              deletes it if it returns, as OS_TaskReturn() in the LR of a new task does on the target.
+*
+* Arguments  : p_arg     is the task's host context.
+*********************************************************************************************************
+*/
+
+static  void  *OS_CPU_TaskThread (void *p_arg)
+{
+    OS_CPU_TASK  *p_ctx;
+
+
+    p_ctx          = (OS_CPU_TASK *)p_arg;
+    OSCPUIrqMasked = 1;
+    pthread_sigmask(SIG_UNBLOCK, &OSCPUIrqSet, (sigset_t *)0);
+
+    OS_CPU_Park(p_ctx);
+    OS_CPU_SR_Restore(0u);                                      /* See note (1) of OSTaskStkInit()                      */
+
+    p_ctx->Task(p_ctx->Arg);
+    OS_TaskReturn();
+
+    return ((void *)0);
+}
+
+
+/*$PAGE*/
+/*
+*********************************************************************************************************
+*                                          SYS TICK HANDLER
+*
+* Description: Handle the system tick, which is used to generate the uC/OS-II tick interrupt.
+*
+* Arguments  : None.
+*
+* Note(s)    : 1) Called from OS_CPU_IrqService() with interrupts masked.
+*********************************************************************************************************
+*/
+
+void  OS_CPU_SysTickHandler (void)
+{
+    OS_CPU_SR  cpu_sr;
+
+
+    OS_ENTER_CRITICAL();                                        /* Tell uC/OS-II that we are starting an ISR            */
+    OSIntNesting++;
+    OS_TRACE_ISR_ENTER();                                       /* Record ISR entry in trace buffer                     */
+    OS_EXIT_CRITICAL();
+
+    OSTimeTick();                                               /* Call uC/OS-II's OSTimeTick()                         */
+
+    OSIntExit();                                                /* Tell uC/OS-II that we are leaving the ISR            */
+}
+
+
+/*
+*********************************************************************************************************
+*                                        TICK SIGNAL HANDLING
+*
+* Description: OS_CPU_IrqHandler() is the handler of OS_CPU_IRQ_SIGNAL.  OS_CPU_IrqService() takes the
+*              pending tick, with interrupts masked, until no tick is left.
+*
+* Note(s)    : 1) A signal that reaches a thread after it was switched out is harmless: that thread is
+*                 masked, and OSCPUIrqPending is only cleared by the thread that handles the tick.
+*
+*              2) OSCPUIpsr is per thread like the rest of the context: a task switched out by OSIntExit()
+*                 is still in the handler when it resumes, and the task switched in is not.
+*********************************************************************************************************
+*/
+
+static  void  OS_CPU_IrqHandler (int sig)
+{
+    int  err;
+
+
+    (void)sig;
+    err = errno;
+    if (OSCPUIrqMasked != 0) {
+        OSCPUIrqDeferred = 1;
+    } else {
+        OS_CPU_IrqService();
+    }
+    errno = err;
+}
+
+
+static  void  OS_CPU_IrqService (void)
+{
+    do {
+        OSCPUIrqMasked   = 1;
+        OSCPUIrqDeferred = 0;
+        if (__atomic_exchange_n(&OSCPUIrqPending, 0, __ATOMIC_SEQ_CST) != 0) {
+            OSCPUIpsr = OS_CPU_SYSTICK_EXC_NBR;                 /* See note (2)                                         */
+            OS_CPU_SysTickHandler();
+            OSCPUIpsr = 0u;
+        }
+        OSCPUIrqMasked   = 0;
+    } while (OSCPUIrqDeferred != 0);
+}
+
+
+/*$PAGE*/
+/*
+*********************************************************************************************************
+*                                          SYS TICK INIT
+*
+* Description: Starts the tick thread, or changes its rate if it is already running.
+*
+* Arguments  : ticksPerSec is the number of ticks per second
+*
+* Note(s)    : 1) Call this function from the startup task to initialize the timer tick.
+*********************************************************************************************************
+*/
+
+void  OS_CPU_SysTickInit (INT32U ticksPerSec)
+{
+    __atomic_store_n(&OSCPUTickPeriodNs, 1000000000L / (long)ticksPerSec, __ATOMIC_SEQ_CST);
+    if (OSCPUTickStarted == OS_FALSE) {
+        OSCPUTickStarted = OS_TRUE;
+        if (pthread_create(&OSCPUTickThread, (pthread_attr_t *)0, OS_CPU_TickThread, (void *)0) != 0) {
+            OS_CPU_Fatal("pthread_create");
+        }
+    }
+}
+
+
+/*
+*********************************************************************************************************
+*                                             TICK THREAD
+*
+* Description: Raises the tick in the running task every OSCPUTickPeriodNs, on an absolute schedule so
+*              the tick rate does not drift.  If the process was stopped, the missed ticks are dropped.
+*
+* Note(s)    : 1) OSCPUIrqPending is set before OSCPURunning is read, and OS_CPU_Switch() stores
+*                 OSCPURunning before the task switched in reads OSCPUIrqPending (OS_CPU_Park()), so
+*                 either the signal goes to the new task or the new task finds the tick pending.
+*********************************************************************************************************
+*/
+
+static  void  *OS_CPU_TickThread (void *p_arg)
+{
+    struct timespec   next;
+    struct timespec   now;
+    OS_CPU_TASK      *p_ctx;
+    long              period;
+
+
+    (void)p_arg;
+    pthread_sigmask(SIG_BLOCK, &OSCPUIrqSet, (sigset_t *)0);
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (;;) {
+        period        = __atomic_load_n(&OSCPUTickPeriodNs, __ATOMIC_SEQ_CST);
+        next.tv_nsec += period;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > next.tv_sec + 1) {                     /* Fell behind, start over from now                     */
+            next = now;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, (struct timespec *)0) == EINTR) {
+            ;
+        }
+
+        __atomic_store_n(&OSCPUIrqPending, 1, __ATOMIC_SEQ_CST);
+        p_ctx = __atomic_load_n(&OSCPURunning, __ATOMIC_SEQ_CST);
+        if (p_ctx != (OS_CPU_TASK *)0) {
+            pthread_kill(p_ctx->Thread, OS_CPU_IRQ_SIGNAL);
+        }
+    }
+
+    return ((void *)0);
+}
+
+
+/*
+*********************************************************************************************************
+*                                          HOST FAILURE
+*
+* Description: A host call the port depends on failed; there is no way to carry on.
+*********************************************************************************************************
+*/
+
+static  void  OS_CPU_Fatal (const char *msg)
+{
+    perror(msg);
+    abort();
+}
@@ -77,6 +77,12 @@ static  void  OS_InitTCBList(void);
 
 static  void  OS_SchedNew(void);
 
+static  void  OS_TimeTickExpire(OS_TCB *ptcb);
+
+#if OS_TICK_DLY_LIST_EN > 0u
+static  void  OS_TickListExpire(INT32U ticks);
+#endif
+
 /*$PAGE*/
 /*
 *********************************************************************************************************
@@ -471,7 +477,7 @@ INT16U  OSEventPendMulti (OS_EVENT  **pevents_pend,
     OSTCBCur->OSTCBStat     |= events_stat  |           /* Resource not available, ...                 */
                                OS_STAT_MULTI;           /* ... pend on multiple events                 */
     OSTCBCur->OSTCBStatPend  = OS_STAT_PEND_OK;
-    OSTCBCur->OSTCBDly       = timeout;                 /* Store pend timeout in TCB                   */
+    OS_TCB_DLY_SET(OSTCBCur, timeout);                  /* Store pend timeout in TCB                   */
     OS_EventTaskWaitMulti(pevents_pend);                /* Suspend task until events or timeout occurs */
 
     OS_EXIT_CRITICAL();
@@ -602,6 +608,8 @@ void  OSInit (void)
 
     OSInitHookEnd();                                             /* Call port specific init. code            */
 
+    OS_TRACE_INIT();                                             /* Initialize the kernel trace recorder     */
+
 #if OS_DEBUG_EN > 0u
     OSDebugInit();
 #endif
@@ -638,6 +646,7 @@ void  OSIntEnter (void)
         if (OSIntNesting < 255u) {
             OSIntNesting++;                      /* Increment ISR nesting level                        */
         }
+        OS_TRACE_ISR_ENTER();                    /* Record ISR entry in trace buffer                   */
     }
 }
 /*$PAGE*/
@@ -670,6 +679,7 @@ void  OSIntExit (void)
 
     if (OSRunning == OS_TRUE) {
         OS_ENTER_CRITICAL();
+        OS_TRACE_ISR_EXIT();                               /* Record ISR exit in trace buffer          */
         if (OSIntNesting > 0u) {                           /* Prevent OSIntNesting from wrapping       */
             OSIntNesting--;
         }
@@ -931,31 +941,302 @@ void  OSTimeTick (void)
             return;
         }
 #endif
+#if OS_TICK_DLY_LIST_EN > 0u
+        OS_ENTER_CRITICAL();
+        OS_TickListExpire(1u);                             /* Only the head of the delta list counts down  */
+        OS_EXIT_CRITICAL();
+#else
         ptcb = OSTCBList;                                  /* Point at first TCB in TCB list               */
         while (ptcb->OSTCBPrio != OS_TASK_IDLE_PRIO) {     /* Go through all TCBs in TCB list              */
             OS_ENTER_CRITICAL();
             if (ptcb->OSTCBDly != 0u) {                    /* No, Delayed or waiting for event with TO     */
                 ptcb->OSTCBDly--;                          /* Decrement nbr of ticks to end of delay       */
                 if (ptcb->OSTCBDly == 0u) {                /* Check for timeout                            */
-
-                    if ((ptcb->OSTCBStat & OS_STAT_PEND_ANY) != OS_STAT_RDY) {
-                        ptcb->OSTCBStat  &= (INT8U)~(INT8U)OS_STAT_PEND_ANY;          /* Yes, Clear status flag   */
-                        ptcb->OSTCBStatPend = OS_STAT_PEND_TO;                 /* Indicate PEND timeout    */
-                    } else {
-                        ptcb->OSTCBStatPend = OS_STAT_PEND_OK;
-                    }
-
-                    if ((ptcb->OSTCBStat & OS_STAT_SUSPEND) == OS_STAT_RDY) {  /* Is task suspended?       */
-                        OSRdyGrp               |= ptcb->OSTCBBitY;             /* No,  Make ready          */
-                        OSRdyTbl[ptcb->OSTCBY] |= ptcb->OSTCBBitX;
-                    }
+                    OS_TimeTickExpire(ptcb);
                 }
             }
             ptcb = ptcb->OSTCBNext;                        /* Point at next TCB in TCB list                */
             OS_EXIT_CRITICAL();
         }
+#endif
+    }
+}
+
+/*$PAGE*/
+#if OS_TICKLESS_EN > 0u
+/*
+*********************************************************************************************************
+*                                    PROCESS SEVERAL SYSTEM TICKS AT ONCE
+*
+* Description: This function is called by the tickless idle code after the tick interrupt was suppressed
+*              for 'ticks' periods.  It advances OSTime and every delay and pend timeout by 'ticks' and
+*              readies the tasks that expired in the meantime, as if OSTimeTick() had been called
+*              'ticks' times.
+*
+* Arguments  : ticks         is the number of tick periods that elapsed.  The caller must not let more
+*                            ticks go by than OSTimeNextWake() returned, or expired tasks wake late.
+*
+* Returns    : none
+*
+* Notes      : 1) OSTimeTickHook() is called once, not once per elapsed tick.
+*              2) Tick stepping for uC/OS-View is ignored.
+*              3) A context switch is requested if a higher priority task was readied, it happens as soon
+*                 as interrupts are enabled again.
+*********************************************************************************************************
+*/
+
+void  OSTimeTickN (INT32U ticks)
+{
+#if OS_TICK_DLY_LIST_EN == 0u
+    OS_TCB    *ptcb;
+#endif
+#if OS_CRITICAL_METHOD == 3u                               /* Allocate storage for CPU status register     */
+    OS_CPU_SR  cpu_sr = 0u;
+#endif
+
+
+
+    if (ticks == 0u) {
+        return;
+    }
+#if OS_TIME_TICK_HOOK_EN > 0u
+    OSTimeTickHook();                                      /* Call user definable hook                     */
+#endif
+    OS_ENTER_CRITICAL();
+#if OS_TIME_GET_SET_EN > 0u
+    OSTime += ticks;                                       /* Update the 32-bit tick counter               */
+#endif
+    if (OSRunning == OS_TRUE) {
+#if OS_TICK_DLY_LIST_EN > 0u
+        OS_TickListExpire(ticks);
+#else
+        ptcb = OSTCBList;                                  /* Point at first TCB in TCB list               */
+        while (ptcb->OSTCBPrio != OS_TASK_IDLE_PRIO) {     /* Go through all TCBs in TCB list              */
+            if (ptcb->OSTCBDly != 0u) {                    /* No, Delayed or waiting for event with TO     */
+                if (ptcb->OSTCBDly <= ticks) {             /* Check for timeout                            */
+                    ptcb->OSTCBDly = 0u;
+                    OS_TimeTickExpire(ptcb);
+                } else {
+                    ptcb->OSTCBDly -= ticks;
+                }
+            }
+            ptcb = ptcb->OSTCBNext;                        /* Point at next TCB in TCB list                */
+        }
+#endif
+    }
+    OS_EXIT_CRITICAL();
+    if ((OSRunning == OS_TRUE) && (OSIntNesting == 0u)) {
+        OS_Sched();                                        /* Run the highest priority task readied        */
+    }
+}
+
+/*$PAGE*/
+/*
+*********************************************************************************************************
+*                                   GET THE NUMBER OF TICKS TO THE NEXT WAKE UP
+*
+* Description: This function returns how many ticks may elapse before a delayed or pending task times out,
+*              that is how long the tick interrupt may be suppressed.
+*
+* Arguments  : none
+*
+* Returns    : the number of ticks until the earliest delay or timeout expires, 0 if no task is waiting on
+*              a delay or timeout.
+*
+* Note       : Call this function with interrupts disabled and keep them disabled until the ticks have been
+*              accounted for with OSTimeTickN(), otherwise a task may be delayed in between.
+*********************************************************************************************************
+*/
+
+INT32U  OSTimeNextWake (void)
+{
+#if OS_TICK_DLY_LIST_EN > 0u
+    if (OSTCBDlyList == (OS_TCB *)0) {                     /* Head of the delta list expires first         */
+        return (0u);
+    }
+    return (OSTCBDlyList->OSTCBDlyDelta);
+#else
+    OS_TCB  *ptcb;
+    INT32U   next;
+
+
+    next = 0u;
+    ptcb = OSTCBList;
+    while (ptcb->OSTCBPrio != OS_TASK_IDLE_PRIO) {         /* Find the shortest delay or timeout           */
+        if ((ptcb->OSTCBDly != 0u) &&
+            ((next == 0u) || (ptcb->OSTCBDly < next))) {
+            next = ptcb->OSTCBDly;
+        }
+        ptcb = ptcb->OSTCBNext;
+    }
+    return (next);
+#endif
+}
+#endif
+
+/*$PAGE*/
+/*
+*********************************************************************************************************
+*                                   READY A TASK WHOSE DELAY EXPIRED
+*
+* Description: This function is called by OSTimeTick() when the delay or pend timeout of a task reaches 0.
+*
+* Arguments  : ptcb          is a pointer to the TCB of the task whose delay expired.
+*
+* Returns    : none
+*
+* Note       : This function is INTERNAL to uC/OS-II and is called with interrupts disabled.
+*********************************************************************************************************
+*/
+
+static  void  OS_TimeTickExpire (OS_TCB *ptcb)
+{
+    if ((ptcb->OSTCBStat & OS_STAT_PEND_ANY) != OS_STAT_RDY) {
+        ptcb->OSTCBStat  &= (INT8U)~(INT8U)OS_STAT_PEND_ANY;          /* Yes, Clear status flag   */
+        ptcb->OSTCBStatPend = OS_STAT_PEND_TO;                 /* Indicate PEND timeout    */
+    } else {
+        ptcb->OSTCBStatPend = OS_STAT_PEND_OK;
+    }
+
+    if ((ptcb->OSTCBStat & OS_STAT_SUSPEND) == OS_STAT_RDY) {  /* Is task suspended?       */
+        OSRdyGrp               |= ptcb->OSTCBBitY;             /* No,  Make ready          */
+        OSRdyTbl[ptcb->OSTCBY] |= ptcb->OSTCBBitX;
+    }
+}
+
+/*$PAGE*/
+#if OS_TICK_DLY_LIST_EN > 0u
+/*
+*********************************************************************************************************
+*                            INSERT A TASK IN THE DELTA LIST OF DELAYED TASKS
+*
+* Description: This function sets the delay of a task and links its TCB into OSTCBDlyList.  The list is
+*              sorted by expiry and each TCB stores the number of ticks after its predecessor, so
+*              OSTimeTick() only has to decrement the head.  Tasks that expire on the same tick keep
+*              the order in which they were inserted.
+*
+* Arguments  : ptcb          is a pointer to the TCB of the task to delay.
+*
+*              ticks         is the number of ticks to delay.  0 means no delay (e.g. pend forever).
+*
+* Returns    : none
+*
+* Note       : This function is INTERNAL to uC/OS-II and is called with interrupts disabled.  Use
+*              OS_TCB_DLY_SET().
+*********************************************************************************************************
+*/
+
+void  OS_TickListInsert (OS_TCB *ptcb,
+                         INT32U  ticks)
+{
+    OS_TCB  *pprev;
+    OS_TCB  *pnext;
+
+
+    OS_TickListRemove(ptcb);                               /* In case the task is already delayed          */
+    if (ticks == 0u) {
+        return;
+    }
+    ptcb->OSTCBDly = ticks;
+    pprev          = (OS_TCB *)0;
+    pnext          = OSTCBDlyList;
+    while ((pnext != (OS_TCB *)0) &&                       /* Find the first TCB that expires later        */
+           (pnext->OSTCBDlyDelta <= ticks)) {
+        ticks -= pnext->OSTCBDlyDelta;
+        pprev  = pnext;
+        pnext  = pnext->OSTCBDlyNext;
+    }
+    ptcb->OSTCBDlyDelta = ticks;
+    ptcb->OSTCBDlyPrev  = pprev;
+    ptcb->OSTCBDlyNext  = pnext;
+    if (pnext != (OS_TCB *)0) {
+        pnext->OSTCBDlyDelta -= ticks;                     /* Successor is now relative to this TCB        */
+        pnext->OSTCBDlyPrev   = ptcb;
+    }
+    if (pprev != (OS_TCB *)0) {
+        pprev->OSTCBDlyNext = ptcb;
+    } else {
+        OSTCBDlyList        = ptcb;
+    }
+}
+
+/*$PAGE*/
+/*
+*********************************************************************************************************
+*                            REMOVE A TASK FROM THE DELTA LIST OF DELAYED TASKS
+*
+* Description: This function clears the delay of a task and unlinks its TCB from OSTCBDlyList, handing its
+*              remaining ticks to its successor.
+*
+* Arguments  : ptcb          is a pointer to the TCB of the task.
+*
+* Returns    : none
+*
+* Note       : This function is INTERNAL to uC/OS-II and is called with interrupts disabled.  Use
+*              OS_TCB_DLY_CLR().
+*********************************************************************************************************
+*/
+
+void  OS_TickListRemove (OS_TCB *ptcb)
+{
+    if (ptcb->OSTCBDly == 0u) {                            /* Not in the list                              */
+        return;
+    }
+    if (ptcb->OSTCBDlyNext != (OS_TCB *)0) {
+        ptcb->OSTCBDlyNext->OSTCBDlyDelta += ptcb->OSTCBDlyDelta;
+        ptcb->OSTCBDlyNext->OSTCBDlyPrev   = ptcb->OSTCBDlyPrev;
+    }
+    if (ptcb->OSTCBDlyPrev != (OS_TCB *)0) {
+        ptcb->OSTCBDlyPrev->OSTCBDlyNext = ptcb->OSTCBDlyNext;
+    } else {
+        OSTCBDlyList                     = ptcb->OSTCBDlyNext;
+    }
+    ptcb->OSTCBDlyNext  = (OS_TCB *)0;
+    ptcb->OSTCBDlyPrev  = (OS_TCB *)0;
+    ptcb->OSTCBDlyDelta = 0u;
+    ptcb->OSTCBDly      = 0u;
+}
+
+/*$PAGE*/
+/*
+*********************************************************************************************************
+*                            EXPIRE TASKS AT THE HEAD OF THE DELTA LIST OF DELAYED TASKS
+*
+* Description: This function advances OSTCBDlyList by 'ticks' and readies every TCB whose delay or timeout
+*              runs out.  The head of the list always has a delta of at least 1 tick.
+*
+* Arguments  : ticks         is the number of ticks that elapsed, 1 for OSTimeTick().
+*
+* Returns    : none
+*
+* Note       : This function is INTERNAL to uC/OS-II and is called with interrupts disabled.
+*********************************************************************************************************
+*/
+
+static  void  OS_TickListExpire (INT32U ticks)
+{
+    OS_TCB  *ptcb;
+
+
+    ptcb = OSTCBDlyList;
+    while ((ptcb != (OS_TCB *)0) &&                        /* Ready every TCB that expires within 'ticks'  */
+           (ptcb->OSTCBDlyDelta <= ticks)) {
+        ticks        -= ptcb->OSTCBDlyDelta;
+        OSTCBDlyList  = ptcb->OSTCBDlyNext;                /* Unlink the head                              */
+        if (OSTCBDlyList != (OS_TCB *)0) {
+            OSTCBDlyList->OSTCBDlyPrev = (OS_TCB *)0;
+        }
+        ptcb->OSTCBDlyNext  = (OS_TCB *)0;
+        ptcb->OSTCBDlyDelta = 0u;
+        ptcb->OSTCBDly      = 0u;
+        OS_TimeTickExpire(ptcb);
+        ptcb = OSTCBDlyList;
+    }
+    if (ptcb != (OS_TCB *)0) {
+        ptcb->OSTCBDlyDelta -= ticks;                      /* Remaining ticks come off the new head        */
     }
 }
+#endif
 
 /*$PAGE*/
 /*
@@ -1059,7 +1340,7 @@ INT8U  OS_EventTaskRdy (OS_EVENT  *pevent,
 #endif
 
     ptcb                  =  OSTCBPrioTbl[prio];        /* Point to this task's OS_TCB                 */
-    ptcb->OSTCBDly        =  0u;                        /* Prevent OSTimeTick() from readying task     */
+    OS_TCB_DLY_CLR(ptcb);                               /* Prevent OSTimeTick() from readying task     */
 #if ((OS_Q_EN > 0u) && (OS_MAX_QS > 0u)) || (OS_MBOX_EN > 0u)
     ptcb->OSTCBMsg        =  pmsg;                      /* Send message directly to waiting task       */
 #else
@@ -1545,6 +1826,9 @@ static  void  OS_InitTCBList (void)
 #endif
     OSTCBList               = (OS_TCB *)0;                       /* TCB lists initializations          */
     OSTCBFreeList           = &OSTCBTbl[0];
+#if OS_TICK_DLY_LIST_EN > 0u
+    OSTCBDlyList            = (OS_TCB *)0;                       /* No task is delayed                 */
+#endif
 }
 /*$PAGE*/
 /*
@@ -1941,6 +2225,11 @@ INT8U  OS_TCBInit (INT8U    prio,
         ptcb->OSTCBStat          = OS_STAT_RDY;            /* Task is ready to run                     */
         ptcb->OSTCBStatPend      = OS_STAT_PEND_OK;        /* Clear pend status                        */
         ptcb->OSTCBDly           = 0u;                     /* Task is not delayed                      */
+#if OS_TICK_DLY_LIST_EN > 0u
+        ptcb->OSTCBDlyNext       = (OS_TCB *)0;            /* Not in the delta list of delayed tasks   */
+        ptcb->OSTCBDlyPrev       = (OS_TCB *)0;
+        ptcb->OSTCBDlyDelta      = 0u;
+#endif
 
 #if OS_TASK_CREATE_EXT_EN > 0u
         ptcb->OSTCBExtPtr        = pext;                   /* Store pointer to TCB extension           */
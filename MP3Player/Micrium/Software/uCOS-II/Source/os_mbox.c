@@ -315,6 +315,7 @@ void  *OSMboxPend (OS_EVENT  *pevent,
         return ((void *)0);
     }
     OS_ENTER_CRITICAL();
+    OS_TRACE_MBOX_PEND(pevent);                       /* Record pend in trace buffer                   */
     pmsg = pevent->OSEventPtr;
     if (pmsg != (void *)0) {                          /* See if there is already a message             */
         pevent->OSEventPtr = (void *)0;               /* Clear the mailbox                             */
@@ -324,7 +325,8 @@ void  *OSMboxPend (OS_EVENT  *pevent,
     }
     OSTCBCur->OSTCBStat     |= OS_STAT_MBOX;          /* Message not available, task will pend         */
     OSTCBCur->OSTCBStatPend  = OS_STAT_PEND_OK;
-    OSTCBCur->OSTCBDly       = timeout;               /* Load timeout in TCB                           */
+    OS_TCB_DLY_SET(OSTCBCur, timeout);                /* Load timeout in TCB                           */
+    OS_TRACE_MBOX_PEND_BLOCK(pevent);                 /* Record that the task is about to block        */
     OS_EventTaskWait(pevent);                         /* Suspend task until event or timeout occurs    */
     OS_EXIT_CRITICAL();
     OS_Sched();                                       /* Find next highest priority task ready to run  */
@@ -491,6 +493,7 @@ INT8U  OSMboxPost (OS_EVENT  *pevent,
         return (OS_ERR_EVENT_TYPE);
     }
     OS_ENTER_CRITICAL();
+    OS_TRACE_MBOX_POST(pevent);                       /* Record post in trace buffer                   */
     if (pevent->OSEventGrp != 0u) {                   /* See if any task pending on mailbox            */
                                                       /* Ready HPT waiting on event                    */
         (void)OS_EventTaskRdy(pevent, pmsg, OS_STAT_MBOX, OS_STAT_PEND_OK);
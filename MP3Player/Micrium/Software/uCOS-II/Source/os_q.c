@@ -435,6 +435,7 @@ void  *OSQPend (OS_EVENT  *pevent,
         return ((void *)0);
     }
     OS_ENTER_CRITICAL();
+    OS_TRACE_Q_PEND(pevent);                     /* Record pend in trace buffer                        */
     pq = (OS_Q *)pevent->OSEventPtr;             /* Point at queue control block                       */
     if (pq->OSQEntries > 0u) {                   /* See if any messages in the queue                   */
         pmsg = *pq->OSQOut++;                    /* Yes, extract oldest message from the queue         */
@@ -448,7 +449,8 @@ void  *OSQPend (OS_EVENT  *pevent,
     }
     OSTCBCur->OSTCBStat     |= OS_STAT_Q;        /* Task will have to pend for a message to be posted  */
     OSTCBCur->OSTCBStatPend  = OS_STAT_PEND_OK;
-    OSTCBCur->OSTCBDly       = timeout;          /* Load timeout into TCB                              */
+    OS_TCB_DLY_SET(OSTCBCur, timeout);           /* Load timeout into TCB                              */
+    OS_TRACE_Q_PEND_BLOCK(pevent);               /* Record that the task is about to block             */
     OS_EventTaskWait(pevent);                    /* Suspend task until event or timeout occurs         */
     OS_EXIT_CRITICAL();
     OS_Sched();                                  /* Find next highest priority task ready to run       */
@@ -610,6 +612,7 @@ INT8U  OSQPost (OS_EVENT  *pevent,
         return (OS_ERR_EVENT_TYPE);
     }
     OS_ENTER_CRITICAL();
+    OS_TRACE_Q_POST(pevent);                           /* Record post in trace buffer                  */
     if (pevent->OSEventGrp != 0u) {                    /* See if any task pending on queue             */
                                                        /* Ready highest priority task waiting on event */
         (void)OS_EventTaskRdy(pevent, pmsg, OS_STAT_Q, OS_STAT_PEND_OK);
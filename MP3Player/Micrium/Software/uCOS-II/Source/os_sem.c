@@ -321,6 +321,7 @@ void  OSSemPend (OS_EVENT  *pevent,
         return;
     }
     OS_ENTER_CRITICAL();
+    OS_TRACE_SEM_PEND(pevent);                        /* Record pend in trace buffer                   */
     if (pevent->OSEventCnt > 0u) {                    /* If sem. is positive, resource available ...   */
         pevent->OSEventCnt--;                         /* ... decrement semaphore only if positive.     */
         OS_EXIT_CRITICAL();
@@ -330,7 +331,8 @@ void  OSSemPend (OS_EVENT  *pevent,
                                                       /* Otherwise, must wait until event occurs       */
     OSTCBCur->OSTCBStat     |= OS_STAT_SEM;           /* Resource not available, pend on semaphore     */
     OSTCBCur->OSTCBStatPend  = OS_STAT_PEND_OK;
-    OSTCBCur->OSTCBDly       = timeout;               /* Store pend timeout in TCB                     */
+    OS_TCB_DLY_SET(OSTCBCur, timeout);                /* Store pend timeout in TCB                     */
+    OS_TRACE_SEM_PEND_BLOCK(pevent);                  /* Record that the task is about to block        */
     OS_EventTaskWait(pevent);                         /* Suspend task until event or timeout occurs    */
     OS_EXIT_CRITICAL();
     OS_Sched();                                       /* Find next highest priority task ready         */
@@ -485,6 +487,7 @@ INT8U  OSSemPost (OS_EVENT *pevent)
         return (OS_ERR_EVENT_TYPE);
     }
     OS_ENTER_CRITICAL();
+    OS_TRACE_SEM_POST(pevent);                        /* Record post in trace buffer                   */
     if (pevent->OSEventGrp != 0u) {                   /* See if any task waiting for semaphore         */
                                                       /* Ready HPT waiting on event                    */
         (void)OS_EventTaskRdy(pevent, (void *)0, OS_STAT_SEM, OS_STAT_PEND_OK);
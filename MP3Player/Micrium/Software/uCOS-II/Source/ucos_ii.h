@@ -45,6 +45,37 @@ extern "C" {
 #include <os_cfg.h>
 #include <os_cpu.h>
 
+/*
+*********************************************************************************************************
+*                                          KERNEL EVENT TRACE
+*
+* Note(s) : 1) When OS_TRACE_EN is 0 (or not defined in OS_CFG.H) the trace points compile to nothing.
+*           2) The recorder itself lives in trace.c/trace.h (see Util\).
+*********************************************************************************************************
+*/
+
+#ifndef  OS_TRACE_EN
+#define  OS_TRACE_EN                    0u
+#endif
+
+#if OS_TRACE_EN > 0u
+#include <trace.h>
+#else
+#define  OS_TRACE_INIT()
+#define  OS_TRACE_TASK_SWITCHED_IN(ptcb)
+#define  OS_TRACE_ISR_ENTER()
+#define  OS_TRACE_ISR_EXIT()
+#define  OS_TRACE_SEM_PEND(pevent)
+#define  OS_TRACE_SEM_PEND_BLOCK(pevent)
+#define  OS_TRACE_SEM_POST(pevent)
+#define  OS_TRACE_Q_PEND(pevent)
+#define  OS_TRACE_Q_PEND_BLOCK(pevent)
+#define  OS_TRACE_Q_POST(pevent)
+#define  OS_TRACE_MBOX_PEND(pevent)
+#define  OS_TRACE_MBOX_PEND_BLOCK(pevent)
+#define  OS_TRACE_MBOX_POST(pevent)
+#endif
+
 /*
 *********************************************************************************************************
 *                                             MISCELLANEOUS
@@ -565,6 +596,11 @@ typedef struct os_tcb {
 #endif
 
     INT32U           OSTCBDly;              /* Nbr ticks to delay task or, timeout waiting for event   */
+#if OS_TICK_DLY_LIST_EN > 0u
+    struct os_tcb   *OSTCBDlyNext;          /* Pointer to next     TCB in the delta list of delayed TCBs */
+    struct os_tcb   *OSTCBDlyPrev;          /* Pointer to previous TCB in the delta list of delayed TCBs */
+    INT32U           OSTCBDlyDelta;         /* Nbr ticks after the previous TCB in the delta list        */
+#endif
     INT8U            OSTCBStat;             /* Task      status                                        */
     INT8U            OSTCBStatPend;         /* Task PEND status                                        */
     INT8U            OSTCBPrio;             /* Task priority (0 == highest)                            */
@@ -688,6 +724,9 @@ OS_EXT  OS_TCB           *OSTCBCur;                        /* Pointer to current
 OS_EXT  OS_TCB           *OSTCBFreeList;                   /* Pointer to list of free TCBs             */
 OS_EXT  OS_TCB           *OSTCBHighRdy;                    /* Pointer to highest priority TCB R-to-R   */
 OS_EXT  OS_TCB           *OSTCBList;                       /* Pointer to doubly linked list of TCBs    */
+#if OS_TICK_DLY_LIST_EN > 0u
+OS_EXT  OS_TCB           *OSTCBDlyList;                    /* Delta list of delayed TCBs, soonest first */
+#endif
 OS_EXT  OS_TCB           *OSTCBPrioTbl[OS_LOWEST_PRIO + 1u];    /* Table of pointers to created TCBs   */
 OS_EXT  OS_TCB            OSTCBTbl[OS_MAX_TASKS + OS_N_SYS_TASKS];   /* Table of TCBs                  */
 
@@ -1135,6 +1174,11 @@ void          OSTimeSet               (INT32U           ticks);
 
 void          OSTimeTick              (void);
 
+#if OS_TICKLESS_EN > 0u
+INT32U        OSTimeNextWake          (void);
+void          OSTimeTickN             (INT32U           ticks);
+#endif
+
 /*
 *********************************************************************************************************
 *                                            TIMER MANAGEMENT
@@ -1260,6 +1304,13 @@ void          OS_Sched                (void);
 INT8U         OS_StrLen               (INT8U           *psrc);
 #endif
 
+#if OS_TICK_DLY_LIST_EN > 0u
+void          OS_TickListInsert       (OS_TCB          *ptcb,
+                                       INT32U           ticks);
+
+void          OS_TickListRemove       (OS_TCB          *ptcb);
+#endif
+
 void          OS_TaskIdle             (void            *p_arg);
 
 void          OS_TaskReturn           (void);
@@ -1290,6 +1341,30 @@ INT8U         OS_TCBInit              (INT8U            prio,
 void          OSTmr_Init              (void);
 #endif
 
+/*$PAGE*/
+/*
+*********************************************************************************************************
+*                                       TASK DELAY / TIMEOUT ACCESS
+*
+* Note(s) : 1) All writes to OSTCBDly go through these macros so that, with OS_TICK_DLY_LIST_EN, the TCB is
+*              also linked into (or removed from) the delta list processed by OSTimeTick().
+*
+*           2) With OS_TICK_DLY_LIST_EN, OSTCBDly holds the delay the task was given and is only meaningful
+*              as zero (not delayed) or non-zero (delayed).  The remaining ticks are the sum of the
+*              OSTCBDlyDelta fields from the head of OSTCBDlyList up to the TCB.
+*
+*           3) Must be invoked with interrupts disabled.
+*********************************************************************************************************
+*/
+
+#if OS_TICK_DLY_LIST_EN > 0u
+#define  OS_TCB_DLY_SET(ptcb, ticks)    OS_TickListInsert((ptcb), (ticks))
+#define  OS_TCB_DLY_CLR(ptcb)           OS_TickListRemove(ptcb)
+#else
+#define  OS_TCB_DLY_SET(ptcb, ticks)    (ptcb)->OSTCBDly = (ticks)
+#define  OS_TCB_DLY_CLR(ptcb)           (ptcb)->OSTCBDly = 0u
+#endif
+
 /*$PAGE*/
 /*
 *********************************************************************************************************
@@ -1801,6 +1876,16 @@ void          OSCtxSw                 (void);
 #endif
 
 
+#ifndef OS_TICK_DLY_LIST_EN
+#error  "OS_CFG.H, Missing OS_TICK_DLY_LIST_EN: Keep delayed tasks in a delta list instead of scanning all TCBs"
+#endif
+
+
+#ifndef OS_TICKLESS_EN
+#error  "OS_CFG.H, Missing OS_TICKLESS_EN: Include OSTimeNextWake() and OSTimeTickN() for tickless idle"
+#endif
+
+
 #ifndef OS_TIME_TICK_HOOK_EN
 #error  "OS_CFG.H, Missing OS_TIME_TICK_HOOK_EN: Allows you to include the code for OSTimeTickHook() or not"
 #endif
@@ -11,26 +11,329 @@
 #include "bsp.h"
 #include "pjdf.h"
 #include "pjdfInternal.h"
+#ifdef PJDF_SIM
+#include "sim.h"
+#endif
 
-static char *DeviceDriverIDs [] =
+static const char *DeviceDriverIDs [] =
 {
     PJDF_DEVICE_IDS
 };
 
-#define MAXDEVICES (sizeof(DeviceDriverIDs)/sizeof(char*))
+#define MAXDEVICES ((int)(sizeof(DeviceDriverIDs)/sizeof(const char*)))
 
 
 // DRIVER TODO: add the reference to your driver's pName and Init() function here:
 // IMPORTANT: maintain the same order as in PJDF_DEVICE_IDS
+// PJDF_SIM (Linux build, Host/sim.h): the buses are simulated, the drivers
+// on top of them are the real ones.
 static DriverInternal driversInternal[MAXDEVICES] = 
 {
+#ifdef PJDF_SIM
+    {PJDF_DEVICE_ID_SPI1, InitSPISim},
+#else
     {PJDF_DEVICE_ID_SPI1, InitSPI},
+#endif
     {PJDF_DEVICE_ID_MP3_VS1053, InitMp3VS1053},
     {PJDF_DEVICE_ID_LCD_ILI9341, InitLcdILI9341},
     {PJDF_DEVICE_ID_SD_ADAFRUIT, InitSDAdafruit},
+#ifdef PJDF_SIM
+    {PJDF_DEVICE_ID_I2C, InitI2CSim},
+#else
     {PJDF_DEVICE_ID_I2C, InitI2C},
+#endif
 };
 
+#define PJDF_OP_READ  0
+#define PJDF_OP_WRITE 1
+#define PJDF_OP_IOCTL 2
+
+
+// Count a call of the driver's method for op that started at CYCLE_COUNT() start
+static void PjdfAccount(DriverInternal *pDriver, INT8U op, INT32U start, PjdfErrCode retval, INT32U bytes)
+{
+    PjdfDeviceStats *pStats = &pDriver->stats;
+    INT32U us = ClockElapsedUs(start);
+#if OS_CRITICAL_METHOD == 3u
+    OS_CPU_SR cpu_sr = 0u;
+#endif
+
+    OS_ENTER_CRITICAL();
+    if (PJDF_IS_ERROR(retval))
+    {
+        pStats->errors++;
+        bytes = 0;
+    }
+    switch (op)
+    {
+    case PJDF_OP_READ:
+        pStats->reads++;
+        pStats->bytesRead += bytes;
+        break;
+    case PJDF_OP_WRITE:
+        pStats->writes++;
+        pStats->bytesWritten += bytes;
+        break;
+    default:
+        pStats->ioctls++;
+        break;
+    }
+    pStats->busyUs += us;
+    if (us > pStats->maxBusyUs) pStats->maxBusyUs = us;
+    OS_EXIT_CRITICAL();
+}
+
+// Count time spent waiting for the device since CYCLE_COUNT() start
+static void PjdfAccountWait(DriverInternal *pDriver, INT32U start)
+{
+    INT32U us = ClockElapsedUs(start);
+#if OS_CRITICAL_METHOD == 3u
+    OS_CPU_SR cpu_sr = 0u;
+#endif
+
+    OS_ENTER_CRITICAL();
+    pDriver->stats.waitUs += us;
+    OS_EXIT_CRITICAL();
+}
+
+
+// Signal completion of pRequest. The caller may reuse the descriptor as
+// soon as pending is clear, so the notification fields are read first.
+static void PjdfComplete(PjdfRequest *pRequest)
+{
+    OS_EVENT *pDoneSem = pRequest->pDoneSem;
+#if OS_FLAG_EN > 0u
+    OS_FLAG_GRP *pDoneFlags = pRequest->pDoneFlags;
+    OS_FLAGS doneFlags = pRequest->doneFlags;
+    INT8U osErr;
+#endif
+    void (*Done)(PjdfRequest *pRequest) = pRequest->Done;
+
+    if (Done != NULL)
+    {
+        Done(pRequest);
+    }
+    pRequest->pending = OS_FALSE;
+    if (pDoneSem != NULL)
+    {
+        OSSemPost(pDoneSem);
+    }
+#if OS_FLAG_EN > 0u
+    if (pDoneFlags != NULL)
+    {
+        OSFlagPost(pDoneFlags, doneFlags, OS_FLAG_SET, &osErr);
+    }
+#endif
+}
+
+// Run pRequest with the driver's synchronous method
+static void PjdfRun(DriverInternal *pDriver, PjdfRequest *pRequest)
+{
+    INT32U start = CYCLE_COUNT();
+
+    if (pRequest->op == PJDF_OP_READ)
+    {
+        pRequest->result = pDriver->Read(pDriver, pRequest->pBuffer, &pRequest->length);
+    }
+    else
+    {
+        pRequest->result = pDriver->Write(pDriver, pRequest->pBuffer, &pRequest->length);
+    }
+    PjdfAccount(pDriver, pRequest->op, start, pRequest->result, pRequest->length);
+}
+
+// PjdfIoTask
+// Serves the request queue of one device, see PjdfAsyncInit(). A request
+// stays at the head of the queue while it runs so a drain waits for it.
+static void PjdfIoTask(void *pArg)
+{
+    DriverInternal *pDriver = (DriverInternal*) pArg;
+    PjdfAsyncQueue *pQueue = pDriver->pAsync;
+    PjdfRequest *pRequest;
+    INT8U osErr;
+    INT8U waiters;
+#if OS_CRITICAL_METHOD == 3u
+    OS_CPU_SR cpu_sr = 0u;
+#endif
+
+    while (1)
+    {
+        OSSemPend(pQueue->sem, 0, &osErr);
+        if (osErr != OS_ERR_NONE) while (1);
+
+        pRequest = pQueue->pHead;
+        PjdfRun(pDriver, pRequest);
+
+        OS_ENTER_CRITICAL();
+        pQueue->pHead = pRequest->pNext;
+        if (pQueue->pHead == NULL) pQueue->pTail = NULL;
+        pQueue->depth--;
+        waiters = 0;
+        if (pQueue->drainWaiters > 0 && --pQueue->drainCount == 0)
+        {
+            waiters = pQueue->drainWaiters;
+            pQueue->drainWaiters = 0;
+        }
+        OS_EXIT_CRITICAL();
+
+        PjdfComplete(pRequest);
+        while (waiters-- > 0)
+        {
+            OSSemPost(pQueue->drained);
+        }
+    }
+}
+
+// Queue pRequest for the I/O task of the device
+static PjdfErrCode PjdfAsyncSubmit(DriverInternal *pDriver, PjdfRequest *pRequest)
+{
+    PjdfAsyncQueue *pQueue = pDriver->pAsync;
+#if OS_CRITICAL_METHOD == 3u
+    OS_CPU_SR cpu_sr = 0u;
+#endif
+
+    pRequest->pNext = NULL;
+    OS_ENTER_CRITICAL();
+    if (pQueue->pTail == NULL)
+    {
+        pQueue->pHead = pRequest;
+    }
+    else
+    {
+        pQueue->pTail->pNext = pRequest;
+    }
+    pQueue->pTail = pRequest;
+    pQueue->depth++;
+    if (pQueue->depth > pQueue->maxDepth) pQueue->maxDepth = pQueue->depth;
+    OS_EXIT_CRITICAL();
+
+    if (OSSemPost(pQueue->sem) != OS_ERR_NONE) while (1);
+    return PJDF_ERR_NONE;
+}
+
+// Wait until the requests queued on the device so far are done. Ones queued
+// while waiting do not count: a higher priority task that keeps the queue
+// full, like Mp3SDTask streaming, would hold a lower priority one up for
+// as long as it does. Not from its own I/O task (a Done callback), which
+// would wait for itself.
+static void PjdfAsyncDrain(DriverInternal *pDriver)
+{
+    PjdfAsyncQueue *pQueue = pDriver->pAsync;
+    BOOLEAN wait = OS_FALSE;
+    INT8U osErr;
+#if OS_CRITICAL_METHOD == 3u
+    OS_CPU_SR cpu_sr = 0u;
+#endif
+
+    if (pQueue == NULL) return;
+    if (OSTCBCur->OSTCBPrio == pQueue->prio)
+        while (1);
+    OS_ENTER_CRITICAL();
+    if (pQueue->depth > 0)
+    {
+        pQueue->drainWaiters++;
+        pQueue->drainCount = pQueue->depth;    // the earlier waiters' ones included
+        wait = OS_TRUE;
+    }
+    OS_EXIT_CRITICAL();
+    if (wait)
+    {
+        INT32U start = CYCLE_COUNT();
+        OSSemPend(pQueue->drained, 0, &osErr);
+        if (osErr != OS_ERR_NONE) while (1);
+        PjdfAccountWait(pDriver, start);
+    }
+}
+
+/*
+ NAME:
+   PjdfAsyncInit
+ PURPOSE:
+   Give a device a request queue and an I/O task that serves it with the
+   driver's Read() and Write(), so ReadAsync() and WriteAsync() return at
+   once. Called from the driver's Init(), before OSStart() or from a task.
+ */
+void PjdfAsyncInit(DriverInternal *pDriver, PjdfAsyncQueue *pQueue, OS_STK *pStkTop, INT8U prio)
+{
+    INT8U osErr;
+
+    memset(pQueue, 0, sizeof(*pQueue));
+    pQueue->sem = OSSemCreate(0);
+    pQueue->drained = OSSemCreate(0);
+    if (pQueue->sem == NULL || pQueue->drained == NULL) while (1);  // not enough semaphores available
+    pQueue->prio = prio;
+
+    pDriver->pAsync = pQueue;
+    pDriver->ReadAsync = PjdfAsyncSubmit;
+    pDriver->WriteAsync = PjdfAsyncSubmit;
+
+    if (OSTaskCreate(PjdfIoTask, (void*)pDriver, pStkTop, prio) != OS_ERR_NONE) while (1);
+    OSTaskNameSet(prio, (INT8U*)pDriver->pName, &osErr);
+}
+
+// PJDF_CTRL_GET_STATS and PJDF_CTRL_CLR_STATS, for any device
+static PjdfErrCode PjdfStatsIoctl(DriverInternal *pDriver, INT8U request, void* pArgs, INT32U* pSize)
+{
+#if OS_CRITICAL_METHOD == 3u
+    OS_CPU_SR cpu_sr = 0u;
+#endif
+
+    if (request == PJDF_CTRL_GET_STATS)
+    {
+        if (pArgs == NULL || pSize == NULL || *pSize < sizeof(PjdfDeviceStats)) return PJDF_ERR_ARG;
+        OS_ENTER_CRITICAL();
+        *(PjdfDeviceStats*)pArgs = pDriver->stats;
+        OS_EXIT_CRITICAL();
+        *pSize = sizeof(PjdfDeviceStats);
+    }
+    else
+    {
+        OS_ENTER_CRITICAL();
+        memset(&pDriver->stats, 0, sizeof(pDriver->stats));
+        OS_EXIT_CRITICAL();
+    }
+    return PJDF_ERR_NONE;
+}
+
+/*
+ NAME:
+   PjdfGetStatsAt
+ PURPOSE:
+   Copy the counters of the index-th device, whether it is open or not,
+   for diagnostics such as the shell.
+ RETURN:
+   The device name, or NULL if there is no such device.
+ */
+const char *PjdfGetStatsAt(INT8U index, PjdfDeviceStats *pStats)
+{
+    INT32U size = sizeof(*pStats);
+
+    if (index >= MAXDEVICES) return NULL;
+    PjdfStatsIoctl(&driversInternal[index], PJDF_CTRL_GET_STATS, pStats, &size);
+    return driversInternal[index].pName;
+}
+
+// Clear the counters of every device
+void PjdfClearStats(void)
+{
+    INT8U i;
+
+    for (i = 0; i < MAXDEVICES; i++)
+    {
+        PjdfStatsIoctl(&driversInternal[i], PJDF_CTRL_CLR_STATS, NULL, NULL);
+    }
+}
+
+#ifdef PJDF_SIM
+// For the host report, which runs outside the uC/OS tasks, see sim.h
+SIM_UNLOCKED_READ const char *SimPjdfStats(INT8U index, PjdfDeviceStats *pStats)
+{
+    if (index >= MAXDEVICES) return NULL;
+    memcpy(pStats, &driversInternal[index].stats, sizeof(*pStats));
+    return driversInternal[index].pName;
+}
+#endif
+
 
 // Opens a handle to the specified device.
 // pName: the identifier of the device chosen from PJDF_DEVICE_IDS.
@@ -38,11 +341,12 @@ static DriverInternal driversInternal[MAXDEVICES] =
 // Returns: if no error occured, a valid handle is returned which may be used to
 //    operate on the device. If an error occurs, an error code is returned. 
 //    Valid handles are positive numbers; error codes are negative numbers.
-HANDLE Open(char *pName, INT8U flags)
+HANDLE Open(const char *pName, INT8U flags)
 {
     HANDLE retval;
     int i;
     DriverInternal *pDriver;
+    INT32U start;
     INT8U osErr;
     
     for (i = 0, pDriver = &driversInternal[0]; i < MAXDEVICES; i++, pDriver++)
@@ -52,8 +356,10 @@ HANDLE Open(char *pName, INT8U flags)
             // We found the device.
 
             // Enter a critical section to increment the device reference count and call device specific Open()
+            start = CYCLE_COUNT();
             OSSemPend(pDriver->sem, 0, &osErr);
             if (osErr != OS_ERR_NONE) while (1);
+            PjdfAccountWait(pDriver, start);
             if (pDriver->refCount < pDriver->maxRefCount)
             {
                 pDriver->refCount += 1;
@@ -93,6 +399,7 @@ PjdfErrCode Close(HANDLE handle)
     PjdfErrCode retval;
     DriverInternal *pDriver;
     INT8U osErr;
+    INT32U start;
     
     if (handle <= 0 || handle > MAXDEVICES)
     {
@@ -107,9 +414,13 @@ PjdfErrCode Close(HANDLE handle)
         while (1);
     }
     
+    PjdfAsyncDrain(pDriver);
+    
     // Enter a critical section to call device specific Close() and decrement the device reference count
+    start = CYCLE_COUNT();
     OSSemPend(pDriver->sem, 0, &osErr);
     if (osErr != OS_ERR_NONE) while (1);
+    PjdfAccountWait(pDriver, start);
     
     if (pDriver->refCount == 0)
     {
@@ -133,6 +444,7 @@ PjdfErrCode Read(HANDLE handle, void* pBuffer, INT32U* pLength)
 {
     PjdfErrCode retval;
     DriverInternal *pDriver;
+    INT32U start;
     if (handle <= 0 || handle > MAXDEVICES)
     {
         retval = PJDF_ERR_INVALID_HANDLE;
@@ -145,7 +457,10 @@ PjdfErrCode Read(HANDLE handle, void* pBuffer, INT32U* pLength)
         retval = PJDF_ERR_DEVICE_NOT_INIT;
         while (1);
     }
+    PjdfAsyncDrain(pDriver);
+    start = CYCLE_COUNT();
     retval = pDriver->Read(pDriver, pBuffer, pLength);
+    PjdfAccount(pDriver, PJDF_OP_READ, start, retval, *pLength);
     return retval;
 }
 
@@ -153,6 +468,7 @@ PjdfErrCode Write(HANDLE handle, void* pBuffer, INT32U* pLength)
 {
     PjdfErrCode retval;
     DriverInternal *pDriver;
+    INT32U start;
     if (handle <= 0 || handle > MAXDEVICES)
     {
         retval = PJDF_ERR_INVALID_HANDLE;
@@ -165,7 +481,10 @@ PjdfErrCode Write(HANDLE handle, void* pBuffer, INT32U* pLength)
         retval = PJDF_ERR_DEVICE_NOT_INIT;
         while (1);
     }
+    PjdfAsyncDrain(pDriver);
+    start = CYCLE_COUNT();
     retval = pDriver->Write(pDriver, pBuffer, pLength);
+    PjdfAccount(pDriver, PJDF_OP_WRITE, start, retval, *pLength);
     return retval;
 }
 
@@ -173,6 +492,7 @@ PjdfErrCode Ioctl(HANDLE handle, INT8U request, void* pArgs, INT32U* pSize)
 {
     PjdfErrCode retval;
     DriverInternal *pDriver;
+    INT32U start;
     if (handle <= 0 || handle > MAXDEVICES)
     {
         retval = PJDF_ERR_INVALID_HANDLE;
@@ -185,10 +505,103 @@ PjdfErrCode Ioctl(HANDLE handle, INT8U request, void* pArgs, INT32U* pSize)
         retval = PJDF_ERR_DEVICE_NOT_INIT;
         while (1);
     }
+    if (request == PJDF_CTRL_GET_STATS || request == PJDF_CTRL_CLR_STATS)
+    {
+        return PjdfStatsIoctl(pDriver, request, pArgs, pSize);
+    }
+    PjdfAsyncDrain(pDriver);
+    start = CYCLE_COUNT();
     retval = pDriver->Ioctl(pDriver, request, pArgs, pSize);
+    PjdfAccount(pDriver, PJDF_OP_IOCTL, start, retval, 0);
     return retval;
 }
 
+PjdfErrCode WriteV(HANDLE handle, const PjdfSegment *pSegments, INT8U count)
+{
+    PjdfErrCode retval = PJDF_ERR_NONE;
+    DriverInternal *pDriver;
+    INT32U length;
+    INT32U bytes = 0;
+    INT32U start;
+    INT8U i;
+    if (handle <= 0 || handle > MAXDEVICES)
+    {
+        retval = PJDF_ERR_INVALID_HANDLE;
+        while (1);
+    }
+    
+    pDriver = &driversInternal[handle-1];
+    if (!pDriver->initialized)
+    {
+        retval = PJDF_ERR_DEVICE_NOT_INIT;
+        while (1);
+    }
+    PjdfAsyncDrain(pDriver);
+    start = CYCLE_COUNT();
+    if (pDriver->WriteV != NULL)
+    {
+        retval = pDriver->WriteV(pDriver, pSegments, count);
+        for (i = 0; i < count; i++) bytes += pSegments[i].length;
+    }
+    else
+    {
+        // No command interface: data segments only, then one Write() each
+        for (i = 0; i < count; i++)
+        {
+            if (pSegments[i].mode != PJDF_SEG_DATA) retval = PJDF_ERR_UNSUPPORTED;
+        }
+        for (i = 0; i < count && !PJDF_IS_ERROR(retval); i++)
+        {
+            length = pSegments[i].length;
+            retval = pDriver->Write(pDriver, pSegments[i].pData, &length);
+            bytes += length;
+        }
+    }
+    PjdfAccount(pDriver, PJDF_OP_WRITE, start, retval, bytes);
+    return retval;
+}
+
+// Submit pRequest as op, or run it here if the driver has no queue
+static PjdfErrCode PjdfSubmit(HANDLE handle, PjdfRequest *pRequest, INT8U op)
+{
+    PjdfErrCode (*Submit)(DriverInternal *pDriver, PjdfRequest *pRequest);
+    DriverInternal *pDriver;
+    if (handle <= 0 || handle > MAXDEVICES)
+    {
+        while (1);
+    }
+    
+    pDriver = &driversInternal[handle-1];
+    if (!pDriver->initialized)
+    {
+        while (1);
+    }
+    if (pRequest->pending) while (1); // still owned by PJDF
+    
+    pRequest->op = op;
+    pRequest->pending = OS_TRUE;
+    Submit = (op == PJDF_OP_READ) ? pDriver->ReadAsync : pDriver->WriteAsync;
+    if (Submit != NULL)
+    {
+        return Submit(pDriver, pRequest);
+    }
+    
+    // Synchronous fallback
+    PjdfRun(pDriver, pRequest);
+    PjdfComplete(pRequest);
+    return PJDF_ERR_NONE;
+}
+
+PjdfErrCode ReadAsync(HANDLE handle, PjdfRequest *pRequest)
+{
+    return PjdfSubmit(handle, pRequest, PJDF_OP_READ);
+}
+
+PjdfErrCode WriteAsync(HANDLE handle, PjdfRequest *pRequest)
+{
+    return PjdfSubmit(handle, pRequest, PJDF_OP_WRITE);
+}
+
 
 // InitPjdf
 // Initialize the device driver framework.
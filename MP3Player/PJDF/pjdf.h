@@ -18,6 +18,10 @@
 #include "pjdfCtrlMp3VS1053.h"
 #include "pjdfCtrlSDAdafruit.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 typedef INT8S HANDLE;
 #define PJDF_IS_VALID_HANDLE(x)  (x > 0) // A valid device driver handle is a positive number
 
@@ -60,15 +64,101 @@ typedef INT8S PjdfErrCode;
 #define PJDF_ERR_UNKNOWN_CTRL_REQUEST -6 // A given Ctrl request was not defined for the driver
 #define PJDF_ERR_CHIP_SELECT -7 // Incorrect chip selection or no chip selected
 #define PJDF_ERR_DEVICE_NOT_OPEN -8 // Attempted operation on device that is not open
+#define PJDF_ERR_UNSUPPORTED -9 // The device cannot do what was asked of it
+
+// Descriptor of an asynchronous Read or Write, see ReadAsync() and
+// WriteAsync(). The caller owns it and the buffer; neither may be touched
+// from submission until the request completes.
+typedef struct _PjdfRequest PjdfRequest;
+struct _PjdfRequest
+{
+    void *pBuffer;          // data to write, or where to read to
+    INT32U length;          // bytes to transfer; on completion the bytes transferred
+    PjdfErrCode result;     // set on completion
+
+    // Completion notification: any of these that are set, in this order
+    void (*Done)(PjdfRequest *pRequest); // called from the task that completed the request
+    void *pUser;            // for Done
+    OS_EVENT *pDoneSem;     // semaphore posted
+#if OS_FLAG_EN > 0u
+    OS_FLAG_GRP *pDoneFlags; // flags doneFlags set
+    OS_FLAGS doneFlags;
+#endif
+
+    volatile BOOLEAN pending; // OS_TRUE from submission to completion
+
+    // Used by PJDF
+    INT8U op;
+    PjdfRequest *pNext;
+};
+
+// One segment of a WriteV(): length bytes at pData for the device's command
+// or data interface (the D/C line of the ILI9341, SCI or SDI of the VS1053)
+#define PJDF_SEG_DATA     0
+#define PJDF_SEG_COMMAND  1
+
+typedef struct _PjdfSegment
+{
+    void *pData;
+    INT32U length;
+    INT8U mode;             // PJDF_SEG_DATA or PJDF_SEG_COMMAND
+} PjdfSegment;
 
 // Generic API methods exposed to applications for operating on devices
-HANDLE Open(char *pName, INT8U flags);
+HANDLE Open(const char *pName, INT8U flags);
 PjdfErrCode Close(HANDLE handle);
 PjdfErrCode Read(HANDLE handle, void* pBuffer, INT32U* pLength);
 PjdfErrCode Write(HANDLE handle, void* pBuffer, INT32U* pLength);
 PjdfErrCode Ioctl(HANDLE handle, INT8U request, void* pArgs, INT32U* pSize);
 
+// Vectored Write: send count segments as one transaction, under one hold of
+// the bus and, where the device allows it, one chip-select assertion. The
+// command or data selection made with Ioctl() is the same afterwards.
+// Devices without a command interface take data segments only: with a
+// command segment among them, nothing is sent and the result is
+// PJDF_ERR_UNSUPPORTED.
+PjdfErrCode WriteV(HANDLE handle, const PjdfSegment *pSegments, INT8U count);
+
+// Counters kept for every device by Read(), Write(), WriteV(), Ioctl() and
+// the asynchronous requests. Read them with Ioctl() on any device, or
+// without a handle with PjdfGetStatsAt(). Times are in microseconds,
+// measured with the DWT cycle counter.
+#define PJDF_CTRL_GET_STATS  0xF0   // pArgs: PjdfDeviceStats to copy them to
+#define PJDF_CTRL_CLR_STATS  0xF1   // pArgs: not used
+
+typedef struct _PjdfDeviceStats
+{
+    INT32U reads;           // Read() and ReadAsync()
+    INT32U writes;          // Write(), WriteV() and WriteAsync()
+    INT32U ioctls;
+    INT32U errors;          // calls that returned an error
+    uint64_t bytesRead;
+    uint64_t bytesWritten;
+    uint64_t busyUs;        // time in the driver, bus lock waits included
+    INT32U maxBusyUs;       // longest single call
+    uint64_t waitUs;        // time waiting for the device before the driver ran:
+                            // for its queued requests, or to Open() or Close() it
+} PjdfDeviceStats;
+
+// Counters of the index-th device; returns its name, NULL past the last one
+const char *PjdfGetStatsAt(INT8U index, PjdfDeviceStats *pStats);
+void PjdfClearStats(void);
+
+// Asynchronous Read and Write: queue the request and return. Requests to
+// a device complete in the order submitted. Read, Write, WriteV, Ioctl and
+// Close on the device first wait for the requests queued so far, so they
+// never overtake queued data (nor may a Done callback call them for the
+// same device).
+// Devices without an asynchronous implementation complete the request
+// before returning.
+PjdfErrCode ReadAsync(HANDLE handle, PjdfRequest *pRequest);
+PjdfErrCode WriteAsync(HANDLE handle, PjdfRequest *pRequest);
+
 // Method called by the OS to initialize the driver framework
 PjdfErrCode InitPjdf();
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,111 @@
+/*
+    pjdfBind.h
+    Compile-time binding of the hot device paths: the byte transfers of the
+    SD card library and the ILI9341 command/data selection, both made for
+    every byte or two that goes over SPI1.
+
+    PJDF_BIND_DIRECT 0 (default): through the PJDF handle, Read(), Write()
+        and Ioctl() as everywhere else, with the driver checks and counters.
+    PJDF_BIND_DIRECT 1: inlined register access. Bus arbitration does not
+        change: the SPI lock, the bus profile and the chip-select are still
+        taken through PJDF, once per transaction (PJDF_CTRL_SD_LOCK_SPI,
+        WriteLCD()), only the calls in between skip the device table, the
+        function pointers and the checks. Such transfers are not in the
+        PJDF_CTRL_GET_STATS counters.
+
+    Set it with the compiler's preprocessor defines (the Linux build:
+    make BIND=direct). Tools/bindbench.py compares the two.
+*/
+
+#ifndef __PJDFBIND_H__
+#define __PJDFBIND_H__
+
+#include "bsp.h"
+
+#ifndef PJDF_BIND_DIRECT
+#define PJDF_BIND_DIRECT 0
+#endif
+
+#if PJDF_BIND_DIRECT
+
+#ifdef BSP_HOST
+// The host BSP hands the bytes to the simulated bus, see Host/bspSpi.c
+#define BindSpiSend(pData, length)      SPI_SendBuffer(PJDF_SPI1, pData, length)
+#define BindSpiTransfer(pData, length)  SPI_GetBuffer(PJDF_SPI1, pData, length)
+#else
+// SPI_SendBuffer() and SPI_GetBuffer() of bspSpi.c, inlined
+static inline void BindSpiSend(uint8_t *pData, uint32_t length)
+{
+    while (length--)
+    {
+        while (!LL_SPI_IsActiveFlag_TXE(PJDF_SPI1));
+        LL_SPI_TransmitData8(PJDF_SPI1, *pData++);
+        while (!LL_SPI_IsActiveFlag_RXNE(PJDF_SPI1));
+        LL_SPI_ReceiveData8(PJDF_SPI1);
+    }
+}
+
+static inline void BindSpiTransfer(uint8_t *pData, uint32_t length)
+{
+    while (length--)
+    {
+        while (!LL_SPI_IsActiveFlag_TXE(PJDF_SPI1));
+        LL_SPI_TransmitData8(PJDF_SPI1, *pData);
+        while (!LL_SPI_IsActiveFlag_RXNE(PJDF_SPI1));
+        *pData++ = LL_SPI_ReceiveData8(PJDF_SPI1);
+    }
+}
+#endif
+
+// SD card, between PJDF_CTRL_SD_LOCK_SPI and PJDF_CTRL_SD_RELEASE_SPI
+static inline void BindSdSend(HANDLE hSD, uint8_t *pData, uint32_t length)
+{
+    (void)hSD;
+    BindSpiSend(pData, length);
+}
+
+// Full duplex: pData is sent and overwritten by what the card returns
+static inline void BindSdTransfer(HANDLE hSD, uint8_t *pData, uint32_t length)
+{
+    (void)hSD;
+    BindSpiTransfer(pData, length);
+}
+
+// ILI9341 D/C line, see PJDF_CTRL_LCD_SELECT_COMMAND and _DATA
+static inline void BindLcdSelectCommand(HANDLE hLcd)
+{
+    (void)hLcd;
+    LCD_ILI9341_DC_LOW();
+}
+
+static inline void BindLcdSelectData(HANDLE hLcd)
+{
+    (void)hLcd;
+    LCD_ILI9341_DC_HIGH();
+}
+
+#else
+
+static inline void BindSdSend(HANDLE hSD, uint8_t *pData, uint32_t length)
+{
+    Write(hSD, pData, &length);
+}
+
+static inline void BindSdTransfer(HANDLE hSD, uint8_t *pData, uint32_t length)
+{
+    Read(hSD, pData, &length);
+}
+
+static inline void BindLcdSelectCommand(HANDLE hLcd)
+{
+    Ioctl(hLcd, PJDF_CTRL_LCD_SELECT_COMMAND, 0, 0);
+}
+
+static inline void BindLcdSelectData(HANDLE hLcd)
+{
+    Ioctl(hLcd, PJDF_CTRL_LCD_SELECT_DATA, 0, 0);
+}
+
+#endif
+
+#endif
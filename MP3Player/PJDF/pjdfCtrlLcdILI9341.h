@@ -19,4 +19,9 @@
 
 #define PJDF_CTRL_LCD_SET_SPI_HANDLE 0x3  // Passes the required SPI handle to the LCD driver to enable it to talk to the ILI9341
 
+// Longest run of bytes sent under one hold of the SPI lock. Between runs
+// Write() and WriteV() let a waiting higher priority task (the MP3 feeder)
+// have the bus: it waits for at most this many bytes of the LCD's.
+#define LCD_SPI_HOLD_MAX  512
+
 #endif
\ No newline at end of file
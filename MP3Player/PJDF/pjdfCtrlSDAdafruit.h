@@ -18,5 +18,6 @@
 #define PJDF_CTRL_SD_RELEASE_SPI 0x4  // Release exclusive access to the SD's SPI
 
 #define PJDF_CTRL_SD_SET_SPI_HANDLE 0x5  // Passes the required SPI handle to the SD driver to enable it to talk to the SD card
+#define PJDF_CTRL_SD_SET_MAX_HZ 0x6  // With the SPI locked: INT32U SCK limit in, the SCK it gives at the current clock out; applies from the next lock
 
 #endif
\ No newline at end of file
@@ -13,8 +13,54 @@
 
 // Control definitions for SPI1
 
-#define PJDF_CTRL_SPI_WAIT_FOR_LOCK  0x01   // Wait for exclusive access to SPI, then lock it
-#define PJDF_CTRL_SPI_RELEASE_LOCK   0x02   // Release exclusive SPI lock
-#define PJDF_CTRL_SPI_SET_DATARATE   0x03   // Set transmission rate of the SPI interface
+#define PJDF_CTRL_SPI_WAIT_FOR_LOCK     0x01   // Wait for exclusive access to SPI, then lock it
+#define PJDF_CTRL_SPI_RELEASE_LOCK      0x02   // Release exclusive SPI lock
+#define PJDF_CTRL_SPI_SET_DATARATE      0x03   // Set transmission rate of the SPI interface
+#define PJDF_CTRL_SPI_YIELD_LOCK        0x04   // Hand the lock to a higher priority waiter, then lock again
+#define PJDF_CTRL_SPI_GET_LOCK_STATS    0x05   // Copy out PjdfSpiLockStats[PJDF_SPI_CLIENT_COUNT]
+#define PJDF_CTRL_SPI_CLR_LOCK_STATS    0x06   // Zero the lock statistics
+#define PJDF_CTRL_SPI_REGISTER_PROFILE  0x07   // Register the PjdfSpiProfile of a client
+#define PJDF_CTRL_SPI_SELECT_PROFILE    0x08   // Configure the bus for a client (INT8U), if it is not already
+#define PJDF_CTRL_SPI_GET_PROFILE_STATS 0x09   // Copy out PjdfSpiProfileStats[PJDF_SPI_CLIENT_COUNT]
+
+// Clients of the SPI lock. PJDF_CTRL_SPI_WAIT_FOR_LOCK takes one as an INT8U
+// in pArgs so the statistics are kept per client; with pArgs NULL the
+// client is PJDF_SPI_CLIENT_OTHER.
+#define PJDF_SPI_CLIENT_OTHER   0
+#define PJDF_SPI_CLIENT_MP3     1
+#define PJDF_SPI_CLIENT_LCD     2
+#define PJDF_SPI_CLIENT_SD      3
+#define PJDF_SPI_CLIENT_COUNT   4
+
+// Lock statistics of one client. Times are in microseconds at the
+// SystemCoreClock in effect when they are taken.
+typedef struct _PjdfSpiLockStats
+{
+    INT32U locks;           // times the client got the lock
+    INT32U contended;       // of those, the times it had to wait for it
+    INT32U yields;          // times it handed the lock over with PJDF_CTRL_SPI_YIELD_LOCK
+    uint64_t waitUs;        // total time spent waiting
+    INT32U maxWaitUs;
+    INT32U maxHoldUs;       // longest time between getting and releasing the lock
+} PjdfSpiLockStats;
+
+// Bus configuration of a client, registered once with
+// PJDF_CTRL_SPI_REGISTER_PROFILE. Selecting it with the lock held before a
+// transfer costs a comparison unless another client used the bus meanwhile
+// or the clock changed.
+typedef struct _PjdfSpiProfile
+{
+    INT8U client;           // PJDF_SPI_CLIENT_xxx
+    INT8U rate;             // SPI_RATE_xxx: the prescaler follows the clock, see SPI_UpdateDataRates()
+    INT8U dataWidth;        // bits per frame, 8 or 16
+    INT8U mode;             // SPI mode 0-3: CPOL in bit 1, CPHA in bit 0
+    BOOLEAN dma;            // DMA requests enabled
+} PjdfSpiProfile;
+
+typedef struct _PjdfSpiProfileStats
+{
+    INT32U selects;         // PJDF_CTRL_SPI_SELECT_PROFILE requests
+    INT32U reconfigs;       // of those, the ones that reprogrammed the bus
+} PjdfSpiProfileStats;
 
 #endif
\ No newline at end of file
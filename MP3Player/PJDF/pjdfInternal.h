@@ -12,17 +12,35 @@
 
 #include "pjdf.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 struct _DriverInternal; // forward declaration
 typedef struct _DriverInternal DriverInternal; // forward declaration
 
+// Asynchronous request queue of a device, served by an I/O task of its own
+// with the device's Read() and Write(), see PjdfAsyncInit()
+typedef struct _PjdfAsyncQueue
+{
+    PjdfRequest *pHead;     // in progress or next
+    PjdfRequest *pTail;
+    OS_EVENT *sem;          // counts queued requests, pended by the I/O task
+    OS_EVENT *drained;      // posted to the drain waiters when drainCount are done
+    INT8U drainWaiters;
+    INT8U drainCount;       // requests ahead of the last drain waiter
+    INT8U prio;             // of the I/O task
+    INT8U depth;            // requests queued or in progress
+    INT8U maxDepth;         // high water mark of depth
+} PjdfAsyncQueue;
+
 // Device interface to be implemented by developers
 struct _DriverInternal
 {
-    char *pName;     // name used by applications and internally to identify the device
+    const char *pName; // name used by applications and internally to identify the device
     
     // Method for initializing the device driver before exposing it to applications
-    PjdfErrCode (*Init)(DriverInternal *pDriver, char *pName);
+    PjdfErrCode (*Init)(DriverInternal *pDriver, const char *pName);
     
     BOOLEAN initialized; // true if Init() ran successfully otherwise false.
     OS_EVENT *sem;  // semaphore to serialize operations on the device 
@@ -36,16 +54,78 @@ struct _DriverInternal
     PjdfErrCode (*Read)(DriverInternal *pDriver, void* pBuffer, INT32U* pCount);
     PjdfErrCode (*Write)(DriverInternal *pDriver, void* pBuffer, INT32U* pCount);
     PjdfErrCode (*Ioctl)(DriverInternal *pDriver, INT8U request, void* pArgs, INT32U* pSize);
+    // Optional, NULL means WriteV() writes the data segments with Write()
+    PjdfErrCode (*WriteV)(DriverInternal *pDriver, const PjdfSegment *pSegments, INT8U count);
+
+    // Optional asynchronous methods, set by PjdfAsyncInit(). NULL means
+    // ReadAsync()/WriteAsync() run Read()/Write() in the caller.
+    PjdfErrCode (*ReadAsync)(DriverInternal *pDriver, PjdfRequest *pRequest);
+    PjdfErrCode (*WriteAsync)(DriverInternal *pDriver, PjdfRequest *pRequest);
+    PjdfAsyncQueue *pAsync; // queue behind them
+
+    PjdfDeviceStats stats; // kept by pjdf.c, see PJDF_CTRL_GET_STATS
 };
 
+// For a driver's Init(), after its Read and Write are assigned: serve
+// ReadAsync() and WriteAsync() on the device from a request queue with an
+// I/O task at prio running on the given stack.
+void PjdfAsyncInit(DriverInternal *pDriver, PjdfAsyncQueue *pQueue, OS_STK *pStkTop, INT8U prio);
+
 
 // DRIVER TODO: add the prototype of your driver's Init() implementation here:
-PjdfErrCode InitSPI(DriverInternal *pDriver, char *pName);
-PjdfErrCode InitMp3VS1053(DriverInternal *pDriver, char *pName);
-PjdfErrCode InitLcdILI9341(DriverInternal *pDriver, char *pName);
-PjdfErrCode InitSDAdafruit(DriverInternal *pDriver, char *pName);
+PjdfErrCode InitSPI(DriverInternal *pDriver, const char *pName);
+PjdfErrCode InitMp3VS1053(DriverInternal *pDriver, const char *pName);
+PjdfErrCode InitLcdILI9341(DriverInternal *pDriver, const char *pName);
+PjdfErrCode InitSDAdafruit(DriverInternal *pDriver, const char *pName);
 
 // Touch Driver I2C to the Standard Driver Interface
-PjdfErrCode InitI2C(DriverInternal *pDriver, char *pName);
+PjdfErrCode InitI2C(DriverInternal *pDriver, const char *pName);
+
+// Lock of a shared SPI bus, see pjdfInternalSPI.c: a priority inheritance
+// mutex, so a low priority LCD transfer holding the bus runs at
+// APP_TASK_SPI_MUTEX_PRIO while the MP3 feeder waits for it, plus
+// statistics per client. Shared with the simulated bus of the Linux build.
+typedef struct _PjdfSpiLock
+{
+    OS_EVENT *mutex;
+    INT8U client;           // PJDF_SPI_CLIENT_xxx of the holder
+    INT32U lockedAt;        // CYCLE_COUNT() when the holder got the lock
+    PjdfSpiLockStats stats[PJDF_SPI_CLIENT_COUNT];
+} PjdfSpiLock;
+
+void SpiLockInit(PjdfSpiLock *pLock);
+// Handles the lock requests of pjdfCtrlSpi.h; returns OS_FALSE for the others
+BOOLEAN SpiLockIoctl(PjdfSpiLock *pLock, INT8U request, void* pArgs, INT32U* pSize);
+
+// Configuration profiles of a SPI bus, one per client, see pjdfInternalSPI.c.
+// Also shared with the simulated bus.
+typedef struct _PjdfSpiProfiles
+{
+    PjdfSpiProfile profiles[PJDF_SPI_CLIENT_COUNT];
+    BOOLEAN registered[PJDF_SPI_CLIENT_COUNT];
+    INT8U active;           // client the bus is configured for, PJDF_SPI_CLIENT_COUNT if none
+    INT16U prescaler;       // prescaler it was configured with
+    PjdfSpiProfileStats stats[PJDF_SPI_CLIENT_COUNT];
+} PjdfSpiProfiles;
+
+void SpiProfilesInit(PjdfSpiProfiles *pProfiles);
+// Handles PJDF_CTRL_SPI_REGISTER_PROFILE and PJDF_CTRL_SPI_GET_PROFILE_STATS;
+// returns OS_FALSE for the others
+BOOLEAN SpiProfilesIoctl(PjdfSpiProfiles *pProfiles, INT8U request, void* pArgs, INT32U* pSize);
+// For PJDF_CTRL_SPI_SELECT_PROFILE: the profile to program the bus with, or
+// NULL if the bus already has it. *pPrescaler is the prescaler for the clock.
+const PjdfSpiProfile *SpiProfileSelect(PjdfSpiProfiles *pProfiles, INT8U client, INT16U *pPrescaler);
+// The bus was reprogrammed without a profile (PJDF_CTRL_SPI_SET_DATARATE)
+void SpiProfilesInvalidate(PjdfSpiProfiles *pProfiles);
+
+#ifdef PJDF_SIM
+// Simulated buses of the Linux build, see Host/sim.h
+PjdfErrCode InitSPISim(DriverInternal *pDriver, const char *pName);
+PjdfErrCode InitI2CSim(DriverInternal *pDriver, const char *pName);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
\ No newline at end of file
@@ -162,7 +162,7 @@ static PjdfErrCode IoctlI2C(DriverInternal *pDriver, INT8U request, void* pArgs,
 
 
 // Initializes the given I2C driver.
-PjdfErrCode InitI2C(DriverInternal *pDriver, char *pName)
+PjdfErrCode InitI2C(DriverInternal *pDriver, const char *pName)
 {   
   if (strcmp (pName, pDriver->pName) != 0) while(1); // pName should have been initialized in driversInternal[] declaration
   
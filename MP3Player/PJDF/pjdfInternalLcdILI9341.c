@@ -21,8 +21,11 @@ typedef struct _PjdfContextLcdILI9341
 
 static PjdfContextLcdILI9341 ili9341Context = { 0 };
 
-static const INT16U LcdSpiDataRate = LCD_SPI_DATARATE;
-static const INT32U SizeofLcdSpiDataRate = sizeof(LcdSpiDataRate);
+// SPI client identity and bus configuration, registered with the SPI handle
+static const INT8U LcdSpiClient = PJDF_SPI_CLIENT_LCD;
+static const INT32U SizeofLcdSpiClient = sizeof(LcdSpiClient);
+static const PjdfSpiProfile LcdSpiProfile = { PJDF_SPI_CLIENT_LCD, SPI_RATE_LCD, 8, 0, OS_FALSE };
+static const INT32U SizeofLcdSpiProfile = sizeof(LcdSpiProfile);
 
 
 // OpenLCD
@@ -60,11 +63,11 @@ static PjdfErrCode ReadLCD(DriverInternal *pDriver, void* pBuffer, INT32U* pCoun
     PjdfContextLcdILI9341 *pContext = (PjdfContextLcdILI9341*) pDriver->deviceContext;
     HANDLE hSPI = pContext->spiHandle;
     
-    retval = Ioctl(hSPI, PJDF_CTRL_SPI_WAIT_FOR_LOCK, 0, 0); // wait for exclusive access
+    retval = Ioctl(hSPI, PJDF_CTRL_SPI_WAIT_FOR_LOCK, (void*)&LcdSpiClient, (INT32U*)&SizeofLcdSpiClient); // wait for exclusive access
     if (retval != PJDF_ERR_NONE) while(1);
 
-    // adjust SPI transmission rate
-    retval = Ioctl(hSPI, PJDF_CTRL_SPI_SET_DATARATE, (void*)&LcdSpiDataRate, (INT32U*)&SizeofLcdSpiDataRate); 
+    // configure SPI for the LCD unless it still is
+    retval = Ioctl(hSPI, PJDF_CTRL_SPI_SELECT_PROFILE, (void*)&LcdSpiClient, (INT32U*)&SizeofLcdSpiClient);
     if (retval != PJDF_ERR_NONE) while(1);
 
     LCD_ILI9341_CS_ASSERT(); // assert LCD SPI
@@ -77,6 +80,42 @@ static PjdfErrCode ReadLCD(DriverInternal *pDriver, void* pBuffer, INT32U* pCoun
 }
 
 
+// LcdSend
+// Sends count bytes to the selected ILI9341 with the SPI lock held, LCD
+// chip-select asserted and the LCD profile selected. Once LCD_SPI_HOLD_MAX
+// bytes have gone out under this hold of the lock (*pHeld), lets a higher
+// priority task waiting for the bus (the MP3 feeder) have it first.
+static void LcdSend(HANDLE hSPI, INT8U *pData, INT32U count, INT32U *pHeld)
+{
+    PjdfErrCode retval;
+    INT32U run;
+    
+    while (count > 0)
+    {
+        if (*pHeld >= LCD_SPI_HOLD_MAX)
+        {
+            // The controller keeps its command state while deselected
+            LCD_ILI9341_CS_DEASSERT();
+            retval = Ioctl(hSPI, PJDF_CTRL_SPI_YIELD_LOCK, 0, 0);
+            if (retval != PJDF_ERR_NONE) while(1);
+            
+            // configure SPI for the LCD again if the yield changed it
+            retval = Ioctl(hSPI, PJDF_CTRL_SPI_SELECT_PROFILE, (void*)&LcdSpiClient, (INT32U*)&SizeofLcdSpiClient);
+            if (retval != PJDF_ERR_NONE) while(1);
+            LCD_ILI9341_CS_ASSERT();
+            *pHeld = 0;
+        }
+        
+        run = LCD_SPI_HOLD_MAX - *pHeld;
+        if (run > count) run = count;
+        retval = Write(hSPI, pData, &run);
+        if (retval != PJDF_ERR_NONE) while(1);
+        pData += run;
+        count -= run;
+        *pHeld += run;
+    }
+}
+
 // WriteLCD
 // Writes the contents of the buffer to the given device.
 // Before writing, select the ILI9341 command or data interface by passing one 
@@ -86,6 +125,9 @@ static PjdfErrCode ReadLCD(DriverInternal *pDriver, void* pBuffer, INT32U* pCoun
 //
 // The above selection will persist until changed by another call to Ioctl()
 //
+// Long writes are sent in runs of LCD_SPI_HOLD_MAX bytes, handing the SPI
+// bus to a higher priority task waiting for it in between.
+//
 // pDriver: pointer to an initialized ILI9341 LCD driver
 // pBuffer: the data to write to the device
 // pCount: the number of bytes to write
@@ -95,16 +137,17 @@ static PjdfErrCode WriteLCD(DriverInternal *pDriver, void* pBuffer, INT32U* pCou
     PjdfErrCode retval;
     PjdfContextLcdILI9341 *pContext = (PjdfContextLcdILI9341*) pDriver->deviceContext;
     HANDLE hSPI = pContext->spiHandle;
+    INT32U held = 0;
     
-    retval = Ioctl(hSPI, PJDF_CTRL_SPI_WAIT_FOR_LOCK, 0, 0);  // wait for exclusive access
+    retval = Ioctl(hSPI, PJDF_CTRL_SPI_WAIT_FOR_LOCK, (void*)&LcdSpiClient, (INT32U*)&SizeofLcdSpiClient);  // wait for exclusive access
     if (retval != PJDF_ERR_NONE) while(1);
     
-    // adjust SPI transmission rate
-    retval = Ioctl(hSPI, PJDF_CTRL_SPI_SET_DATARATE, (void*)&LcdSpiDataRate, (INT32U*)&SizeofLcdSpiDataRate); 
+    // configure SPI for the LCD unless it still is
+    retval = Ioctl(hSPI, PJDF_CTRL_SPI_SELECT_PROFILE, (void*)&LcdSpiClient, (INT32U*)&SizeofLcdSpiClient);
     if (retval != PJDF_ERR_NONE) while(1);
 
     LCD_ILI9341_CS_ASSERT(); // assert LCD SPI
-    retval = Write(hSPI, pBuffer, pCount);
+    LcdSend(hSPI, (INT8U*) pBuffer, *pCount, &held);
     LCD_ILI9341_CS_DEASSERT(); // de-assert LCD SPI
     
     retval = Ioctl(hSPI, PJDF_CTRL_SPI_RELEASE_LOCK, 0, 0);
@@ -112,6 +155,61 @@ static PjdfErrCode WriteLCD(DriverInternal *pDriver, void* pBuffer, INT32U* pCou
     return retval;
 }
 
+// WriteVLCD
+// Writes the segments to the given device with one chip-select assertion,
+// switching the D/C line between command and data segments, e.g. a command,
+// its parameters and then pixel data. The D/C line is put back as selected
+// with Ioctl(). Long transactions hand the bus over as WriteLCD() does.
+// pDriver: pointer to an initialized ILI9341 LCD driver
+// pSegments: the segments to write, see PjdfSegment
+// count: the number of segments
+// Returns: PJDF_ERR_NONE if there was no error, otherwise an error code.
+static PjdfErrCode WriteVLCD(DriverInternal *pDriver, const PjdfSegment *pSegments, INT8U count)
+{
+    PjdfErrCode retval;
+    PjdfContextLcdILI9341 *pContext = (PjdfContextLcdILI9341*) pDriver->deviceContext;
+    HANDLE hSPI = pContext->spiHandle;
+    INT32U held = 0;
+    BOOLEAN data = LCD_ILI9341_DC_IS_HIGH();
+    INT8U i;
+    
+    retval = Ioctl(hSPI, PJDF_CTRL_SPI_WAIT_FOR_LOCK, (void*)&LcdSpiClient, (INT32U*)&SizeofLcdSpiClient);  // wait for exclusive access
+    if (retval != PJDF_ERR_NONE) while(1);
+    
+    // configure SPI for the LCD unless it still is
+    retval = Ioctl(hSPI, PJDF_CTRL_SPI_SELECT_PROFILE, (void*)&LcdSpiClient, (INT32U*)&SizeofLcdSpiClient);
+    if (retval != PJDF_ERR_NONE) while(1);
+
+    LCD_ILI9341_CS_ASSERT(); // assert LCD SPI
+    for (i = 0; i < count; i++)
+    {
+        // SPI Write() returns once the last byte is clocked out, so D/C
+        // can change between segments
+        if (pSegments[i].mode == PJDF_SEG_COMMAND)
+        {
+            LCD_ILI9341_DC_LOW();
+        }
+        else
+        {
+            LCD_ILI9341_DC_HIGH();
+        }
+        LcdSend(hSPI, (INT8U*) pSegments[i].pData, pSegments[i].length, &held);
+    }
+    LCD_ILI9341_CS_DEASSERT(); // de-assert LCD SPI
+    if (data)
+    {
+        LCD_ILI9341_DC_HIGH();
+    }
+    else
+    {
+        LCD_ILI9341_DC_LOW();
+    }
+    
+    retval = Ioctl(hSPI, PJDF_CTRL_SPI_RELEASE_LOCK, 0, 0);
+    if (retval != PJDF_ERR_NONE) while(1);
+    return retval;
+}
+
 // IoctlLCD
 // pDriver: pointer to an initialized ILI9341 LCD driver
 // request: a request code chosen from those in pjdfCtrlLcdILI9341.h
@@ -142,6 +240,7 @@ static PjdfErrCode IoctlLCD(DriverInternal *pDriver, INT8U request, void* pArgs,
             return PJDF_ERR_INVALID_HANDLE;
         }
         pContext->spiHandle = handle;
+        retval = Ioctl(handle, PJDF_CTRL_SPI_REGISTER_PROFILE, (void*)&LcdSpiProfile, (INT32U*)&SizeofLcdSpiProfile);
         break;
     default:
         retval = PJDF_ERR_UNKNOWN_CTRL_REQUEST;
@@ -152,7 +251,7 @@ static PjdfErrCode IoctlLCD(DriverInternal *pDriver, INT8U request, void* pArgs,
 
 
 // Initializes the given ILI9341 LCD driver.
-PjdfErrCode InitLcdILI9341(DriverInternal *pDriver, char *pName)
+PjdfErrCode InitLcdILI9341(DriverInternal *pDriver, const char *pName)
 {
     if (strcmp (pName, pDriver->pName) != 0) while(1); // pName should have been initialized in driversInternal[] declaration
     
@@ -171,6 +270,7 @@ PjdfErrCode InitLcdILI9341(DriverInternal *pDriver, char *pName)
     pDriver->Read = ReadLCD;
     pDriver->Write = WriteLCD;
     pDriver->Ioctl = IoctlLCD;
+    pDriver->WriteV = WriteVLCD;
     
     pDriver->initialized = OS_TRUE;
     return PJDF_ERR_NONE;
@@ -22,8 +22,15 @@ typedef struct _PjdfContextMp3VS1053
 
 static PjdfContextMp3VS1053 mp3VS1053Context = { 0 };
 
-static const INT16U Mp3SpiDataRate = MP3_SPI_DATARATE;
-static const INT32U SizeofMp3SpiDataRate = sizeof(Mp3SpiDataRate);
+// Queue and I/O task for WriteAsync(), so streaming overlaps the DREQ waits
+static PjdfAsyncQueue mp3VS1053Async;
+static OS_STK mp3VS1053IoStk[APP_CFG_TASK_PJDF_IO_STK_SIZE];
+
+// SPI client identity and bus configuration, registered with the SPI handle
+static const INT8U Mp3SpiClient = PJDF_SPI_CLIENT_MP3;
+static const INT32U SizeofMp3SpiClient = sizeof(Mp3SpiClient);
+static const PjdfSpiProfile Mp3SpiProfile = { PJDF_SPI_CLIENT_MP3, SPI_RATE_MP3, 8, 0, OS_FALSE };
+static const INT32U SizeofMp3SpiProfile = sizeof(Mp3SpiProfile);
 
 // OpenMP3
 // Nothing to do.
@@ -40,6 +47,48 @@ static PjdfErrCode CloseMP3(DriverInternal *pDriver)
     return Close(pContext->spiHandle);
 }
 
+// Mp3Send
+// Sends count bytes to the VS1053 command (chipSelect 0) or data (1)
+// interface once DREQ says it is ready, with the SPI lock held. While the
+// decoder is busy the lock is released so other tasks can use the bus.
+static PjdfErrCode Mp3Send(HANDLE hSPI, INT8U chipSelect, void* pBuffer, INT32U* pCount)
+{
+    PjdfErrCode retval;
+    
+    // Wait for device ready
+    while (!LL_GPIO_IsInputPinSet(MP3_VS1053_DREQ_GPIO, MP3_VS1053_DREQ_GPIO_Pin))
+    {
+        // Device not ready so release it and delay before trying again
+        retval = Ioctl(hSPI, PJDF_CTRL_SPI_RELEASE_LOCK, 0, 0);
+        if (retval != PJDF_ERR_NONE) while(1);
+        
+        OSTimeDly(5); // can optimize this to handle highest audio bit rate while allowing delay for other tasks 
+        
+        retval = Ioctl(hSPI, PJDF_CTRL_SPI_WAIT_FOR_LOCK, (void*)&Mp3SpiClient, (INT32U*)&SizeofMp3SpiClient); // wait for exclusive access
+        if (retval != PJDF_ERR_NONE) while(1);
+    }
+    
+    // configure SPI for the VS1053 unless it still is
+    retval = Ioctl(hSPI, PJDF_CTRL_SPI_SELECT_PROFILE, (void*)&Mp3SpiClient, (INT32U*)&SizeofMp3SpiClient);
+    if (retval != PJDF_ERR_NONE) while(1);
+    
+    switch (chipSelect) {
+    case 0: /* send command */
+        MP3_VS1053_MCS_ASSERT(); // assert command chip-select
+        retval = Write(hSPI, pBuffer, pCount);
+        MP3_VS1053_MCS_DEASSERT(); // de-assert command chip-select
+        break;
+    case 1:  /* send data */
+        MP3_VS1053_DCS_ASSERT(); // assert data chip-select
+        retval = Write(hSPI, pBuffer, pCount);
+        MP3_VS1053_DCS_DEASSERT(); // de-assert data chip-select
+        break;
+    default:
+        while(1);
+    }
+    return retval;
+}
+
 // ReadMP3
 // Writes the contents of the buffer to the given device, and concurrently
 // gets the resulting data back from the device via full duplex SPI. 
@@ -60,11 +109,11 @@ static PjdfErrCode ReadMP3(DriverInternal *pDriver, void* pBuffer, INT32U* pCoun
     PjdfContextMp3VS1053 *pContext = (PjdfContextMp3VS1053*) pDriver->deviceContext;
     HANDLE hSPI = pContext->spiHandle;
     
-    retval = Ioctl(hSPI, PJDF_CTRL_SPI_WAIT_FOR_LOCK, 0, 0);   // wait for exclusive access
+    retval = Ioctl(hSPI, PJDF_CTRL_SPI_WAIT_FOR_LOCK, (void*)&Mp3SpiClient, (INT32U*)&SizeofMp3SpiClient);   // wait for exclusive access
     if (retval != PJDF_ERR_NONE) while(1);
     
-    // adjust SPI transmission rate
-    retval = Ioctl(hSPI, PJDF_CTRL_SPI_SET_DATARATE, (void*)&Mp3SpiDataRate, (INT32U*)&SizeofMp3SpiDataRate); 
+    // configure SPI for the VS1053 unless it still is
+    retval = Ioctl(hSPI, PJDF_CTRL_SPI_SELECT_PROFILE, (void*)&Mp3SpiClient, (INT32U*)&SizeofMp3SpiClient);
     if (retval != PJDF_ERR_NONE) while(1);
 
     // Wait for device ready
@@ -104,45 +153,44 @@ static PjdfErrCode WriteMP3(DriverInternal *pDriver, void* pBuffer, INT32U* pCou
     PjdfContextMp3VS1053 *pContext = (PjdfContextMp3VS1053*) pDriver->deviceContext;
     HANDLE hSPI = pContext->spiHandle;
     
-    retval = Ioctl(hSPI, PJDF_CTRL_SPI_WAIT_FOR_LOCK, 0, 0); // wait for exclusive access
+    retval = Ioctl(hSPI, PJDF_CTRL_SPI_WAIT_FOR_LOCK, (void*)&Mp3SpiClient, (INT32U*)&SizeofMp3SpiClient); // wait for exclusive access
     if (retval != PJDF_ERR_NONE) while(1);
     
-    // Wait for device ready
-    while (!LL_GPIO_IsInputPinSet(MP3_VS1053_DREQ_GPIO, MP3_VS1053_DREQ_GPIO_Pin))
-    {
-        // Device not ready so release it and delay before trying again
-        retval = Ioctl(hSPI, PJDF_CTRL_SPI_RELEASE_LOCK, 0, 0);
-        if (retval != PJDF_ERR_NONE) while(1);
-        
-        OSTimeDly(5); // can optimize this to handle highest audio bit rate while allowing delay for other tasks 
-        
-        retval = Ioctl(hSPI, PJDF_CTRL_SPI_WAIT_FOR_LOCK, 0, 0); // wait for exclusive access
-        if (retval != PJDF_ERR_NONE) while(1);
-    }
-        
-        
+    retval = Mp3Send(hSPI, pContext->chipSelect, pBuffer, pCount);
     
-    // adjust SPI transmission rate
-    retval = Ioctl(hSPI, PJDF_CTRL_SPI_SET_DATARATE, (void*)&Mp3SpiDataRate, (INT32U*)&SizeofMp3SpiDataRate); 
+    retval = Ioctl(hSPI, PJDF_CTRL_SPI_RELEASE_LOCK, 0, 0);
     if (retval != PJDF_ERR_NONE) while(1);
+    return retval;
+}
 
+// WriteVMP3
+// Writes the segments to the given device with one take of the SPI lock
+// (let go only while the decoder is busy): command segments to the SCI,
+// data segments to the SDI, each once DREQ says the decoder is ready for
+// it. The command or data mode selected with Ioctl() does not change.
+// pDriver: pointer to an initialized VS1053 MP3 driver
+// pSegments: the segments to write, see PjdfSegment
+// count: the number of segments
+// Returns: PJDF_ERR_NONE if there was no error, otherwise an error code.
+static PjdfErrCode WriteVMP3(DriverInternal *pDriver, const PjdfSegment *pSegments, INT8U count)
+{
+    PjdfErrCode retval;
+    PjdfContextMp3VS1053 *pContext = (PjdfContextMp3VS1053*) pDriver->deviceContext;
+    HANDLE hSPI = pContext->spiHandle;
+    INT32U length;
+    INT8U i;
     
-    switch (pContext->chipSelect) {
-    case 0: /* send command */
-        MP3_VS1053_MCS_ASSERT(); // assert command chip-select
-        retval = Write(hSPI, pBuffer, pCount);
-        MP3_VS1053_MCS_DEASSERT(); // de-assert command chip-select
-        break;
-    case 1:  /* send data */
-        MP3_VS1053_DCS_ASSERT(); // assert data chip-select
-        retval = Write(hSPI, pBuffer, pCount);
-        MP3_VS1053_DCS_DEASSERT(); // de-assert data chip-select
-        break;
-    default:
-        while(1);
-    }
-    retval = Ioctl(hSPI, PJDF_CTRL_SPI_RELEASE_LOCK, 0, 0);
+    retval = Ioctl(hSPI, PJDF_CTRL_SPI_WAIT_FOR_LOCK, (void*)&Mp3SpiClient, (INT32U*)&SizeofMp3SpiClient); // wait for exclusive access
     if (retval != PJDF_ERR_NONE) while(1);
+    
+    for (i = 0; i < count; i++)
+    {
+        length = pSegments[i].length;
+        retval = Mp3Send(hSPI, pSegments[i].mode == PJDF_SEG_COMMAND ? 0 : 1, pSegments[i].pData, &length);
+        if (retval != PJDF_ERR_NONE) break;
+    }
+    
+    if (Ioctl(hSPI, PJDF_CTRL_SPI_RELEASE_LOCK, 0, 0) != PJDF_ERR_NONE) while(1);
     return retval;
 }
 
@@ -176,6 +224,7 @@ static PjdfErrCode IoctlMP3(DriverInternal *pDriver, INT8U request, void* pArgs,
             return PJDF_ERR_INVALID_HANDLE;
         }
         pContext->spiHandle = handle;
+        retval = Ioctl(handle, PJDF_CTRL_SPI_REGISTER_PROFILE, (void*)&Mp3SpiProfile, (INT32U*)&SizeofMp3SpiProfile);
         break;
     default:
         retval = PJDF_ERR_UNKNOWN_CTRL_REQUEST;
@@ -186,7 +235,7 @@ static PjdfErrCode IoctlMP3(DriverInternal *pDriver, INT8U request, void* pArgs,
 
 
 // Initializes the given VS1053 MP3 driver.
-PjdfErrCode InitMp3VS1053(DriverInternal *pDriver, char *pName)
+PjdfErrCode InitMp3VS1053(DriverInternal *pDriver, const char *pName)
 {
     if (strcmp (pName, pDriver->pName) != 0) while(1); // pName should have been initialized in driversInternal[] declaration
     
@@ -205,6 +254,8 @@ PjdfErrCode InitMp3VS1053(DriverInternal *pDriver, char *pName)
     pDriver->Read = ReadMP3;
     pDriver->Write = WriteMP3;
     pDriver->Ioctl = IoctlMP3;
+    pDriver->WriteV = WriteVMP3;
+    PjdfAsyncInit(pDriver, &mp3VS1053Async, &mp3VS1053IoStk[APP_CFG_TASK_PJDF_IO_STK_SIZE-1], APP_TASK_MP3_IO_PRIO);
     
     pDriver->initialized = OS_TRUE;
     return PJDF_ERR_NONE;
@@ -23,8 +23,11 @@ typedef struct _PjdfContextSD
 
 static PjdfContextSD SDContext = { 0 };
 
-static const INT16U SDSpiDataRate = SD_SPI_DATARATE;
-static const INT32U SizeofSDSpiDataRate = sizeof(SDSpiDataRate);
+// SPI client identity and bus configuration, registered with the SPI handle
+static const INT8U SDSpiClient = PJDF_SPI_CLIENT_SD;
+static const INT32U SizeofSDSpiClient = sizeof(SDSpiClient);
+static const PjdfSpiProfile SDSpiProfile = { PJDF_SPI_CLIENT_SD, SPI_RATE_SD, 8, 0, OS_FALSE };
+static const INT32U SizeofSDSpiProfile = sizeof(SDSpiProfile);
 
 // OpenSDAdafruit
 // Nothing to do.
@@ -66,10 +69,6 @@ static PjdfErrCode ReadSDAdafruit(DriverInternal *pDriver, void* pBuffer, INT32U
     if (!pContext->spiLocked) while(1);
     if (!pContext->csAsserted) while(1);
     
-    // adjust SPI transmission rate
-    retval = Ioctl(hSPI, PJDF_CTRL_SPI_SET_DATARATE, (void*)&SDSpiDataRate, (INT32U*)&SizeofSDSpiDataRate); 
-    if (retval != PJDF_ERR_NONE) while(1);
-    
     retval = Read(hSPI, pBuffer, pCount);
     
     return retval;
@@ -98,10 +97,6 @@ static PjdfErrCode WriteSDAdafruit(DriverInternal *pDriver, void* pBuffer, INT32
     if (!pContext->spiLocked) while(1);
     // if (!pContext->csAsserted) while(1); // TODO: does initialization require no assert?
     
-    // adjust SPI transmission rate
-    retval = Ioctl(hSPI, PJDF_CTRL_SPI_SET_DATARATE, (void*)&SDSpiDataRate, (INT32U*)&SizeofSDSpiDataRate); 
-    if (retval != PJDF_ERR_NONE) while(1);
-    
     retval = Write(hSPI, pBuffer, pCount);
         
     return retval;
@@ -123,25 +118,29 @@ static PjdfErrCode IoctlSDAdafruit(DriverInternal *pDriver, INT8U request, void*
     case PJDF_CTRL_SD_ASSERT_CS:
         if (!pContext->spiLocked) while(1);
         SD_ADAFRUIT_CS_ASSERT();
-        pContext->csAsserted = true;
+        pContext->csAsserted = OS_TRUE;
         break;
     case PJDF_CTRL_SD_DEASSERT_CS:
         if (!pContext->csAsserted) while(1);
         SD_ADAFRUIT_CS_DEASSERT();
-        pContext->csAsserted = false;
+        pContext->csAsserted = OS_FALSE;
         break;
     case PJDF_CTRL_SD_LOCK_SPI:
         if (pContext->spiLocked) 
             return PJDF_ERR_NONE; // already locked
-        retval = Ioctl(pContext->spiHandle, PJDF_CTRL_SPI_WAIT_FOR_LOCK, 0, 0);
+        retval = Ioctl(pContext->spiHandle, PJDF_CTRL_SPI_WAIT_FOR_LOCK, (void*)&SDSpiClient, (INT32U*)&SizeofSDSpiClient);
         if (PJDF_IS_ERROR(retval)) while(1);
-        pContext->spiLocked = true;
+        // Nobody else can reconfigure SPI until the lock is released, so
+        // the bus is set up once here rather than on every Read() and Write()
+        retval = Ioctl(pContext->spiHandle, PJDF_CTRL_SPI_SELECT_PROFILE, (void*)&SDSpiClient, (INT32U*)&SizeofSDSpiClient);
+        if (PJDF_IS_ERROR(retval)) while(1);
+        pContext->spiLocked = OS_TRUE;
         break;
     case PJDF_CTRL_SD_RELEASE_SPI:
         if (!pContext->spiLocked) while(1); // not currently locked
         retval = Ioctl(pContext->spiHandle, PJDF_CTRL_SPI_RELEASE_LOCK, 0, 0);
         if (PJDF_IS_ERROR(retval)) while(1);
-        pContext->spiLocked = false;
+        pContext->spiLocked = OS_FALSE;
         break;
     case PJDF_CTRL_SD_SET_SPI_HANDLE:
         if (*pSize < sizeof(HANDLE))
@@ -154,6 +153,15 @@ static PjdfErrCode IoctlSDAdafruit(DriverInternal *pDriver, INT8U request, void*
             return PJDF_ERR_INVALID_HANDLE;
         }
         pContext->spiHandle = handle;
+        retval = Ioctl(handle, PJDF_CTRL_SPI_REGISTER_PROFILE, (void*)&SDSpiProfile, (INT32U*)&SizeofSDSpiProfile);
+        break;
+    case PJDF_CTRL_SD_SET_MAX_HZ:
+        if (!pContext->spiLocked) while(1); // the SPI1 rates change under its lock only
+        if (*pSize < sizeof(INT32U))
+        {
+            return PJDF_ERR_ARG;
+        }
+        *(INT32U*)pArgs = SPI_SetMaxHz(SPI_RATE_SD, *(INT32U*)pArgs);
         break;
     default:
         retval = PJDF_ERR_UNKNOWN_CTRL_REQUEST;
@@ -164,7 +172,7 @@ static PjdfErrCode IoctlSDAdafruit(DriverInternal *pDriver, INT8U request, void*
 
 
 // Initializes the given SD driver.
-PjdfErrCode InitSDAdafruit(DriverInternal *pDriver, char *pName)
+PjdfErrCode InitSDAdafruit(DriverInternal *pDriver, const char *pName)
 {
     if (strcmp (pName, pDriver->pName) != 0) while(1); // pName should have been initialized in driversInternal[] declaration
     
@@ -16,11 +16,221 @@
 typedef struct _PjdfContextSpi
 {
     SPI_TypeDef *spiMemMap; // Memory mapped register block for a SPI interface
+    PjdfSpiLock lock;       // Exclusive access to the bus
+    PjdfSpiProfiles profiles; // Bus configuration of each client
 } PjdfContextSpi;
 
 static PjdfContextSpi spi1Context = { PJDF_SPI1 };
 
 
+// Wait for the lock on behalf of client
+static void SpiLockPend(PjdfSpiLock *pLock, INT8U client)
+{
+    PjdfSpiLockStats *pStats;
+    INT32U start = CYCLE_COUNT();
+    INT32U waitUs;
+    INT8U osErr;
+
+    if (client >= PJDF_SPI_CLIENT_COUNT) while(1);
+    pStats = &pLock->stats[client];
+    if (!OSMutexAccept(pLock->mutex, &osErr))
+    {
+        OSMutexPend(pLock->mutex, 0, &osErr);
+        if (osErr != OS_ERR_NONE) while(1);
+        waitUs = ClockElapsedUs(start);
+        pStats->contended++;
+        pStats->waitUs += waitUs;
+        if (waitUs > pStats->maxWaitUs) pStats->maxWaitUs = waitUs;
+    }
+    else if (osErr != OS_ERR_NONE) while(1); // APP_TASK_SPI_MUTEX_PRIO is not above the task
+    pStats->locks++;
+    pLock->client = client;
+    pLock->lockedAt = CYCLE_COUNT();
+}
+
+static void SpiLockPost(PjdfSpiLock *pLock)
+{
+    PjdfSpiLockStats *pStats = &pLock->stats[pLock->client];
+    INT32U holdUs = ClockElapsedUs(pLock->lockedAt);
+
+    if (holdUs > pStats->maxHoldUs) pStats->maxHoldUs = holdUs;
+    if (OSMutexPost(pLock->mutex) != OS_ERR_NONE) while(1); // not the holder
+}
+
+// True if a task of higher priority than the holder's own waits for the lock.
+// The holder may be running at APP_TASK_SPI_MUTEX_PRIO meanwhile.
+static BOOLEAN SpiLockHigherWaiter(PjdfSpiLock *pLock)
+{
+    OS_MUTEX_DATA data;
+    INT8U y, waiter;
+
+    if (OSMutexQuery(pLock->mutex, &data) != OS_ERR_NONE) while(1);
+    if (data.OSEventGrp == 0u) return OS_FALSE;
+    y = OSUnMapTbl[data.OSEventGrp];
+    waiter = (INT8U)((y << 3u) + OSUnMapTbl[data.OSEventTbl[y]]);
+    return waiter < data.OSOwnerPrio;
+}
+
+/*
+ NAME:
+   SpiLockInit
+ PURPOSE:
+   Create the mutex of a SPI bus lock. The priority inheritance priority
+   APP_TASK_SPI_MUTEX_PRIO must be free and above every task that takes
+   the lock.
+ */
+void SpiLockInit(PjdfSpiLock *pLock)
+{
+    INT8U osErr;
+
+    memset(pLock, 0, sizeof(*pLock));
+    pLock->mutex = OSMutexCreate(APP_TASK_SPI_MUTEX_PRIO, &osErr);
+    if (pLock->mutex == NULL) while (1);  // priority in use or no event control block left
+}
+
+/*
+ NAME:
+   SpiLockIoctl
+ PURPOSE:
+   The lock requests of pjdfCtrlSpi.h, for the Ioctl() of a SPI driver.
+   PJDF_CTRL_SPI_YIELD_LOCK is for long transfers: between chunks, with its
+   chip select deasserted, the holder lets a higher priority task that is
+   waiting have the bus, then waits to get it back. The holder must set up
+   the bus again (data rate) after it.
+ RETURNS:
+   OS_FALSE if request is not a lock request
+ */
+BOOLEAN SpiLockIoctl(PjdfSpiLock *pLock, INT8U request, void* pArgs, INT32U* pSize)
+{
+    INT8U client;
+#if OS_CRITICAL_METHOD == 3u
+    OS_CPU_SR cpu_sr = 0u;
+#endif
+
+    switch (request)
+    {
+    case PJDF_CTRL_SPI_WAIT_FOR_LOCK:
+        client = PJDF_SPI_CLIENT_OTHER;
+        if (pArgs != NULL)
+        {
+            if (*pSize != sizeof(INT8U)) while (1);
+            client = *(INT8U*)pArgs;
+        }
+        SpiLockPend(pLock, client);
+        break;
+    case PJDF_CTRL_SPI_RELEASE_LOCK:
+        SpiLockPost(pLock);
+        break;
+    case PJDF_CTRL_SPI_YIELD_LOCK:
+        if (SpiLockHigherWaiter(pLock))
+        {
+            client = pLock->client;
+            pLock->stats[client].yields++;
+            SpiLockPost(pLock);
+            SpiLockPend(pLock, client);
+        }
+        break;
+    case PJDF_CTRL_SPI_GET_LOCK_STATS:
+        if (*pSize != sizeof(pLock->stats))
+            while (1);
+        OS_ENTER_CRITICAL();
+        memcpy(pArgs, pLock->stats, sizeof(pLock->stats));
+        OS_EXIT_CRITICAL();
+        break;
+    case PJDF_CTRL_SPI_CLR_LOCK_STATS:
+        OS_ENTER_CRITICAL();
+        memset(pLock->stats, 0, sizeof(pLock->stats));
+        OS_EXIT_CRITICAL();
+        break;
+    default:
+        return OS_FALSE;
+    }
+    return OS_TRUE;
+}
+
+
+
+/*
+ NAME:
+   SpiProfilesInit
+ PURPOSE:
+   Start with no profiles registered and the bus configuration unknown.
+ */
+void SpiProfilesInit(PjdfSpiProfiles *pProfiles)
+{
+    memset(pProfiles, 0, sizeof(*pProfiles));
+    pProfiles->active = PJDF_SPI_CLIENT_COUNT;
+}
+
+/*
+ NAME:
+   SpiProfilesIoctl
+ PURPOSE:
+   The profile requests of pjdfCtrlSpi.h other than
+   PJDF_CTRL_SPI_SELECT_PROFILE, which needs the hardware, for the Ioctl()
+   of a SPI driver.
+ RETURNS:
+   OS_FALSE if request is not one of them
+ */
+BOOLEAN SpiProfilesIoctl(PjdfSpiProfiles *pProfiles, INT8U request, void* pArgs, INT32U* pSize)
+{
+    const PjdfSpiProfile *pProfile;
+#if OS_CRITICAL_METHOD == 3u
+    OS_CPU_SR cpu_sr = 0u;
+#endif
+
+    switch (request)
+    {
+    case PJDF_CTRL_SPI_REGISTER_PROFILE:
+        if (*pSize != sizeof(PjdfSpiProfile)) while (1);
+        pProfile = (const PjdfSpiProfile*) pArgs;
+        if (pProfile->client >= PJDF_SPI_CLIENT_COUNT || pProfile->rate >= SPI_RATE_COUNT ||
+            (pProfile->dataWidth != 8 && pProfile->dataWidth != 16) || pProfile->mode > 3) while (1);
+        OS_ENTER_CRITICAL();
+        pProfiles->profiles[pProfile->client] = *pProfile;
+        pProfiles->registered[pProfile->client] = OS_TRUE;
+        if (pProfiles->active == pProfile->client) pProfiles->active = PJDF_SPI_CLIENT_COUNT;
+        OS_EXIT_CRITICAL();
+        break;
+    case PJDF_CTRL_SPI_GET_PROFILE_STATS:
+        if (*pSize != sizeof(pProfiles->stats))
+            while (1);
+        OS_ENTER_CRITICAL();
+        memcpy(pArgs, pProfiles->stats, sizeof(pProfiles->stats));
+        OS_EXIT_CRITICAL();
+        break;
+    default:
+        return OS_FALSE;
+    }
+    return OS_TRUE;
+}
+
+// Called with the lock held
+const PjdfSpiProfile *SpiProfileSelect(PjdfSpiProfiles *pProfiles, INT8U client, INT16U *pPrescaler)
+{
+    const PjdfSpiProfile *pProfile;
+
+    if (client >= PJDF_SPI_CLIENT_COUNT || !pProfiles->registered[client]) while(1); // not registered
+    pProfile = &pProfiles->profiles[client];
+    *pPrescaler = spiDataRate[pProfile->rate];
+    pProfiles->stats[client].selects++;
+
+    // A clock change moves the prescaler of every profile
+    if (pProfiles->active == client && pProfiles->prescaler == *pPrescaler) return NULL;
+
+    pProfiles->stats[client].reconfigs++;
+    pProfiles->active = client;
+    pProfiles->prescaler = *pPrescaler;
+    return pProfile;
+}
+
+// Counted against PJDF_SPI_CLIENT_OTHER
+void SpiProfilesInvalidate(PjdfSpiProfiles *pProfiles)
+{
+    pProfiles->stats[PJDF_SPI_CLIENT_OTHER].reconfigs++;
+    pProfiles->active = PJDF_SPI_CLIENT_COUNT;
+}
+
 
 // OpenSPI
 // No special action required to open SPI device
@@ -77,19 +287,25 @@ static PjdfErrCode WriteSPI(DriverInternal *pDriver, void* pBuffer, INT32U* pCou
 // Handles the request codes defined in pjdfCtrlSpi.h
 static PjdfErrCode IoctlSPI(DriverInternal *pDriver, INT8U request, void* pArgs, INT32U* pSize)
 {
-    INT8U osErr;
+    const PjdfSpiProfile *pProfile;
+    INT16U prescaler;
     PjdfContextSpi *pContext = (PjdfContextSpi*) pDriver->deviceContext;
     if (pContext == NULL) while(1);
+    if (SpiLockIoctl(&pContext->lock, request, pArgs, pSize)) return PJDF_ERR_NONE;
+    if (SpiProfilesIoctl(&pContext->profiles, request, pArgs, pSize)) return PJDF_ERR_NONE;
     switch (request)
     {
-    case PJDF_CTRL_SPI_WAIT_FOR_LOCK:
-        OSSemPend(pDriver->sem, 0, &osErr);
-        break;
-    case PJDF_CTRL_SPI_RELEASE_LOCK:
-        osErr = OSSemPost(pDriver->sem);
+    case PJDF_CTRL_SPI_SELECT_PROFILE: // Reprogram the bus only if another client or clock had it
+        if (*pSize != sizeof(INT8U)) while (1);
+        pProfile = SpiProfileSelect(&pContext->profiles, *(INT8U*)pArgs, &prescaler);
+        if (pProfile != NULL)
+        {
+            SPI_Configure(pContext->spiMemMap, prescaler, pProfile->dataWidth, pProfile->mode, pProfile->dma);
+        }
         break;
     case PJDF_CTRL_SPI_SET_DATARATE: // Call BSP code to adjust transmission speed of SPI
         if (*pSize != sizeof(INT16U)) while (1);
+        SpiProfilesInvalidate(&pContext->profiles);
         SPI_SetDataRate(pContext->spiMemMap, *(INT16U*)pArgs);
         break;
     default:
@@ -101,7 +317,7 @@ static PjdfErrCode IoctlSPI(DriverInternal *pDriver, INT8U request, void* pArgs,
 
 
 // Initializes the given SPI driver.
-PjdfErrCode InitSPI(DriverInternal *pDriver, char *pName)
+PjdfErrCode InitSPI(DriverInternal *pDriver, const char *pName)
 {   
     if (strcmp (pName, pDriver->pName) != 0) while(1); // pName should have been initialized in driversInternal[] declaration
     
@@ -117,6 +333,8 @@ PjdfErrCode InitSPI(DriverInternal *pDriver, char *pName)
     {
         pDriver->maxRefCount = 10; // Maximum refcount allowed for the device
         pDriver->deviceContext = (void*) &spi1Context;
+        SpiLockInit(&spi1Context.lock);
+        SpiProfilesInit(&spi1Context.profiles);
         BspSPI1Init(); // init SPI1 hardware
     }
   
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""
+bindbench.py
+
+Compares the two device bindings of pjdfBind.h on the Linux build: the
+player built with PJDF calls (make, the default) against the one with
+inline register access (make BIND=direct). Both play the same playbench.py
+corpus and touch scripts; reported per run, as JSON, side by side:
+
+  - CPU use per task, the median of --repeat runs
+  - cycles per SD block read and per LCD fill (fillRect()), timed with
+    CYCLE_COUNT() around each one like the DWT does on the board; the
+    median of --repeat runs, both bindings side by side per scenario
+  - PJDF calls per device (what the direct binding takes off the path)
+  - underruns, lowest VS1053 FIFO level and SPI1 utilization, which should
+    not change: the bytes on the bus are the same
+
+The host pays far less for a function pointer call than the Cortex-M4
+does, and the simulated bus spins for the SCK time of every byte, which
+dominates the task times; the CPU differences here are a lower bound of
+those on the board. The call counts carry over as they are.
+
+    make -C Host bindbench
+    Tools/bindbench.py --pjdf Host/build/mp3player --direct Host/build-direct/mp3player
+"""
+
+import argparse
+import json
+import os
+import random
+import statistics
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import playbench
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+BINDINGS = ("pjdf", "direct")
+IDLE_TASK = "uC/OS-II Idle"
+
+
+def measure(player, workdir, name, files, script, seconds, repeat):
+    """Runs of one player on one scenario, reduced to the median CPU use."""
+    os.makedirs(workdir, exist_ok=True)
+    runs = []
+    for _ in range(repeat):
+        summary = playbench.run(player, workdir, name, files, script(), seconds)
+        with open(os.path.join(workdir, name + ".json")) as f:
+            report = json.load(f)
+        summary["pjdf"] = {d["device"]: d for d in report.get("pjdf", [])}
+        reads, fills = report["sd_block_reads"], report["lcd_fills"]
+        summary["sd_block"] = reads["cycles"] / reads["blocks"] if reads["blocks"] else None
+        summary["lcd_fill"] = fills["cycles"] / fills["fills"] if fills["fills"] else None
+        runs.append(summary)
+    last = runs[-1]
+    cpu = {task: round(statistics.median(r["cpu_pct"].get(task, 0) for r in runs), 3) for task in last["cpu_pct"]}
+    return {
+        "cpu_pct": cpu,
+        "cpu_pct_busy": round(sum(v for task, v in cpu.items() if task != IDLE_TASK), 3),
+        "pjdf_calls": {dev: d["reads"] + d["writes"] + d["ioctls"] for dev, d in sorted(last["pjdf"].items())},
+        "underruns": max(r["underruns"] for r in runs),
+        "min_fifo": min(r["min_fifo"] for r in runs),
+        "spi1_busy_pct": round(statistics.median(r["spi1_busy_pct"] for r in runs), 3),
+        "sd_blocks_read": last["sd_blocks_read"],
+        "cycles_per_sd_block": median_of(runs, "sd_block"),
+        "cycles_per_lcd_fill": median_of(runs, "lcd_fill"),
+    }
+
+
+def median_of(runs, key):
+    """Median of a per run figure over the runs that have it, None if none do."""
+    values = [r[key] for r in runs if r[key] is not None]
+    return round(statistics.median(values)) if values else None
+
+
+def side_by_side(pjdf, direct):
+    """One figure of both bindings and the share the direct one saves."""
+    saved = round(100.0 * (pjdf - direct) / pjdf, 1) if pjdf and direct is not None else None
+    return {"pjdf": pjdf, "direct": direct, "saved_pct": saved}
+
+
+def main():
+    ap = argparse.ArgumentParser(description="PJDF against direct device binding on the simulated board")
+    ap.add_argument("--pjdf", default=os.path.join(HERE, "..", "Host", "build", "mp3player"))
+    ap.add_argument("--direct", default=os.path.join(HERE, "..", "Host", "build-direct", "mp3player"))
+    ap.add_argument("--seconds", type=int, default=10, help="length of each playback run")
+    ap.add_argument("--repeat", type=int, default=3, help="runs per player and scenario")
+    ap.add_argument("--workdir", help="keep the corpus, images and raw reports here")
+    ap.add_argument("-o", "--output", help="JSON output (default: stdout)")
+    args = ap.parse_args()
+
+    workdir = args.workdir or tempfile.mkdtemp(prefix="bindbench-")
+    os.makedirs(workdir, exist_ok=True)
+    corpus = playbench.make_corpus(workdir, max(args.seconds, 30) + 5, 512)
+    by_name = {os.path.splitext(os.path.basename(p))[0].lower(): p for p in corpus}
+
+    # Streaming at the highest rate, reading past cover art, and the UI
+    # under load, where the LCD driver does most of its calls
+    scenarios = [
+        ("cbr320", [by_name["cbr320"]], playbench.playback_script, args.seconds),
+        ("id3art", [by_name["id3art"]], playbench.playback_script, args.seconds),
+        ("ui_load", corpus, lambda: playbench.ui_load_script(random.Random(3)), 28),
+    ]
+
+    runs = []
+    for name, files, script, seconds in scenarios:
+        result = {"name": name}
+        for binding, player in zip(BINDINGS, (args.pjdf, args.direct)):
+            result[binding] = measure(player, os.path.join(workdir, binding), name, files, script, seconds,
+                                      args.repeat)
+        pjdf, direct = result["pjdf"], result["direct"]
+        result["cpu_pct_saved"] = {task: round(pjdf["cpu_pct"][task] - direct["cpu_pct"].get(task, 0), 3)
+                                   for task in pjdf["cpu_pct"]}
+        result["cpu_pct_busy_saved"] = round(pjdf["cpu_pct_busy"] - direct["cpu_pct_busy"], 3)
+        for key in ("cycles_per_sd_block", "cycles_per_lcd_fill"):
+            result[key] = side_by_side(pjdf[key], direct[key])
+        runs.append(result)
+
+    result = {"seconds": args.seconds, "repeat": args.repeat, "runs": runs}
+    text = json.dumps(result, indent=2)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text + "\n")
+    else:
+        print(text)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""
+cachebench.py
+
+Compares SD library block cache configurations (SD_CACHE_SLOTS and
+SD_CACHE_FAT_SLOTS in SdFat.h) on the Linux build. Each player plays the
+playbench.py corpus from two images with the same files: one with every
+file in consecutive clusters, and one with the files' clusters interleaved
+(mkfatimg.py --fragment), so that every cluster of the file playing is
+followed by a FAT lookup that is not in the block just read. Reported per
+run, as JSON:
+
+  - SD blocks read and read commands: what the cache saves
+  - cache hits and misses, FAT and data apart, write-backs and the
+    cluster chain walks that fill the chain maps of the files read
+  - Mp3SDTask CPU use, underruns and the lowest VS1053 FIFO level
+
+Mp3StreamFile() reads a file that is not contiguous through the SD
+library a decoder buffer at a time, so the data lookups count the parts of
+blocks read; the misses count blocks.
+
+    make -C Host cachebench
+    Tools/cachebench.py --player single=Host/build-cache1-0/mp3player --player pinned=Host/build/mp3player
+    Tools/cachebench.py --fat 16 --cluster-kb 4 --player shared=... --player pinned=...
+"""
+
+import argparse
+import json
+import os
+import random
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import playbench
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SD_TASK = "Mp3SDTask"
+
+
+def measure(player, workdir, name, files, script, seconds, image_args):
+    os.makedirs(workdir, exist_ok=True)
+    r = playbench.run(player, workdir, name, files, script(), seconds, image_args)
+    cache = r["sd_cache"]
+    lookups = cache["fat_hits"] + cache["fat_misses"] + cache["data_hits"] + cache["data_misses"]
+    return {
+        "sd_blocks_read": r["sd_blocks_read"],
+        "sd_read_commands": r["sd_read_commands"],
+        "sd_cache": cache,
+        "fat_miss_pct": round(100.0 * cache["fat_misses"] / max(1, cache["fat_hits"] + cache["fat_misses"]), 3),
+        "miss_pct": round(100.0 * (cache["fat_misses"] + cache["data_misses"]) / max(1, lookups), 3),
+        "sd_task_cpu_pct": r["cpu_pct"].get(SD_TASK, 0),
+        "underruns": r["underruns"],
+        "min_fifo": r["min_fifo"],
+        "frames": r["frames"],
+    }
+
+
+def main():
+    ap = argparse.ArgumentParser(description="SD block cache configurations on the simulated board")
+    ap.add_argument("--player", action="append", metavar="NAME=PATH",
+                    help="a player to compare, built with make SD_CACHE=slots:fatslots (repeat)")
+    ap.add_argument("--fragment", type=int, default=1, help="clusters per run on the fragmented image")
+    ap.add_argument("--fat", type=int, choices=(16, 32), default=32, help="FAT type of the images")
+    ap.add_argument("--cluster-kb", type=int, help="cluster size of the images, see mkfatimg.py")
+    ap.add_argument("--seconds", type=int, default=10, help="length of each playback run")
+    ap.add_argument("--workdir", help="keep the corpus, images and raw reports here")
+    ap.add_argument("-o", "--output", help="JSON output (default: stdout)")
+    args = ap.parse_args()
+
+    players = [p.split("=", 1) for p in args.player or
+               ["pinned=" + os.path.join(HERE, "..", "Host", "build", "mp3player")]]
+
+    workdir = args.workdir or tempfile.mkdtemp(prefix="cachebench-")
+    os.makedirs(workdir, exist_ok=True)
+    corpus = playbench.make_corpus(workdir, max(args.seconds, 30) + 5, 512)
+
+    # The first file played to the end of the run, then the UI under load,
+    # which walks the directory and opens the next and previous files
+    scenarios = [
+        ("playback", playbench.playback_script, args.seconds),
+        ("ui_load", lambda: playbench.ui_load_script(random.Random(3)), 28),
+    ]
+    geometry = ["--fat", str(args.fat)] + (["--cluster-kb", str(args.cluster_kb)] if args.cluster_kb else [])
+    layouts = [("contiguous", geometry), ("fragmented", geometry + ["--fragment", str(args.fragment)])]
+
+    runs = []
+    for name, script, seconds in scenarios:
+        for layout, image_args in layouts:
+            result = {"name": name, "layout": layout}
+            for label, player in players:
+                result[label] = measure(player, os.path.join(workdir, label), name + "_" + layout, corpus,
+                                        script, seconds, image_args)
+            runs.append(result)
+
+    result = {"seconds": args.seconds, "fragment": args.fragment, "fat": args.fat, "cluster_kb": args.cluster_kb,
+              "players": dict(players), "runs": runs}
+    text = json.dumps(result, indent=2)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text + "\n")
+    else:
+        print(text)
+
+
+if __name__ == "__main__":
+    main()
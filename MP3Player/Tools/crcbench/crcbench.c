@@ -0,0 +1,132 @@
+/*
+    crcbench.c
+
+    Host benchmark of the SD library's CRCs (Arduino/SD/src/utility/SdCrc.cpp):
+    the CRC16 of a 512 byte block and the CRC7 of a command frame, from the
+    tables the library uses and a bit at a time, as Host/simSD.c does.
+    Built and run by run.sh.
+
+    Both ways must agree on random blocks and frames, and on the CRC7 of
+    CMD0 and CMD8 that cards check before CMD59. The time per block is set
+    beside the time the block takes on the SPI bus at a few SD clocks, the
+    share of a streamed block the CPU spends checking it. The shell's
+    sdcrc command times the same calls on the target.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "SdCrc.h"
+
+#define BENCH_BLOCKS    200000u
+#define BENCH_FRAMES    2000000u
+
+static uint8_t blocks[16][512];
+
+// ---- A bit at a time -----------------------------------------------------------
+static uint8_t BitCrc7(const uint8_t *buf, uint8_t count)
+{
+    uint8_t crc = 0;
+
+    while (count--)
+    {
+        uint8_t d = *buf++;
+        for (int k = 0; k < 8; k++)
+        {
+            crc <<= 1;
+            if ((d ^ crc) & 0x80) crc ^= 0x09;
+            d <<= 1;
+        }
+    }
+    return (crc & 0x7F) << 1;
+}
+
+static uint16_t BitCrc16(uint16_t crc, const uint8_t *buf, uint32_t count)
+{
+    while (count--)
+    {
+        crc ^= *buf++ << 8;
+        for (int k = 0; k < 8; k++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+// ---- Benchmark ---------------------------------------------------------------
+static double NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double TimeCrc16(uint16_t (*crc16)(uint16_t, const uint8_t *, uint32_t), uint16_t *pSum)
+{
+    uint16_t sum = 0;
+    double start = NowNs();
+
+    for (uint32_t i = 0; i < BENCH_BLOCKS; i++) sum ^= crc16(0, blocks[i % 16], 512);
+    *pSum = sum;
+    return (NowNs() - start) / BENCH_BLOCKS;
+}
+
+static double TimeCrc7(uint8_t (*crc7)(const uint8_t *, uint8_t), uint8_t *pSum)
+{
+    uint8_t sum = 0;
+    double start = NowNs();
+
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) sum ^= crc7(&blocks[0][i % 500], 5);
+    *pSum = sum;
+    return (NowNs() - start) / BENCH_FRAMES;
+}
+
+int main(void)
+{
+    static const uint8_t cmd0[5] = { 0x40, 0, 0, 0, 0 };
+    static const uint8_t cmd8[5] = { 0x48, 0, 0, 0x01, 0xAA };
+    static const double sckMHz[] = { 10.0, 20.0, 40.0 };
+    uint16_t sum16Table, sum16Bit;
+    uint8_t sum7Table, sum7Bit;
+    double table16, bit16, table7, bit7;
+
+    srand(1);
+    for (int b = 0; b < 16; b++)
+    {
+        for (int i = 0; i < 512; i++) blocks[b][i] = (uint8_t)rand();
+    }
+
+    // the same CRCs both ways, in one piece and in two
+    if ((sdCrc7(cmd0, 5) | 1) != 0x95 || (sdCrc7(cmd8, 5) | 1) != 0x87)
+    {
+        printf("FAIL: CRC7 of CMD0 %02X, CMD8 %02X\n", sdCrc7(cmd0, 5) | 1, sdCrc7(cmd8, 5) | 1);
+        return 1;
+    }
+    for (int b = 0; b < 16; b++)
+    {
+        uint16_t crc = sdCrc16(sdCrc16(0, blocks[b], 100 + b), blocks[b] + 100 + b, 412 - b);
+        if (crc != BitCrc16(0, blocks[b], 512) || sdCrc7(blocks[b], 5) != BitCrc7(blocks[b], 5))
+        {
+            printf("FAIL: block %d, CRC16 %04X, bitwise %04X\n", b, crc, BitCrc16(0, blocks[b], 512));
+            return 1;
+        }
+    }
+
+    table16 = TimeCrc16(sdCrc16, &sum16Table);
+    bit16 = TimeCrc16(BitCrc16, &sum16Bit);
+    table7 = TimeCrc7(sdCrc7, &sum7Table);
+    bit7 = TimeCrc7(BitCrc7, &sum7Bit);
+    if (sum16Table != sum16Bit || sum7Table != sum7Bit)
+    {
+        printf("FAIL: checksums differ\n");
+        return 1;
+    }
+
+    printf("CRC16 of a 512 byte block: table %7.1f ns, bitwise %7.1f ns (%.1fx)\n", table16, bit16, bit16 / table16);
+    printf("CRC7 of a command frame:   table %7.1f ns, bitwise %7.1f ns (%.1fx)\n", table7, bit7, bit7 / table7);
+    for (unsigned i = 0; i < sizeof(sckMHz) / sizeof(sckMHz[0]); i++)
+    {
+        double blockNs = 514 * 8 * 1e3 / sckMHz[i];
+        printf("  a block on the bus at %4.1f MHz SCK takes %6.0f ns: table CRC %4.1f%%, bitwise %5.1f%%\n",
+               sckMHz[i], blockNs, 100 * table16 / blockNs, 100 * bit16 / blockNs);
+    }
+    return 0;
+}
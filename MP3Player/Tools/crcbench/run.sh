@@ -0,0 +1,14 @@
+#!/bin/sh
+# Build crcbench against the SD library's CRC code and run it.
+# Usage: Tools/crcbench/run.sh [output dir]
+set -e
+HERE=$(cd "$(dirname "$0")" && pwd)
+ROOT="$HERE/../.."
+OUT=${1:-/tmp/crcbench}
+CXX=${CXX:-g++}
+mkdir -p "$OUT"
+
+$CXX -O2 -I"$ROOT/Arduino/SD/src/utility" \
+    -x c++ "$HERE/crcbench.c" "$ROOT/Arduino/SD/src/utility/SdCrc.cpp" \
+    -o "$OUT/crcbench"
+"$OUT/crcbench"
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""
+critbench.py
+
+Interrupts disabled time of the player on the Linux build made with
+make CRITMEAS=1, which times every OS_ENTER_CRITICAL() section
+(OS_CRITICAL_MEAS_EN, Util/critmeas.c) the way the shell's "crit" does on
+the board. Reported per run, as JSON:
+
+  - the sections timed and their log2 duration histogram
+  - the call sites with the longest worst case: file, line, count, worst
+    and average in microseconds, and the task running at the worst
+  - the player's underruns and frames
+  - sanitizer reports on stderr
+
+The durations are host time: the simulated bus transfers inside a section
+take as long as on the board, the rest runs at host speed, and a host
+thread preempted inside a section is timed as if it ran. Which sites come
+out on top is what carries over.
+
+Runs plain playback and the ui_load touch storm. Exits with status 1 if
+no section was timed, a site's worst case took longer than --max-us
+(when given), a sanitizer reported something, or the song did not play.
+
+    make -C Host critbench
+    Tools/critbench.py --player Host/build-critmeas/mp3player --max-us 100
+"""
+
+import argparse
+import json
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import playbench
+import sdstress
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+def run(player, workdir, name, song, touches, seconds):
+    image = os.path.join(workdir, name + ".img")
+    script = os.path.join(workdir, name + ".touch")
+    report = os.path.join(workdir, name + ".json")
+    subprocess.run([sys.executable, os.path.join(HERE, "mkfatimg.py"), image, song],
+                   check=True, stdout=subprocess.DEVNULL)
+    touches.write(script)
+    print("critbench: %s (%d s)" % (name, seconds), file=sys.stderr)
+    p = subprocess.run([player, "-s", image, "-t", script, "-j", report, "-d", str(seconds)],
+                       stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True, timeout=seconds * 10 + 60)
+    reports = sum(p.stderr.count(mark) for mark in sdstress.SANITIZER_MARKS)
+    if reports:
+        sys.stderr.write(p.stderr)
+    if p.returncode != 0:
+        sys.exit("critbench: %s exited with status %d" % (player, p.returncode))
+    with open(report) as f:
+        r = json.load(f)
+    if "critical" not in r:
+        sys.exit("critbench: %s was not built with make CRITMEAS=1" % player)
+    summary = playbench.summarize(name, r)
+    return {
+        "name": name,
+        "critical": r["critical"],
+        "sanitizer_reports": reports,
+        "underruns": summary["underruns"],
+        "frames": summary["frames"],
+    }
+
+
+def failures(result, max_us):
+    c = result["critical"]
+    out = []
+    if c["sections"] == 0:
+        out.append("no critical section timed")
+    if max_us is not None:
+        for site in c["worst"]:
+            if site["max_us"] > max_us:
+                out.append("%s:%d held interrupts off for %.1f us" % (site["file"], site["line"], site["max_us"]))
+    if result["sanitizer_reports"]:
+        out.append("%d sanitizer reports" % result["sanitizer_reports"])
+    if result["frames"] == 0:
+        out.append("the song did not play")
+    return out
+
+
+def main():
+    ap = argparse.ArgumentParser(description="OS_ENTER_CRITICAL() durations on the simulated board")
+    ap.add_argument("--player", default=os.path.join(HERE, "..", "Host", "build-critmeas", "mp3player"))
+    ap.add_argument("--seconds", type=int, default=30, help="length of each run")
+    ap.add_argument("--max-us", type=float, help="longest worst case a site may have (default: no limit)")
+    ap.add_argument("--seed", type=int, default=1, help="seed of the ui_load touches")
+    ap.add_argument("--workdir", help="keep the song, images and raw reports here")
+    ap.add_argument("-o", "--output", help="JSON output (default: stdout)")
+    args = ap.parse_args()
+
+    workdir = args.workdir or tempfile.mkdtemp(prefix="critbench-")
+    os.makedirs(workdir, exist_ok=True)
+    song = playbench.make_corpus(workdir, args.seconds + 5, 64)[0]
+
+    runs = []
+    for name, touches in (("playback", playbench.playback_script()),
+                          ("ui_load", playbench.ui_load_script(random.Random(args.seed)))):
+        result = run(args.player, workdir, name, song, touches, args.seconds)
+        result["failures"] = failures(result, args.max_us)
+        runs.append(result)
+        for site in result["critical"]["worst"][:5]:
+            print("critbench: %s: %8.1f us worst, %7.3f us avg, %8d times, prio %2d  %s:%d"
+                  % (name, site["max_us"], site["avg_us"], site["count"], site["prio"], site["file"], site["line"]),
+                  file=sys.stderr)
+
+    result = {"seconds": args.seconds, "max_us": args.max_us, "runs": runs}
+    text = json.dumps(result, indent=2)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text + "\n")
+    else:
+        print(text)
+    failed = [r for r in runs if r["failures"]]
+    for r in failed:
+        print("critbench: %s: %s" % (r["name"], "; ".join(r["failures"])), file=sys.stderr)
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
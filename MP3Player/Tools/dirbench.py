@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""
+dirbench.py
+
+Compares opening files by name in a large directory with and without the
+SD library's name index (SD_NAME_INDEXES in SdFat.h) on the Linux build.
+Each player runs the sdstress.py readers beside the player, on an image
+with --fillers small files ahead of the pattern files in the root
+directory: a reader that opens a pattern file by path has to find it past
+them. Reported per player, as JSON:
+
+  - opens by name and the directory entries they read, per open
+  - SD blocks read, and pattern files the readers got through
+  - Mp3SDTask CPU use and underruns, the player's share of the card
+
+    make -C Host dirbench
+    Tools/dirbench.py --player scan=Host/build-names0/mp3player --player index=Host/build/mp3player
+"""
+
+import argparse
+import json
+import os
+import random
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import playbench
+import sdstress
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+def measure(player, workdir, files, readers, seconds):
+    os.makedirs(workdir, exist_ok=True)
+    r = sdstress.run(player, workdir, "names", files, readers, seconds, [])
+    names = r["sd_names"]
+    stress = r["stress"]
+    with open(os.path.join(workdir, "names.json")) as f:
+        blocks = json.load(f)["sd"]["blocks_read"]
+    return {
+        "lookups": names["lookups"],
+        "entries": names["entries"],
+        "entries_per_lookup": round(names["entries"] / max(1, names["lookups"]), 1),
+        "sd_blocks_read": blocks,
+        "files_read": stress["files"],
+        "mismatches": stress["mismatches"],
+        "errors": stress["errors"],
+        "sd_task_cpu_pct": r["sd_task_cpu_pct"],
+        "underruns": r["underruns"],
+    }
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Opening files by name in a large directory on the simulated board")
+    ap.add_argument("--player", action="append", metavar="NAME=PATH",
+                    help="a player to compare, built with make SD_NAMES=indexes (repeat)")
+    ap.add_argument("--fillers", type=int, default=600, help="files ahead of the pattern files")
+    ap.add_argument("--files", type=int, default=12, help="pattern files")
+    ap.add_argument("--readers", type=int, default=2, help="reader tasks")
+    ap.add_argument("--seconds", type=int, default=15, help="length of each run")
+    ap.add_argument("--workdir", help="keep the files, images and raw reports here")
+    ap.add_argument("-o", "--output", help="JSON output (default: stdout)")
+    args = ap.parse_args()
+
+    players = [p.split("=", 1) for p in args.player or
+               ["index=" + os.path.join(HERE, "..", "Host", "build", "mp3player")]]
+
+    workdir = args.workdir or tempfile.mkdtemp(prefix="dirbench-")
+    os.makedirs(workdir, exist_ok=True)
+    song = playbench.make_corpus(workdir, args.seconds + 5, 64)[0]
+    files = ([song] + sdstress.make_fillers(workdir, args.fillers) +
+             sdstress.make_patterns(workdir, args.files, random.Random(5)))
+
+    result = {"fillers": args.fillers, "files": args.files, "readers": args.readers, "seconds": args.seconds,
+              "players": dict(players)}
+    for label, player in players:
+        result[label] = measure(player, os.path.join(workdir, label), files, args.readers, args.seconds)
+    text = json.dumps(result, indent=2)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text + "\n")
+    else:
+        print(text)
+
+
+if __name__ == "__main__":
+    main()
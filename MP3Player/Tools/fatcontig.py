@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+"""
+fatcontig.py
+
+Lists how the files of a FAT16 or FAT32 SD card, or image of one, are laid
+out: the runs of consecutive clusters each is stored in. A file in one run
+is contiguous, and the player streams it straight from the card a block at
+a time (SdRawStream, see Mp3StreamFile()); the others go through the SD
+library and its cache. With --defrag, each fragmented file is copied to
+the first run of free clusters that holds it, so it becomes contiguous.
+
+The volume is found as SdVolume::init() finds it: the first partition of
+the MBR, else a FAT boot sector in block zero.
+
+    fatcontig.py sd.img
+    fatcontig.py --check sd.img             exit status 1 if a file is fragmented
+    fatcontig.py --defrag /dev/sdX          unmount it first
+    fatcontig.py -j layout.json sd.img
+
+Only the first FAT is read; --defrag writes all of them. There are no long
+names, the paths are the 8.3 names the SD library shows.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+SECTOR = 512
+
+
+class Volume:
+    """A FAT16 or FAT32 volume in an image file or on a block device."""
+
+    def __init__(self, f):
+        self.f = f
+        self.start = 0
+        mbr = self.read(0, 1)
+        boot, _, _, _, first, total = struct.unpack_from("<B3sB3sII", mbr, 446)
+        if (boot & 0x7F) == 0 and total >= 100 and first != 0 and self.parse(first):
+            self.start = first
+        elif not self.parse(0):
+            sys.exit("fatcontig: no FAT16 or FAT32 volume found")
+        self.entry = "I" if self.fat_type == 32 else "H"
+        self.per_sector = SECTOR // struct.calcsize(self.entry)
+        self.fat = list(struct.unpack("<%d%s" % (self.fat_sectors * self.per_sector, self.entry),
+                                      self.read(self.fat_start, self.fat_sectors)))
+        self.dirty = set()
+
+    def parse(self, lba):
+        bpb = self.read(lba, 1)
+        bps, spc, reserved, fats, root_entries, total16, _, fat16, = struct.unpack_from("<HBHBHHBH", bpb, 11)
+        total32, fat32, = struct.unpack_from("<II", bpb, 32)
+        if bps != SECTOR or fats == 0 or spc == 0 or spc & (spc - 1) or bpb[510:512] != b"\x55\xaa":
+            return False
+        self.spc = spc
+        self.fats = fats
+        self.fat_sectors = fat16 or fat32
+        self.fat_start = lba + reserved
+        self.root_sectors = (root_entries * 32 + SECTOR - 1) // SECTOR
+        self.root_start = self.fat_start + fats * self.fat_sectors
+        self.data_start = self.root_start + self.root_sectors
+        total = total16 or total32
+        self.clusters = (lba + total - self.data_start) // spc
+        if self.clusters < 4085:
+            return False        # FAT12, not for the SD library
+        self.fat_type = 16 if self.clusters < 65525 else 32
+        self.root_cluster = struct.unpack_from("<I", bpb, 44)[0] if self.fat_type == 32 else 0
+        self.fsinfo = lba + struct.unpack_from("<H", bpb, 48)[0] if self.fat_type == 32 else 0
+        return True
+
+    def read(self, lba, count):
+        self.f.seek(lba * SECTOR)
+        return self.f.read(count * SECTOR)
+
+    def write(self, lba, data):
+        self.f.seek(lba * SECTOR)
+        self.f.write(data)
+
+    @property
+    def cluster_bytes(self):
+        return self.spc * SECTOR
+
+    def cluster_lba(self, cluster):
+        return self.data_start + (cluster - 2) * self.spc
+
+    def is_eoc(self, value):
+        return value >= (0x0FFFFFF8 if self.fat_type == 32 else 0xFFF8)
+
+    def get(self, cluster):
+        return self.fat[cluster] & 0x0FFFFFFF if self.fat_type == 32 else self.fat[cluster]
+
+    def put(self, cluster, value):
+        if self.fat_type == 32:
+            value |= self.fat[cluster] & 0xF0000000
+        self.fat[cluster] = value
+        self.dirty.add(cluster // self.per_sector)
+
+    def chain(self, cluster):
+        """Clusters of the chain starting at cluster."""
+        chain = []
+        while 2 <= cluster < self.clusters + 2 and len(chain) <= self.clusters:
+            chain.append(cluster)
+            cluster = self.get(cluster)
+            if self.is_eoc(cluster):
+                return chain
+        sys.exit("fatcontig: bad cluster chain at cluster %d" % (chain[-1] if chain else cluster))
+
+    def flush(self):
+        """Write the FAT sectors changed to every FAT."""
+        for sector in sorted(self.dirty):
+            entries = self.fat[sector * self.per_sector:(sector + 1) * self.per_sector]
+            data = struct.pack("<%d%s" % (self.per_sector, self.entry), *entries)
+            for copy in range(self.fats):
+                self.write(self.fat_start + copy * self.fat_sectors + sector, data)
+        self.dirty.clear()
+
+    def entries(self, cluster, path=""):
+        """(path, size, first cluster, image offset of the entry) of the files
+        in the directory at cluster, 0 for the FAT16 root, and below it."""
+        if cluster == 0 and self.fat_type == 16:
+            spans = [(self.root_start, self.root_sectors)]
+        else:
+            spans = [(self.cluster_lba(c), self.spc) for c in self.chain(cluster or self.root_cluster)]
+        for lba, count in spans:
+            data = self.read(lba, count)
+            for i in range(0, len(data), 32):
+                name, attr = data[i:i + 11], data[i + 11]
+                if name[0] == 0:
+                    return
+                if name[0] == 0xE5 or attr & 0x0F == 0x0F or attr & 0x08 or name[0] == ord("."):
+                    continue
+                hi, lo, size = struct.unpack_from("<H4xHI", data, i + 20)
+                base, ext = name[:8].decode("ascii", "replace").rstrip(), name[8:].decode("ascii", "replace").rstrip()
+                full = path + "/" + base + ("." + ext if ext else "")
+                if attr & 0x10:
+                    yield from self.entries(hi << 16 | lo, full)
+                else:
+                    yield full, size, hi << 16 | lo, lba * SECTOR + i
+
+    def free_run(self, count):
+        """First cluster of the first count free clusters in a row, or None."""
+        run = 0
+        for cluster in range(2, self.clusters + 2):
+            run = run + 1 if self.get(cluster) == 0 else 0
+            if run == count:
+                return cluster - count + 1
+        return None
+
+
+def runs(chain):
+    """The chain as [first cluster, count] runs of consecutive clusters."""
+    out = []
+    for cluster in chain:
+        if out and out[-1][0] + out[-1][1] == cluster:
+            out[-1][1] += 1
+        else:
+            out.append([cluster, 1])
+    return out
+
+
+def defrag(vol, size, first, offset):
+    """Copy a file to free consecutive clusters; returns its new first
+    cluster, or None if no free run is long enough."""
+    chain = vol.chain(first)
+    need = -(-size // vol.cluster_bytes)
+    if len(chain) < need:
+        return None
+    new = vol.free_run(need)
+    if new is None:
+        return None
+    # data first, then the FAT, then the directory entry
+    for i, cluster in enumerate(chain[:need]):
+        vol.write(vol.cluster_lba(new + i), vol.read(vol.cluster_lba(cluster), vol.spc))
+    for i in range(need):
+        vol.put(new + i, new + i + 1 if i < need - 1 else 0x0FFFFFFF if vol.fat_type == 32 else 0xFFFF)
+    for cluster in chain:
+        vol.put(cluster, 0)
+    vol.flush()
+    vol.f.seek(offset + 20)
+    vol.f.write(struct.pack("<H", new >> 16))
+    vol.f.seek(offset + 26)
+    vol.f.write(struct.pack("<H", new & 0xFFFF))
+    if vol.fsinfo and len(chain) > need:
+        info = bytearray(vol.read(vol.fsinfo, 1))
+        if info[0:4] == b"RRaA" and info[484:488] == b"rrAa":
+            free = struct.unpack_from("<I", info, 488)[0]
+            if free != 0xFFFFFFFF:
+                struct.pack_into("<I", info, 488, free + len(chain) - need)
+                vol.write(vol.fsinfo, bytes(info))
+    return new
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Contiguous and fragmented files of a FAT SD card or image")
+    ap.add_argument("image", help="SD card image or block device")
+    ap.add_argument("--defrag", action="store_true", help="make the fragmented files contiguous")
+    ap.add_argument("--check", action="store_true", help="exit status 1 if any file is fragmented")
+    ap.add_argument("-j", "--json", help="write the layout of every file as JSON")
+    args = ap.parse_args()
+
+    with open(args.image, "r+b" if args.defrag else "rb") as f:
+        vol = Volume(f)
+        files = []
+        for path, size, first, offset in list(vol.entries(0)):
+            chain = vol.chain(first)[:-(-size // vol.cluster_bytes)] if first else []
+            extents = runs(chain)
+            moved = None
+            if args.defrag and len(extents) > 1:
+                moved = defrag(vol, size, first, offset)
+                if moved is not None:
+                    extents = [[moved, len(chain)]]
+            files.append({"path": path, "size": size, "runs": extents, "contiguous": len(extents) <= 1,
+                          "moved": moved is not None})
+
+    print("FAT%d, %d byte clusters, %d clusters" % (vol.fat_type, vol.cluster_bytes, vol.clusters))
+    for entry in files:
+        state = "contiguous" if entry["contiguous"] else "%d runs" % len(entry["runs"])
+        print("  %-12s %10d  %s%s" % (state, entry["size"], entry["path"], "  (moved)" if entry["moved"] else ""))
+    fragmented = [entry for entry in files if not entry["contiguous"]]
+    print("%d of %d files contiguous%s" % (len(files) - len(fragmented), len(files),
+          ", %d with no free run to move to" % len(fragmented) if args.defrag and fragmented else ""))
+
+    if args.json:
+        with open(args.json, "w") as out:
+            json.dump({"fat": vol.fat_type, "cluster_bytes": vol.cluster_bytes, "files": files}, out, indent=2)
+            out.write("\n")
+    if args.check and fragmented:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
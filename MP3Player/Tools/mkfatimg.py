@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""
+mkfatimg.py
+
+Make an SD card image for the Linux build (Host/simSD.c): an MBR with one
+FAT16 or FAT32 partition holding the given files in its root directory,
+each stored in consecutive clusters, or with --fragment N, interleaved in
+runs of N clusters as if they had been written at the same time.
+
+File names become 8.3 names, as the SD library shows them: upper case,
+with a ~N suffix where two would clash. There are no long names.
+
+    mkfatimg.py sd.img ../MP3data/*.mp3
+    mkfatimg.py --size 256 --fat 16 sd.img song1.mp3 song2.mp3
+    mkfatimg.py --size 1024 --fat 16 --cluster-kb 32 sd.img song.mp3
+    mkfatimg.py --fragment 1 sd.img ../MP3data/*.mp3
+
+Without --cluster-kb the clusters are the smallest the size allows, 512
+bytes on a 64 MB FAT32 image; cards formatted by the SD Association's
+formatter have 32 KB ones.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+import time
+
+SECTOR = 512
+PART_START = 2048           # first partition sector, 1 MB aligned like SD cards
+
+
+def short_name(path, used):
+    """8.3 directory entry name (11 bytes) for path, unique among used."""
+    base, ext = os.path.splitext(os.path.basename(path))
+    clean = lambda s: re.sub(r"[^A-Z0-9_$~!#%&\-{}()@'`^]", "", s.upper())
+    base, ext = clean(base) or "FILE", clean(ext[1:])[:3]
+    name = base[:8]
+    n = 1
+    while (name, ext) in used:
+        suffix = "~%d" % n
+        name = base[:8 - len(suffix)] + suffix
+        n += 1
+    used.add((name, ext))
+    return (name.ljust(8) + ext.ljust(3)).encode("ascii")
+
+
+def fat_datetime(t):
+    tm = time.localtime(t)
+    date = ((max(tm.tm_year, 1980) - 1980) << 9) | (tm.tm_mon << 5) | tm.tm_mday
+    tod = (tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec // 2)
+    return date, tod
+
+
+def layout(sectors, fat_type, spc):
+    """Reserved sectors, root directory sectors, FAT sectors and cluster count."""
+    reserved = 32 if fat_type == 32 else 1
+    root_sectors = 0 if fat_type == 32 else 512 * 32 // SECTOR
+    entry_bits = 32 if fat_type == 32 else 16
+    fat_sectors = 1
+    while True:
+        clusters = (sectors - reserved - root_sectors - 2 * fat_sectors) // spc
+        need = -(-(clusters + 2) * entry_bits // 8 // SECTOR)
+        if need <= fat_sectors:
+            return reserved, root_sectors, fat_sectors, clusters
+        fat_sectors = need
+
+
+def choose(sectors, fat_type, cluster_kb=None):
+    """Smallest cluster size, or the one asked for, that gives a cluster
+    count valid for fat_type."""
+    lo, hi = (65525, 0x0FFFFFF5) if fat_type == 32 else (4085, 65524)
+    sizes = (cluster_kb * 1024 // SECTOR,) if cluster_kb else (1, 2, 4, 8, 16, 32, 64, 128)
+    for spc in sizes:
+        geometry = layout(sectors, fat_type, spc)
+        if lo <= geometry[3] <= hi:
+            return (spc,) + geometry
+    sys.exit("mkfatimg: %d MB is the wrong size for FAT%d%s" % (sectors * SECTOR >> 20, fat_type,
+             " with %d KB clusters" % cluster_kb if cluster_kb else ""))
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Make a FAT SD card image for Host/simSD.c")
+    ap.add_argument("image")
+    ap.add_argument("files", nargs="*")
+    ap.add_argument("--size", type=int, help="image size in MB (default: room for the files, at least 64)")
+    ap.add_argument("--fat", type=int, choices=(16, 32), default=32)
+    ap.add_argument("--cluster-kb", type=int, choices=(1, 2, 4, 8, 16, 32, 64), help="cluster size")
+    ap.add_argument("--fragment", type=int, metavar="N",
+                    help="interleave the files' clusters in runs of N instead of storing each file in one piece")
+    args = ap.parse_args()
+
+    data = sum(os.path.getsize(f) for f in args.files)
+    size_mb = args.size or max(64, (data >> 20) * 5 // 4 + 16)
+    total = (size_mb << 20) // SECTOR
+    sectors = total - PART_START
+
+    spc, reserved, root_sectors, fat_sectors, clusters = choose(sectors, args.fat, args.cluster_kb)
+    cluster_bytes = spc * SECTOR
+    fat_start = PART_START + reserved
+    root_start = fat_start + 2 * fat_sectors
+    data_start = root_start + root_sectors
+
+    # Allocate: the FAT32 root directory first, then the files, each in
+    # turn or round robin N clusters at a time. chains[i] lists the
+    # clusters of the i-th file.
+    fat = [0x0FFFFFF8 if args.fat == 32 else 0xFFF8, 0x0FFFFFFF if args.fat == 32 else 0xFFFF]
+    eoc = 0x0FFFFFFF if args.fat == 32 else 0xFFFF
+
+    def link(chain):
+        for cluster, following in zip(chain, chain[1:] + [eoc]):
+            fat[cluster] = following
+
+    def allocate(counts):
+        chains = [[] for _ in counts]
+        run = args.fragment or max(counts + [1])
+        while any(len(chain) < count for chain, count in zip(chains, counts)):
+            for chain, count in zip(chains, counts):
+                n = min(run, count - len(chain))
+                if len(fat) + n - 2 > clusters:
+                    sys.exit("mkfatimg: the files do not fit in %d MB" % size_mb)
+                chain.extend(range(len(fat), len(fat) + n))
+                fat.extend([0] * n)
+        for chain in chains:
+            link(chain)
+        return chains
+
+    entries = [struct.pack("<11sB20x", b"MP3PLAYER  ", 0x08)]     # volume label
+    used = set()
+    dir_bytes = (len(args.files) + 2) * 32      # label, files, end of directory
+    if args.fat == 16 and dir_bytes > root_sectors * SECTOR:
+        sys.exit("mkfatimg: too many files for the FAT16 root directory")
+    root_cluster = allocate([-(-dir_bytes // cluster_bytes)])[0][0] if args.fat == 32 else 0
+
+    sizes = [os.path.getsize(path) for path in args.files]
+    chains = allocate([-(-nbytes // cluster_bytes) for nbytes in sizes])
+    for path, nbytes, chain in zip(args.files, sizes, chains):
+        first = chain[0] if chain else 0
+        date, tod = fat_datetime(os.path.getmtime(path))
+        entries.append(struct.pack("<11sBBBHHHHHHHI", short_name(path, used), 0x20, 0, 0,
+                                   tod, date, date, first >> 16, tod, date, first & 0xFFFF, nbytes))
+
+    with open(args.image, "wb") as img:
+        img.truncate(total * SECTOR)
+
+        # MBR with one partition
+        part_type = 0x0C if args.fat == 32 else 0x06
+        mbr = bytearray(SECTOR)
+        mbr[446:462] = struct.pack("<B3sB3sII", 0x00, b"\xfe\xff\xff", part_type, b"\xfe\xff\xff",
+                                   PART_START, sectors)
+        mbr[510:512] = b"\x55\xaa"
+        img.seek(0)
+        img.write(mbr)
+
+        # Boot sector
+        boot = bytearray(SECTOR)
+        boot[0:36] = struct.pack("<3s8sHBHBHHBHHHII", b"\xeb\x58\x90", b"MKFATIMG", SECTOR, spc,
+                                 reserved, 2, 512 if args.fat == 16 else 0,
+                                 sectors if sectors < 0x10000 else 0, 0xF8,
+                                 fat_sectors if args.fat == 16 else 0, 63, 255, PART_START,
+                                 sectors if sectors >= 0x10000 else 0)
+        if args.fat == 32:
+            boot[36:90] = struct.pack("<IHHIHH12sBBBI11s8s", fat_sectors, 0, 0, root_cluster, 1, 6,
+                                      bytes(12), 0x80, 0, 0x29, 0x12345678, b"MP3PLAYER  ", b"FAT32   ")
+        else:
+            boot[36:62] = struct.pack("<BBBI11s8s", 0x80, 0, 0x29, 0x12345678, b"MP3PLAYER  ", b"FAT16   ")
+        boot[510:512] = b"\x55\xaa"
+        img.seek(PART_START * SECTOR)
+        img.write(boot)
+        if args.fat == 32:
+            free = clusters - (len(fat) - 2)
+            fsinfo = bytearray(SECTOR)
+            fsinfo[0:4] = b"RRaA"
+            fsinfo[484:496] = struct.pack("<4sII", b"rrAa", free, len(fat))
+            fsinfo[508:512] = b"\x00\x00\x55\xaa"
+            img.seek((PART_START + 1) * SECTOR)
+            img.write(fsinfo)
+            img.seek((PART_START + 6) * SECTOR)
+            img.write(boot)
+
+        # Both FATs
+        table = struct.pack("<%d%s" % (len(fat), "I" if args.fat == 32 else "H"), *fat)
+        for copy in range(2):
+            img.seek((fat_start + copy * fat_sectors) * SECTOR)
+            img.write(table)
+
+        # Root directory
+        directory = b"".join(entries)
+        img.seek((data_start + (root_cluster - 2) * spc if args.fat == 32 else root_start) * SECTOR)
+        img.write(directory)
+
+        # File data
+        for path, chain in zip(args.files, chains):
+            with open(path, "rb") as f:
+                for cluster in chain:
+                    img.seek((data_start + (cluster - 2) * spc) * SECTOR)
+                    img.write(f.read(cluster_bytes))
+
+    print("%s: %d MB FAT%d, %d byte clusters, %d files%s" %
+          (args.image, size_mb, args.fat, cluster_bytes, len(args.files),
+           ", fragmented in runs of %d clusters" % args.fragment if args.fragment else ""))
+
+
+if __name__ == "__main__":
+    main()
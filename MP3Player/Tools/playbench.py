@@ -0,0 +1,371 @@
+#!/usr/bin/env python3
+"""
+playbench.py
+
+End-to-end playback benchmark on the Linux build with simulated devices
+(Host/Makefile, SIM=1). Plays a generated corpus through the real
+Mp3SDTask -> Mp3StreamFile -> Write(hMp3) path and reports, as JSON:
+
+  - decoder underruns (gaps a listener would hear, user pauses excluded),
+    underrun time and the lowest VS1053 FIFO level
+  - SPI1 and I2C1 utilization, per device; SPI1 lock contention and bus
+    reconfigurations, per client
+  - CPU use per task
+  - button-to-audio latency: from the finger touching a button to the
+    change in the audio output it asks for
+
+The corpus is MPEG-1 layer III at 44.1 kHz: CBR 128, 192 and 320 kbit/s,
+VBR with a Xing header, and CBR 128 behind a large ID3v2 tag with cover
+art. The frames are valid headers with silent payloads, which is all the
+VS1053 model looks at. Each file is first played alone; then all of them
+are played under scripted UI load: a touch storm, volume spam, next and
+previous, pause and stop.
+
+Presses are scheduled in simulated touch controller time and the
+controller model keeps a finger down until the player has read it, so the
+same presses are seen on every run. Each latency is reported with whether
+its press was detected, and each run and button with how many were.
+
+A last run pauses a song for two seconds to starve the decoder on purpose.
+The bench fails (exit status 1, see "failures") if that underrun is not
+reported as most of the pause, or if the player missed a press.
+
+    make -C Host && Tools/playbench.py -o bench.json
+    Tools/playbench.py --player Host/build-address/mp3player --seconds 10
+"""
+
+import argparse
+import json
+import os
+import random
+import statistics
+import struct
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+# Screen rectangles of the buttons (center x, center y, 60 x 50), see
+# LcdTouchTask. The panel reports (240 - x, 320 - y).
+BUTTONS = {
+    "pause": (210, 290),
+    "play": (140, 290),
+    "next": (70, 290),
+    "previous": (70, 230),
+    "stop": (210, 230),
+    "volup": (210, 170),
+    "voldown": (210, 110),
+}
+
+# Audio events (Host/simVS1053.c) that show a press took effect
+EXPECTED = {
+    "play": ("start", "resume"),
+    "pause": ("starve",),
+    "stop": ("reset",),
+    "next": ("reset",),
+    "previous": ("reset",),
+    "volup": ("volume",),
+    "voldown": ("volume",),
+}
+
+# A press with no such event before the next press or this long is reported
+# as having no effect (latency null)
+LATENCY_WINDOW_MS = 10000
+
+# The touch storm of ui_load_script() is the same on every run
+UI_LOAD_SEED = 3
+
+# The pause of pause_script() starves the decoder on purpose. It must come
+# out as most of the pause: all of it but the FIFO draining and the
+# button's latency
+PAUSE_AT_MS = 3000
+PAUSE_MS = 2000
+FORCED_UNDERRUN_MIN_MS = PAUSE_MS / 2
+
+MPEG1_L3_BITRATES = [0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320]
+SAMPLE_RATE = 44100
+FRAME_SECONDS = 1152 / SAMPLE_RATE
+
+
+def frame(kbps, padding, payload=b""):
+    """One MPEG-1 layer III frame, joint stereo, no CRC."""
+    index = MPEG1_L3_BITRATES.index(kbps)
+    length = 144000 * kbps // SAMPLE_RATE + padding
+    header = bytes((0xFF, 0xFB, (index << 4) | (padding << 1), 0x44))
+    return header + payload + bytes(length - 4 - len(payload))
+
+
+def cbr(kbps, seconds):
+    out = bytearray()
+    rest = 0
+    for _ in range(int(seconds / FRAME_SECONDS)):
+        # Pad as encoders do so the average rate is exact
+        rest += 144000 * kbps % SAMPLE_RATE
+        padding = 1 if rest >= SAMPLE_RATE else 0
+        rest -= padding * SAMPLE_RATE
+        out += frame(kbps, padding)
+    return bytes(out)
+
+
+def vbr(seconds, seed=1):
+    rng = random.Random(seed)
+    frames = [frame(rng.choice(MPEG1_L3_BITRATES[5:]), 0) for _ in range(int(seconds / FRAME_SECONDS))]
+    # Xing header frame: side information (32 bytes) then the tag
+    xing = b"Xing" + struct.pack(">II", 3, len(frames)) + struct.pack(">I", sum(map(len, frames)))
+    return frame(128, 0, bytes(32) + xing) + b"".join(frames)
+
+
+def id3_art(art_bytes, seed=2):
+    """ID3v2.3 tag with a title and an APIC frame of random "image" data."""
+    rng = random.Random(seed)
+    art = b"\xff\xd8\xff\xe0" + bytes(rng.getrandbits(8) for _ in range(art_bytes - 4))
+    title = b"\x00Cover art test"
+    apic = b"\x00image/jpeg\x00\x03\x00" + art
+    frames = (b"TIT2" + struct.pack(">IH", len(title), 0) + title +
+              b"APIC" + struct.pack(">IH", len(apic), 0) + apic)
+    size = len(frames)
+    syncsafe = bytes(((size >> 21) & 0x7F, (size >> 14) & 0x7F, (size >> 7) & 0x7F, size & 0x7F))
+    return b"ID3\x03\x00\x00" + syncsafe + frames
+
+
+def make_corpus(directory, seconds, art_kb):
+    corpus = {
+        "CBR128.MP3": cbr(128, seconds),
+        "CBR192.MP3": cbr(192, seconds),
+        "CBR320.MP3": cbr(320, seconds),
+        "VBR.MP3": vbr(seconds),
+        "ID3ART.MP3": id3_art(art_kb * 1024) + cbr(128, seconds),
+    }
+    paths = []
+    for name, data in corpus.items():
+        path = os.path.join(directory, name)
+        with open(path, "wb") as f:
+            f.write(data)
+        paths.append(path)
+    return paths
+
+
+class Touches:
+    """A touch script for Host/simFT6206.c, in screen coordinates."""
+
+    def __init__(self):
+        self.lines = []
+
+    def tap(self, ms, x, y, hold=80):
+        self.lines.append((ms, "%d %d %d" % (ms, 240 - x, 320 - y)))
+        self.lines.append((ms + hold, "%d up" % (ms + hold)))
+
+    def press(self, ms, button, hold=80):
+        self.tap(ms, *BUTTONS[button], hold=hold)
+
+    def write(self, path):
+        with open(path, "w") as f:
+            f.write("# ms x y | ms up, written by playbench.py\n")
+            for _, line in sorted(self.lines):
+                f.write(line + "\n")
+
+
+def playback_script():
+    t = Touches()
+    t.press(1000, "play")
+    return t
+
+
+def pause_script():
+    t = Touches()
+    t.press(1000, "play")
+    t.press(PAUSE_AT_MS, "pause")
+    t.press(PAUSE_AT_MS + PAUSE_MS, "play")
+    return t
+
+
+def ui_load_script(rng):
+    t = Touches()
+    t.press(1000, "play")
+    # Touch storm on the text area, away from the buttons
+    for ms in range(3000, 5000, 25):
+        t.tap(ms, rng.randrange(0, 160), rng.randrange(0, 100), hold=10)
+    # Volume spam
+    for i, ms in enumerate(range(6000, 9000, 150)):
+        t.press(ms, "volup" if i % 2 == 0 else "voldown", hold=60)
+    t.press(10000, "next")
+    t.press(13000, "next")
+    t.press(16000, "previous")
+    t.press(19000, "pause")
+    t.press(21000, "play")
+    t.press(23000, "stop")
+    t.press(25000, "play")
+    return t
+
+
+def button_at(x, y):
+    for name, (cx, cy) in BUTTONS.items():
+        if abs(x - cx) <= 30 and abs(y - cy) <= 25:
+            return name
+    return None
+
+
+def presses(report):
+    """Button presses from the touch log: a finger landing on a button, and
+    whether the player read the point (Host/simFT6206.c)."""
+    out = []
+    down = False
+    for touch in report["touches"]:
+        if touch.get("up"):
+            down = False
+            continue
+        if not down:
+            button = button_at(240 - touch["x"], 320 - touch["y"])
+            if button:
+                out.append((touch["ms"], button, "seen_ms" in touch))
+        down = True
+    return out
+
+
+def latencies(report):
+    events = report["audio_events"]
+    taps = presses(report)
+    result = []
+    for i, (ms, button, seen) in enumerate(taps):
+        limit = min(ms + LATENCY_WINDOW_MS, taps[i + 1][0] if i + 1 < len(taps) else float("inf"))
+        hit = next((e for e in events if ms <= e["ms"] < limit and e["event"] in EXPECTED[button]), None)
+        result.append({"button": button, "ms": ms, "detected": seen,
+                       "latency_ms": round(hit["ms"] - ms, 3) if hit else None})
+    return result
+
+
+def audible_underruns(report):
+    """Starve/resume gaps not explained by the user pausing or stopping."""
+    taps = [(ms, button) for ms, button, _ in presses(report)]
+    gaps = []
+    starve = None
+    for e in report["audio_events"]:
+        if e["event"] == "starve":
+            starve = e["ms"]
+        elif e["event"] == "resume" and starve is not None:
+            last = [b for ms, b in taps if ms <= starve]
+            if not last or last[-1] not in ("pause", "stop"):
+                gaps.append(round(e["ms"] - starve, 3))
+            starve = None
+        elif e["event"] == "reset":
+            starve = None
+    return gaps
+
+
+def summarize(name, report):
+    gaps = audible_underruns(report)
+    result = {
+        "name": name,
+        "elapsed_s": report["elapsed_s"],
+        "underruns": len(gaps),
+        "underrun_ms": round(sum(gaps), 3),
+        "decoder_starvations": report["vs1053"]["underruns"],
+        "decoder_starved_ms": report["vs1053"]["underrun_ms"],
+        "min_fifo": report["vs1053"]["min_fifo"],
+        "fifo_size": report["vs1053"]["fifo_size"],
+        "overflows": report["vs1053"]["overflows"],
+        "frames": report["vs1053"]["frames"],
+        "spi1_busy_pct": report["spi1"]["busy_pct"],
+        "spi1_devices": {d["name"]: d["busy_pct"] for d in report["spi1"]["devices"]},
+        "spi1_clients": {c["client"]: {k: c[k] for k in ("contended", "yields", "max_wait_us", "max_hold_us",
+                                                         "reconfigs")}
+                         for c in report["spi1"]["clients"]},
+        "i2c1_busy_pct": sum(d["busy_pct"] for d in report["i2c1"]["devices"]),
+        "cpu_pct": {t["name"]: t["cpu_pct"] for t in report["tasks"]},
+        "sd_blocks_read": report["sd"]["blocks_read"],
+        "sd_read_commands": report["sd"]["read_commands"],
+        "sd_mb_per_s": report["sd"]["mb_per_s"],
+        "sd_cache": report["sd_cache"],
+        "latency": latencies(report),
+    }
+    result["presses"] = len(result["latency"])
+    result["presses_detected"] = sum(lat["detected"] for lat in result["latency"])
+    return result
+
+
+def run(player, workdir, name, files, touches, seconds, image_args=()):
+    """Play files from a fresh image, made with mkfatimg.py image_args."""
+    image = os.path.join(workdir, name + ".img")
+    script = os.path.join(workdir, name + ".touch")
+    report = os.path.join(workdir, name + ".json")
+    subprocess.run([sys.executable, os.path.join(HERE, "mkfatimg.py")] + list(image_args) + [image] + files,
+                   check=True, stdout=subprocess.DEVNULL)
+    touches.write(script)
+    print("playbench: %s (%d s)" % (name, seconds), file=sys.stderr)
+    subprocess.run([player, "-s", image, "-t", script, "-j", report, "-d", str(seconds)],
+                   check=True, stdout=subprocess.DEVNULL, timeout=seconds * 4 + 30)
+    with open(report) as f:
+        return summarize(name, json.load(f))
+
+
+def main():
+    ap = argparse.ArgumentParser(description="End-to-end playback benchmark on the simulated board")
+    ap.add_argument("--player", default=os.path.join(HERE, "..", "Host", "build", "mp3player"))
+    ap.add_argument("--seconds", type=int, default=15, help="length of each playback run")
+    ap.add_argument("--art-kb", type=int, default=512, help="size of the cover art in ID3ART.MP3")
+    ap.add_argument("--workdir", help="keep the corpus, images and raw reports here")
+    ap.add_argument("-o", "--output", help="JSON output (default: stdout)")
+    args = ap.parse_args()
+
+    workdir = args.workdir or tempfile.mkdtemp(prefix="playbench-")
+    os.makedirs(workdir, exist_ok=True)
+    corpus = make_corpus(workdir, max(args.seconds, 30) + 5, args.art_kb)
+
+    runs = []
+    for path in corpus:
+        name = os.path.splitext(os.path.basename(path))[0].lower()
+        runs.append(run(args.player, workdir, name, [path], playback_script(), args.seconds))
+    runs.append(run(args.player, workdir, "ui_load", corpus, ui_load_script(random.Random(UI_LOAD_SEED)), 28))
+    forced = run(args.player, workdir, "forced_underrun", corpus[:1], pause_script(),
+                 (PAUSE_AT_MS + PAUSE_MS) // 1000 + 3)
+
+    failures = []
+    for r in runs + [forced]:
+        if r["presses_detected"] < r["presses"]:
+            failures.append("%s: the player read %d of %d button presses" %
+                            (r["name"], r["presses_detected"], r["presses"]))
+    if forced["decoder_starved_ms"] < FORCED_UNDERRUN_MIN_MS:
+        failures.append("a %d ms pause starved the decoder for %.3f ms only" %
+                        (PAUSE_MS, forced["decoder_starved_ms"]))
+
+    by_button = {}
+    for r in runs:
+        for lat in r["latency"]:
+            by_button.setdefault(lat["button"], []).append(lat)
+    def stats(lats):
+        hits = [lat["latency_ms"] for lat in lats if lat["latency_ms"] is not None]
+        return {
+            "presses": len(lats),
+            "detected": sum(lat["detected"] for lat in lats),
+            "no_effect": len(lats) - len(hits),
+            "median": statistics.median(hits) if hits else None,
+            "max": max(hits) if hits else None,
+        }
+
+    summary = {
+        "underruns": sum(r["underruns"] for r in runs),
+        "underrun_ms": round(sum(r["underrun_ms"] for r in runs), 3),
+        "min_fifo": min(r["min_fifo"] for r in runs),
+        "spi1_busy_pct_max": max(r["spi1_busy_pct"] for r in runs),
+        "mp3_lock_wait_us_max": max(r["spi1_clients"]["mp3"]["max_wait_us"] for r in runs),
+        "spi1_reconfigs": sum(c["reconfigs"] for r in runs for c in r["spi1_clients"].values()),
+        "latency_ms": {button: stats(values) for button, values in sorted(by_button.items())},
+        "forced_underrun_ms": forced["decoder_starved_ms"],
+    }
+
+    result = {"seconds": args.seconds, "art_kb": args.art_kb, "runs": runs, "summary": summary,
+              "failures": failures}
+    text = json.dumps(result, indent=2)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text + "\n")
+    else:
+        print(text)
+    for failure in failures:
+        print("playbench: FAIL: " + failure, file=sys.stderr)
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+"""
+sdstress.py
+
+Stress test of the SD library's locking on the Linux build: the player
+streams a song while reader tasks (mp3player -r, Host/simSDStress.c) read
+pattern files from the same card through SD.h, in order, at random offsets
+and a byte at a time, and check every byte. Runs on an image with each
+file in consecutive clusters and on one with the files' clusters
+interleaved (mkfatimg.py --fragment), where every reader also walks the
+FAT through the shared cache. With --fillers, small files are put ahead
+of the pattern files in the directory, so that finding one by name means
+getting past them. With --corrupt N, the simulated card flips a bit of
+every Nth block it sends (mp3player -e), and the SD library's CRC checks
+have to catch and read again every one of them. With --garble N, it flips
+a bit of the start token of every Nth block (mp3player -g), and the SD
+library has to read those again too. With --max-sck HZ, the
+card also corrupts every block it sends faster than that (mp3player -k),
+and the SD clock calibration at startup has to settle under it. Reported
+per run, as JSON:
+
+  - what the readers checked: files, bytes, mismatches and errors
+  - volume lock use: locks, waits and the longest wait and hold
+  - opens by name and the directory entries they read
+  - blocks corrupted, and the ones that failed the CRC check
+  - start tokens garbled, and the bad ones the SD library saw
+  - the SD clock calibration: the SCK kept and the read rate at it
+  - the player's underruns and frames, and Mp3SDTask CPU use
+  - sanitizer reports on stderr (build with make SAN=thread)
+
+Exits with status 1 if a reader saw wrong data or an error, a sanitizer
+reported something, the song did not play, or a corrupted block got
+past the CRC check or a garbled start token was not caught, or with --max-sck the calibration kept no SCK or a
+faster one.
+
+    make -C Host stress
+    Tools/sdstress.py --player Host/build/mp3player --readers 3 --seconds 20
+"""
+
+import argparse
+import json
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import playbench
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SD_TASK = "Mp3SDTask"
+SANITIZER_MARKS = ("WARNING: ThreadSanitizer", "ERROR: AddressSanitizer", "runtime error:")
+
+
+def pattern(seed, size):
+    """The contents of pattern file SDS<seed>.BIN, see StressByte() in simSDStress.c."""
+    words = []
+    for word in range((size + 3) // 4):
+        h = (seed * 0x9E3779B1 ^ word * 0x85EBCA77) & 0xFFFFFFFF
+        h ^= h >> 15
+        h = (h * 0x2C1B3C6D) & 0xFFFFFFFF
+        h ^= h >> 12
+        words.append(h)
+    data = b"".join(w.to_bytes(4, "little") for w in words)
+    return data[:size]
+
+
+def make_patterns(directory, count, rng):
+    """count pattern files from under a block to a few hundred KB."""
+    sizes = [1, 511, 512, 513, 4096 + 7] + [rng.randrange(1, 400 * 1024) for _ in range(max(0, count - 5))]
+    paths = []
+    for seed, size in enumerate(sizes[:count]):
+        path = os.path.join(directory, "SDS%03d.BIN" % seed)
+        with open(path, "wb") as f:
+            f.write(pattern(seed, size))
+        paths.append(path)
+    return paths
+
+
+def make_fillers(directory, count):
+    """count one byte files, FILnnnnn.TXT."""
+    paths = []
+    for n in range(count):
+        path = os.path.join(directory, "FIL%05d.TXT" % n)
+        with open(path, "wb") as f:
+            f.write(b"x")
+        paths.append(path)
+    return paths
+
+
+def run(player, workdir, name, files, readers, seconds, image_args, player_args=()):
+    image = os.path.join(workdir, name + ".img")
+    script = os.path.join(workdir, name + ".touch")
+    report = os.path.join(workdir, name + ".json")
+    subprocess.run([sys.executable, os.path.join(HERE, "mkfatimg.py")] + list(image_args) + [image] + files,
+                   check=True, stdout=subprocess.DEVNULL)
+    playbench.playback_script().write(script)
+    print("sdstress: %s, %d readers (%d s)" % (name, readers, seconds), file=sys.stderr)
+    p = subprocess.run([player, "-s", image, "-t", script, "-j", report, "-d", str(seconds), "-r", str(readers)] +
+                       list(player_args),
+                       stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True, timeout=seconds * 10 + 60)
+    reports = sum(p.stderr.count(mark) for mark in SANITIZER_MARKS)
+    if reports:
+        sys.stderr.write(p.stderr)
+    if p.returncode != 0:
+        sys.exit("sdstress: %s exited with status %d" % (player, p.returncode))
+    with open(report) as f:
+        r = json.load(f)
+    summary = playbench.summarize(name, r)
+    return {
+        "name": name,
+        "stress": r["sd_stress"],
+        "sd_lock": r["sd_lock"],
+        "sd_names": r["sd_names"],
+        "sd_crc": dict(r["sd_crc"], corrupted=r["sd"]["corrupted"], garbled=r["sd"]["garbled"]),
+        "sd_cal": r["sd_cal"],
+        "sanitizer_reports": reports,
+        "underruns": summary["underruns"],
+        "min_fifo": summary["min_fifo"],
+        "frames": summary["frames"],
+        "sd_task_cpu_pct": summary["cpu_pct"].get(SD_TASK, 0),
+        "sd_cache": r["sd_cache"],
+    }
+
+
+def failures(result, max_sck=0):
+    stress = result["stress"]
+    out = []
+    if stress["mismatches"] or stress["errors"]:
+        out.append("%d mismatches, %d errors" % (stress["mismatches"], stress["errors"]))
+    if stress["files"] == 0:
+        out.append("no pattern file read")
+    if result["sanitizer_reports"]:
+        out.append("%d sanitizer reports" % result["sanitizer_reports"])
+    if result["frames"] == 0:
+        out.append("the song did not play")
+    crc = result["sd_crc"]
+    if crc["corrupted"] and (not crc["on"] or crc["errors"] < crc["corrupted"]):
+        out.append("%d blocks corrupted, %d failed the CRC check" % (crc["corrupted"], crc["errors"]))
+    if crc["token_errors"] < crc["garbled"]:
+        out.append("%d start tokens garbled, %d caught" % (crc["garbled"], crc["token_errors"]))
+    cal = result["sd_cal"]
+    if max_sck and not 0 < cal["sck_hz"] <= max_sck:
+        out.append("SD clock calibration kept SCK %d Hz" % cal["sck_hz"])
+    return out
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Concurrent SD readers beside the player on the simulated board")
+    ap.add_argument("--player", default=os.path.join(HERE, "..", "Host", "build-thread", "mp3player"))
+    ap.add_argument("--readers", type=int, default=3, help="reader tasks, see SIM_SD_STRESS_MAX_READERS")
+    ap.add_argument("--files", type=int, default=12, help="pattern files on the card")
+    ap.add_argument("--fillers", type=int, default=0, help="other files ahead of them in the directory")
+    ap.add_argument("--seconds", type=int, default=15, help="length of each run")
+    ap.add_argument("--corrupt", type=int, default=0, metavar="N", help="corrupt every Nth block read")
+    ap.add_argument("--garble", type=int, default=0, metavar="N", help="garble the start token of every Nth block read")
+    ap.add_argument("--max-sck", type=int, default=0, metavar="HZ", help="corrupt every block sent faster")
+    ap.add_argument("--fat", type=int, choices=(16, 32), default=32, help="FAT type of the images")
+    ap.add_argument("--workdir", help="keep the files, images and raw reports here")
+    ap.add_argument("-o", "--output", help="JSON output (default: stdout)")
+    args = ap.parse_args()
+
+    workdir = args.workdir or tempfile.mkdtemp(prefix="sdstress-")
+    os.makedirs(workdir, exist_ok=True)
+    # the song first: the player plays the files in directory order
+    song = playbench.make_corpus(workdir, args.seconds + 5, 64)[0]
+    files = [song] + make_fillers(workdir, args.fillers) + make_patterns(workdir, args.files, random.Random(5))
+
+    runs = []
+    for layout, image_args in (("contiguous", []), ("fragmented", ["--fragment", "1"])):
+        result = run(args.player, workdir, layout, files, args.readers, args.seconds,
+                     ["--fat", str(args.fat)] + image_args,
+                     (["-e", str(args.corrupt)] if args.corrupt else []) +
+                     (["-g", str(args.garble)] if args.garble else []) +
+                     (["-k", str(args.max_sck)] if args.max_sck else []))
+        result["failures"] = failures(result, args.max_sck)
+        runs.append(result)
+
+    result = {"readers": args.readers, "files": args.files, "fillers": args.fillers, "seconds": args.seconds,
+              "fat": args.fat, "corrupt": args.corrupt, "garble": args.garble, "max_sck": args.max_sck, "runs": runs}
+    text = json.dumps(result, indent=2)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text + "\n")
+    else:
+        print(text)
+    failed = [r for r in runs if r["failures"]]
+    for r in failed:
+        print("sdstress: %s: %s" % (r["name"], "; ".join(r["failures"])), file=sys.stderr)
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
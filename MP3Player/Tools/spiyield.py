@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""
+spiyield.py
+
+SPI1 hand-over test on the Linux build: the player streams a song while a
+task fills the LCD over and over (mp3player -y, Host/simSpiYield.c), each
+fill one transaction of more than LCD_SPI_HOLD_MAX bytes. Whenever the MP3
+feeder needs the bus in the middle of a fill, the LCD driver has to yield
+it at the next LCD_SPI_HOLD_MAX byte boundary (PJDF_CTRL_SPI_YIELD_LOCK),
+so the feeder never waits for the LCD much longer than that many bytes
+take at the LCD's SCK: the hold bound. Reported per run, as JSON:
+
+  - the LCD fills, and the MP3 client's waits for the lock the LCD held:
+    how many, the longest and the hold bound when it ended
+  - the most any wait took over the hold bound
+  - SPI1 lock use of the mp3 and lcd clients: contended locks and yields
+  - the player's underruns and frames
+  - sanitizer reports on stderr
+
+Exits with status 1 if the LCD never yielded, the feeder never had to
+wait for it, a wait took more than --slack-us over the hold bound, a
+sanitizer reported something, or the song did not play.
+
+    make -C Host spiyield
+    Tools/spiyield.py --player Host/build/mp3player --seconds 10 --bytes 4096
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import playbench
+import sdstress
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SCREEN_BYTES = 240 * 320 * 2    # SIM_SPI_YIELD_MAX_BYTES
+
+
+def run(player, workdir, name, song, fill_bytes, seconds):
+    image = os.path.join(workdir, name + ".img")
+    script = os.path.join(workdir, name + ".touch")
+    report = os.path.join(workdir, name + ".json")
+    subprocess.run([sys.executable, os.path.join(HERE, "mkfatimg.py"), image, song],
+                   check=True, stdout=subprocess.DEVNULL)
+    playbench.playback_script().write(script)
+    print("spiyield: %s, fills of %d bytes (%d s)" % (name, fill_bytes, seconds), file=sys.stderr)
+    p = subprocess.run([player, "-s", image, "-t", script, "-j", report, "-d", str(seconds), "-y", str(fill_bytes)],
+                       stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True, timeout=seconds * 10 + 60)
+    reports = sum(p.stderr.count(mark) for mark in sdstress.SANITIZER_MARKS)
+    if reports:
+        sys.stderr.write(p.stderr)
+    if p.returncode != 0:
+        sys.exit("spiyield: %s exited with status %d" % (player, p.returncode))
+    with open(report) as f:
+        r = json.load(f)
+    summary = playbench.summarize(name, r)
+    clients = {c["client"]: c for c in r["spi1"]["clients"]}
+    return {
+        "name": name,
+        "spi_yield": r["spi_yield"],
+        "mp3_lock": clients["mp3"],
+        "lcd_lock": clients["lcd"],
+        "sanitizer_reports": reports,
+        "underruns": summary["underruns"],
+        "min_fifo": summary["min_fifo"],
+        "frames": summary["frames"],
+    }
+
+
+def failures(result, slack_us):
+    y = result["spi_yield"]
+    out = []
+    if result["lcd_lock"]["yields"] == 0:
+        out.append("the LCD never yielded the bus")
+    if y["waits"] == 0:
+        out.append("the MP3 feeder never waited for the LCD")
+    elif y["max_over_us"] > slack_us:
+        out.append("a wait for the LCD took %.1f us over the %.1f us hold bound" % (y["max_over_us"], y["hold_bound_us"]))
+    if result["sanitizer_reports"]:
+        out.append("%d sanitizer reports" % result["sanitizer_reports"])
+    if result["frames"] == 0:
+        out.append("the song did not play")
+    return out
+
+
+def main():
+    ap = argparse.ArgumentParser(description="MP3 feeder against LCD fills on SPI1 on the simulated board")
+    ap.add_argument("--player", default=os.path.join(HERE, "..", "Host", "build", "mp3player"))
+    ap.add_argument("--bytes", type=int, action="append",
+                    help="bytes of pixels per fill, repeat for several runs (default: two runs, 1 KB and a screenful)")
+    ap.add_argument("--seconds", type=int, default=10, help="length of each run")
+    ap.add_argument("--slack-us", type=float, default=50.0,
+                    help="how much longer than the hold bound a wait may take (task switches)")
+    ap.add_argument("--workdir", help="keep the song, images and raw reports here")
+    ap.add_argument("-o", "--output", help="JSON output (default: stdout)")
+    args = ap.parse_args()
+
+    workdir = args.workdir or tempfile.mkdtemp(prefix="spiyield-")
+    os.makedirs(workdir, exist_ok=True)
+    song = playbench.make_corpus(workdir, args.seconds + 5, 64)[0]
+
+    runs = []
+    for fill_bytes in args.bytes or [1024, SCREEN_BYTES]:
+        result = run(args.player, workdir, "fill%d" % fill_bytes, song, fill_bytes, args.seconds)
+        result["failures"] = failures(result, args.slack_us)
+        runs.append(result)
+
+    result = {"seconds": args.seconds, "slack_us": args.slack_us, "runs": runs}
+    text = json.dumps(result, indent=2)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text + "\n")
+    else:
+        print(text)
+    failed = [r for r in runs if r["failures"]]
+    for r in failed:
+        print("spiyield: %s: %s" % (r["name"], "; ".join(r["failures"])), file=sys.stderr)
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,25 @@
+/*
+    os_cfg.h (tickbench)
+
+    Uses the application's os_cfg.h, then widens the task table so the
+    benchmark can sweep the task count, and selects the tick algorithm
+    with TICKBENCH_DLY_LIST (set by run.sh).
+*/
+
+#ifndef TICKBENCH_OS_CFG_H
+#define TICKBENCH_OS_CFG_H
+
+#include "../../App/uCOS/os_cfg.h"
+
+#undef  OS_MAX_TASKS
+#define OS_MAX_TASKS            250u
+#undef  OS_LOWEST_PRIO
+#define OS_LOWEST_PRIO          254u
+
+#undef  OS_TICK_DLY_LIST_EN
+#define OS_TICK_DLY_LIST_EN     TICKBENCH_DLY_LIST
+
+#undef  OS_TRACE_EN
+#define OS_TRACE_EN             0u
+
+#endif
@@ -0,0 +1,35 @@
+/*
+    os_cpu.h (tickbench)
+
+    Minimal host port: just enough for the kernel to build and for
+    OSTimeTick() to run single threaded. No context switching.
+*/
+
+#ifndef  OS_CPU_H
+#define  OS_CPU_H
+
+typedef unsigned char  BOOLEAN;
+typedef unsigned char  INT8U;
+typedef signed   char  INT8S;
+typedef unsigned short INT16U;
+typedef signed   short INT16S;
+typedef unsigned int   INT32U;
+typedef signed   int   INT32S;
+typedef float          FP32;
+typedef double         FP64;
+
+typedef unsigned int   OS_STK;
+typedef unsigned int   OS_CPU_SR;
+
+#define  OS_CRITICAL_METHOD   3u
+#define  OS_ENTER_CRITICAL()  {cpu_sr = 0u; (void)cpu_sr;}
+#define  OS_EXIT_CRITICAL()   {(void)cpu_sr;}
+
+#define  OS_STK_GROWTH        1u
+#define  OS_TASK_SW()         OSCtxSw()
+
+void  OSCtxSw                (void);
+void  OSIntCtxSw             (void);
+void  OSStartHighRdy         (void);
+
+#endif
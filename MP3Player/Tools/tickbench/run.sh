@@ -0,0 +1,18 @@
+#!/bin/sh
+# Build tickbench with and without the delayed task delta list and run both.
+# Usage: Tools/tickbench/run.sh [output dir]
+set -e
+HERE=$(cd "$(dirname "$0")" && pwd)
+ROOT="$HERE/../.."
+OUT=${1:-/tmp/tickbench}
+CC=${CC:-gcc}
+mkdir -p "$OUT"
+
+for DLY in 0 1; do
+    $CC -O2 -w -DTICKBENCH_DLY_LIST=${DLY}u \
+        -I"$HERE" -I"$ROOT/App/uCOS" -I"$ROOT/Micrium/Software/uCOS-II/Source" \
+        "$ROOT/Micrium/Software/uCOS-II/Source/ucos_ii.c" "$HERE/tickbench.c" \
+        -o "$OUT/tickbench$DLY"
+    "$OUT/tickbench$DLY"
+    echo
+done
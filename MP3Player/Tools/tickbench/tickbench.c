@@ -0,0 +1,141 @@
+/*
+    tickbench.c
+
+    Host benchmark of OSTimeTick(): time per tick versus number of tasks,
+    with the TCB list scan (OS_TICK_DLY_LIST_EN 0) or the delta list
+    (OS_TICK_DLY_LIST_EN 1). Built and run for both by run.sh.
+
+    The real kernel sources are compiled against a stub port. Every task
+    is "run" by making it OSTCBCur and calling OSTimeDly(), so the delay
+    bookkeeping is exactly what the target executes. Two loads are timed:
+      idle   - every task delayed far in the future, nothing expires
+      period - every task re-delays itself with a period of 5..68 ticks
+    The wakeup count of the periodic load must match between both builds.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ucos_ii.h>
+
+#define BENCH_TICKS   20000u
+#define STK_SIZE      64u
+
+static OS_STK taskStk[OS_MAX_TASKS][STK_SIZE];
+
+// ---- Port stubs ------------------------------------------------------------
+void OSInitHookBegin(void) {}
+void OSInitHookEnd(void) {}
+void OSTaskCreateHook(OS_TCB *ptcb) { (void)ptcb; }
+void OSTaskDelHook(OS_TCB *ptcb) { (void)ptcb; }
+void OSTaskIdleHook(void) {}
+void OSTaskReturnHook(OS_TCB *ptcb) { (void)ptcb; }
+void OSTaskStatHook(void) {}
+void OSTaskSwHook(void) {}
+void OSTCBInitHook(OS_TCB *ptcb) { (void)ptcb; }
+void OSTimeTickHook(void) {}
+void OSCtxSw(void) {}
+void OSIntCtxSw(void) {}
+void OSStartHighRdy(void) {}
+
+OS_STK *OSTaskStkInit(void (*task)(void *p_arg), void *p_arg, OS_STK *ptos, INT16U opt)
+{
+    (void)task; (void)p_arg; (void)opt;
+    return ptos;
+}
+
+static void DummyTask(void *p_arg)
+{
+    (void)p_arg;
+}
+
+// ---- Benchmark ---------------------------------------------------------------
+static double NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Run a task: it calls OSTimeDly() and "blocks"
+static void RunTaskDelay(INT8U prio, INT32U ticks)
+{
+    OSTCBCur = OSTCBPrioTbl[prio];
+    OSPrioCur = prio;
+    OSTimeDly(ticks);
+}
+
+static BOOLEAN IsReady(INT8U prio)
+{
+    OS_TCB *ptcb = OSTCBPrioTbl[prio];
+    return (OSRdyTbl[ptcb->OSTCBY] & ptcb->OSTCBBitX) != 0u;
+}
+
+static INT32U Period(INT8U prio)
+{
+    return 5u + (prio * 7u) % 64u;
+}
+
+static INT32U Bench(INT32U nTasks, BOOLEAN periodic, double *pAvgNs, double *pMaxNs)
+{
+    INT32U i;
+    INT32U t;
+    INT32U wakeups = 0;
+    double total = 0.0;
+    double worst = 0.0;
+
+    OSInit();
+    for (i = 0; i < nTasks; i++)
+    {
+        OSTaskCreate(DummyTask, 0, &taskStk[i][STK_SIZE - 1], (INT8U)(i + 1));
+    }
+    OSRunning = OS_TRUE;
+    for (i = 0; i < nTasks; i++)
+    {
+        RunTaskDelay((INT8U)(i + 1), periodic ? Period((INT8U)(i + 1)) : 0x7FFFFFFFu - i);
+    }
+
+    for (t = 0; t < BENCH_TICKS; t++)
+    {
+        double start = NowNs();
+        OSTimeTick();
+        double ns = NowNs() - start;
+
+        total += ns;
+        if (ns > worst) worst = ns;
+
+        if (periodic)
+        {
+            for (i = 0; i < nTasks; i++)
+            {
+                if (IsReady((INT8U)(i + 1)))
+                {
+                    wakeups++;
+                    RunTaskDelay((INT8U)(i + 1), Period((INT8U)(i + 1)));
+                }
+            }
+        }
+    }
+    *pAvgNs = total / BENCH_TICKS;
+    *pMaxNs = worst;
+    return wakeups;
+}
+
+int main(void)
+{
+    static const INT32U counts[] = {2, 4, 8, 16, 32, 64, 128, 240};
+    INT32U i;
+
+    printf("OS_TICK_DLY_LIST_EN=%u, %u ticks per point\n", (unsigned)OS_TICK_DLY_LIST_EN, BENCH_TICKS);
+    printf("%6s %14s %14s %14s %14s %10s\n", "tasks", "idle avg ns", "idle max ns", "period avg ns", "period max ns", "wakeups");
+    for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+    {
+        double idleAvg, idleMax, perAvg, perMax;
+        INT32U wakeups;
+
+        Bench(counts[i], OS_FALSE, &idleAvg, &idleMax);
+        wakeups = Bench(counts[i], OS_TRUE, &perAvg, &perMax);
+        printf("%6u %14.1f %14.1f %14.1f %14.1f %10u\n", counts[i], idleAvg, idleMax, perAvg, perMax, wakeups);
+    }
+    return 0;
+}
@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+"""
+trace2json.py
+
+Convert a kernel trace dump (shell command "trace dump", see Util/trace.c)
+into Chrome trace event JSON. Open the result in chrome://tracing or
+https://ui.perfetto.dev.
+
+The input may be a raw terminal capture; everything before the "UTRC" magic
+is skipped.
+
+    trace2json.py capture.bin -o trace.json
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = b"UTRC"
+
+# Keep in sync with Util/trace.h
+EVT_TASK_SWITCH = 0x01
+EVT_ISR_ENTER = 0x02
+EVT_ISR_EXIT = 0x03
+EVT_CLOCK = 0x04
+EVT_NAMES = {
+    0x10: "SemPend",
+    0x11: "SemPendBlock",
+    0x12: "SemPost",
+    0x20: "QPend",
+    0x21: "QPendBlock",
+    0x22: "QPost",
+    0x30: "MboxPend",
+    0x31: "MboxPendBlock",
+    0x32: "MboxPost",
+}
+
+# Cortex-M exception numbers worth naming, IRQn = exception - 16
+EXC_NAMES = {
+    11: "SVCall",
+    14: "PendSV",
+    15: "SysTick",
+}
+
+PID = 1
+ISR_TID = 1000
+
+
+def parse(data):
+    start = data.find(MAGIC)
+    if start < 0:
+        raise ValueError("no trace dump found (missing UTRC magic)")
+    pos = start + len(MAGIC)
+    version, event_size, cpu_hz, count, lost = struct.unpack_from("<HHIII", data, pos)
+    pos += 16
+    if version not in (1, 2):
+        raise ValueError("unsupported dump version %d" % version)
+
+    names = {}
+    while True:
+        prio = data[pos]
+        pos += 1
+        if prio == 0xFF:
+            break
+        length = data[pos]
+        pos += 1
+        names[prio] = data[pos:pos + length].decode("ascii", "replace")
+        pos += length
+
+    events = []
+    for _ in range(count):
+        if pos + event_size > len(data):
+            sys.stderr.write("warning: dump truncated after %d events\n" % len(events))
+            break
+        events.append(struct.unpack_from("<IBBH", data, pos))
+        pos += event_size
+    return cpu_hz, lost, names, events
+
+
+def task_name(names, prio):
+    name = names.get(prio)
+    if name and name != "?":
+        return "%s (%d)" % (name, prio)
+    return "prio %d" % prio
+
+
+def exc_name(exc):
+    if exc in EXC_NAMES:
+        return EXC_NAMES[exc]
+    if exc >= 16:
+        return "IRQ%d" % (exc - 16)
+    return "exc%d" % exc
+
+
+def convert(cpu_hz, names, events):
+    out = []
+    us_per_cycle = 1e6 / cpu_hz
+
+    # Time each step at the clock in effect: the 32-bit cycle counter wraps
+    # every 53 s at 80 MHz, and a clock event changes its rate after it
+    stamps = []
+    t = 0.0
+    prev = None
+    for ts, evt, _, arg in events:
+        if prev is not None:
+            t += ((ts - prev) & 0xFFFFFFFF) * us_per_cycle
+        prev = ts
+        stamps.append(t)
+        if evt == EVT_CLOCK and arg:
+            us_per_cycle = 1.0 / arg
+
+    seen = set()
+    running = None
+    run_start = 0.0
+
+    def slice_end(t):
+        if running is not None and t > run_start:
+            out.append({"name": task_name(names, running), "ph": "X", "pid": PID,
+                        "tid": running, "ts": run_start, "dur": t - run_start})
+
+    for (ts, evt, prio, arg), t in zip(events, stamps):
+        seen.add(prio)
+        if running is None:
+            running, run_start = prio, t
+
+        if evt == EVT_TASK_SWITCH:
+            slice_end(t)
+            running, run_start = arg, t
+            seen.add(arg)
+        elif evt == EVT_ISR_ENTER:
+            out.append({"name": exc_name(arg), "ph": "B", "pid": PID, "tid": ISR_TID, "ts": t})
+        elif evt == EVT_ISR_EXIT:
+            out.append({"name": exc_name(arg), "ph": "E", "pid": PID, "tid": ISR_TID, "ts": t})
+        elif evt == EVT_CLOCK:
+            out.append({"name": "Clock %d MHz" % arg, "ph": "i", "s": "g", "pid": PID, "tid": prio, "ts": t})
+        else:
+            name = EVT_NAMES.get(evt, "evt 0x%02x" % evt)
+            out.append({"name": name, "ph": "i", "s": "t", "pid": PID, "tid": prio,
+                        "ts": t, "args": {"event": arg}})
+
+    if stamps:
+        slice_end(stamps[-1])
+
+    out.append({"name": "process_name", "ph": "M", "pid": PID, "args": {"name": "uC/OS-II"}})
+    out.append({"name": "thread_name", "ph": "M", "pid": PID, "tid": ISR_TID,
+                "args": {"name": "Interrupts"}})
+    for prio in sorted(seen):
+        out.append({"name": "thread_name", "ph": "M", "pid": PID, "tid": prio,
+                    "args": {"name": task_name(names, prio)}})
+        out.append({"name": "thread_sort_index", "ph": "M", "pid": PID, "tid": prio,
+                    "args": {"sort_index": prio}})
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert a uC/OS-II trace dump to Chrome trace JSON")
+    parser.add_argument("dump", help="binary capture of the 'trace dump' shell command")
+    parser.add_argument("-o", "--output", default="-", help="output file (default stdout)")
+    args = parser.parse_args()
+
+    with open(args.dump, "rb") as f:
+        cpu_hz, lost, names, events = parse(f.read())
+
+    trace = {
+        "traceEvents": convert(cpu_hz, names, events),
+        "displayTimeUnit": "ns",
+        "otherData": {"cpuHz": cpu_hz, "events": len(events), "lost": lost},
+    }
+    if args.output == "-":
+        json.dump(trace, sys.stdout)
+    else:
+        with open(args.output, "w") as f:
+            json.dump(trace, f)
+    sys.stderr.write("%d events, %d lost, %d Hz\n" % (len(events), lost, cpu_hz))
+
+
+if __name__ == "__main__":
+    main()
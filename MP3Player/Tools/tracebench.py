@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""
+tracebench.py
+
+Cost of the kernel trace recorder (Util/trace.c) on the Linux build made
+with make TRACE=1, which compiles uC/OS-II's trace hooks in. The player
+times TraceRecord() before the kernel starts and reports, per run, how many
+events the hooks recorded, so the share of the CPU they take is events per
+second times the cost of one. Reported per run, as JSON:
+
+  - the events recorded, per second, the cost of one and the CPU share
+  - of the events still in the buffer: ISR entries, the ones tagged with
+    the SysTick exception number, and task switches
+  - the player's underruns and frames
+  - sanitizer reports on stderr
+
+Runs plain playback and the ui_load touch storm. Exits with status 1 if
+the recorder took --max-pct of the CPU or more, recorded no ISR entries or
+ISR entries not tagged as SysTick (the host's __get_IPSR() is the tick
+handler's exception number while it runs), a sanitizer reported
+something, or the song did not play.
+
+    make -C Host tracebench
+    Tools/tracebench.py --player Host/build-trace/mp3player --seconds 30
+"""
+
+import argparse
+import json
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import playbench
+import sdstress
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+def run(player, workdir, name, song, touches, seconds):
+    image = os.path.join(workdir, name + ".img")
+    script = os.path.join(workdir, name + ".touch")
+    report = os.path.join(workdir, name + ".json")
+    subprocess.run([sys.executable, os.path.join(HERE, "mkfatimg.py"), image, song],
+                   check=True, stdout=subprocess.DEVNULL)
+    touches.write(script)
+    print("tracebench: %s (%d s)" % (name, seconds), file=sys.stderr)
+    p = subprocess.run([player, "-s", image, "-t", script, "-j", report, "-d", str(seconds)],
+                       stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True, timeout=seconds * 10 + 60)
+    reports = sum(p.stderr.count(mark) for mark in sdstress.SANITIZER_MARKS)
+    if reports:
+        sys.stderr.write(p.stderr)
+    if p.returncode != 0:
+        sys.exit("tracebench: %s exited with status %d" % (player, p.returncode))
+    with open(report) as f:
+        r = json.load(f)
+    if "trace" not in r:
+        sys.exit("tracebench: %s was not built with make TRACE=1" % player)
+    summary = playbench.summarize(name, r)
+    return {
+        "name": name,
+        "trace": r["trace"],
+        "sanitizer_reports": reports,
+        "underruns": summary["underruns"],
+        "frames": summary["frames"],
+    }
+
+
+def failures(result, max_pct):
+    t = result["trace"]
+    out = []
+    if t["cpu_pct"] >= max_pct:
+        out.append("the recorder took %.3f%% of the CPU" % t["cpu_pct"])
+    if t["isr_enters"] == 0:
+        out.append("no ISR entries recorded")
+    elif t["isr_systick"] != t["isr_enters"]:
+        out.append("%d of %d ISR entries not tagged as SysTick" % (t["isr_enters"] - t["isr_systick"], t["isr_enters"]))
+    if result["sanitizer_reports"]:
+        out.append("%d sanitizer reports" % result["sanitizer_reports"])
+    if result["frames"] == 0:
+        out.append("the song did not play")
+    return out
+
+
+def main():
+    ap = argparse.ArgumentParser(description="kernel trace recorder overhead on the simulated board")
+    ap.add_argument("--player", default=os.path.join(HERE, "..", "Host", "build-trace", "mp3player"))
+    ap.add_argument("--seconds", type=int, default=30, help="length of each run")
+    ap.add_argument("--max-pct", type=float, default=2.0, help="largest share of the CPU the recorder may take")
+    ap.add_argument("--seed", type=int, default=1, help="seed of the ui_load touches")
+    ap.add_argument("--workdir", help="keep the song, images and raw reports here")
+    ap.add_argument("-o", "--output", help="JSON output (default: stdout)")
+    args = ap.parse_args()
+
+    workdir = args.workdir or tempfile.mkdtemp(prefix="tracebench-")
+    os.makedirs(workdir, exist_ok=True)
+    song = playbench.make_corpus(workdir, args.seconds + 5, 64)[0]
+
+    runs = []
+    for name, touches in (("playback", playbench.playback_script()),
+                          ("ui_load", playbench.ui_load_script(random.Random(args.seed)))):
+        result = run(args.player, workdir, name, song, touches, args.seconds)
+        result["failures"] = failures(result, args.max_pct)
+        runs.append(result)
+
+    result = {"seconds": args.seconds, "max_pct": args.max_pct, "runs": runs}
+    text = json.dumps(result, indent=2)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text + "\n")
+    else:
+        print(text)
+    failed = [r for r in runs if r["failures"]]
+    for r in failed:
+        print("tracebench: %s: %s" % (r["name"], "; ".join(r["failures"])), file=sys.stderr)
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,213 @@
+/*
+    critmeas.c
+
+    Interrupts disabled time measurement for OS_ENTER_CRITICAL(), see
+    critmeas.h.
+
+    CritMeasEnter()/CritMeasExit() run with interrupts already disabled, so
+    the bookkeeping needs no locking of its own. Sites are linked into the
+    report list the first time they complete.
+*/
+
+#include "bsp.h"
+#include "print.h"
+
+#if OS_CRITICAL_MEAS_EN > 0u
+
+#define CRIT_PRINT_MAX_SITES 16
+
+static INT32U critNesting;
+static INT32U critStart;
+static CritSite_t *pCritCur;
+static CritSite_t *pCritList;
+static INT32U critHist[CRIT_HIST_BUCKETS];
+
+
+void CritMeasEnter(CritSite_t *pSite)
+{
+    if (critNesting++ == 0)
+    {
+        pCritCur = pSite;
+        critStart = CYCLE_COUNT();
+    }
+}
+
+// Cycles to nanoseconds at the current clock, in 32 bits: to the
+// nanosecond below 53 ms at 80 MHz
+static INT32U CritNs(INT32U cycles)
+{
+    INT32U mhz = SystemCoreClock / 1000000u;
+
+    if (cycles <= 0xFFFFFFFFu / 1000u) return cycles * 1000u / mhz;
+    return cycles / mhz * 1000u;
+}
+
+void CritMeasExit(void)
+{
+    INT32U ns;
+    CritSite_t *pSite;
+
+    if (critNesting == 0 || --critNesting != 0) return;
+
+    ns = CritNs(CYCLE_COUNT() - critStart);
+    pSite = pCritCur;
+    if (!pSite->registered)
+    {
+        pSite->registered = OS_TRUE;
+        pSite->pNext = pCritList;
+        pCritList = pSite;
+    }
+    pSite->count++;
+    pSite->totalNs += ns;
+    if (ns > pSite->maxNs)
+    {
+        pSite->maxNs = ns;
+        pSite->maxPrio = OSPrioCur;
+    }
+    critHist[ns == 0 ? 0 : 31 - __CLZ(ns)]++;
+}
+
+/*
+ NAME:
+   CritMeasSave, CritMeasLoad
+ PURPOSE:
+   Take the section being timed off the CPU when a task is switched out
+   inside it, and put it back when the task is switched in. On the target
+   the switch waits for OS_EXIT_CRITICAL(); the POSIX port switches at
+   OS_TASK_SW() and would otherwise time the other tasks' run as part of
+   the section, and leave the nesting count to a task that never entered
+   it.
+ PARAMETERS:
+   pCtx: the switched task's context, zeroed for a new task
+ RETURN:
+   none
+ */
+void CritMeasSave(CritMeasCtx_t *pCtx)
+{
+    pCtx->nesting = critNesting;
+    pCtx->cycles = CYCLE_COUNT() - critStart;
+    pCtx->pSite = pCritCur;
+    critNesting = 0;
+}
+
+void CritMeasLoad(const CritMeasCtx_t *pCtx)
+{
+    critNesting = pCtx->nesting;
+    critStart = CYCLE_COUNT() - pCtx->cycles;
+    pCritCur = pCtx->pSite;
+}
+
+// Clear the histogram and every site's statistics
+void CritMeasReset(void)
+{
+    OS_CPU_SR cpu_sr;
+    CritSite_t *pSite;
+    INT32U i;
+
+    OS_ENTER_CRITICAL();
+    for (i = 0; i < CRIT_HIST_BUCKETS; i++) critHist[i] = 0;
+    for (pSite = pCritList; pSite != 0; pSite = pSite->pNext)
+    {
+        pSite->count = 0;
+        pSite->totalNs = 0;
+        pSite->maxNs = 0;
+        pSite->maxPrio = 0;
+    }
+    OS_EXIT_CRITICAL();
+}
+
+/*
+ NAME:
+   CritMeasWorst
+ PURPOSE:
+   Find the call sites with the longest worst case interrupts disabled
+   time, e.g. for the shell or the Linux build's report.
+ PARAMETERS:
+   ppSites: set to the sites, worst first
+   maxSites: how many fit there
+ RETURN:
+   the number of sites found
+ */
+INT32U CritMeasWorst(CritSite_t **ppSites, INT32U maxSites)
+{
+    CritSite_t *pSite;
+    INT32U nTop = 0;
+    INT32U i;
+    INT32U j;
+
+    for (pSite = pCritList; pSite != 0; pSite = pSite->pNext)
+    {
+        for (i = 0; i < nTop && ppSites[i]->maxNs >= pSite->maxNs; i++);
+        if (i >= maxSites) continue;
+        if (nTop < maxSites) nTop++;
+        for (j = nTop - 1; j > i; j--) ppSites[j] = ppSites[j - 1];
+        ppSites[i] = pSite;
+    }
+    return nTop;
+}
+
+// Copy the CRIT_HIST_BUCKETS counts of the duration histogram. Like
+// CritMeasPrint(), without a critical section of its own, which would be
+// measured too.
+void CritMeasHistogram(INT32U *pCounts)
+{
+    INT32U i;
+
+    for (i = 0; i < CRIT_HIST_BUCKETS; i++) pCounts[i] = critHist[i];
+}
+
+static const char *CritBaseName(const char *path)
+{
+    const char *p = path;
+
+    for (; *path; path++)
+    {
+        if (*path == '/' || *path == '\\') p = path + 1;
+    }
+    return p;
+}
+
+/*
+ NAME:
+   CritMeasPrint
+ PURPOSE:
+   Print the duration histogram and the call sites with the longest worst
+   case interrupts disabled time to the UART.
+ PARAMETERS:
+   maxSites: number of sites to list (at most CRIT_PRINT_MAX_SITES)
+ RETURN:
+   none
+ */
+void CritMeasPrint(INT8U maxSites)
+{
+    char buf[PRINTBUFMAX];
+    CritSite_t *top[CRIT_PRINT_MAX_SITES];
+    CritSite_t *pSite;
+    INT32U nTop;
+    INT32U i;
+
+    if (maxSites > CRIT_PRINT_MAX_SITES) maxSites = CRIT_PRINT_MAX_SITES;
+
+    PrintString("Critical section length histogram (ns)\n");
+    for (i = 0; i < CRIT_HIST_BUCKETS; i++)
+    {
+        if (critHist[i] == 0) continue;
+        PrintWithBuf(buf, sizeof(buf), "  >= %10u (%7u us): %u\n",
+                     1u << i, (1u << i) / 1000u, critHist[i]);
+    }
+
+    nTop = CritMeasWorst(top, maxSites);
+
+    PrintString("Worst call sites: max us, avg us, count, prio at max, location\n");
+    for (i = 0; i < nTop; i++)
+    {
+        pSite = top[i];
+        PrintWithBuf(buf, sizeof(buf), "  %7u %7u %9u %3u  %s:%u\n",
+                     pSite->maxNs / 1000u,
+                     pSite->count ? (INT32U)(pSite->totalNs / pSite->count / 1000u) : 0,
+                     pSite->count, pSite->maxPrio,
+                     CritBaseName(pSite->file), pSite->line);
+    }
+}
+
+#endif // OS_CRITICAL_MEAS_EN
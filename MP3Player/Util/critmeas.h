@@ -0,0 +1,64 @@
+/*
+    critmeas.h
+
+    Interrupts disabled time measurement for OS_ENTER_CRITICAL().
+
+    With OS_CRITICAL_MEAS_EN set in os_cfg.h, os_cpu.h gives every
+    OS_ENTER_CRITICAL() expansion its own static CritSite_t holding the
+    source location, and brackets the critical section with CritMeasEnter()
+    and CritMeasExit(). Only the outermost section of a nested group is
+    timed; that is the time interrupts (DREQ, SysTick) were held off.
+
+    Durations go into a log2 histogram and each site keeps its count, total
+    and worst case, in nanoseconds: the cycles are converted at the clock
+    in effect when the section ends, as the governor switches between 16
+    and 80 MHz. "crit" in the shell prints them.
+*/
+
+#ifndef __CRITMEAS_H__
+#define __CRITMEAS_H__
+
+#include <stdint.h>
+#include <os_cpu.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CRIT_HIST_BUCKETS 32    // bucket n counts durations in [2^n, 2^(n+1)) ns
+
+typedef struct _CritSite
+{
+    const char *file;
+    INT32U line;
+    INT32U count;
+    uint64_t totalNs;
+    INT32U maxNs;
+    INT8U maxPrio;              // task running when maxNs was seen
+    BOOLEAN registered;
+    struct _CritSite *pNext;
+} CritSite_t;
+
+// Section a task was switched out in, kept by ports that switch inside
+// OS_ENTER_CRITICAL() (the POSIX port), see CritMeasSave()
+typedef struct _CritMeasCtx
+{
+    INT32U nesting;
+    INT32U cycles;              // spent in the section so far
+    CritSite_t *pSite;
+} CritMeasCtx_t;
+
+void CritMeasEnter(CritSite_t *pSite);
+void CritMeasExit(void);
+void CritMeasSave(CritMeasCtx_t *pCtx);
+void CritMeasLoad(const CritMeasCtx_t *pCtx);
+void CritMeasReset(void);
+void CritMeasPrint(INT8U maxSites);
+INT32U CritMeasWorst(CritSite_t **ppSites, INT32U maxSites);
+void CritMeasHistogram(INT32U *pCounts);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CRITMEAS_H__ */
@@ -50,7 +50,7 @@ char *p = &buffer[BUFFER_LENGTH - 1];
     PrintString(p);
 }
 //
-void PrintString(char *ptr) {
+void PrintString(const char *ptr) {
 
   if (ptr==0 || *ptr==0) return;
 
@@ -67,7 +67,7 @@ void PrintString(char *ptr) {
 // Prints a string using the given PrintChar() function which implements
 // the necessary code to print the each char of the given string to a 
 // particular device.
-void PrintStringToDevice(void (*PrintCharFunc)(char c), char *ptr) {
+void PrintStringToDevice(void (*PrintCharFunc)(char c), const char *ptr) {
     
   if (ptr==0 || *ptr==0) return;
   if (PrintCharFunc==0) while(1);
@@ -89,7 +89,7 @@ void PrintStringToDevice(void (*PrintCharFunc)(char c), char *ptr) {
    Requires a function to print a character to a desired device to be provided.
 
 ************************************************************************************/
-void PrintToDeviceWithBuf(void (*PrintCharFunc)(char c), char *buf, int size, char *format, va_list args)
+void PrintToDeviceWithBuf(void (*PrintCharFunc)(char c), char *buf, int size, const char *format, va_list args)
 {
     vsnprintf(buf, size, format, args);
     //strncpy(buf, format, size);
@@ -102,7 +102,7 @@ void PrintToDeviceWithBuf(void (*PrintCharFunc)(char c), char *buf, int size, ch
    Each task should use its own buffer to prevent data corruption.
 
 ************************************************************************************/
-void PrintWithBuf(char *buf, int size, char *format, ...)
+void PrintWithBuf(char *buf, int size, const char *format, ...)
 {
     va_list args;
     va_start(args, format);
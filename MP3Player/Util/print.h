@@ -17,12 +17,16 @@
 #include <stdarg.h>
 #include <os_cpu.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 void PrintHex(INT32U u32);
 void Print_uint32(INT32U u);
-void PrintString(char *ptr);
-void PrintStringToDevice(void (*PrintCharFunc)(char c), char *ptr);
-void PrintWithBuf(char *buf, int size, char *format, ...);
-void PrintToDeviceWithBuf(void (*PrintCharFunc)(char c), char *buf, int size, char *format, va_list args);
+void PrintString(const char *ptr);
+void PrintStringToDevice(void (*PrintCharFunc)(char c), const char *ptr);
+void PrintWithBuf(char *buf, int size, const char *format, ...);
+void PrintToDeviceWithBuf(void (*PrintCharFunc)(char c), char *buf, int size, const char *format, va_list args);
 
 //
 // Macros for printing debug messages.
@@ -38,7 +42,11 @@ void PrintToDeviceWithBuf(void (*PrintCharFunc)(char c), char *buf, int size, ch
 #define DEBUGMSG(x,y) \
     ((x) ? (snprintf(stringbuffer, PRINTBUFMAX, _DBG_PRINTX_ARG y), PrintString(stringbuffer)) : (void)(0))
 #else // DEBUG
-    #define DEBUGMSG(x,y) (0)
+    #define DEBUGMSG(x,y) ((void)0)
 #endif // DEBUG
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* __PRINT_H__ */
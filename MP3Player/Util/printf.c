@@ -36,11 +36,12 @@ File: printf.c
 */
 //putchar#include <stdio.h>
 
-#include "printf.h"
 #include "bsp.h"
+#include "printf.h"
 
-// We modify putchar to deposit chars in a buffer instead of a serial device
-void putchar(char *userBuf, unsigned int *i, const unsigned int size, char c) {
+// We modify putchar to deposit chars in a buffer instead of a serial device;
+// renamed from putchar, which stdio.h declares
+static void tfp_putchar(char *userBuf, unsigned int *i, const unsigned int size, char c) {
     if (*i < size) {
         userBuf[(*i)++] = c;
     }
@@ -88,7 +89,7 @@ void tfp_vsnprintf(char *userBuf, unsigned int size, char *fmt, va_list va)
 	
 	while ((ch=*(fmt++))) {
 		if (ch!='%') {
-			putchar(userBuf, &bufPos, size, ch);
+			tfp_putchar(userBuf, &bufPos, size, ch);
 			}
 		else {
 			char lz=0;
@@ -149,9 +150,9 @@ void tfp_vsnprintf(char *userBuf, unsigned int size, char *fmt, va_list va)
 			while (*bf++ && w > 0)
 				w--;
 			while (w-- > 0) 
-				putchar(userBuf, &bufPos, size, lz ? '0' : ' ');
+				tfp_putchar(userBuf, &bufPos, size, lz ? '0' : ' ');
 			while ((ch= *p++))
-				putchar(userBuf, &bufPos, size, ch);
+				tfp_putchar(userBuf, &bufPos, size, ch);
 			}
 		}
 	abort:;
@@ -85,10 +85,18 @@ regs Kusti, 26.2.2008
 
 #include <stdarg.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 void tfp_vsnprintf(char *buf, unsigned int size, char *fmt, va_list args);
 
 #define vsnprintf tfp_vsnprintf 
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
 
 
@@ -0,0 +1,210 @@
+/*
+    trace.c
+
+    Low overhead kernel event recorder, see trace.h.
+
+    Each event costs one critical section, a DWT->CYCCNT read and an 8 byte
+    store, a few tens of cycles. At the event rates the player produces
+    (1000 ticks/s plus task switches and mailbox traffic) that is well under
+    1% of the CPU at 80 MHz.
+
+    Dump format (little endian):
+        char   magic[4]     "UTRC"
+        INT16U version
+        INT16U eventSize    sizeof(TraceEvent_t)
+        INT32U cpuHz        DWT->CYCCNT rate at the oldest event; each
+                            TRACE_EVT_CLOCK event changes it from there on
+        INT32U count        number of events that follow
+        INT32U lost         events overwritten before the dump
+        task names          repeated { INT8U prio; INT8U len; char name[len]; },
+                            terminated by prio 0xFF
+        TraceEvent_t events[count], oldest first
+*/
+
+#include "bsp.h"
+#include "print.h"
+
+#if OS_TRACE_EN > 0u
+
+#if (APP_CFG_TRACE_BUF_SIZE & (APP_CFG_TRACE_BUF_SIZE - 1u)) != 0u
+#error "APP_CFG_TRACE_BUF_SIZE must be a power of 2"
+#endif
+
+#define TRACE_BUF_MASK (APP_CFG_TRACE_BUF_SIZE - 1u)
+#define TRACE_NAME_END 0xFF
+
+static TraceEvent_t traceBuf[APP_CFG_TRACE_BUF_SIZE];
+static INT32U traceHead;        // total number of events recorded
+static INT32U traceFirstHz;     // HCLK at the oldest event in the buffer
+static BOOLEAN traceRunning;
+
+
+/*
+ NAME:
+   TraceInit
+ PURPOSE:
+   Clear the ring buffer and start recording. Called from OSInit() through
+   OS_TRACE_INIT(); the cycle counter is already running (Hw_init()).
+ */
+void TraceInit(void)
+{
+    traceHead = 0;
+    traceFirstHz = SystemCoreClock;
+    traceRunning = OS_TRUE;
+}
+
+void TraceStart(void)
+{
+    traceRunning = OS_TRUE;
+}
+
+void TraceStop(void)
+{
+    traceRunning = OS_FALSE;
+}
+
+/*
+ NAME:
+   TraceRecord
+ PURPOSE:
+   Append one event to the ring buffer, overwriting the oldest one when full.
+   Safe to call from tasks, ISRs and with interrupts already disabled.
+ PARAMETERS:
+   event: TRACE_EVT_xxx
+   arg: event specific argument, see trace.h
+ */
+void TraceRecord(INT8U event, INT16U arg)
+{
+    OS_CPU_SR cpu_sr;
+    TraceEvent_t *pEvent;
+
+    if (!traceRunning) return;
+
+    OS_ENTER_CRITICAL();
+    pEvent = &traceBuf[traceHead & TRACE_BUF_MASK];
+    // The clock the next oldest event was stamped at goes with this one
+    if (traceHead >= APP_CFG_TRACE_BUF_SIZE && pEvent->event == TRACE_EVT_CLOCK)
+    {
+        traceFirstHz = pEvent->arg * 1000000u;
+    }
+    traceHead++;
+    pEvent->timestamp = CYCLE_COUNT();
+    pEvent->event = event;
+    pEvent->prio = OSPrioCur;
+    pEvent->arg = arg;
+    OS_EXIT_CRITICAL();
+}
+
+// Record an ISR entry/exit tagged with the active exception number
+void TraceRecordIsr(INT8U event)
+{
+    TraceRecord(event, (INT16U)(__get_IPSR() & 0x1FF));
+}
+
+// Record a system clock switch; ClockSetSpeed() calls it once HCLK changed
+void TraceClock(void)
+{
+    TraceRecord(TRACE_EVT_CLOCK, (INT16U)(SystemCoreClock / 1000000u));
+}
+
+/*
+ NAME:
+   TraceCopy
+ PURPOSE:
+   Copy the newest events in the buffer, oldest of them first, without
+   stopping the recorder, e.g. for the Linux build's report.
+ PARAMETERS:
+   pEvents: where to copy them
+   max: how many fit there
+   pTotal: set to the number of events recorded since TraceInit() or the
+       last TraceDump(), the overwritten ones included
+ RETURNS:
+   the number of events copied
+ */
+INT32U TraceCopy(TraceEvent_t *pEvents, INT32U max, INT32U *pTotal)
+{
+    OS_CPU_SR cpu_sr;
+    INT32U head;
+    INT32U count;
+    INT32U i;
+
+    OS_ENTER_CRITICAL();
+    head = traceHead;
+    count = head < APP_CFG_TRACE_BUF_SIZE ? head : APP_CFG_TRACE_BUF_SIZE;
+    if (count > max) count = max;
+    for (i = 0; i < count; i++)
+    {
+        pEvents[i] = traceBuf[(head - count + i) & TRACE_BUF_MASK];
+    }
+    OS_EXIT_CRITICAL();
+    *pTotal = head;
+    return count;
+}
+
+static void TraceSend(const void *pData, INT32U size)
+{
+    const char *p = (const char *)pData;
+
+    while (size--) PrintByte(*p++);
+}
+
+static void TraceSendNames(void)
+{
+    INT8U prio;
+    INT8U len;
+    OS_TCB *ptcb;
+
+    for (prio = 0; prio <= OS_LOWEST_PRIO; prio++)
+    {
+        ptcb = OSTCBPrioTbl[prio];
+        if (ptcb == (OS_TCB *)0 || ptcb == OS_TCB_RESERVED) continue;
+        len = (INT8U)strlen((char *)ptcb->OSTCBTaskName);
+        TraceSend(&prio, sizeof(prio));
+        TraceSend(&len, sizeof(len));
+        TraceSend(ptcb->OSTCBTaskName, len);
+    }
+    prio = TRACE_NAME_END;
+    TraceSend(&prio, sizeof(prio));
+}
+
+/*
+ NAME:
+   TraceDump
+ PURPOSE:
+   Send the recorded events out the UART in the binary format described at
+   the top of this file. Recording is paused while the dump is in progress
+   so the dump does not trace itself, then resumed where it was.
+ */
+void TraceDump(void)
+{
+    BOOLEAN wasRunning = traceRunning;
+    INT16U version = TRACE_DUMP_VERSION;
+    INT16U eventSize = sizeof(TraceEvent_t);
+    INT32U cpuHz = traceFirstHz;
+    INT32U count;
+    INT32U lost;
+    INT32U i;
+
+    TraceStop();
+
+    count = traceHead < APP_CFG_TRACE_BUF_SIZE ? traceHead : APP_CFG_TRACE_BUF_SIZE;
+    lost = traceHead - count;
+
+    TraceSend(TRACE_DUMP_MAGIC, 4);
+    TraceSend(&version, sizeof(version));
+    TraceSend(&eventSize, sizeof(eventSize));
+    TraceSend(&cpuHz, sizeof(cpuHz));
+    TraceSend(&count, sizeof(count));
+    TraceSend(&lost, sizeof(lost));
+    TraceSendNames();
+    for (i = 0; i < count; i++)
+    {
+        TraceSend(&traceBuf[(lost + i) & TRACE_BUF_MASK], sizeof(TraceEvent_t));
+    }
+
+    traceHead = 0;
+    traceFirstHz = SystemCoreClock;
+    if (wasRunning) TraceStart();
+}
+
+#endif // OS_TRACE_EN
@@ -0,0 +1,85 @@
+/*
+    trace.h
+
+    Low overhead kernel event recorder.
+
+    Events are stamped with the DWT cycle counter and stored in a RAM ring
+    buffer (APP_CFG_TRACE_BUF_SIZE entries, oldest overwritten first).
+    The counter runs at HCLK, so ClockSetSpeed() records every switch as a
+    TRACE_EVT_CLOCK event and the events after it are timed at the new rate.
+    TraceDump() sends the buffer out the UART in binary; Tools/trace2json.py
+    turns the dump into Chrome/Perfetto trace JSON.
+
+    Enabled by OS_TRACE_EN in os_cfg.h. ucos_ii.h includes this file and
+    the OS_TRACE_xxx() macros below are the kernel's trace points. With
+    OS_TRACE_EN set to 0 they are empty and nothing here is linked in.
+*/
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <os_cpu.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Event ids. Keep in sync with Tools/trace2json.py
+#define TRACE_EVT_TASK_SWITCH       0x01   // arg: prio of the task switched in
+#define TRACE_EVT_ISR_ENTER         0x02   // arg: active exception number
+#define TRACE_EVT_ISR_EXIT          0x03   // arg: active exception number
+#define TRACE_EVT_CLOCK             0x04   // arg: HCLK in MHz, the timestamp rate from here on
+#define TRACE_EVT_SEM_PEND          0x10   // arg for the rest: OSEventTbl index
+#define TRACE_EVT_SEM_PEND_BLOCK    0x11
+#define TRACE_EVT_SEM_POST          0x12
+#define TRACE_EVT_Q_PEND            0x20
+#define TRACE_EVT_Q_PEND_BLOCK      0x21
+#define TRACE_EVT_Q_POST            0x22
+#define TRACE_EVT_MBOX_PEND         0x30
+#define TRACE_EVT_MBOX_PEND_BLOCK   0x31
+#define TRACE_EVT_MBOX_POST         0x32
+
+// Dump header values
+#define TRACE_DUMP_MAGIC            "UTRC"
+#define TRACE_DUMP_VERSION          2
+
+// One recorded event, 8 bytes
+typedef struct _TraceEvent
+{
+    INT32U timestamp;   // DWT->CYCCNT, at the HCLK of the last TRACE_EVT_CLOCK
+    INT8U  event;       // TRACE_EVT_xxx
+    INT8U  prio;        // OSPrioCur when the event was recorded
+    INT16U arg;
+} TraceEvent_t;
+
+void TraceInit(void);
+void TraceStart(void);
+void TraceStop(void);
+void TraceRecord(INT8U event, INT16U arg);
+void TraceRecordIsr(INT8U event);
+void TraceClock(void);
+void TraceDump(void);
+INT32U TraceCopy(TraceEvent_t *pEvents, INT32U max, INT32U *pTotal);
+
+// Kernel trace points
+#define TRACE_EVENT_INDEX(pevent)           ((INT16U)((pevent) - OSEventTbl))
+
+#define OS_TRACE_INIT()                     TraceInit()
+#define OS_TRACE_TASK_SWITCHED_IN(ptcb)     TraceRecord(TRACE_EVT_TASK_SWITCH, (ptcb)->OSTCBPrio)
+#define OS_TRACE_ISR_ENTER()                TraceRecordIsr(TRACE_EVT_ISR_ENTER)
+#define OS_TRACE_ISR_EXIT()                 TraceRecordIsr(TRACE_EVT_ISR_EXIT)
+#define OS_TRACE_SEM_PEND(pevent)           TraceRecord(TRACE_EVT_SEM_PEND, TRACE_EVENT_INDEX(pevent))
+#define OS_TRACE_SEM_PEND_BLOCK(pevent)     TraceRecord(TRACE_EVT_SEM_PEND_BLOCK, TRACE_EVENT_INDEX(pevent))
+#define OS_TRACE_SEM_POST(pevent)           TraceRecord(TRACE_EVT_SEM_POST, TRACE_EVENT_INDEX(pevent))
+#define OS_TRACE_Q_PEND(pevent)             TraceRecord(TRACE_EVT_Q_PEND, TRACE_EVENT_INDEX(pevent))
+#define OS_TRACE_Q_PEND_BLOCK(pevent)       TraceRecord(TRACE_EVT_Q_PEND_BLOCK, TRACE_EVENT_INDEX(pevent))
+#define OS_TRACE_Q_POST(pevent)             TraceRecord(TRACE_EVT_Q_POST, TRACE_EVENT_INDEX(pevent))
+#define OS_TRACE_MBOX_PEND(pevent)          TraceRecord(TRACE_EVT_MBOX_PEND, TRACE_EVENT_INDEX(pevent))
+#define OS_TRACE_MBOX_PEND_BLOCK(pevent)    TraceRecord(TRACE_EVT_MBOX_PEND_BLOCK, TRACE_EVENT_INDEX(pevent))
+#define OS_TRACE_MBOX_POST(pevent)          TraceRecord(TRACE_EVT_MBOX_POST, TRACE_EVENT_INDEX(pevent))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TRACE_H__ */